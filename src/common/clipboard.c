@@ -26,9 +26,20 @@
 #include <guacamole/string.h>
 #include <guacamole/user.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 
+/**
+ * The offset basis of the 64-bit FNV-1a hash.
+ */
+#define GUAC_COMMON_CLIPBOARD_FNV_OFFSET 0xCBF29CE484222325ULL
+
+/**
+ * The prime of the 64-bit FNV-1a hash.
+ */
+#define GUAC_COMMON_CLIPBOARD_FNV_PRIME 0x100000001B3ULL
+
 guac_common_clipboard* guac_common_clipboard_alloc(int buffer_size) {
 
     guac_common_clipboard* clipboard = guac_mem_alloc(sizeof(guac_common_clipboard));
@@ -38,6 +49,7 @@ guac_common_clipboard* guac_common_clipboard_alloc(int buffer_size) {
     clipboard->buffer = guac_mem_alloc(buffer_size);
     clipboard->available = buffer_size;
     clipboard->length = 0;
+    clipboard->broadcast_hash_valid = 0;
 
     pthread_mutex_init(&(clipboard->lock), NULL);
 
@@ -120,14 +132,69 @@ static void* __send_user_clipboard(guac_user* user, void* data) {
 
 }
 
+/**
+ * Continues the 64-bit FNV-1a hash of the given hash value over the given
+ * data.
+ *
+ * @param hash
+ *     The hash value produced thus far, or GUAC_COMMON_CLIPBOARD_FNV_OFFSET
+ *     if no data has yet been hashed.
+ *
+ * @param data
+ *     The data to hash.
+ *
+ * @param length
+ *     The number of bytes of data to hash.
+ *
+ * @return
+ *     The hash value resulting from hashing the given data.
+ */
+static uint64_t guac_common_clipboard_hash(uint64_t hash,
+        const char* data, int length) {
+
+    const unsigned char* current = (const unsigned char*) data;
+    for (int i = 0; i < length; i++) {
+        hash ^= current[i];
+        hash *= GUAC_COMMON_CLIPBOARD_FNV_PRIME;
+    }
+
+    return hash;
+
+}
+
 void guac_common_clipboard_send(guac_common_clipboard* clipboard, guac_client* client) {
 
     pthread_mutex_lock(&(clipboard->lock));
 
+    /* Hash mimetype (including null terminator) and contents together */
+    uint64_t hash = guac_common_clipboard_hash(GUAC_COMMON_CLIPBOARD_FNV_OFFSET,
+            clipboard->mimetype, strlen(clipboard->mimetype) + 1);
+    hash = guac_common_clipboard_hash(hash, clipboard->buffer,
+            clipboard->length);
+
+    /* Do not resend contents that all users already have */
+    if (clipboard->broadcast_hash_valid && clipboard->broadcast_hash == hash) {
+        guac_client_log(client, GUAC_LOG_DEBUG, "Clipboard contents are "
+                "unchanged. Skipping broadcast.");
+        pthread_mutex_unlock(&(clipboard->lock));
+        return;
+    }
+
     guac_client_log(client, GUAC_LOG_DEBUG, "Broadcasting clipboard to all connected users.");
     guac_client_foreach_user(client, __send_user_clipboard, clipboard);
     guac_client_log(client, GUAC_LOG_DEBUG, "Broadcast of clipboard complete.");
 
+    clipboard->broadcast_hash = hash;
+    clipboard->broadcast_hash_valid = 1;
+
+    pthread_mutex_unlock(&(clipboard->lock));
+
+}
+
+void guac_common_clipboard_invalidate(guac_common_clipboard* clipboard) {
+
+    pthread_mutex_lock(&(clipboard->lock));
+    clipboard->broadcast_hash_valid = 0;
     pthread_mutex_unlock(&(clipboard->lock));
 
 }
@@ -22,6 +22,7 @@
 
 #include <guacamole/client.h>
 #include <pthread.h>
+#include <stdint.h>
 
 /**
  * The maximum number of bytes to send in an individual blob when
@@ -73,6 +74,19 @@ typedef struct guac_common_clipboard {
      */
     int available;
 
+    /**
+     * Hash of the mimetype and contents of the clipboard as of the last time
+     * the clipboard was broadcast to all connected users. This value is only
+     * meaningful if broadcast_hash_valid is non-zero.
+     */
+    uint64_t broadcast_hash;
+
+    /**
+     * Non-zero if broadcast_hash reflects the clipboard contents that all
+     * connected users are known to have received, zero otherwise.
+     */
+    int broadcast_hash_valid;
+
 } guac_common_clipboard;
 
 /**
@@ -93,7 +107,10 @@ void guac_common_clipboard_free(guac_common_clipboard* clipboard);
 
 /**
  * Sends the contents of the clipboard along the given client, splitting
- * the contents as necessary.
+ * the contents as necessary. If the contents of the clipboard are identical
+ * to those most recently broadcast, and the clipboard has not since been
+ * invalidated with guac_common_clipboard_invalidate(), the contents are not
+ * resent.
  *
  * @param clipboard
  *     The clipboard whose contents should be sent.
@@ -103,6 +120,18 @@ void guac_common_clipboard_free(guac_common_clipboard* clipboard);
  */
 void guac_common_clipboard_send(guac_common_clipboard* clipboard, guac_client* client);
 
+/**
+ * Marks the contents most recently broadcast by guac_common_clipboard_send()
+ * as no longer being known to be held by all connected users, such that the
+ * next call to guac_common_clipboard_send() will broadcast the clipboard
+ * contents regardless of whether they have changed. This function must be
+ * invoked whenever clipboard data is received from a connected user.
+ *
+ * @param clipboard
+ *     The clipboard to invalidate.
+ */
+void guac_common_clipboard_invalidate(guac_common_clipboard* clipboard);
+
 /**
  * Clears the clipboard contents and assigns a new mimetype for future data.
  *
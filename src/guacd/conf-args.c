@@ -33,7 +33,7 @@ int guacd_conf_parse_args(guacd_config* config, int argc, char** argv) {
 
     /* Parse arguments */
     int opt;
-    while ((opt = getopt(argc, argv, "l:b:p:L:C:K:fv")) != -1) {
+    while ((opt = getopt(argc, argv, "l:b:p:M:L:C:K:fv")) != -1) {
 
         /* -l: Bind port */
         if (opt == 'l') {
@@ -63,6 +63,12 @@ int guacd_conf_parse_args(guacd_config* config, int argc, char** argv) {
             config->pidfile = guac_strdup(optarg);
         }
 
+        /* -M: Metrics socket */
+        else if (opt == 'M') {
+            guac_mem_free(config->metrics_socket);
+            config->metrics_socket = guac_strdup(optarg);
+        }
+
         /* -L: Log level */
         else if (opt == 'L') {
 
@@ -106,6 +112,7 @@ int guacd_conf_parse_args(guacd_config* config, int argc, char** argv) {
                     " [-l LISTENPORT]"
                     " [-b LISTENADDRESS]"
                     " [-p PIDFILE]"
+                    " [-M METRICS_SOCKET]"
                     " [-L LEVEL]"
 #ifdef ENABLE_SSL
                     " [-C CERTIFICATE_FILE]"
@@ -73,6 +73,13 @@ static int guacd_conf_callback(const char* section, const char* param, const cha
             return 0;
         }
 
+        /* Metrics socket */
+        else if (strcmp(param, "metrics_socket") == 0) {
+            guac_mem_free(config->metrics_socket);
+            config->metrics_socket = guac_strdup(value);
+            return 0;
+        }
+
         /* Max log level */
         else if (strcmp(param, "log_level") == 0) {
 
@@ -108,6 +115,22 @@ static int guacd_conf_callback(const char* section, const char* param, const cha
             config->key_file = guac_strdup(value);
             return 0;
         }
+
+        /* Kernel TLS */
+        else if (strcmp(param, "kernel_tls") == 0) {
+
+            if (strcmp(value, "true") == 0)
+                config->kernel_tls = 1;
+            else if (strcmp(value, "false") == 0)
+                config->kernel_tls = 0;
+            else {
+                guacd_conf_parse_error = "Invalid value for kernel_tls (must be \"true\" or \"false\")";
+                return 1;
+            }
+
+            return 0;
+
+        }
 #else
         guacd_conf_parse_error = "SSL support not compiled in";
         return 1;
@@ -184,6 +207,7 @@ guacd_config* guacd_conf_load(void) {
     conf->bind_host = guac_strdup(GUACD_DEFAULT_BIND_HOST);
     conf->bind_port = guac_strdup(GUACD_DEFAULT_BIND_PORT);
     conf->pidfile = NULL;
+    conf->metrics_socket = NULL;
     conf->foreground = 0;
     conf->print_version = 0;
     conf->max_log_level = GUAC_LOG_INFO;
@@ -191,6 +215,7 @@ guacd_config* guacd_conf_load(void) {
 #ifdef ENABLE_SSL
     conf->cert_file = NULL;
     conf->key_file = NULL;
+    conf->kernel_tls = 0;
 #endif
 
     /* Read configuration from file */
@@ -54,6 +54,12 @@ typedef struct guacd_config {
      */
     char* pidfile;
 
+    /**
+     * The path of the UNIX domain socket on which connection metrics should
+     * be served, if any.
+     */
+    char* metrics_socket;
+
     /**
      * Whether guacd should run in the foreground.
      */
@@ -74,6 +80,13 @@ typedef struct guacd_config {
      * SSL private key file.
      */
     char* key_file;
+
+    /**
+     * Whether encryption of SSL/TLS connections should be offloaded to the
+     * kernel (kTLS) where supported. Non-zero if kernel TLS should be used,
+     * zero otherwise.
+     */
+    int kernel_tls;
 #endif
 
     /**
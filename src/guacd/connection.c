@@ -39,6 +39,7 @@
 #endif
 
 #include <errno.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -133,6 +134,31 @@ static void* guacd_connection_write_thread(void* data) {
 
 }
 
+/**
+ * Returns whether data is immediately available for reading from the given
+ * file descriptor, without blocking.
+ *
+ * @param fd
+ *     The file descriptor to check.
+ *
+ * @return
+ *     Non-zero if data can be read from the given file descriptor without
+ *     blocking, zero otherwise.
+ */
+static int guacd_connection_data_pending(int fd) {
+
+    struct pollfd fds[] = {{
+        .fd      = fd,
+        .events  = POLLIN,
+        .revents = 0
+    }};
+
+    int retval;
+    GUAC_RETRY_EINTR(retval, poll(fds, 1, 0));
+    return retval > 0;
+
+}
+
 void* guacd_connection_io_thread(void* data) {
 
     /* Thread name conn-read: forwards data from the connection's child
@@ -156,7 +182,12 @@ void* guacd_connection_io_thread(void* data) {
 
         if (guac_socket_write(params->socket, buffer, length))
             break;
-        guac_socket_flush(params->socket);
+
+        /* Flush only once all immediately-available data has been written,
+         * such that bursts of output are sent as few large writes (and, for
+         * SSL/TLS, as few large records) rather than many small ones */
+        if (length < sizeof(buffer) || !guacd_connection_data_pending(params->fd))
+            guac_socket_flush(params->socket);
     }
 
     /* Wait for write thread to die */
@@ -363,12 +394,9 @@ static int guacd_route_connection(guacd_proc_map* map, guac_socket* socket) {
         /* Force process to stop and clean up */
         guacd_proc_stop(proc);
 
-        /* Free skeleton client */
-        guac_client_free(proc->client);
-
         /* Clean up */
         close(proc->fd_socket);
-        guac_mem_free(proc);
+        guacd_proc_free(proc);
 
     }
 
@@ -403,6 +431,13 @@ void* guacd_connection_thread(void* data) {
             guac_mem_free(params);
             return NULL;
         }
+
+#ifdef SSL_OP_ENABLE_KTLS
+        /* Note whether encryption has been offloaded to the kernel */
+        guac_socket_ssl_data* ssl_data = (guac_socket_ssl_data*) socket->data;
+        if (BIO_get_ktls_send(SSL_get_wbio(ssl_data->ssl)))
+            guacd_log(GUAC_LOG_DEBUG, "Kernel TLS is in use for this connection.");
+#endif
     }
     else
         socket = guac_socket_open(connected_socket_fd);
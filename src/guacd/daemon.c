@@ -22,6 +22,7 @@
 #include "conf-file.h"
 #include "connection.h"
 #include "log.h"
+#include "metrics.h"
 #include "proc-map.h"
 
 #include <guacamole/mem.h>
@@ -472,6 +473,17 @@ int main(int argc, char* argv[]) {
         else
             guacd_log(GUAC_LOG_WARNING, "No certificate file given - SSL/TLS may not work.");
 
+        /* Offload encryption to the kernel if requested */
+        if (config->kernel_tls) {
+#ifdef SSL_OP_ENABLE_KTLS
+            SSL_CTX_set_options(ssl_context, SSL_OP_ENABLE_KTLS);
+            guacd_log(GUAC_LOG_INFO, "Kernel TLS will be used where supported.");
+#else
+            guacd_log(GUAC_LOG_WARNING, "Kernel TLS was requested but is "
+                    "not supported by this build of OpenSSL.");
+#endif
+        }
+
     }
 #endif
 
@@ -504,6 +516,11 @@ int main(int argc, char* argv[]) {
 
     }
 
+    /* Serve connection metrics if requested */
+    if (config->metrics_socket != NULL
+            && guacd_metrics_start(map, config->metrics_socket))
+        exit(EXIT_FAILURE);
+
     /* Ignore SIGPIPE */
     if (signal(SIGPIPE, SIG_IGN) == SIG_ERR) {
         guacd_log(GUAC_LOG_INFO, "Could not set handler for SIGPIPE to ignore. "
@@ -607,6 +624,10 @@ int main(int argc, char* argv[]) {
 
     }
 
+    /* Remove metrics socket, if any */
+    if (config->metrics_socket != NULL)
+        unlink(config->metrics_socket);
+
     /* Close socket */
     if (close(socket_fd) < 0) {
         guacd_log(GUAC_LOG_ERROR, "Could not close socket: %s", strerror(errno));
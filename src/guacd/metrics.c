@@ -0,0 +1,485 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "log.h"
+#include "metrics.h"
+#include "proc.h"
+#include "proc-map.h"
+
+#include <guacamole/mem.h>
+#include <guacamole/metrics.h>
+#include <guacamole/proctitle.h>
+#include <guacamole/string.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * The names of each encoding tracked within guac_metrics, as included in the
+ * "encoding" label of encoding-related metrics.
+ */
+static const char* GUACD_METRICS_ENCODING_NAMES[GUAC_METRICS_ENCODINGS] = {
+    "png", "jpeg", "webp", "video"
+};
+
+/**
+ * The names of each phase of frame planning tracked within guac_metrics, as
+ * included in the "phase" label of planning-related metrics.
+ */
+static const char* GUACD_METRICS_PLAN_PHASE_NAMES[GUAC_METRICS_PLAN_PHASES] = {
+    "draft", "rects", "search", "combine", "commit"
+};
+
+/**
+ * A point-in-time copy of the performance counters of a single connection.
+ */
+typedef struct guacd_metrics_snapshot {
+
+    /**
+     * The ID of the connection.
+     */
+    char connection_id[GUACD_METRICS_CONNECTION_ID_SIZE];
+
+    /**
+     * A copy of the performance counters of the connection.
+     */
+    guac_metrics metrics;
+
+} guacd_metrics_snapshot;
+
+/**
+ * The set of snapshots taken of all connections within a process map.
+ */
+typedef struct guacd_metrics_snapshot_list {
+
+    /**
+     * Array of all snapshots taken.
+     */
+    guacd_metrics_snapshot* snapshots;
+
+    /**
+     * The number of snapshots within the snapshots array.
+     */
+    int count;
+
+    /**
+     * The number of snapshots that the snapshots array has space for.
+     */
+    int size;
+
+} guacd_metrics_snapshot_list;
+
+/**
+ * The parameters of the background thread serving metrics.
+ */
+typedef struct guacd_metrics_thread_params {
+
+    /**
+     * The map of all active connection processes.
+     */
+    guacd_proc_map* map;
+
+    /**
+     * The file descriptor of the listening UNIX domain socket.
+     */
+    int socket_fd;
+
+} guacd_metrics_thread_params;
+
+/**
+ * Copies a single performance counter from the given source guac_metrics to
+ * the given destination guac_metrics, reading the source atomically.
+ */
+#define GUACD_METRICS_COPY(dst, src, counter) \
+    ((dst)->counter = guac_metrics_get(&(src)->counter))
+
+/**
+ * Callback for guacd_proc_map_foreach() which appends a snapshot of the
+ * performance counters of the given process to a guacd_metrics_snapshot_list.
+ *
+ * @param proc
+ *     The process whose counters should be copied.
+ *
+ * @param data
+ *     The guacd_metrics_snapshot_list to append to.
+ */
+static void guacd_metrics_snapshot_proc(guacd_proc* proc, void* data) {
+
+    guacd_metrics_snapshot_list* list = (guacd_metrics_snapshot_list*) data;
+
+    if (proc->metrics == NULL)
+        return;
+
+    /* Grow list as needed */
+    if (list->count == list->size) {
+        list->size = list->size ? list->size * 2 : 16;
+        list->snapshots = guac_mem_realloc(list->snapshots,
+                sizeof(guacd_metrics_snapshot), list->size);
+    }
+
+    guacd_metrics_snapshot* snapshot = &list->snapshots[list->count++];
+    guac_strlcpy(snapshot->connection_id, proc->client->connection_id,
+            sizeof(snapshot->connection_id));
+
+    guac_metrics* dst = &snapshot->metrics;
+    guac_metrics* src = proc->metrics;
+
+    GUACD_METRICS_COPY(dst, src, frames);
+    GUACD_METRICS_COPY(dst, src, frames_deferred);
+    GUACD_METRICS_COPY(dst, src, frames_combined);
+    GUACD_METRICS_COPY(dst, src, input_events);
+    GUACD_METRICS_COPY(dst, src, processing_lag);
+    GUACD_METRICS_COPY(dst, src, bytes_sent);
+
+    for (int i = 0; i < GUAC_METRICS_PLAN_PHASES; i++)
+        GUACD_METRICS_COPY(dst, src, plan_usec[i]);
+
+    for (int i = 0; i < GUAC_METRICS_ENCODINGS; i++) {
+        GUACD_METRICS_COPY(dst, src, encode_usec[i]);
+        GUACD_METRICS_COPY(dst, src, encode_count[i]);
+        GUACD_METRICS_COPY(dst, src, encode_pixels[i]);
+    }
+
+    /* Copy only the users that are currently connected */
+    for (int i = 0; i < GUAC_METRICS_MAX_USERS; i++) {
+
+        guac_metrics_user* dst_user = &dst->users[i];
+        guac_metrics_user* src_user = &src->users[i];
+
+        dst_user->state = GUAC_METRICS_USER_FREE;
+        if (!guac_metrics_user_is_active(src_user))
+            continue;
+
+        guac_strlcpy(dst_user->user_id, src_user->user_id,
+                sizeof(dst_user->user_id));
+        GUACD_METRICS_COPY(dst_user, src_user, bytes_sent);
+        dst_user->state = GUAC_METRICS_USER_ACTIVE;
+
+    }
+
+}
+
+/**
+ * Writes the HELP and TYPE lines describing a single metric.
+ *
+ * @param output
+ *     The stream to write to.
+ *
+ * @param name
+ *     The name of the metric.
+ *
+ * @param type
+ *     The Prometheus type of the metric, such as "counter" or "gauge".
+ *
+ * @param help
+ *     A human-readable description of the metric.
+ */
+static void guacd_metrics_write_header(FILE* output, const char* name,
+        const char* type, const char* help) {
+    fprintf(output, "# HELP %s %s\n", name, help);
+    fprintf(output, "# TYPE %s %s\n", name, type);
+}
+
+/**
+ * Writes a single metric having an integer value for each connection within
+ * the given list of snapshots, where the value of the metric is located at
+ * the given offset within each guac_metrics.
+ *
+ * @param output
+ *     The stream to write to.
+ *
+ * @param list
+ *     The snapshots of all connections.
+ *
+ * @param name
+ *     The name of the metric.
+ *
+ * @param type
+ *     The Prometheus type of the metric, such as "counter" or "gauge".
+ *
+ * @param help
+ *     A human-readable description of the metric.
+ *
+ * @param offset
+ *     The offset of the uint64_t value of the metric within guac_metrics.
+ *
+ * @param scale
+ *     The value that each stored value should be divided by to produce the
+ *     value of the metric, such as 1000000 to convert microseconds to
+ *     seconds.
+ */
+static void guacd_metrics_write_metric(FILE* output,
+        const guacd_metrics_snapshot_list* list, const char* name,
+        const char* type, const char* help, size_t offset, double scale) {
+
+    guacd_metrics_write_header(output, name, type, help);
+
+    for (int i = 0; i < list->count; i++) {
+
+        const guacd_metrics_snapshot* snapshot = &list->snapshots[i];
+        uint64_t value = *((const uint64_t*) ((const char*) &snapshot->metrics + offset));
+
+        if (scale == 1)
+            fprintf(output, "%s{connection_id=\"%s\"} %" PRIu64 "\n",
+                    name, snapshot->connection_id, value);
+        else
+            fprintf(output, "%s{connection_id=\"%s\"} %.6f\n",
+                    name, snapshot->connection_id, value / scale);
+
+    }
+
+}
+
+/**
+ * Writes all metrics describing the given snapshots in Prometheus text
+ * exposition format.
+ *
+ * @param output
+ *     The stream to write to.
+ *
+ * @param list
+ *     The snapshots of all connections.
+ */
+static void guacd_metrics_write(FILE* output,
+        const guacd_metrics_snapshot_list* list) {
+
+    guacd_metrics_write_header(output, "guacd_connections", "gauge",
+            "Number of active connections.");
+    fprintf(output, "guacd_connections %i\n", list->count);
+
+    guacd_metrics_write_metric(output, list, "guacd_connection_frames_total",
+            "counter", "Frames flushed to connected users.",
+            offsetof(guac_metrics, frames), 1);
+
+    guacd_metrics_write_metric(output, list, "guacd_connection_frames_deferred_total",
+            "counter", "Frames deferred while a previous frame was still being encoded.",
+            offsetof(guac_metrics, frames_deferred), 1);
+
+    guacd_metrics_write_metric(output, list, "guacd_connection_frames_combined_total",
+            "counter", "Frames combined into later frames rather than being flushed individually.",
+            offsetof(guac_metrics, frames_combined), 1);
+
+    guacd_metrics_write_metric(output, list, "guacd_connection_input_events_total",
+            "counter", "Mouse, keyboard, and touch events received from all users.",
+            offsetof(guac_metrics, input_events), 1);
+
+    guacd_metrics_write_metric(output, list, "guacd_connection_processing_lag_seconds",
+            "gauge", "Most recently measured processing lag of connected users.",
+            offsetof(guac_metrics, processing_lag), 1000.0);
+
+    guacd_metrics_write_metric(output, list, "guacd_connection_sent_bytes_total",
+            "counter", "Bytes sent to all users.",
+            offsetof(guac_metrics, bytes_sent), 1);
+
+    /* Planning metrics are further labeled by phase */
+    guacd_metrics_write_header(output, "guacd_connection_plan_seconds_total",
+            "counter", "Time spent planning the contents of frames.");
+    for (int i = 0; i < list->count; i++) {
+        const guacd_metrics_snapshot* snapshot = &list->snapshots[i];
+        for (int j = 0; j < GUAC_METRICS_PLAN_PHASES; j++)
+            fprintf(output, "guacd_connection_plan_seconds_total"
+                    "{connection_id=\"%s\",phase=\"%s\"} %.6f\n",
+                    snapshot->connection_id, GUACD_METRICS_PLAN_PHASE_NAMES[j],
+                    snapshot->metrics.plan_usec[j] / 1000000.0);
+    }
+
+    /* Encoding metrics are further labeled by encoding */
+    guacd_metrics_write_header(output, "guacd_connection_encode_seconds_total",
+            "counter", "Time spent encoding images.");
+    for (int i = 0; i < list->count; i++) {
+        const guacd_metrics_snapshot* snapshot = &list->snapshots[i];
+        for (int j = 0; j < GUAC_METRICS_ENCODINGS; j++)
+            fprintf(output, "guacd_connection_encode_seconds_total"
+                    "{connection_id=\"%s\",encoding=\"%s\"} %.6f\n",
+                    snapshot->connection_id, GUACD_METRICS_ENCODING_NAMES[j],
+                    snapshot->metrics.encode_usec[j] / 1000000.0);
+    }
+
+    guacd_metrics_write_header(output, "guacd_connection_encoded_images_total",
+            "counter", "Images encoded.");
+    for (int i = 0; i < list->count; i++) {
+        const guacd_metrics_snapshot* snapshot = &list->snapshots[i];
+        for (int j = 0; j < GUAC_METRICS_ENCODINGS; j++)
+            fprintf(output, "guacd_connection_encoded_images_total"
+                    "{connection_id=\"%s\",encoding=\"%s\"} %" PRIu64 "\n",
+                    snapshot->connection_id, GUACD_METRICS_ENCODING_NAMES[j],
+                    snapshot->metrics.encode_count[j]);
+    }
+
+    guacd_metrics_write_header(output, "guacd_connection_encoded_pixels_total",
+            "counter", "Pixels encoded.");
+    for (int i = 0; i < list->count; i++) {
+        const guacd_metrics_snapshot* snapshot = &list->snapshots[i];
+        for (int j = 0; j < GUAC_METRICS_ENCODINGS; j++)
+            fprintf(output, "guacd_connection_encoded_pixels_total"
+                    "{connection_id=\"%s\",encoding=\"%s\"} %" PRIu64 "\n",
+                    snapshot->connection_id, GUACD_METRICS_ENCODING_NAMES[j],
+                    snapshot->metrics.encode_pixels[j]);
+    }
+
+    /* Per-user metrics are further labeled by user */
+    guacd_metrics_write_header(output, "guacd_user_sent_bytes_total",
+            "counter", "Bytes sent to each connected user.");
+    for (int i = 0; i < list->count; i++) {
+        const guacd_metrics_snapshot* snapshot = &list->snapshots[i];
+        for (int j = 0; j < GUAC_METRICS_MAX_USERS; j++) {
+
+            const guac_metrics_user* user = &snapshot->metrics.users[j];
+            if (user->state != GUAC_METRICS_USER_ACTIVE)
+                continue;
+
+            fprintf(output, "guacd_user_sent_bytes_total"
+                    "{connection_id=\"%s\",user_id=\"%s\"} %" PRIu64 "\n",
+                    snapshot->connection_id, user->user_id, user->bytes_sent);
+
+        }
+    }
+
+}
+
+/**
+ * The file descriptor of the socket listening for connections to the metrics
+ * socket, or -1 if metrics are not being served.
+ */
+static int guacd_metrics_socket_fd = -1;
+
+/**
+ * Closes the metrics socket within the child of a fork(). Only the guacd
+ * daemon itself serves metrics, and connection processes must not hold the
+ * socket open.
+ */
+static void guacd_metrics_atfork_child(void) {
+
+    if (guacd_metrics_socket_fd >= 0) {
+        close(guacd_metrics_socket_fd);
+        guacd_metrics_socket_fd = -1;
+    }
+
+}
+
+/**
+ * Accepts connections to the metrics socket, writing the current metrics of
+ * all connections to each before closing it.
+ *
+ * @param data
+ *     A pointer to a guacd_metrics_thread_params structure.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guacd_metrics_thread(void* data) {
+
+    /* Thread name metrics: serves per-connection performance counters over
+     * the metrics socket. */
+    guac_thread_name_set("metrics");
+
+    guacd_metrics_thread_params* params = (guacd_metrics_thread_params*) data;
+
+    for (;;) {
+
+        int fd = accept(params->socket_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno != EINTR)
+                guacd_log(GUAC_LOG_WARNING, "Could not accept connection to "
+                        "metrics socket: %s", strerror(errno));
+            continue;
+        }
+
+        FILE* output = fdopen(fd, "w");
+        if (output == NULL) {
+            close(fd);
+            continue;
+        }
+
+        /* Copy all counters before writing anything, such that the process
+         * map is not locked while waiting on the reader */
+        guacd_metrics_snapshot_list list = { 0 };
+        guacd_proc_map_foreach(params->map, guacd_metrics_snapshot_proc, &list);
+
+        guacd_metrics_write(output, &list);
+        fclose(output);
+
+        guac_mem_free(list.snapshots);
+
+    }
+
+    return NULL;
+
+}
+
+int guacd_metrics_start(guacd_proc_map* map, const char* path) {
+
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (guac_strlcpy(address.sun_path, path, sizeof(address.sun_path))
+            >= sizeof(address.sun_path)) {
+        guacd_log(GUAC_LOG_ERROR, "Metrics socket path is too long: %s", path);
+        return 1;
+    }
+
+    int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd < 0) {
+        guacd_log(GUAC_LOG_ERROR, "Could not create metrics socket: %s",
+                strerror(errno));
+        return 1;
+    }
+
+    /* The metrics socket must not be inherited by connection processes */
+    fcntl(socket_fd, F_SETFD, FD_CLOEXEC);
+
+    /* Replace any socket left behind by a previous instance of guacd */
+    unlink(path);
+
+    if (bind(socket_fd, (struct sockaddr*) &address, sizeof(address))
+            || listen(socket_fd, GUACD_METRICS_BACKLOG)) {
+        guacd_log(GUAC_LOG_ERROR, "Could not listen on metrics socket "
+                "\"%s\": %s", path, strerror(errno));
+        close(socket_fd);
+        return 1;
+    }
+
+    guacd_metrics_thread_params* params = guac_mem_alloc(sizeof(guacd_metrics_thread_params));
+    params->map = map;
+    params->socket_fd = socket_fd;
+
+    pthread_t metrics_thread;
+    if (pthread_create(&metrics_thread, NULL, guacd_metrics_thread, params)) {
+        guacd_log(GUAC_LOG_ERROR, "Could not start metrics thread.");
+        guac_mem_free(params);
+        close(socket_fd);
+        return 1;
+    }
+
+    pthread_detach(metrics_thread);
+
+    guacd_metrics_socket_fd = socket_fd;
+    pthread_atfork(NULL, NULL, guacd_metrics_atfork_child);
+
+    guacd_log(GUAC_LOG_INFO, "Serving connection metrics on \"%s\"", path);
+    return 0;
+
+}
+
@@ -0,0 +1,56 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUACD_METRICS_H
+#define GUACD_METRICS_H
+
+#include "proc-map.h"
+
+/**
+ * The maximum number of pending connections to the metrics socket.
+ */
+#define GUACD_METRICS_BACKLOG 8
+
+/**
+ * The number of bytes to allocate for each connection ID copied while
+ * gathering metrics, including the null terminator.
+ */
+#define GUACD_METRICS_CONNECTION_ID_SIZE 64
+
+/**
+ * Starts a background thread which listens on a UNIX domain socket at the
+ * given path, writing the current performance counters of every connection
+ * within the given process map to each client of that socket in Prometheus
+ * text exposition format. Any file already present at the given path is
+ * replaced.
+ *
+ * @param map
+ *     The map of all active connection processes.
+ *
+ * @param path
+ *     The path of the UNIX domain socket to create.
+ *
+ * @return
+ *     Zero if the socket was created and the background thread started
+ *     successfully, non-zero otherwise.
+ */
+int guacd_metrics_start(guacd_proc_map* map, const char* path);
+
+#endif
+
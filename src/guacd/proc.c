@@ -25,6 +25,7 @@
 #include <guacamole/client.h>
 #include <guacamole/error.h>
 #include <guacamole/mem.h>
+#include <guacamole/metrics.h>
 #include <guacamole/parser.h>
 #include <guacamole/plugin.h>
 #include <guacamole/proctitle.h>
@@ -38,6 +39,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -94,6 +96,20 @@ static void* guacd_user_thread(void* data) {
 
     /* Create skeleton user */
     guac_user* user = guac_user_alloc();
+
+    /* Count all data sent to the user if performance counters are being
+     * tracked (the metered socket takes ownership of the original socket) */
+    guac_metrics_user* user_metrics = NULL;
+    if (client->metrics != NULL) {
+
+        user_metrics = guac_metrics_user_claim(client->metrics, user->user_id);
+
+        guac_socket* metered = guac_socket_meter(socket, client->metrics, user_metrics);
+        if (metered != NULL)
+            socket = metered;
+
+    }
+
     user->socket = socket;
     user->client = client;
     user->owner  = params->owner;
@@ -112,6 +128,9 @@ static void* guacd_user_thread(void* data) {
     guac_user_free(user);
     guac_mem_free(params);
 
+    if (user_metrics != NULL)
+        guac_metrics_user_release(user_metrics);
+
     return NULL;
 
 }
@@ -345,8 +364,10 @@ static void guacd_exec_proc(guacd_proc* proc, const char* protocol) {
         goto cleanup_process;
     }
 
-    /* Init client for selected protocol */
+    /* Init client for selected protocol, tracking performance counters
+     * within memory shared with the parent */
     guac_client* client = proc->client;
+    client->metrics = proc->metrics;
     if (guac_client_load_plugin(client, protocol)) {
 
         /* Log error */
@@ -471,14 +492,26 @@ guacd_proc* guacd_create_proc(const char* protocol) {
     /* Init logging */
     proc->client->log_handler = guacd_client_log;
 
+    /* Allocate performance counters within memory that will remain shared
+     * with the child process after fork() */
+    proc->metrics = mmap(NULL, sizeof(guac_metrics), PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (proc->metrics == MAP_FAILED) {
+        guacd_log(GUAC_LOG_WARNING, "Unable to allocate shared memory for "
+                "connection metrics: %s", strerror(errno));
+        proc->metrics = NULL;
+    }
+    else
+        guac_metrics_init(proc->metrics);
+
     /* Fork */
     proc->pid = fork();
     if (proc->pid < 0) {
         guacd_log(GUAC_LOG_ERROR, "Cannot fork child process: %s", strerror(errno));
         close(parent_socket);
         close(child_socket);
-        guac_client_free(proc->client);
-        guac_mem_free(proc);
+        guacd_proc_free(proc);
         return NULL;
     }
 
@@ -501,12 +534,33 @@ guacd_proc* guacd_create_proc(const char* protocol) {
         proc->fd_socket = child_socket;
         close(parent_socket);
 
+        /* The performance counters of this connection are now shared with
+         * its process and must not be inherited by any other connection
+         * process forked later */
+#ifdef MADV_DONTFORK
+        if (proc->metrics != NULL)
+            madvise(proc->metrics, sizeof(guac_metrics), MADV_DONTFORK);
+#endif
+
     }
 
     return proc;
 
 }
 
+void guacd_proc_free(guacd_proc* proc) {
+
+    /* Free skeleton client */
+    guac_client_free(proc->client);
+
+    /* Release shared performance counters */
+    if (proc->metrics != NULL)
+        munmap(proc->metrics, sizeof(guac_metrics));
+
+    guac_mem_free(proc);
+
+}
+
 /**
  * Kill the provided child guacd process. This function must be called by the
  * parent process, and will block until all processes associated with the
@@ -21,6 +21,7 @@
 #define GUACD_PROC_H
 
 #include <guacamole/client.h>
+#include <guacamole/metrics.h>
 #include <guacamole/parser.h>
 
 #include <unistd.h>
@@ -76,6 +77,14 @@ typedef struct guacd_proc {
      */
     guac_client* client;
 
+    /**
+     * Performance counters for the connection, stored in memory shared
+     * between the parent and child processes. The child process updates
+     * these counters, while the parent process reads them to serve metrics.
+     * This will be NULL if shared memory could not be allocated.
+     */
+    guac_metrics* metrics;
+
 } guacd_proc;
 
 /**
@@ -94,6 +103,17 @@ typedef struct guacd_proc {
  */
 guacd_proc* guacd_create_proc(const char* protocol);
 
+/**
+ * Frees all resources associated with the given process within the parent
+ * process, including the skeleton guac_client and any shared memory. The
+ * process itself must already have been stopped with guacd_proc_stop(), and
+ * the fd_socket of the process must be closed separately.
+ *
+ * @param proc
+ *     The process to free.
+ */
+void guacd_proc_free(guacd_proc* proc);
+
 /**
  * Signals the given process to stop accepting new users and clean up. This
  * will eventually cause the child process to exit.
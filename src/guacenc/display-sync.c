@@ -39,6 +39,14 @@ int guacenc_display_sync(guacenc_display* display, guac_timestamp timestamp) {
     /* Update timestamp of display */
     display->last_sync = timestamp;
 
+    if (display->first_sync == 0)
+        display->first_sync = timestamp;
+
+    /* Only track state if not writing video or not yet at start position */
+    if (display->output == NULL
+            || timestamp - display->first_sync < display->start_position)
+        return 0;
+
     /* Flatten display to default layer */
     if (guacenc_display_flatten(display))
         return 1;
@@ -86,10 +86,13 @@ cairo_operator_t guacenc_display_cairo_operator(guac_composite_mode mask) {
 guacenc_display* guacenc_display_alloc(const char* path, const char* codec,
         int width, int height, int bitrate) {
 
-    /* Prepare video encoding */
-    guacenc_video* video = guacenc_video_alloc(path, codec, width, height, bitrate);
-    if (video == NULL)
-        return NULL;
+    /* Prepare video encoding, if requested */
+    guacenc_video* video = NULL;
+    if (path != NULL) {
+        video = guacenc_video_alloc(path, codec, width, height, bitrate);
+        if (video == NULL)
+            return NULL;
+    }
 
     /* Allocate display */
     guacenc_display* display =
@@ -89,7 +89,23 @@ typedef struct guacenc_display {
     guac_timestamp last_sync;
 
     /**
-     * The video that this display is recording to.
+     * The timestamp of the first sync instruction of the recording, or 0 if
+     * not yet known.
+     */
+    guac_timestamp first_sync;
+
+    /**
+     * The position within the recording at which video output should begin,
+     * in milliseconds relative to the first sync instruction. Frames prior to
+     * this position update the display state but are not written to the
+     * video.
+     */
+    guac_timestamp start_position;
+
+    /**
+     * The video that this display is recording to, or NULL if the display
+     * is only tracking display state (such as while building a recording
+     * index).
      */
     guacenc_video* output;
 
@@ -97,7 +113,9 @@ typedef struct guacenc_display {
 
 /**
  * Handles a received "sync" instruction having the given timestamp, flushing
- * the current display to the in-progress video encoding.
+ * the current display to the in-progress video encoding. If the display has
+ * no associated video, or the timestamp precedes the requested start position,
+ * only the timestamp of the display is updated.
  *
  * @param display
  *     The display to flush to the video encoding as a new frame.
@@ -133,7 +151,8 @@ int guacenc_display_flatten(guacenc_display* display);
  * display as instructions are read and handled.
  *
  * @param path
- *     The full path to the file in which encoded video should be written.
+ *     The full path to the file in which encoded video should be written, or
+ *     NULL if no video should be written.
  *
  * @param codec
  *     The name of the codec to use for the video encoding, as defined by
@@ -18,6 +18,7 @@
  */
 
 #include "display.h"
+#include "index.h"
 #include "instructions.h"
 #include "log.h"
 
@@ -31,6 +32,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -48,12 +50,19 @@
  * @param socket
  *     The guac_socket through which instructions should be read.
  *
+ * @param fd
+ *     The file descriptor wrapped by the given guac_socket.
+ *
+ * @param index
+ *     The recording index that should be updated as "sync" instructions are
+ *     read, or NULL if no index is being written.
+ *
  * @return
  *     Zero on success, non-zero if parsing of Guacamole protocol data through
  *     the given socket fails.
  */
 static int guacenc_read_instructions(guacenc_display* display,
-        const char* path, guac_socket* socket) {
+        const char* path, guac_socket* socket, int fd, guacenc_index* index) {
 
     /* Obtain Guacamole protocol parser */
     guac_parser* parser = guac_parser_alloc();
@@ -67,6 +76,15 @@ static int guacenc_read_instructions(guacenc_display* display,
             guacenc_log(GUAC_LOG_DEBUG, "Handling of \"%s\" instruction "
                     "failed.", parser->opcode);
         }
+
+        /* Record position following each sync within index */
+        else if (index != NULL && strcmp(parser->opcode, "sync") == 0
+                && guacenc_index_add(index, display,
+                    guacenc_index_parser_offset(parser, fd))) {
+            guacenc_log(GUAC_LOG_ERROR, "%s: Unable to write index.", path);
+            guac_parser_free(parser);
+            return 1;
+        }
     }
 
     /* Fail on read/parse error */
@@ -83,14 +101,28 @@ static int guacenc_read_instructions(guacenc_display* display,
 
 }
 
-int guacenc_encode(const char* path, const char* out_path, const char* codec,
-        int width, int height, int bitrate, bool force) {
+/**
+ * Opens the given recording for reading, acquiring a read lock on the file to
+ * ensure that in-progress recordings are not read unless explicitly forced.
+ *
+ * @param path
+ *     The path to the file containing the raw Guacamole protocol dump.
+ *
+ * @param force
+ *     Open the file even if it appears to be an in-progress recording (has
+ *     an associated lock).
+ *
+ * @return
+ *     The file descriptor of the opened recording, or -1 if the recording
+ *     cannot be opened.
+ */
+static int guacenc_open_recording(const char* path, bool force) {
 
     /* Open input file */
     int fd = open(path, O_RDONLY);
     if (fd < 0) {
         guacenc_log(GUAC_LOG_ERROR, "%s: %s", path, strerror(errno));
-        return 1;
+        return -1;
     }
 
     /* Lock entire input file for reading by the current process */
@@ -117,9 +149,21 @@ int guacenc_encode(const char* path, const char* out_path, const char* codec,
                     path, strerror(errno));
 
         close(fd);
-        return 1;
+        return -1;
     }
 
+    return fd;
+
+}
+
+int guacenc_encode(const char* path, const char* out_path, const char* codec,
+        int width, int height, int bitrate, bool force,
+        guac_timestamp position) {
+
+    int fd = guacenc_open_recording(path, force);
+    if (fd < 0)
+        return 1;
+
     /* Allocate display for encoding process */
     guacenc_display* display = guacenc_display_alloc(out_path, codec,
             width, height, bitrate);
@@ -128,6 +172,31 @@ int guacenc_encode(const char* path, const char* out_path, const char* codec,
         return 1;
     }
 
+    /* Skip as much of the recording as the index allows if starting from a
+     * later position */
+    if (position > 0) {
+
+        display->start_position = position;
+
+        char index_path[4096];
+        snprintf(index_path, sizeof(index_path), "%s" GUACENC_INDEX_SUFFIX,
+                path);
+
+        off_t offset = guacenc_index_seek(display, index_path, position);
+        if (offset == -1)
+            guacenc_log(GUAC_LOG_WARNING, "Recording index \"%s\" is not "
+                    "usable. The recording will be read from the "
+                    "beginning.", index_path);
+
+        else if (offset > 0 && lseek(fd, offset, SEEK_SET) == -1) {
+            guacenc_log(GUAC_LOG_ERROR, "%s: %s", path, strerror(errno));
+            close(fd);
+            guacenc_display_free(display);
+            return 1;
+        }
+
+    }
+
     /* Obtain guac_socket wrapping file descriptor */
     guac_socket* socket = guac_socket_open(fd);
     if (socket == NULL) {
@@ -141,7 +210,7 @@ int guacenc_encode(const char* path, const char* out_path, const char* codec,
     guacenc_log(GUAC_LOG_INFO, "Encoding \"%s\" to \"%s\" ...", path, out_path);
 
     /* Attempt to read all instructions in the file */
-    if (guacenc_read_instructions(display, path, socket)) {
+    if (guacenc_read_instructions(display, path, socket, fd, NULL)) {
         guac_socket_free(socket);
         guacenc_display_free(display);
         return 1;
@@ -153,3 +222,52 @@ int guacenc_encode(const char* path, const char* out_path, const char* codec,
 
 }
 
+int guacenc_build_index(const char* path, const char* index_path,
+        bool force) {
+
+    int fd = guacenc_open_recording(path, force);
+    if (fd < 0)
+        return 1;
+
+    /* Track display state only, without writing any video */
+    guacenc_display* display = guacenc_display_alloc(NULL, NULL, 0, 0, 0);
+    if (display == NULL) {
+        close(fd);
+        return 1;
+    }
+
+    guacenc_index* index = guacenc_index_alloc(index_path);
+    if (index == NULL) {
+        close(fd);
+        guacenc_display_free(display);
+        return 1;
+    }
+
+    /* Obtain guac_socket wrapping file descriptor */
+    guac_socket* socket = guac_socket_open(fd);
+    if (socket == NULL) {
+        guacenc_log(GUAC_LOG_ERROR, "%s: %s", path,
+                guac_status_string(guac_error));
+        close(fd);
+        guacenc_index_free(index);
+        guacenc_display_free(display);
+        return 1;
+    }
+
+    guacenc_log(GUAC_LOG_INFO, "Indexing \"%s\" to \"%s\" ...", path,
+            index_path);
+
+    /* Attempt to read all instructions in the file */
+    int retval = guacenc_read_instructions(display, path, socket, fd, index);
+
+    guac_socket_free(socket);
+    guacenc_display_free(display);
+
+    if (guacenc_index_free(index)) {
+        guacenc_log(GUAC_LOG_ERROR, "%s: Unable to write index.", index_path);
+        return 1;
+    }
+
+    return retval;
+
+}
@@ -20,6 +20,8 @@
 #ifndef GUACENC_ENCODE_H
 #define GUACENC_ENCODE_H
 
+#include <guacamole/timestamp.h>
+
 #include <stdbool.h>
 
 /**
@@ -52,12 +54,45 @@
  *     Perform the encoding, even if the input file appears to be an
  *     in-progress recording (has an associated lock).
  *
+ * @param position
+ *     The position within the recording at which the video should begin, in
+ *     milliseconds relative to the start of the recording. If an index
+ *     exists for the recording (a file having the same name as the recording
+ *     but with GUACENC_INDEX_SUFFIX appended), the portion of the recording
+ *     preceding the nearest keyframe is skipped entirely.
+ *
  * @return
  *     Zero on success, non-zero if an error prevented successful encoding of
  *     the video.
  */
 int guacenc_encode(const char* path, const char* out_path, const char* codec,
-        int width, int height, int bitrate, bool force);
+        int width, int height, int bitrate, bool force,
+        guac_timestamp position);
+
+/**
+ * Builds an index for the given Guacamole protocol dump, mapping the
+ * timestamps of its "sync" instructions to byte offsets and periodically
+ * recording keyframes of the display state, such that the recording can
+ * later be read starting from any position. As with guacenc_encode(), a read
+ * lock will be acquired on the input file unless force is true.
+ *
+ * @param path
+ *     The path to the file containing the raw Guacamole protocol dump.
+ *
+ * @param index_path
+ *     The full path to the file in which the index should be written. Any
+ *     existing file at this path will be overwritten.
+ *
+ * @param force
+ *     Build the index, even if the input file appears to be an in-progress
+ *     recording (has an associated lock).
+ *
+ * @return
+ *     Zero on success, non-zero if an error prevented successful indexing of
+ *     the recording.
+ */
+int guacenc_build_index(const char* path, const char* index_path,
+        bool force);
 
 #endif
 
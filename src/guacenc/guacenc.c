@@ -19,6 +19,7 @@
 
 #include "encode.h"
 #include "guacenc.h"
+#include "index.h"
 #include "log.h"
 #include "parse.h"
 
@@ -35,13 +36,15 @@ int main(int argc, char* argv[]) {
 
     /* Load defaults */
     bool force = false;
+    bool index_only = false;
+    int start = 0;
     int width = GUACENC_DEFAULT_WIDTH;
     int height = GUACENC_DEFAULT_HEIGHT;
     int bitrate = GUACENC_DEFAULT_BITRATE;
 
     /* Parse arguments */
     int opt;
-    while ((opt = getopt(argc, argv, "s:r:f")) != -1) {
+    while ((opt = getopt(argc, argv, "s:r:t:fi")) != -1) {
 
         /* -s: Dimensions (WIDTHxHEIGHT) */
         if (opt == 's') {
@@ -59,10 +62,22 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        /* -t: Start position (seconds) */
+        else if (opt == 't') {
+            if (guacenc_parse_int(optarg, &start) || start < 0) {
+                guacenc_log(GUAC_LOG_ERROR, "Invalid start position.");
+                goto invalid_options;
+            }
+        }
+
         /* -f: Force */
         else if (opt == 'f')
             force = true;
 
+        /* -i: Build index only */
+        else if (opt == 'i')
+            index_only = true;
+
         /* Invalid option */
         else {
             goto invalid_options;
@@ -95,8 +110,9 @@ int main(int argc, char* argv[]) {
 
     guacenc_log(GUAC_LOG_INFO, "%i input file(s) provided.", total_files);
 
-    guacenc_log(GUAC_LOG_INFO, "Video will be encoded at %ix%i "
-            "and %i bps.", width, height, bitrate);
+    if (!index_only)
+        guacenc_log(GUAC_LOG_INFO, "Video will be encoded at %ix%i "
+                "and %i bps.", width, height, bitrate);
 
     /* Encode all input files */
     for (i = optind; i < argc; i++) {
@@ -106,7 +122,8 @@ int main(int argc, char* argv[]) {
 
         /* Generate output filename */
         char out_path[4096];
-        int len = snprintf(out_path, sizeof(out_path), "%s.m4v", path);
+        int len = snprintf(out_path, sizeof(out_path), "%s%s", path,
+                index_only ? GUACENC_INDEX_SUFFIX : ".m4v");
 
         /* Do not write if filename exceeds maximum length */
         if (len >= sizeof(out_path)) {
@@ -115,9 +132,23 @@ int main(int argc, char* argv[]) {
             continue;
         }
 
+        /* Build index only if requested */
+        if (index_only) {
+            if (guacenc_build_index(path, out_path, force)) {
+                failures++;
+                guacenc_log(GUAC_LOG_DEBUG,
+                        "%s was NOT successfully indexed.", path);
+            }
+            else
+                guacenc_log(GUAC_LOG_DEBUG, "%s was successfully indexed.",
+                        path);
+            continue;
+        }
+
         /* Attempt encoding, log granular success/failure at debug level */
         if (guacenc_encode(path, out_path, "mpeg4",
-                    width, height, bitrate, force)) {
+                    width, height, bitrate, force,
+                    (guac_timestamp) start * 1000)) {
             failures++;
             guacenc_log(GUAC_LOG_DEBUG,
                     "%s was NOT successfully encoded.", path);
@@ -145,7 +176,9 @@ invalid_options:
     fprintf(stderr, "USAGE: %s"
             " [-s WIDTHxHEIGHT]"
             " [-r BITRATE]"
+            " [-t SECONDS]"
             " [-f]"
+            " [-i]"
             " [FILE]...\n", argv[0]);
 
     return 1;
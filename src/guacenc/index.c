@@ -0,0 +1,552 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "buffer.h"
+#include "cursor.h"
+#include "display.h"
+#include "index.h"
+#include "instructions.h"
+#include "layer.h"
+#include "log.h"
+#include "parse.h"
+
+#include <cairo/cairo.h>
+#include <guacamole/client.h>
+#include <guacamole/error.h>
+#include <guacamole/layer.h>
+#include <guacamole/mem.h>
+#include <guacamole/parser.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+#include <guacamole/stream.h>
+#include <guacamole/timestamp.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/**
+ * The current state of a PNG image being written to a recording index as a
+ * series of "blob" instructions.
+ */
+typedef struct guacenc_index_png_state {
+
+    /**
+     * The socket of the index being written.
+     */
+    guac_socket* socket;
+
+    /**
+     * The stream that the PNG image is being written to.
+     */
+    const guac_stream* stream;
+
+    /**
+     * PNG data which has not yet been sent within a "blob" instruction.
+     */
+    unsigned char buffer[GUACENC_INDEX_BLOB_SIZE];
+
+    /**
+     * The number of bytes currently stored within the buffer.
+     */
+    int length;
+
+} guacenc_index_png_state;
+
+/**
+ * Cairo write callback which sends PNG data as "blob" instructions whenever
+ * a full blob's worth of data has been accumulated.
+ *
+ * @param closure
+ *     The guacenc_index_png_state of the PNG image being written.
+ *
+ * @param data
+ *     The PNG data to write.
+ *
+ * @param length
+ *     The number of bytes of PNG data to write.
+ *
+ * @return
+ *     CAIRO_STATUS_SUCCESS if the data was written successfully,
+ *     CAIRO_STATUS_WRITE_ERROR otherwise.
+ */
+static cairo_status_t guacenc_index_write_png_data(void* closure,
+        const unsigned char* data, unsigned int length) {
+
+    guacenc_index_png_state* state = (guacenc_index_png_state*) closure;
+
+    while (length > 0) {
+
+        /* Copy as much data as will fit within the current blob */
+        int remaining = sizeof(state->buffer) - state->length;
+        if (remaining > length)
+            remaining = length;
+
+        memcpy(state->buffer + state->length, data, remaining);
+        state->length += remaining;
+        data += remaining;
+        length -= remaining;
+
+        /* Send blob once full */
+        if (state->length == sizeof(state->buffer)) {
+            if (guac_protocol_send_blob(state->socket, state->stream,
+                        state->buffer, state->length))
+                return CAIRO_STATUS_WRITE_ERROR;
+            state->length = 0;
+        }
+
+    }
+
+    return CAIRO_STATUS_SUCCESS;
+
+}
+
+/**
+ * Writes the instructions necessary to restore the size and contents of the
+ * given buffer to the given index socket.
+ *
+ * @param socket
+ *     The socket of the index being written.
+ *
+ * @param index
+ *     The index of the layer or buffer being restored.
+ *
+ * @param buffer
+ *     The guacenc_buffer containing the current size and contents of the
+ *     layer or buffer.
+ *
+ * @return
+ *     Zero on success, non-zero if an error occurs.
+ */
+static int guacenc_index_write_buffer(guac_socket* socket, int index,
+        guacenc_buffer* buffer) {
+
+    const guac_layer layer = { .index = index };
+
+    if (guac_protocol_send_size(socket, &layer,
+                buffer->width, buffer->height))
+        return 1;
+
+    /* Nothing further to write if the buffer is empty */
+    if (buffer->surface == NULL)
+        return 0;
+
+    const guac_stream stream = { .index = 0 };
+
+    if (guac_protocol_send_img(socket, &stream, GUAC_COMP_SRC, &layer,
+                "image/png", 0, 0))
+        return 1;
+
+    guacenc_index_png_state state = {
+        .socket = socket,
+        .stream = &stream,
+        .length = 0
+    };
+
+    if (cairo_surface_write_to_png_stream(buffer->surface,
+                guacenc_index_write_png_data, &state) != CAIRO_STATUS_SUCCESS)
+        return 1;
+
+    /* Send any remaining data */
+    if (state.length > 0 && guac_protocol_send_blob(socket, &stream,
+                state.buffer, state.length))
+        return 1;
+
+    return guac_protocol_send_end(socket, &stream);
+
+}
+
+/**
+ * Writes the instructions necessary to restore the image, hotspot, and
+ * position of the mouse cursor to the given index socket. The cursor image
+ * is transferred through a temporary buffer which is disposed once the
+ * cursor has been set.
+ *
+ * @param socket
+ *     The socket of the index being written.
+ *
+ * @param display
+ *     The display whose mouse cursor should be restored.
+ *
+ * @return
+ *     Zero on success, non-zero if an error occurs.
+ */
+static int guacenc_index_write_cursor(guac_socket* socket,
+        guacenc_display* display) {
+
+    guacenc_cursor* cursor = display->cursor;
+    guacenc_buffer* image = cursor->buffer;
+
+    if (image->surface != NULL) {
+
+        /* Locate an unused buffer to hold the cursor image */
+        int i = GUACENC_DISPLAY_MAX_BUFFERS - 1;
+        while (i >= 0 && display->buffers[i] != NULL)
+            i--;
+
+        if (i >= 0) {
+
+            const guac_layer layer = { .index = -1 - i };
+
+            if (guacenc_index_write_buffer(socket, layer.index, image)
+                    || guac_protocol_send_cursor(socket,
+                        cursor->hotspot_x, cursor->hotspot_y, &layer,
+                        0, 0, image->width, image->height)
+                    || guac_protocol_send_dispose(socket, &layer))
+                return 1;
+
+        }
+
+    }
+
+    return guac_protocol_send_mouse(socket, cursor->x, cursor->y, 0,
+            display->last_sync);
+
+}
+
+/**
+ * Writes a single element of a Guacamole instruction containing the given
+ * integer value, followed by the given terminator (either "," or ";").
+ *
+ * @param socket
+ *     The socket of the index being written.
+ *
+ * @param value
+ *     The integer value of the element.
+ *
+ * @param terminator
+ *     The character(s) that should follow the element.
+ *
+ * @return
+ *     Zero on success, non-zero if an error occurs.
+ */
+static int guacenc_index_write_int_element(guac_socket* socket,
+        int64_t value, const char* terminator) {
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%" PRId64, value);
+
+    return guac_socket_write_int(socket, strlen(buffer))
+        || guac_socket_write_string(socket, ".")
+        || guac_socket_write_string(socket, buffer)
+        || guac_socket_write_string(socket, terminator);
+
+}
+
+/**
+ * Writes an "index" or "keyframe" entry header to the given index socket.
+ *
+ * @param socket
+ *     The socket of the index being written.
+ *
+ * @param opcode
+ *     The opcode of the entry, already in Guacamole protocol element form
+ *     (ie: "5.index," or "8.keyframe,").
+ *
+ * @param timestamp
+ *     The timestamp of the "sync" instruction being indexed.
+ *
+ * @param offset
+ *     The byte offset within the recording of the instruction immediately
+ *     following the "sync" instruction.
+ *
+ * @return
+ *     Zero on success, non-zero if an error occurs.
+ */
+static int guacenc_index_write_entry(guac_socket* socket, const char* opcode,
+        guac_timestamp timestamp, off_t offset) {
+
+    int ret_val;
+
+    guac_socket_instruction_begin(socket);
+    ret_val =
+           guac_socket_write_string(socket, opcode)
+        || guacenc_index_write_int_element(socket, timestamp, ",")
+        || guacenc_index_write_int_element(socket, offset, ";");
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
+
+    return ret_val;
+
+}
+
+/**
+ * Writes a keyframe for the current state of the given display to the given
+ * index socket.
+ *
+ * @param socket
+ *     The socket of the index being written.
+ *
+ * @param display
+ *     The display whose state should be recorded.
+ *
+ * @param offset
+ *     The byte offset within the recording of the instruction immediately
+ *     following the most recent "sync" instruction.
+ *
+ * @return
+ *     Zero on success, non-zero if an error occurs.
+ */
+static int guacenc_index_write_keyframe(guac_socket* socket,
+        guacenc_display* display, off_t offset) {
+
+    int i;
+
+    if (guacenc_index_write_entry(socket, "8.keyframe,",
+                display->last_sync, offset))
+        return 1;
+
+    /* Restore all buffers */
+    for (i = 0; i < GUACENC_DISPLAY_MAX_BUFFERS; i++) {
+        guacenc_buffer* buffer = display->buffers[i];
+        if (buffer != NULL && guacenc_index_write_buffer(socket, -1 - i, buffer))
+            return 1;
+    }
+
+    /* Restore all layers, including their position and opacity */
+    for (i = 0; i < GUACENC_DISPLAY_MAX_LAYERS; i++) {
+
+        guacenc_layer* layer = display->layers[i];
+        if (layer == NULL)
+            continue;
+
+        if (guacenc_index_write_buffer(socket, i, layer->buffer))
+            return 1;
+
+        const guac_layer current = { .index = i };
+        const guac_layer parent = { .index = layer->parent_index };
+
+        if (layer->parent_index != GUACENC_LAYER_NO_PARENT
+                && guac_protocol_send_move(socket, &current, &parent,
+                    layer->x, layer->y, layer->z))
+            return 1;
+
+        if (guac_protocol_send_shade(socket, &current, layer->opacity))
+            return 1;
+
+    }
+
+    /* Restore mouse cursor, ending keyframe with a sync */
+    return guacenc_index_write_cursor(socket, display)
+        || guac_protocol_send_sync(socket, display->last_sync, 1);
+
+}
+
+guacenc_index* guacenc_index_alloc(const char* path) {
+
+    int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        guacenc_log(GUAC_LOG_ERROR, "%s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    guac_socket* socket = guac_socket_open(fd);
+    if (socket == NULL) {
+        guacenc_log(GUAC_LOG_ERROR, "%s: %s", path,
+                guac_status_string(guac_error));
+        close(fd);
+        return NULL;
+    }
+
+    guacenc_index* index = guac_mem_zalloc(sizeof(guacenc_index));
+    index->socket = socket;
+    return index;
+
+}
+
+int guacenc_index_add(guacenc_index* index, guacenc_display* display,
+        off_t offset) {
+
+    guac_timestamp timestamp = display->last_sync;
+
+    /* Write keyframes periodically, starting with the first sync */
+    if (index->last_keyframe == 0
+            || timestamp - index->last_keyframe >= GUACENC_INDEX_KEYFRAME_INTERVAL) {
+        index->last_keyframe = index->last_entry = timestamp;
+        return guacenc_index_write_keyframe(index->socket, display, offset);
+    }
+
+    /* Write plain entries between keyframes */
+    if (timestamp - index->last_entry >= GUACENC_INDEX_INTERVAL) {
+        index->last_entry = timestamp;
+        return guacenc_index_write_entry(index->socket, "5.index,",
+                timestamp, offset);
+    }
+
+    return 0;
+
+}
+
+int guacenc_index_free(guacenc_index* index) {
+
+    /* Ignore NULL index */
+    if (index == NULL)
+        return 0;
+
+    int retval = guac_socket_flush(index->socket) ? 1 : 0;
+
+    guac_socket_free(index->socket);
+    guac_mem_free(index);
+    return retval;
+
+}
+
+off_t guacenc_index_parser_offset(guac_parser* parser, int fd) {
+
+    off_t position = lseek(fd, 0, SEEK_CUR);
+    if (position == -1)
+        return -1;
+
+    /* Any data read but not yet parsed follows the next instruction */
+    return position - guac_parser_length(parser);
+
+}
+
+/**
+ * Replays the keyframe at the given offset within the given index file,
+ * restoring the state of the given display.
+ *
+ * @param display
+ *     The display to restore.
+ *
+ * @param path
+ *     The full path to the index file.
+ *
+ * @param keyframe_offset
+ *     The byte offset within the index file of the first instruction
+ *     following the "keyframe" entry.
+ *
+ * @return
+ *     Zero on success, non-zero if the keyframe cannot be read.
+ */
+static int guacenc_index_replay_keyframe(guacenc_display* display,
+        const char* path, off_t keyframe_offset) {
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1 || lseek(fd, keyframe_offset, SEEK_SET) == -1) {
+        guacenc_log(GUAC_LOG_WARNING, "%s: %s", path, strerror(errno));
+        if (fd != -1)
+            close(fd);
+        return 1;
+    }
+
+    guac_socket* socket = guac_socket_open(fd);
+    if (socket == NULL) {
+        close(fd);
+        return 1;
+    }
+
+    guac_parser* parser = guac_parser_alloc();
+    if (parser == NULL) {
+        guac_socket_free(socket);
+        return 1;
+    }
+
+    /* Handle all instructions up to and including the terminating sync */
+    int retval = 1;
+    while (!guac_parser_read(parser, socket, -1)) {
+
+        if (guacenc_handle_instruction(display, parser->opcode,
+                parser->argc, parser->argv)) {
+            guacenc_log(GUAC_LOG_DEBUG, "Handling of \"%s\" instruction "
+                    "within keyframe failed.", parser->opcode);
+        }
+
+        if (strcmp(parser->opcode, "sync") == 0) {
+            retval = 0;
+            break;
+        }
+
+    }
+
+    guac_parser_free(parser);
+    guac_socket_free(socket);
+    return retval;
+
+}
+
+off_t guacenc_index_seek(guacenc_display* display, const char* path,
+        guac_timestamp position) {
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        guacenc_log(GUAC_LOG_WARNING, "%s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    guac_socket* socket = guac_socket_open(fd);
+    if (socket == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    guac_parser* parser = guac_parser_alloc();
+    if (parser == NULL) {
+        guac_socket_free(socket);
+        return -1;
+    }
+
+    guac_timestamp first = 0;
+    off_t keyframe_offset = -1;
+    off_t recording_offset = 0;
+
+    /* Locate the last keyframe preceding the requested position */
+    while (!guac_parser_read(parser, socket, -1)) {
+
+        int keyframe = (strcmp(parser->opcode, "keyframe") == 0);
+        if ((!keyframe && strcmp(parser->opcode, "index") != 0)
+                || parser->argc < 2)
+            continue;
+
+        guac_timestamp timestamp = guacenc_parse_timestamp(parser->argv[0]);
+        if (first == 0)
+            first = timestamp;
+
+        if (timestamp - first > position)
+            break;
+
+        if (keyframe) {
+            keyframe_offset = guacenc_index_parser_offset(parser, fd);
+            recording_offset = strtoll(parser->argv[1], NULL, 10);
+        }
+
+    }
+
+    guac_parser_free(parser);
+    guac_socket_free(socket);
+
+    /* Positions are relative to the start of the recording regardless of
+     * whether a keyframe could be used */
+    display->first_sync = first;
+
+    if (keyframe_offset == -1)
+        return 0;
+
+    if (guacenc_index_replay_keyframe(display, path, keyframe_offset))
+        return -1;
+
+    return recording_offset;
+
+}
+
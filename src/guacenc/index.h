@@ -0,0 +1,183 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUACENC_INDEX_H
+#define GUACENC_INDEX_H
+
+#include "display.h"
+
+#include <guacamole/parser.h>
+#include <guacamole/socket.h>
+#include <guacamole/timestamp.h>
+
+#include <sys/types.h>
+
+/**
+ * The minimum amount of time between consecutive "index" entries within a
+ * recording index, in milliseconds.
+ */
+#define GUACENC_INDEX_INTERVAL 1000
+
+/**
+ * The minimum amount of time between consecutive keyframes within a
+ * recording index, in milliseconds.
+ */
+#define GUACENC_INDEX_KEYFRAME_INTERVAL 60000
+
+/**
+ * The maximum number of bytes of PNG data to include in each "blob"
+ * instruction of a keyframe.
+ */
+#define GUACENC_INDEX_BLOB_SIZE 6048
+
+/**
+ * The suffix appended to the filename of a recording to produce the filename
+ * of its index.
+ */
+#define GUACENC_INDEX_SUFFIX ".idx"
+
+/**
+ * A recording index which is being written. A recording index is a sidecar
+ * file consisting of Guacamole instructions which map the timestamps of
+ * "sync" instructions within a recording to the byte offsets of the
+ * instructions that follow them. Two custom instructions are used:
+ *
+ *     index,TIMESTAMP,OFFSET;
+ *
+ * marks the position following a "sync" instruction, while
+ *
+ *     keyframe,TIMESTAMP,OFFSET;
+ *
+ * marks the same but is additionally followed by the instructions necessary
+ * to restore the state of all layers, buffers, and the mouse cursor as of
+ * that position, terminated by "sync,TIMESTAMP;". A recording can thus be
+ * replayed from any keyframe by first replaying the keyframe itself and then
+ * reading the recording from OFFSET.
+ */
+typedef struct guacenc_index {
+
+    /**
+     * The guac_socket wrapping the file descriptor of the index file.
+     */
+    guac_socket* socket;
+
+    /**
+     * The timestamp of the most recent "index" or "keyframe" entry written,
+     * or 0 if no entries have yet been written.
+     */
+    guac_timestamp last_entry;
+
+    /**
+     * The timestamp of the most recent keyframe written, or 0 if no keyframes
+     * have yet been written.
+     */
+    guac_timestamp last_keyframe;
+
+} guacenc_index;
+
+/**
+ * Creates a new recording index at the given path. Any existing file at the
+ * given path is overwritten.
+ *
+ * @param path
+ *     The full path to the index file that should be written.
+ *
+ * @return
+ *     A newly-allocated guacenc_index, or NULL if the index file cannot be
+ *     created.
+ */
+guacenc_index* guacenc_index_alloc(const char* path);
+
+/**
+ * Records the position following a "sync" instruction that has just been
+ * handled by the given display, writing an "index" entry or a keyframe if
+ * sufficient time has elapsed since the previous entry or keyframe.
+ *
+ * @param index
+ *     The index to update.
+ *
+ * @param display
+ *     The display which has just handled the "sync" instruction. The
+ *     timestamp of that instruction is taken from this display, as is the
+ *     layer state stored within any keyframe.
+ *
+ * @param offset
+ *     The byte offset within the recording of the instruction immediately
+ *     following the "sync" instruction.
+ *
+ * @return
+ *     Zero on success, non-zero if the index could not be written.
+ */
+int guacenc_index_add(guacenc_index* index, guacenc_display* display,
+        off_t offset);
+
+/**
+ * Flushes and closes the given index, freeing all associated resources.
+ *
+ * @param index
+ *     The index to free.
+ *
+ * @return
+ *     Zero if the index was written successfully, non-zero otherwise.
+ */
+int guacenc_index_free(guacenc_index* index);
+
+/**
+ * Restores the given display to the state recorded by the last keyframe in
+ * the given index which precedes the requested position, returning the byte
+ * offset within the recording from which reading should continue.
+ *
+ * @param display
+ *     The display to restore. This display should not yet have handled any
+ *     instructions.
+ *
+ * @param path
+ *     The full path to the index file to read.
+ *
+ * @param position
+ *     The requested position within the recording, in milliseconds relative
+ *     to the first entry of the index.
+ *
+ * @return
+ *     The byte offset within the recording from which reading should
+ *     continue, 0 if no keyframe precedes the requested position, or -1 if
+ *     the index cannot be read.
+ */
+off_t guacenc_index_seek(guacenc_display* display, const char* path,
+        guac_timestamp position);
+
+/**
+ * Returns the byte offset of the next instruction that the given parser will
+ * return, given that all data read by that parser has been read from the
+ * given file descriptor.
+ *
+ * @param parser
+ *     The parser reading from the given file descriptor.
+ *
+ * @param fd
+ *     The file descriptor that the parser is reading from.
+ *
+ * @return
+ *     The byte offset of the next instruction within the file, or -1 if the
+ *     current position of the file descriptor cannot be determined.
+ */
+off_t guacenc_index_parser_offset(guac_parser* parser, int fd);
+
+#endif
+
@@ -0,0 +1,132 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "display.h"
+#include "index.h"
+
+#include <CUnit/CUnit.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * The contents of the index expected to be written by
+ * test_index__write_entries(): a keyframe for the (empty) display, followed
+ * by a single plain index entry.
+ */
+#define TEST_INDEX_EXPECTED              \
+    "8.keyframe,4.1000,3.123;"           \
+    "5.mouse,2.-1,2.-1,1.0,4.1000;"      \
+    "4.sync,4.1000,1.1;"                 \
+    "5.index,4.2100,3.456;"
+
+/**
+ * Creates a new, empty temporary file, as with mkstemp().
+ *
+ * @param path
+ *     The template for the path of the temporary file, ending with
+ *     "XXXXXX". The template is modified in place to contain the actual path.
+ */
+static void test_index_create_file(char* path) {
+
+    int fd = mkstemp(path);
+    CU_ASSERT_NOT_EQUAL_FATAL(fd, -1);
+    close(fd);
+
+}
+
+/**
+ * Writes index entries for a series of sync timestamps to a new index at the
+ * given path, as guacenc would while encoding a recording.
+ *
+ * @param path
+ *     The path of the index file to write.
+ */
+static void test_index_write(const char* path) {
+
+    guacenc_display* display = guacenc_display_alloc(NULL, NULL, 0, 0, 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(display);
+
+    guacenc_index* index = guacenc_index_alloc(path);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(index);
+
+    /* The first sync always produces a keyframe */
+    display->last_sync = 1000;
+    CU_ASSERT_EQUAL(guacenc_index_add(index, display, 123), 0);
+
+    /* Syncs less than GUACENC_INDEX_INTERVAL apart are not indexed */
+    display->last_sync = 1500;
+    CU_ASSERT_EQUAL(guacenc_index_add(index, display, 234), 0);
+
+    /* Syncs between keyframes produce plain index entries */
+    display->last_sync = 2100;
+    CU_ASSERT_EQUAL(guacenc_index_add(index, display, 456), 0);
+
+    CU_ASSERT_EQUAL(guacenc_index_free(index), 0);
+    CU_ASSERT_EQUAL(guacenc_display_free(display), 0);
+
+}
+
+/**
+ * Verifies that keyframes and plain index entries are written to the index
+ * at the expected intervals and in the expected format.
+ */
+void test_index__write_entries(void) {
+
+    char path[] = "/tmp/guacenc-test-index-XXXXXX";
+    test_index_create_file(path);
+    test_index_write(path);
+
+    char contents[256];
+    FILE* file = fopen(path, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+
+    size_t length = fread(contents, 1, sizeof(contents), file);
+    fclose(file);
+    unlink(path);
+
+    CU_ASSERT_EQUAL_FATAL(length, strlen(TEST_INDEX_EXPECTED));
+    CU_ASSERT_NSTRING_EQUAL(contents, TEST_INDEX_EXPECTED, length);
+
+}
+
+/**
+ * Verifies that seeking using a written index locates the keyframe preceding
+ * the requested position, returning the corresponding offset within the
+ * recording.
+ */
+void test_index__seek(void) {
+
+    char path[] = "/tmp/guacenc-test-index-XXXXXX";
+    test_index_create_file(path);
+    test_index_write(path);
+
+    guacenc_display* display = guacenc_display_alloc(NULL, NULL, 0, 0, 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(display);
+
+    /* Positions are relative to the first indexed sync */
+    CU_ASSERT_EQUAL(guacenc_index_seek(display, path, 1500), 123);
+    CU_ASSERT_EQUAL(display->first_sync, 1000);
+
+    CU_ASSERT_EQUAL(guacenc_display_free(display), 0);
+    unlink(path);
+
+}
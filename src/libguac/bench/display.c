@@ -0,0 +1,557 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/**
+ * Standalone benchmark of the guac_display rendering pipeline. A sequence of
+ * frames, either generated from one of several synthetic patterns or read
+ * from a file of captured raw framebuffer contents, is drawn to the default
+ * layer of a guac_display and flushed with guac_display_end_frame(). All
+ * resulting Guacamole protocol data is written to a socket which does nothing
+ * but count the bytes written.
+ *
+ * Once all frames have been rendered, the time spent within each phase of
+ * frame planning, the time spent encoding each image format, the number of
+ * bytes emitted, and the overall number of frames per second are printed to
+ * STDOUT.
+ *
+ * @file display.c
+ */
+
+#include "display-priv.h"
+
+#include <guacamole/client.h>
+#include <guacamole/display.h>
+#include <guacamole/fifo.h>
+#include <guacamole/mem.h>
+#include <guacamole/metrics.h>
+#include <guacamole/rect.h>
+#include <guacamole/socket.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The default width of the display, in pixels, if no width is specified.
+ */
+#define GUAC_BENCH_DEFAULT_WIDTH 1920
+
+/**
+ * The default height of the display, in pixels, if no height is specified.
+ */
+#define GUAC_BENCH_DEFAULT_HEIGHT 1080
+
+/**
+ * The default number of frames to render, if no frame count is specified.
+ */
+#define GUAC_BENCH_DEFAULT_FRAMES 300
+
+/**
+ * The number of rows that the "scroll" pattern scrolls with each frame.
+ */
+#define GUAC_BENCH_SCROLL_ROWS 16
+
+/**
+ * The width of each character cell of the "typing" pattern, in pixels.
+ */
+#define GUAC_BENCH_CHAR_WIDTH 8
+
+/**
+ * The height of each character cell of the "typing" pattern, in pixels.
+ */
+#define GUAC_BENCH_CHAR_HEIGHT 16
+
+/**
+ * The number of nanoseconds to wait between checks for whether the display
+ * has finished rendering the current frame.
+ */
+#define GUAC_BENCH_POLL_NSEC 100000
+
+/**
+ * Human-readable names of each phase of frame planning, in the order that
+ * their durations are stored within guac_metrics.
+ */
+static const char* GUAC_BENCH_PHASE_NAMES[GUAC_DISPLAY_PLAN_PHASES] = {
+    "draft", "rects", "search", "combine", "commit"
+};
+
+/**
+ * Human-readable names of each image encoding, in the order defined by
+ * guac_display_encoding.
+ */
+static const char* GUAC_BENCH_ENCODING_NAMES[GUAC_DISPLAY_ENCODINGS] = {
+    "png", "jpeg", "webp", "video"
+};
+
+/**
+ * Function which draws the next frame of a benchmark pattern.
+ *
+ * @param context
+ *     The raw context of the layer being drawn to. The pattern must update
+ *     the dirty rect of this context to cover the region that was modified.
+ *
+ * @param frame
+ *     The zero-based index of the frame being drawn.
+ *
+ * @param data
+ *     Arbitrary pattern-specific data.
+ *
+ * @return
+ *     Zero if the frame was drawn successfully, non-zero if no further frames
+ *     are available.
+ */
+typedef int guac_bench_pattern(guac_display_layer_raw_context* context,
+        int frame, void* data);
+
+/**
+ * The total number of bytes written to the benchmark socket.
+ */
+static uint64_t guac_bench_bytes_written = 0;
+
+/**
+ * Socket write handler which discards all data, only counting the number of
+ * bytes written.
+ *
+ * @param socket
+ *     The guac_socket being written to.
+ *
+ * @param buf
+ *     The data being written.
+ *
+ * @param count
+ *     The number of bytes being written.
+ *
+ * @return
+ *     The number of bytes written, which is always the number of bytes
+ *     provided.
+ */
+static ssize_t guac_bench_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+    __atomic_add_fetch(&guac_bench_bytes_written, count, __ATOMIC_RELAXED);
+    return count;
+}
+
+/**
+ * Log handler which discards all messages, such that logging does not
+ * contribute to benchmark results.
+ */
+static void guac_bench_log_handler(guac_client* client,
+        guac_client_log_level level, const char* format, va_list args) {
+    /* Ignore all log messages */
+}
+
+/**
+ * Sets every pixel within the given rectangle of the given raw context to
+ * the given opaque color, extending the dirty rect of the context to cover
+ * that rectangle.
+ *
+ * @param context
+ *     The raw context to draw to.
+ *
+ * @param rect
+ *     The rectangle to fill.
+ *
+ * @param color
+ *     The color to fill the rectangle with, in 32-bit RGB.
+ */
+static void guac_bench_fill(guac_display_layer_raw_context* context,
+        const guac_rect* rect, uint32_t color) {
+
+    for (int y = rect->top; y < rect->bottom; y++) {
+        uint32_t* row = (uint32_t*) (context->buffer + y * context->stride);
+        for (int x = rect->left; x < rect->right; x++)
+            row[x] = 0xFF000000 | color;
+    }
+
+    guac_rect_extend(&context->dirty, rect);
+
+}
+
+/**
+ * Benchmark pattern which fills the entire display with a different solid
+ * color every frame.
+ */
+static int guac_bench_pattern_solid(guac_display_layer_raw_context* context,
+        int frame, void* data) {
+    guac_bench_fill(context, &context->bounds, frame * 0x010305);
+    return 0;
+}
+
+/**
+ * Benchmark pattern which scrolls the contents of the display upward with
+ * every frame, drawing a new row of text-like content at the bottom,
+ * similar to the output of a terminal or a scrolling document.
+ */
+static int guac_bench_pattern_scroll(guac_display_layer_raw_context* context,
+        int frame, void* data) {
+
+    int width = guac_rect_width(&context->bounds);
+    int height = guac_rect_height(&context->bounds);
+
+    if (height <= GUAC_BENCH_SCROLL_ROWS)
+        return guac_bench_pattern_solid(context, frame, data);
+
+    /* Shift existing contents up */
+    memmove(context->buffer,
+            context->buffer + GUAC_BENCH_SCROLL_ROWS * context->stride,
+            (height - GUAC_BENCH_SCROLL_ROWS) * context->stride);
+
+    /* Draw new line of "words" along the bottom */
+    guac_rect line;
+    guac_rect_init(&line, 0, height - GUAC_BENCH_SCROLL_ROWS,
+            width, GUAC_BENCH_SCROLL_ROWS);
+    guac_bench_fill(context, &line, 0xFFFFFF);
+
+    unsigned int seed = frame;
+    for (int x = 0; x < width; x += GUAC_BENCH_CHAR_WIDTH) {
+
+        /* Leave occasional gaps between words */
+        if (rand_r(&seed) % 6 == 0)
+            continue;
+
+        guac_rect glyph;
+        guac_rect_init(&glyph, x + 1, line.top + 3,
+                GUAC_BENCH_CHAR_WIDTH - 2, GUAC_BENCH_SCROLL_ROWS - 6);
+        guac_rect_constrain(&glyph, &line);
+        guac_bench_fill(context, &glyph, 0x202020);
+
+    }
+
+    context->dirty = context->bounds;
+    return 0;
+
+}
+
+/**
+ * Benchmark pattern which redraws a video-like region of random noise in the
+ * center of the display with every frame.
+ */
+static int guac_bench_pattern_noise(guac_display_layer_raw_context* context,
+        int frame, void* data) {
+
+    int width = guac_rect_width(&context->bounds);
+    int height = guac_rect_height(&context->bounds);
+
+    guac_rect region;
+    guac_rect_init(&region, width / 4, height / 4, width / 2, height / 2);
+
+    unsigned int seed = frame;
+    for (int y = region.top; y < region.bottom; y++) {
+        uint32_t* row = (uint32_t*) (context->buffer + y * context->stride);
+        for (int x = region.left; x < region.right; x++)
+            row[x] = 0xFF000000 | (rand_r(&seed) & 0xFFFFFF);
+    }
+
+    guac_rect_extend(&context->dirty, &region);
+    return 0;
+
+}
+
+/**
+ * Benchmark pattern which draws a single character cell with every frame,
+ * advancing left to right and top to bottom, similar to a user typing into
+ * a text editor.
+ */
+static int guac_bench_pattern_typing(guac_display_layer_raw_context* context,
+        int frame, void* data) {
+
+    int columns = guac_rect_width(&context->bounds) / GUAC_BENCH_CHAR_WIDTH;
+    int rows = guac_rect_height(&context->bounds) / GUAC_BENCH_CHAR_HEIGHT;
+
+    if (columns <= 0 || rows <= 0)
+        return guac_bench_pattern_solid(context, frame, data);
+
+    /* Clear the screen upon reaching the end */
+    int cell = frame % (columns * rows);
+    if (cell == 0)
+        guac_bench_fill(context, &context->bounds, 0xFFFFFF);
+
+    guac_rect glyph;
+    guac_rect_init(&glyph,
+            (cell % columns) * GUAC_BENCH_CHAR_WIDTH + 1,
+            (cell / columns) * GUAC_BENCH_CHAR_HEIGHT + 3,
+            GUAC_BENCH_CHAR_WIDTH - 2, GUAC_BENCH_CHAR_HEIGHT - 6);
+
+    guac_bench_fill(context, &glyph, 0x202020);
+    return 0;
+
+}
+
+/**
+ * Benchmark pattern which reads each frame from a file of raw framebuffer
+ * contents, where each frame is stored as consecutive rows of 32-bit pixels
+ * in host byte order with the same dimensions as the display. The file is
+ * rewound upon reaching its end.
+ *
+ * @param data
+ *     The FILE* to read frames from.
+ */
+static int guac_bench_pattern_file(guac_display_layer_raw_context* context,
+        int frame, void* data) {
+
+    FILE* file = (FILE*) data;
+
+    int width = guac_rect_width(&context->bounds);
+    int height = guac_rect_height(&context->bounds);
+    size_t row_size = width * 4;
+
+    for (int y = 0; y < height; y++) {
+
+        unsigned char* row = context->buffer + y * context->stride;
+
+        if (fread(row, 1, row_size, file) != row_size) {
+
+            /* Loop back to the first frame if the end of the file is reached
+             * exactly at a frame boundary */
+            if (y == 0 && feof(file) && ftell(file) > 0) {
+                rewind(file);
+                y--;
+                continue;
+            }
+
+            return 1;
+
+        }
+
+        /* Captured framebuffers are not guaranteed to be opaque */
+        uint32_t* pixels = (uint32_t*) row;
+        for (int x = 0; x < width; x++)
+            pixels[x] |= 0xFF000000;
+
+    }
+
+    /* Rely on the display to determine what has actually changed */
+    context->dirty = context->bounds;
+    return 0;
+
+}
+
+/**
+ * Blocks until the given display has finished rendering all frames, including
+ * any frames that were deferred while a previous frame was being rendered.
+ *
+ * @param display
+ *     The display to wait for.
+ */
+static void guac_bench_wait_for_display(guac_display* display) {
+
+    struct timespec delay = {
+        .tv_sec = 0,
+        .tv_nsec = GUAC_BENCH_POLL_NSEC
+    };
+
+    for (;;) {
+
+        guac_fifo_lock(&display->ops);
+        int busy = (display->ops.state.value & GUAC_FIFO_STATE_NONEMPTY)
+            || display->active_workers
+            || display->frame_deferred;
+        guac_fifo_unlock(&display->ops);
+
+        if (!busy)
+            return;
+
+        nanosleep(&delay, NULL);
+
+    }
+
+}
+
+/**
+ * Prints the results of a completed benchmark to STDOUT.
+ *
+ * @param display
+ *     The display that was benchmarked.
+ *
+ * @param frames
+ *     The number of frames rendered.
+ *
+ * @param elapsed
+ *     The total time taken to render all frames, in microseconds.
+ */
+static void guac_bench_report(guac_display* display, int frames,
+        uint64_t elapsed) {
+
+    guac_metrics* metrics = guac_display_metrics(display);
+
+    double seconds = elapsed / 1000000.0;
+    printf("frames:        %i\n", frames);
+    printf("elapsed:       %.3f s\n", seconds);
+    printf("fps:           %.2f\n", seconds > 0 ? frames / seconds : 0.0);
+    printf("bytes:         %" PRIu64 "\n", guac_bench_bytes_written);
+    printf("bytes/frame:   %" PRIu64 "\n",
+            frames > 0 ? guac_bench_bytes_written / frames : 0);
+
+    printf("\nplanning (average per frame):\n");
+    for (int i = 0; i < GUAC_DISPLAY_PLAN_PHASES; i++)
+        printf("  %-10s %10.3f ms\n", GUAC_BENCH_PHASE_NAMES[i],
+                frames > 0 ? guac_metrics_get(&metrics->plan_usec[i])
+                    / 1000.0 / frames : 0.0);
+
+    printf("\nencoding:\n");
+    for (int i = 0; i < GUAC_DISPLAY_ENCODINGS; i++) {
+
+        uint64_t count = guac_metrics_get(&metrics->encode_count[i]);
+        uint64_t usec = guac_metrics_get(&metrics->encode_usec[i]);
+        printf("  %-10s %8" PRIu64 " images, %10.3f ms total,"
+                " %8.3f ms/image, %12" PRIu64 " pixels\n",
+                GUAC_BENCH_ENCODING_NAMES[i], count, usec / 1000.0,
+                count > 0 ? usec / 1000.0 / count : 0.0,
+                guac_metrics_get(&metrics->encode_pixels[i]));
+
+    }
+
+}
+
+/**
+ * Prints usage information for the benchmark to STDERR.
+ *
+ * @param name
+ *     The name of the benchmark executable.
+ */
+static void guac_bench_usage(const char* name) {
+    fprintf(stderr, "USAGE: %s"
+            " [-w WIDTH]"
+            " [-h HEIGHT]"
+            " [-n FRAMES]"
+            " [-p solid|scroll|noise|typing]"
+            " [-f RAW_FRAME_FILE]\n", name);
+}
+
+int main(int argc, char** argv) {
+
+    int width = GUAC_BENCH_DEFAULT_WIDTH;
+    int height = GUAC_BENCH_DEFAULT_HEIGHT;
+    int frames = GUAC_BENCH_DEFAULT_FRAMES;
+    guac_bench_pattern* pattern = guac_bench_pattern_solid;
+    const char* filename = NULL;
+
+    /* Parse arguments */
+    int opt;
+    while ((opt = getopt(argc, argv, "w:h:n:p:f:")) != -1) {
+
+        /* -w: Display width */
+        if (opt == 'w')
+            width = atoi(optarg);
+
+        /* -h: Display height */
+        else if (opt == 'h')
+            height = atoi(optarg);
+
+        /* -n: Number of frames */
+        else if (opt == 'n')
+            frames = atoi(optarg);
+
+        /* -p: Synthetic pattern */
+        else if (opt == 'p') {
+            if (strcmp(optarg, "solid") == 0)
+                pattern = guac_bench_pattern_solid;
+            else if (strcmp(optarg, "scroll") == 0)
+                pattern = guac_bench_pattern_scroll;
+            else if (strcmp(optarg, "noise") == 0)
+                pattern = guac_bench_pattern_noise;
+            else if (strcmp(optarg, "typing") == 0)
+                pattern = guac_bench_pattern_typing;
+            else {
+                fprintf(stderr, "Invalid pattern: \"%s\"\n", optarg);
+                return 1;
+            }
+        }
+
+        /* -f: Captured raw frames */
+        else if (opt == 'f')
+            filename = optarg;
+
+        else {
+            guac_bench_usage(argv[0]);
+            return 1;
+        }
+
+    }
+
+    if (width <= 0 || height <= 0 || frames <= 0) {
+        guac_bench_usage(argv[0]);
+        return 1;
+    }
+
+    FILE* file = NULL;
+    if (filename != NULL) {
+
+        file = fopen(filename, "rb");
+        if (file == NULL) {
+            fprintf(stderr, "Unable to open \"%s\": %s\n", filename,
+                    strerror(errno));
+            return 1;
+        }
+
+        pattern = guac_bench_pattern_file;
+
+    }
+
+    /* Replace the broadcast socket of the client with a socket that only
+     * counts the bytes written */
+    guac_client* client = guac_client_alloc();
+    client->log_handler = guac_bench_log_handler;
+    guac_socket_free(client->socket);
+    client->socket = guac_socket_alloc();
+    client->socket->write_handler = guac_bench_write_handler;
+
+    guac_display* display = guac_display_alloc(client);
+    guac_display_layer* layer = guac_display_default_layer(display);
+    guac_display_layer_resize(layer, width, height);
+
+    int rendered = 0;
+    uint64_t start = guac_display_usec_current();
+
+    for (; rendered < frames; rendered++) {
+
+        guac_display_layer_raw_context* context = guac_display_layer_open_raw(layer);
+        int result = pattern(context, rendered, file);
+        guac_display_layer_close_raw(layer, context);
+
+        if (result) {
+            fprintf(stderr, "Unable to read frame %i.\n", rendered + 1);
+            break;
+        }
+
+        /* Render each frame to completion before moving on to the next such
+         * that all frames are actually encoded */
+        guac_display_end_frame(display);
+        guac_bench_wait_for_display(display);
+
+    }
+
+    uint64_t elapsed = guac_display_usec_current() - start;
+    guac_bench_report(display, rendered, elapsed);
+
+    guac_display_free(display);
+    guac_client_free(client);
+
+    if (file != NULL)
+        fclose(file);
+
+    return 0;
+
+}
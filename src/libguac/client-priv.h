@@ -0,0 +1,173 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_CLIENT_PRIV_H
+#define GUAC_CLIENT_PRIV_H
+
+/**
+ * Variants of the guac_client_stream_png(), guac_client_stream_jpeg(), and
+ * guac_client_stream_webp() functions which reuse the state of an existing
+ * encoder rather than creating new encoder state for each image. These are
+ * used only internally within libguac, and are not installed along with the
+ * library.
+ *
+ * @file client-priv.h
+ */
+
+#include "encode-jpeg.h"
+#include "encode-png.h"
+#include "guacamole/client.h"
+#include "guacamole/layer.h"
+#include "guacamole/protocol-types.h"
+#include "guacamole/socket.h"
+
+#ifdef ENABLE_WEBP
+#include "encode-webp.h"
+#endif
+
+#include <cairo/cairo.h>
+
+/**
+ * Streams the image data of the given surface over an image stream ("img"
+ * instruction) as PNG-encoded data using the given encoder. This is identical
+ * to guac_client_stream_png(), except that the state of the given encoder is
+ * reused.
+ *
+ * @param client
+ *     The Guacamole client for which the image stream should be allocated.
+ *
+ * @param encoder
+ *     The encoder to use to encode the surface.
+ *
+ * @param socket
+ *     The socket over which instructions associated with the image stream
+ *     should be sent.
+ *
+ * @param mode
+ *     The composite mode to use when rendering the image over the given layer.
+ *
+ * @param layer
+ *     The destination layer.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the destination rectangle
+ *     within the given layer.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the destination rectangle
+ *     within the given layer.
+ *
+ * @param surface
+ *     A Cairo surface containing the image data to be streamed.
+ */
+void guac_client_stream_png_with_encoder(guac_client* client,
+        guac_png_encoder* encoder, guac_socket* socket,
+        guac_composite_mode mode, const guac_layer* layer, int x, int y,
+        cairo_surface_t* surface);
+
+/**
+ * Streams the image data of the given surface over an image stream ("img"
+ * instruction) as JPEG-encoded data at the given quality using the given
+ * encoder. This is identical to guac_client_stream_jpeg(), except that the
+ * state of the given encoder is reused.
+ *
+ * @param client
+ *     The Guacamole client for which the image stream should be allocated.
+ *
+ * @param encoder
+ *     The encoder to use to encode the surface.
+ *
+ * @param socket
+ *     The socket over which instructions associated with the image stream
+ *     should be sent.
+ *
+ * @param mode
+ *     The composite mode to use when rendering the image over the given layer.
+ *
+ * @param layer
+ *     The destination layer.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the destination rectangle
+ *     within the given layer.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the destination rectangle
+ *     within the given layer.
+ *
+ * @param surface
+ *     A Cairo surface containing the image data to be streamed.
+ *
+ * @param quality
+ *     The JPEG image quality, which must be an integer value between 0 and 100
+ *     inclusive.
+ */
+void guac_client_stream_jpeg_with_encoder(guac_client* client,
+        guac_jpeg_encoder* encoder, guac_socket* socket,
+        guac_composite_mode mode, const guac_layer* layer, int x, int y,
+        cairo_surface_t* surface, int quality);
+
+#ifdef ENABLE_WEBP
+/**
+ * Streams the image data of the given surface over an image stream ("img"
+ * instruction) as WebP-encoded data at the given quality using the given
+ * encoder. This is identical to guac_client_stream_webp(), except that the
+ * state of the given encoder is reused.
+ *
+ * @param client
+ *     The Guacamole client for which the image stream should be allocated.
+ *
+ * @param encoder
+ *     The encoder to use to encode the surface.
+ *
+ * @param socket
+ *     The socket over which instructions associated with the image stream
+ *     should be sent.
+ *
+ * @param mode
+ *     The composite mode to use when rendering the image over the given layer.
+ *
+ * @param layer
+ *     The destination layer.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the destination rectangle
+ *     within the given layer.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the destination rectangle
+ *     within the given layer.
+ *
+ * @param surface
+ *     A Cairo surface containing the image data to be streamed.
+ *
+ * @param quality
+ *     The WebP image quality, which must be an integer value between 0 and
+ *     100 inclusive.
+ *
+ * @param lossless
+ *     Zero to encode a lossy image, non-zero to encode losslessly.
+ */
+void guac_client_stream_webp_with_encoder(guac_client* client,
+        guac_webp_encoder* encoder, guac_socket* socket,
+        guac_composite_mode mode, const guac_layer* layer, int x, int y,
+        cairo_surface_t* surface, int quality, int lossless);
+#endif
+
+#endif
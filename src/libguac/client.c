@@ -17,6 +17,7 @@
  * under the License.
  */
 
+#include "client-priv.h"
 #include "encode-jpeg.h"
 #include "encode-png.h"
 #include "encode-webp.h"
@@ -26,12 +27,12 @@
 #include "guacamole/layer.h"
 #include "guacamole/plugin.h"
 #include "guacamole/pool.h"
-#include "guacamole/proctitle.h"
 #include "guacamole/protocol.h"
 #include "guacamole/rwlock.h"
 #include "guacamole/socket.h"
 #include "guacamole/stream.h"
 #include "guacamole/string.h"
+#include "guacamole/timer.h"
 #include "guacamole/timestamp.h"
 #include "guacamole/user.h"
 #include "id.h"
@@ -46,12 +47,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-/**
- * The number of milliseconds between times that the pending users list will be
- * synchronized and emptied (250 milliseconds aka 1/4 second).
- */
-#define GUAC_CLIENT_PENDING_USERS_REFRESH_INTERVAL 250
-
 /**
  * A value that indicates that the pending users timer has yet to be
  * initialized and started.
@@ -227,30 +222,18 @@ promotion_complete:
 }
 
 /**
- * Thread that periodically checks for users that have requested to join the
- * current connection (pending users). The check is performed every
- * GUAC_CLIENT_PENDING_USERS_REFRESH_INTERVAL milliseconds.
+ * Callback invoked by the pending users timer whenever a user has requested
+ * to join the current connection, promoting all pending users.
  *
  * @param data
  *     A pointer to the guac_client associated with the connection.
- *
- * @return
- *     Always NULL.
  */
-static void* guac_client_pending_users_thread(void* data) {
-
-    /* Thread name user-pending: periodically promotes pending users into
-     * the active connection. */
-    guac_thread_name_set("user-pending");
+static void guac_client_pending_users_callback(void* data) {
 
     guac_client* client = (guac_client*) data;
 
-    while (client->state == GUAC_CLIENT_RUNNING) {
+    if (client->state == GUAC_CLIENT_RUNNING)
         guac_client_promote_pending_users(client);
-        guac_timestamp_msleep(GUAC_CLIENT_PENDING_USERS_REFRESH_INTERVAL);
-    }
-
-    return NULL;
 
 }
 
@@ -298,6 +281,11 @@ guac_client* guac_client_alloc(void) {
     guac_rwlock_init(&(client->__users_lock));
     guac_rwlock_init(&(client->__pending_users_lock));
 
+    /* Pending users are promoted by the process-wide timer thread as they
+     * join */
+    client->__pending_users_timer = guac_timer_alloc(
+            guac_client_pending_users_callback, client);
+
     /* Set up broadcast sockets */
     client->socket = guac_socket_broadcast(client);
     client->pending_socket = guac_socket_broadcast_pending(client);
@@ -311,6 +299,10 @@ void guac_client_free(guac_client* client) {
     /* Ensure that anything waiting for the client can begin shutting down */
     guac_client_stop(client);
 
+    /* Wait for any in-progress promotion of pending users to complete (this
+     * must be done before acquiring the locks required by that promotion) */
+    guac_timer_free(client->__pending_users_timer);
+
     /* Acquire write locks before referencing user pointers */
     guac_rwlock_acquire_write_lock(&(client->__pending_users_lock));
     guac_rwlock_acquire_write_lock(&(client->__users_lock));
@@ -323,11 +315,6 @@ void guac_client_free(guac_client* client) {
     while (client->__users != NULL)
         guac_client_remove_user(client, client->__users);
 
-    /* Clean up the thread monitoring for new pending users, if it's been
-     * started */
-    if (client->__pending_users_thread_started)
-        pthread_join(client->__pending_users_thread, NULL);
-
     /* Release the locks */
     guac_rwlock_release_lock(&(client->__users_lock));
     guac_rwlock_release_lock(&(client->__pending_users_lock));
@@ -442,13 +429,6 @@ static void guac_client_add_pending_user(guac_client* client,
     /* Acquire the lock for modifying the list of pending users */
     guac_rwlock_acquire_write_lock(&(client->__pending_users_lock));
 
-    /* Set up the pending user promotion mutex */
-    if (!client->__pending_users_thread_started) {
-        pthread_create(&client->__pending_users_thread, NULL,
-                guac_client_pending_users_thread, (void*) client);
-        client->__pending_users_thread_started = 1;
-    }
-
     user->__prev = NULL;
     user->__next = client->__pending_users;
 
@@ -460,6 +440,9 @@ static void guac_client_add_pending_user(guac_client* client,
     /* Increment the user count */
     client->connected_users++;
 
+    /* Promote the new user as soon as possible */
+    guac_timer_schedule(client->__pending_users_timer, 0, 0);
+
     /* Release the lock */
     guac_rwlock_release_lock(&(client->__pending_users_lock));
 
@@ -788,7 +771,8 @@ void guac_client_stream_argv(guac_client* client, guac_socket* socket,
 
 }
 
-void guac_client_stream_png(guac_client* client, guac_socket* socket,
+void guac_client_stream_png_with_encoder(guac_client* client,
+        guac_png_encoder* encoder, guac_socket* socket,
         guac_composite_mode mode, const guac_layer* layer, int x, int y,
         cairo_surface_t* surface) {
 
@@ -799,7 +783,7 @@ void guac_client_stream_png(guac_client* client, guac_socket* socket,
     guac_protocol_send_img(socket, stream, mode, layer, "image/png", x, y);
 
     /* Write PNG data */
-    guac_png_write(socket, stream, surface);
+    guac_png_encoder_write(encoder, socket, stream, surface);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
@@ -809,7 +793,19 @@ void guac_client_stream_png(guac_client* client, guac_socket* socket,
 
 }
 
-void guac_client_stream_jpeg(guac_client* client, guac_socket* socket,
+void guac_client_stream_png(guac_client* client, guac_socket* socket,
+        guac_composite_mode mode, const guac_layer* layer, int x, int y,
+        cairo_surface_t* surface) {
+
+    guac_png_encoder* encoder = guac_png_encoder_alloc();
+    guac_client_stream_png_with_encoder(client, encoder, socket, mode, layer,
+            x, y, surface);
+    guac_png_encoder_free(encoder);
+
+}
+
+void guac_client_stream_jpeg_with_encoder(guac_client* client,
+        guac_jpeg_encoder* encoder, guac_socket* socket,
         guac_composite_mode mode, const guac_layer* layer, int x, int y,
         cairo_surface_t* surface, int quality) {
 
@@ -820,7 +816,7 @@ void guac_client_stream_jpeg(guac_client* client, guac_socket* socket,
     guac_protocol_send_img(socket, stream, mode, layer, "image/jpeg", x, y);
 
     /* Write JPEG data */
-    guac_jpeg_write(socket, stream, surface, quality);
+    guac_jpeg_encoder_write(encoder, socket, stream, surface, quality);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
@@ -830,11 +826,23 @@ void guac_client_stream_jpeg(guac_client* client, guac_socket* socket,
 
 }
 
-void guac_client_stream_webp(guac_client* client, guac_socket* socket,
+void guac_client_stream_jpeg(guac_client* client, guac_socket* socket,
         guac_composite_mode mode, const guac_layer* layer, int x, int y,
-        cairo_surface_t* surface, int quality, int lossless) {
+        cairo_surface_t* surface, int quality) {
+
+    guac_jpeg_encoder* encoder = guac_jpeg_encoder_alloc();
+    guac_client_stream_jpeg_with_encoder(client, encoder, socket, mode, layer,
+            x, y, surface, quality);
+    guac_jpeg_encoder_free(encoder);
+
+}
 
 #ifdef ENABLE_WEBP
+void guac_client_stream_webp_with_encoder(guac_client* client,
+        guac_webp_encoder* encoder, guac_socket* socket,
+        guac_composite_mode mode, const guac_layer* layer, int x, int y,
+        cairo_surface_t* surface, int quality, int lossless) {
+
     /* Allocate new stream for image */
     guac_stream* stream = guac_client_alloc_stream(client);
 
@@ -842,13 +850,26 @@ void guac_client_stream_webp(guac_client* client, guac_socket* socket,
     guac_protocol_send_img(socket, stream, mode, layer, "image/webp", x, y);
 
     /* Write WebP data */
-    guac_webp_write(socket, stream, surface, quality, lossless);
+    guac_webp_encoder_write(encoder, socket, stream, surface, quality, lossless);
 
     /* Terminate stream */
     guac_protocol_send_end(socket, stream);
 
     /* Free allocated stream */
     guac_client_free_stream(client, stream);
+
+}
+#endif
+
+void guac_client_stream_webp(guac_client* client, guac_socket* socket,
+        guac_composite_mode mode, const guac_layer* layer, int x, int y,
+        cairo_surface_t* surface, int quality, int lossless) {
+
+#ifdef ENABLE_WEBP
+    guac_webp_encoder* encoder = guac_webp_encoder_alloc();
+    guac_client_stream_webp_with_encoder(client, encoder, socket, mode, layer,
+            x, y, surface, quality, lossless);
+    guac_webp_encoder_free(encoder);
 #else
     /* Do nothing if WebP support is not built in */
 #endif
@@ -0,0 +1,960 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "display-plan.h"
+#include "display-priv.h"
+#include "encode-png.h"
+#include "guacamole/client.h"
+#include "guacamole/display.h"
+#include "guacamole/flag.h"
+#include "guacamole/layer.h"
+#include "guacamole/mem.h"
+#include "guacamole/protocol.h"
+#include "guacamole/rect.h"
+#include "guacamole/rwlock.h"
+#include "guacamole/socket.h"
+
+#include <cairo/cairo.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The quality to use when sending lossy tiles to joining users. Lossy tiles
+ * are always subsequently replaced with lossless equivalents, so this need
+ * only be high enough for the initial view to be reasonable.
+ */
+#define GUAC_DISPLAY_DUP_LOSSY_QUALITY 60
+
+/**
+ * A copy of the state of a single layer as of the last frame, taken at the
+ * start of synchronizing joining users.
+ */
+typedef struct guac_display_dup_layer {
+
+    /**
+     * The layer copied. This is a copy of the guac_layer (just its index), and
+     * remains valid even if the original layer is freed.
+     */
+    guac_layer layer;
+
+    /**
+     * The width of the layer, in pixels.
+     */
+    int width;
+
+    /**
+     * The height of the layer, in pixels.
+     */
+    int height;
+
+    /**
+     * Whether the layer is opaque. Non-zero if the layer has no alpha
+     * transparency, zero otherwise.
+     */
+    int opaque;
+
+    /**
+     * Whether lossless compression is required for the layer. Non-zero if
+     * lossy compression must not be used, zero otherwise.
+     */
+    int lossless;
+
+    /**
+     * A copy of the image data of the layer, or NULL if the layer is empty.
+     */
+    unsigned char* buffer;
+
+    /**
+     * The number of bytes in each row of buffer.
+     */
+    size_t stride;
+
+    /**
+     * The tiles covering this layer, in the same row-major order as the
+     * layer's cached keyframe.
+     */
+    struct guac_display_dup_tile* tiles;
+
+    /**
+     * The number of tiles covering this layer.
+     */
+    int tile_count;
+
+} guac_display_dup_layer;
+
+/**
+ * A rectangular region of a copied layer that is encoded and sent to joining
+ * users independently of all other regions.
+ */
+typedef struct guac_display_dup_tile {
+
+    /**
+     * The copied layer containing this tile.
+     */
+    guac_display_dup_layer* layer;
+
+    /**
+     * The region of the layer covered by this tile.
+     */
+    guac_rect rect;
+
+    /**
+     * Whether this tile was sent using lossy compression, and must later be
+     * resent losslessly. Non-zero if lossy compression was used, zero
+     * otherwise.
+     */
+    int lossy;
+
+    /**
+     * The PNG-encoded contents of this tile, or NULL if the tile has not been
+     * encoded as PNG. This is either a copy of the tile as cached within the
+     * keyframe of the layer, or a new encoding that should be stored within
+     * that keyframe.
+     */
+    unsigned char* png;
+
+    /**
+     * The number of bytes within png.
+     */
+    size_t png_length;
+
+    /**
+     * Whether png is a copy of the tile as already cached within the
+     * keyframe of the layer. Non-zero if png came from the cache, zero
+     * otherwise.
+     */
+    int cached;
+
+    /**
+     * The generation of the corresponding tile of the layer's keyframe at
+     * the time the layer was copied.
+     */
+    uint64_t generation;
+
+} guac_display_dup_tile;
+
+/**
+ * The state of an in-progress synchronization of joining users, shared
+ * between all threads encoding tiles for those users.
+ */
+typedef struct guac_display_dup_state {
+
+    /**
+     * The display being synchronized.
+     */
+    guac_display* display;
+
+    /**
+     * The socket that should receive all instructions for the joining users.
+     */
+    guac_socket* socket;
+
+    /**
+     * Copies of all layers as of the last frame, in the same order as the
+     * last frame layer list.
+     */
+    guac_display_dup_layer* layers;
+
+    /**
+     * The number of layers within the layers array.
+     */
+    int layer_count;
+
+    /**
+     * All tiles covering the copied layers.
+     */
+    guac_display_dup_tile* tiles;
+
+    /**
+     * The number of tiles within the tiles array.
+     */
+    int tile_count;
+
+    /**
+     * The index of the next tile to be encoded by any thread.
+     */
+    int next_tile;
+
+    /**
+     * Whether tiles are being refined. If non-zero, only tiles previously
+     * sent using lossy compression are encoded, and are encoded losslessly.
+     */
+    int refine;
+
+    /**
+     * Lock which guards access to next_tile.
+     */
+    pthread_mutex_t lock;
+
+} guac_display_dup_state;
+
+/**
+ * Creates a new Cairo surface for the given region of the given image data.
+ * The surface refers to the image data directly, and must be destroyed with
+ * cairo_surface_destroy() before that data is freed.
+ *
+ * @param buffer
+ *     The first pixel of the image data, stored as 32-bit ARGB.
+ *
+ * @param stride
+ *     The number of bytes in each row of the image data.
+ *
+ * @param opaque
+ *     Non-zero if the image data has no alpha transparency, zero otherwise.
+ *
+ * @param rect
+ *     The region of the image data that the surface should cover.
+ *
+ * @return
+ *     A new Cairo surface covering the given region.
+ */
+static cairo_surface_t* guac_display_dup_surface(unsigned char* buffer,
+        size_t stride, int opaque, const guac_rect* rect) {
+
+    return cairo_image_surface_create_for_data(
+            buffer + rect->top * stride + rect->left * 4,
+            opaque ? CAIRO_FORMAT_RGB24 : CAIRO_FORMAT_ARGB32,
+            guac_rect_width(rect), guac_rect_height(rect), stride);
+
+}
+
+/**
+ * Sends the given PNG data as an image drawn to the given layer.
+ *
+ * @param client
+ *     The client associated with the display being synchronized.
+ *
+ * @param socket
+ *     The socket that should receive the image.
+ *
+ * @param layer
+ *     The layer that should receive the image.
+ *
+ * @param rect
+ *     The region of the layer that the image covers.
+ *
+ * @param png
+ *     The PNG data to send.
+ *
+ * @param length
+ *     The number of bytes of PNG data.
+ */
+static void guac_display_dup_send_png(guac_client* client, guac_socket* socket,
+        const guac_layer* layer, const guac_rect* rect,
+        const unsigned char* png, size_t length) {
+
+    guac_stream* stream = guac_client_alloc_stream(client);
+
+    guac_protocol_send_img(socket, stream, GUAC_COMP_OVER, layer, "image/png",
+            rect->left, rect->top);
+    guac_protocol_send_blobs(socket, stream, png, length);
+    guac_protocol_send_end(socket, stream);
+
+    guac_client_free_stream(client, stream);
+
+}
+
+/**
+ * Encodes the given tile losslessly as PNG and sends it, retaining the PNG
+ * data within the tile such that it may later be stored within the cached
+ * keyframe of the layer.
+ *
+ * @param state
+ *     The state of the synchronization.
+ *
+ * @param tile
+ *     The tile to send.
+ */
+static void guac_display_dup_send_lossless(guac_display_dup_state* state,
+        guac_display_dup_tile* tile) {
+
+    guac_client* client = state->display->client;
+    guac_display_dup_layer* layer = tile->layer;
+
+    cairo_surface_t* surface = guac_display_dup_surface(layer->buffer,
+            layer->stride, layer->opaque, &tile->rect);
+
+    if (!guac_png_encode(surface, &tile->png, &tile->png_length))
+        guac_display_dup_send_png(client, state->socket, &layer->layer,
+                &tile->rect, tile->png, tile->png_length);
+
+    /* Fall back to streaming directly if the PNG could not be retained */
+    else
+        guac_client_stream_png(client, state->socket, GUAC_COMP_OVER,
+                &layer->layer, tile->rect.left, tile->rect.top, surface);
+
+    cairo_surface_destroy(surface);
+
+}
+
+/**
+ * Sends the given tile using lossy compression if allowed and appropriate
+ * for its contents.
+ *
+ * @param state
+ *     The state of the synchronization.
+ *
+ * @param tile
+ *     The tile to send.
+ *
+ * @return
+ *     Non-zero if the tile was sent using lossy compression, zero if lossy
+ *     compression is not appropriate and the tile has not been sent.
+ */
+static int guac_display_dup_send_lossy(guac_display_dup_state* state,
+        guac_display_dup_tile* tile) {
+
+    guac_client* client = state->display->client;
+    guac_display_dup_layer* layer = tile->layer;
+    const guac_rect* rect = &tile->rect;
+
+    int width = guac_rect_width(rect);
+    int height = guac_rect_height(rect);
+
+    /* Lossy compression is used only for opaque regions that would not be
+     * better compressed as PNG, as tiles of non-opaque layers would need to
+     * be cleared prior to being refined */
+    if (layer->lossless || !layer->opaque
+            || width * height <= GUAC_DISPLAY_JPEG_MIN_BITMAP_SIZE
+            || guac_display_png_optimality(
+                layer->buffer + rect->top * layer->stride + rect->left * 4,
+                layer->stride, width, height) >= 0)
+        return 0;
+
+    cairo_surface_t* surface = guac_display_dup_surface(layer->buffer,
+            layer->stride, layer->opaque, rect);
+
+    if (guac_client_supports_webp(client))
+        guac_client_stream_webp(client, state->socket, GUAC_COMP_OVER,
+                &layer->layer, rect->left, rect->top, surface,
+                GUAC_DISPLAY_DUP_LOSSY_QUALITY, 0);
+    else
+        guac_client_stream_jpeg(client, state->socket, GUAC_COMP_OVER,
+                &layer->layer, rect->left, rect->top, surface,
+                GUAC_DISPLAY_DUP_LOSSY_QUALITY);
+
+    cairo_surface_destroy(surface);
+    return 1;
+
+}
+
+/**
+ * Thread which repeatedly claims and sends the next unsent tile of an
+ * in-progress synchronization of joining users until no tiles remain.
+ *
+ * @param data
+ *     The guac_display_dup_state of the synchronization.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_display_dup_worker_thread(void* data) {
+
+    guac_display_dup_state* state = (guac_display_dup_state*) data;
+    guac_client* client = state->display->client;
+
+    for (;;) {
+
+        pthread_mutex_lock(&state->lock);
+        int index = state->next_tile++;
+        pthread_mutex_unlock(&state->lock);
+
+        if (index >= state->tile_count)
+            break;
+
+        guac_display_dup_tile* tile = &state->tiles[index];
+
+        /* Refine only tiles that were previously sent lossy */
+        if (state->refine) {
+            if (tile->lossy)
+                guac_display_dup_send_lossless(state, tile);
+        }
+
+        /* Tiles that are already cached need not be encoded at all */
+        else if (tile->cached)
+            guac_display_dup_send_png(client, state->socket,
+                    &tile->layer->layer, &tile->rect,
+                    tile->png, tile->png_length);
+
+        /* Send all other tiles lossy if possible, and losslessly otherwise */
+        else if (!(tile->lossy = guac_display_dup_send_lossy(state, tile)))
+            guac_display_dup_send_lossless(state, tile);
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Encodes and sends all tiles of the given synchronization in parallel,
+ * using one thread per display worker thread, returning only after all tiles
+ * have been sent.
+ *
+ * @param state
+ *     The state of the synchronization.
+ *
+ * @param refine
+ *     Non-zero if only tiles previously sent using lossy compression should
+ *     be resent (losslessly), zero if all tiles should be sent for the first
+ *     time.
+ */
+static void guac_display_dup_encode_tiles(guac_display_dup_state* state,
+        int refine) {
+
+    state->next_tile = 0;
+    state->refine = refine;
+
+    int thread_count = state->display->worker_thread_count;
+    if (thread_count > state->tile_count)
+        thread_count = state->tile_count;
+
+    /* Encode on the current thread alone if there's no benefit to doing
+     * otherwise */
+    if (thread_count <= 1) {
+        guac_display_dup_worker_thread(state);
+        return;
+    }
+
+    pthread_t* threads = guac_mem_alloc(thread_count, sizeof(pthread_t));
+
+    int started = 0;
+    for (; started < thread_count; started++) {
+        if (pthread_create(&threads[started], NULL,
+                    guac_display_dup_worker_thread, state))
+            break;
+    }
+
+    /* Contribute to encoding from the current thread, as well, which also
+     * ensures all tiles are encoded even if no threads could be started */
+    guac_display_dup_worker_thread(state);
+
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    guac_mem_free(threads);
+
+}
+
+/**
+ * Copies the state and image data of all layers as of the last frame,
+ * dividing each copied layer into tiles. The display-level last_frame.lock
+ * MUST already be held for reading.
+ *
+ * @param state
+ *     The state of the synchronization that should receive the copied
+ *     layers and tiles.
+ */
+static void LFR_guac_display_dup_snapshot(guac_display_dup_state* state) {
+
+    guac_display* display = state->display;
+
+    /* Count layers and tiles */
+    int layer_count = 0;
+    int tile_count = 0;
+    guac_display_layer* current = display->last_frame.layers;
+    while (current != NULL) {
+
+        layer_count++;
+        tile_count += ((current->last_frame.width + GUAC_DISPLAY_DUP_TILE_SIZE - 1) / GUAC_DISPLAY_DUP_TILE_SIZE)
+                    * ((current->last_frame.height + GUAC_DISPLAY_DUP_TILE_SIZE - 1) / GUAC_DISPLAY_DUP_TILE_SIZE);
+
+        current = current->last_frame.next;
+
+    }
+
+    state->layers = guac_mem_zalloc(layer_count ? layer_count : 1, sizeof(guac_display_dup_layer));
+    state->tiles = guac_mem_zalloc(tile_count ? tile_count : 1, sizeof(guac_display_dup_tile));
+    state->layer_count = layer_count;
+    state->tile_count = tile_count;
+
+    guac_display_dup_layer* layer = state->layers;
+    guac_display_dup_tile* tile = state->tiles;
+
+    current = display->last_frame.layers;
+    while (current != NULL) {
+
+        layer->layer = *current->layer;
+        layer->width = current->last_frame.width;
+        layer->height = current->last_frame.height;
+        layer->opaque = current->opaque;
+        layer->lossless = current->last_frame.lossless;
+
+        if (layer->width > 0 && layer->height > 0) {
+
+            guac_rect layer_bounds = {
+                .left   = 0,
+                .top    = 0,
+                .right  = layer->width,
+                .bottom = layer->height
+            };
+
+            /* Copy image data row by row, as the layer's own buffer may be
+             * larger than the layer itself */
+            layer->stride = guac_mem_ckd_mul_or_die(layer->width, 4);
+            layer->buffer = guac_mem_alloc(layer->stride, layer->height);
+
+            const unsigned char* src = GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(current->last_frame, layer_bounds);
+            unsigned char* dst = layer->buffer;
+            for (int y = 0; y < layer->height; y++) {
+                memcpy(dst, src, layer->stride);
+                src += current->last_frame.buffer_stride;
+                dst += layer->stride;
+            }
+
+            /* Divide layer into tiles, copying any cached encodings of
+             * those tiles */
+            layer->tiles = tile;
+            int keyframe_tiles = current->keyframe_width * current->keyframe_height;
+            pthread_mutex_lock(&display->keyframe_lock);
+            for (int y = 0; y < layer->height; y += GUAC_DISPLAY_DUP_TILE_SIZE) {
+                for (int x = 0; x < layer->width; x += GUAC_DISPLAY_DUP_TILE_SIZE) {
+
+                    tile->layer = layer;
+                    guac_rect_init(&tile->rect, x, y,
+                            GUAC_DISPLAY_DUP_TILE_SIZE, GUAC_DISPLAY_DUP_TILE_SIZE);
+                    guac_rect_constrain(&tile->rect, &layer_bounds);
+
+                    /* Tiles beyond the bounds of the keyframe (which should
+                     * never occur, as the keyframe is resized as each frame
+                     * is committed) are never cached */
+                    if (layer->tile_count < keyframe_tiles) {
+
+                        guac_display_keyframe_tile* cached = &current->keyframe[layer->tile_count];
+                        tile->generation = cached->generation;
+
+                        if (cached->data != NULL) {
+                            tile->png = guac_mem_alloc(cached->length);
+                            tile->png_length = cached->length;
+                            tile->cached = 1;
+                            memcpy(tile->png, cached->data, cached->length);
+                        }
+
+                    }
+
+                    layer->tile_count++;
+                    tile++;
+
+                }
+            }
+            pthread_mutex_unlock(&display->keyframe_lock);
+
+        }
+
+        layer++;
+        current = current->last_frame.next;
+
+    }
+
+}
+
+/**
+ * Stores any newly-encoded tiles of the given copied layer within the cached
+ * keyframe of the given layer, such that future synchronizations need not
+ * encode those tiles again. Tiles that have been invalidated since the layer
+ * was copied are not stored. The display-level last_frame.lock MUST already
+ * be held for reading.
+ *
+ * @param state
+ *     The state of the synchronization.
+ *
+ * @param copy
+ *     The copy of the layer containing the newly-encoded tiles.
+ *
+ * @param current
+ *     The layer whose cached keyframe should receive the newly-encoded
+ *     tiles. This must be the same layer that was copied.
+ */
+static void LFR_guac_display_dup_store_keyframe(guac_display_dup_state* state,
+        guac_display_dup_layer* copy, guac_display_layer* current) {
+
+    /* Tiles can be stored only if the layer has not been resized */
+    if (copy->tile_count != current->keyframe_width * current->keyframe_height
+            || copy->width != current->last_frame.width
+            || copy->height != current->last_frame.height)
+        return;
+
+    pthread_mutex_lock(&state->display->keyframe_lock);
+
+    for (int i = 0; i < copy->tile_count; i++) {
+
+        guac_display_dup_tile* tile = &copy->tiles[i];
+        guac_display_keyframe_tile* cached = &current->keyframe[i];
+
+        if (tile->png == NULL || tile->cached
+                || cached->data != NULL
+                || cached->generation != tile->generation)
+            continue;
+
+        /* Transfer ownership of the encoded tile to the cache */
+        cached->data = tile->png;
+        cached->length = tile->png_length;
+        tile->png = NULL;
+
+    }
+
+    pthread_mutex_unlock(&state->display->keyframe_lock);
+
+}
+
+/**
+ * Returns the copy of the layer having the given index within the given
+ * synchronization, if any.
+ *
+ * @param state
+ *     The state of the synchronization.
+ *
+ * @param index
+ *     The index of the layer to locate.
+ *
+ * @return
+ *     The copy of the layer having the given index, or NULL if no such layer
+ *     was copied.
+ */
+static guac_display_dup_layer* guac_display_dup_find_layer(
+        guac_display_dup_state* state, int index) {
+
+    for (int i = 0; i < state->layer_count; i++) {
+        if (state->layers[i].layer.index == index)
+            return &state->layers[i];
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Sends all regions of the given layer that have changed since the layer was
+ * copied, bringing the joining users fully in sync with the last frame. If the
+ * layer was not copied, or has been resized since it was copied, the entire
+ * layer is sent. The display-level last_frame.lock MUST already be held for
+ * reading.
+ *
+ * @param state
+ *     The state of the synchronization.
+ *
+ * @param current
+ *     The layer to bring in sync.
+ */
+static void LFR_guac_display_dup_resync_layer(guac_display_dup_state* state,
+        guac_display_layer* current) {
+
+    guac_client* client = state->display->client;
+    guac_socket* socket = state->socket;
+    const guac_layer* layer = current->layer;
+
+    int width = current->last_frame.width;
+    int height = current->last_frame.height;
+
+    guac_display_dup_layer* copy = guac_display_dup_find_layer(state, layer->index);
+
+    /* Only layers that were copied at their current size can be compared */
+    int comparable = copy != NULL && copy->width == width && copy->height == height;
+    if (!comparable)
+        guac_protocol_send_size(socket, layer, width, height);
+
+    if (width <= 0 || height <= 0)
+        return;
+
+    guac_rect layer_bounds = {
+        .left   = 0,
+        .top    = 0,
+        .right  = width,
+        .bottom = height
+    };
+
+    unsigned char* buffer = GUAC_DISPLAY_LAYER_STATE_MUTABLE_BUFFER(current->last_frame, layer_bounds);
+    size_t stride = current->last_frame.buffer_stride;
+
+    for (int y = 0; y < height; y += GUAC_DISPLAY_DUP_TILE_SIZE) {
+        for (int x = 0; x < width; x += GUAC_DISPLAY_DUP_TILE_SIZE) {
+
+            guac_rect rect;
+            guac_rect_init(&rect, x, y, GUAC_DISPLAY_DUP_TILE_SIZE, GUAC_DISPLAY_DUP_TILE_SIZE);
+            guac_rect_constrain(&rect, &layer_bounds);
+
+            /* Skip any tiles that are unchanged since being copied */
+            if (comparable) {
+
+                size_t length = guac_rect_width(&rect) * 4;
+                const unsigned char* current_row = buffer + rect.top * stride + rect.left * 4;
+                const unsigned char* copied_row = copy->buffer + rect.top * copy->stride + rect.left * 4;
+
+                int changed = 0;
+                for (int row = rect.top; row < rect.bottom; row++) {
+
+                    if (memcmp(current_row, copied_row, length)) {
+                        changed = 1;
+                        break;
+                    }
+
+                    current_row += stride;
+                    copied_row += copy->stride;
+
+                }
+
+                if (!changed)
+                    continue;
+
+            }
+
+            /* Clear any existing contents of non-opaque layers, as new image
+             * data would otherwise be composited with the old */
+            if (!current->opaque) {
+                guac_protocol_send_rect(socket, layer, rect.left, rect.top,
+                        guac_rect_width(&rect), guac_rect_height(&rect));
+                guac_protocol_send_cfill(socket, GUAC_COMP_ROUT, layer,
+                        0x00, 0x00, 0x00, 0xFF);
+            }
+
+            cairo_surface_t* surface = guac_display_dup_surface(buffer,
+                    stride, current->opaque, &rect);
+
+            guac_client_stream_png(client, socket, GUAC_COMP_OVER, layer,
+                    rect.left, rect.top, surface);
+
+            cairo_surface_destroy(surface);
+
+        }
+    }
+
+}
+
+void guac_display_dup(guac_display* display, guac_socket* socket) {
+
+    guac_client* client = display->client;
+
+    guac_display_dup_state state = {
+        .display = display,
+        .socket = socket
+    };
+
+    pthread_mutex_init(&state.lock, NULL);
+
+    /* Copy the current state of all layers, waiting for any pending frame to
+     * finish being sent to established users such that the copy matches what
+     * those users currently see. The locks required for this are held only
+     * for as long as it takes to copy, and not while encoding. */
+    guac_rwlock_acquire_read_lock(&display->last_frame.lock);
+    guac_flag_wait_and_lock(&display->render_state,
+            GUAC_DISPLAY_RENDER_STATE_FRAME_NOT_IN_PROGRESS);
+
+    LFR_guac_display_dup_snapshot(&state);
+
+    guac_flag_unlock(&display->render_state);
+    guac_rwlock_release_lock(&display->last_frame.lock);
+
+    /* Send the copied contents of all layers, allowing lossy compression such
+     * that the initial view of joining users is received quickly, and then
+     * refining any lossy regions */
+    for (int i = 0; i < state.layer_count; i++)
+        guac_protocol_send_size(socket, &state.layers[i].layer,
+                state.layers[i].width, state.layers[i].height);
+
+    guac_display_dup_encode_tiles(&state, 0);
+    guac_socket_flush(socket);
+
+    guac_display_dup_encode_tiles(&state, 1);
+
+    /* Frames may have been sent to established users while the copied layers
+     * were being sent, and those frames will not have been sent to the users
+     * being synchronized. Reacquire the locks required to access the last
+     * frame, and send whatever has changed since the copy was made. */
+    guac_rwlock_acquire_read_lock(&display->last_frame.lock);
+
+    /* Wait for any pending frame to finish being sent to established users of
+     * the connection before syncing any new users (doing otherwise could
+     * result in trailing instructions of that pending frame getting sent to
+     * new users after they finish joining, even though they are already in
+     * sync with that frame, and those trailing instructions may not have the
+     * intended meaning in context of the new users' remote displays) */
+    guac_flag_wait_and_lock(&display->render_state,
+            GUAC_DISPLAY_RENDER_STATE_FRAME_NOT_IN_PROGRESS);
+
+    /* The newly-joined users lack the client-side buffers of any cells
+     * cached thus far, so the cache must be cleared before it is next used */
+    display->cache.reset = 1;
+
+    /* Sync the state of all layers/buffers */
+    guac_display_layer* current = display->last_frame.layers;
+    while (current != NULL) {
+
+        LFR_guac_display_dup_resync_layer(&state, current);
+
+        /* Cache any tiles that were encoded for the first time */
+        guac_display_dup_layer* copy = guac_display_dup_find_layer(&state, current->layer->index);
+        if (copy != NULL)
+            LFR_guac_display_dup_store_keyframe(&state, copy, current);
+
+        int width = current->last_frame.width;
+        int height = current->last_frame.height;
+
+        /* Resync copy of previous frame */
+        if (width > 0 && height > 0)
+            guac_protocol_send_copy(socket,
+                    current->layer, 0, 0, width, height,
+                    GUAC_COMP_OVER, current->last_frame_buffer, 0, 0);
+
+        /* Resync any properties that are specific to non-buffer layers */
+        if (current->layer->index > 0) {
+
+            /* Resync layer opacity */
+            guac_protocol_send_shade(socket, current->layer,
+                    current->last_frame.opacity);
+
+            /* Resync layer position/hierarchy */
+            guac_protocol_send_move(socket, current->layer,
+                    current->last_frame.parent,
+                    current->last_frame.x,
+                    current->last_frame.y,
+                    current->last_frame.z);
+
+        }
+
+        /* Resync multitouch support */
+        if (current->layer->index >= 0) {
+            guac_protocol_send_set_int(socket, current->layer,
+                    GUAC_PROTOCOL_LAYER_PARAMETER_MULTI_TOUCH,
+                    current->last_frame.touches);
+        }
+
+        current = current->last_frame.next;
+
+    }
+
+    /* Dispose of any copied layers that have since been removed */
+    for (int i = 0; i < state.layer_count; i++) {
+
+        const guac_layer* layer = &state.layers[i].layer;
+
+        int removed = 1;
+        current = display->last_frame.layers;
+        while (current != NULL) {
+
+            if (current->layer->index == layer->index) {
+                removed = 0;
+                break;
+            }
+
+            current = current->last_frame.next;
+
+        }
+
+        if (removed)
+            guac_protocol_send_dispose(socket, layer);
+
+    }
+
+    /* Avoid sending a zero-size cursor instruction if no cursor has been set */
+    guac_display_layer* cursor = display->cursor_buffer;
+    if (cursor->last_frame.width > 0 && cursor->last_frame.height > 0)
+        guac_protocol_send_cursor(socket,
+                display->last_frame.cursor_hotspot_x,
+                display->last_frame.cursor_hotspot_y,
+                cursor->layer, 0, 0,
+                cursor->last_frame.width,
+                cursor->last_frame.height);
+
+    /* Synchronize mouse location */
+    guac_protocol_send_mouse(socket, display->last_frame.cursor_x, display->last_frame.cursor_y,
+            display->last_frame.cursor_mask, client->last_sent_timestamp);
+
+    /* The initial frame synchronizing the newly-joined users is now complete */
+    guac_protocol_send_sync(socket, client->last_sent_timestamp, display->last_frame.frames);
+
+    /* Further rendering for the current connection can now safely continue */
+    guac_flag_unlock(&display->render_state);
+    guac_rwlock_release_lock(&display->last_frame.lock);
+
+    guac_socket_flush(socket);
+
+    for (int i = 0; i < state.layer_count; i++)
+        guac_mem_free(state.layers[i].buffer);
+
+    for (int i = 0; i < state.tile_count; i++)
+        guac_mem_free(state.tiles[i].png);
+
+    guac_mem_free(state.layers);
+    guac_mem_free(state.tiles);
+    pthread_mutex_destroy(&state.lock);
+
+}
+
+void LFW_guac_display_layer_invalidate_keyframe(guac_display_layer* layer) {
+
+    guac_display* display = layer->display;
+
+    int width = (layer->last_frame.width + GUAC_DISPLAY_DUP_TILE_SIZE - 1) / GUAC_DISPLAY_DUP_TILE_SIZE;
+    int height = (layer->last_frame.height + GUAC_DISPLAY_DUP_TILE_SIZE - 1) / GUAC_DISPLAY_DUP_TILE_SIZE;
+
+    /* Rebuild the keyframe from scratch if the layer has been resized */
+    if (width != layer->keyframe_width || height != layer->keyframe_height) {
+
+        guac_display_layer_free_keyframe(layer);
+
+        if (width > 0 && height > 0) {
+
+            layer->keyframe = guac_mem_zalloc(sizeof(guac_display_keyframe_tile), width, height);
+            layer->keyframe_width = width;
+            layer->keyframe_height = height;
+
+            for (int i = 0; i < width * height; i++)
+                layer->keyframe[i].generation = display->keyframe_generation;
+
+        }
+
+        return;
+
+    }
+
+    guac_rect dirty = layer->last_frame.dirty;
+    if (guac_rect_is_empty(&dirty))
+        return;
+
+    /* Invalidate only the tiles touched by the changes in the last frame */
+    int left = dirty.left / GUAC_DISPLAY_DUP_TILE_SIZE;
+    int top = dirty.top / GUAC_DISPLAY_DUP_TILE_SIZE;
+    int right = (dirty.right + GUAC_DISPLAY_DUP_TILE_SIZE - 1) / GUAC_DISPLAY_DUP_TILE_SIZE;
+    int bottom = (dirty.bottom + GUAC_DISPLAY_DUP_TILE_SIZE - 1) / GUAC_DISPLAY_DUP_TILE_SIZE;
+
+    if (right > width) right = width;
+    if (bottom > height) bottom = height;
+
+    for (int y = top; y < bottom; y++) {
+        for (int x = left; x < right; x++) {
+            guac_display_keyframe_tile* tile = &layer->keyframe[y * width + x];
+            guac_mem_free(tile->data);
+            tile->generation = display->keyframe_generation;
+        }
+    }
+
+}
+
+void guac_display_layer_free_keyframe(guac_display_layer* layer) {
+
+    int count = layer->keyframe_width * layer->keyframe_height;
+    for (int i = 0; i < count; i++)
+        guac_mem_free(layer->keyframe[i].data);
+
+    guac_mem_free(layer->keyframe);
+    layer->keyframe_width = 0;
+    layer->keyframe_height = 0;
+
+}
@@ -25,11 +25,13 @@
 #include "guacamole/fifo.h"
 #include "guacamole/flag.h"
 #include "guacamole/mem.h"
+#include "guacamole/metrics.h"
 #include "guacamole/protocol.h"
 #include "guacamole/rect.h"
 #include "guacamole/rwlock.h"
 #include "guacamole/user.h"
 
+#include <stdint.h>
 #include <string.h>
 
 /**
@@ -38,11 +40,12 @@
  */
 #define GUAC_DISPLAY_PLAN_BEGIN_PHASE()                                       \
     do {                                                                      \
-        guac_timestamp phase_start = guac_timestamp_current();
+        uint64_t phase_start = guac_display_usec_current();
 
 /**
  * Ends a section related to an optimization phase that should be tracked for
- * performance at the "trace" log level.
+ * performance at the "trace" log level. The duration of the phase is also
+ * added to the performance counters of the display.
  *
  * @param display
  *     The guac_display related to the optimizations being performed.
@@ -58,10 +61,12 @@
  *     The total number of optimization phases.
  */
 #define GUAC_DISPLAY_PLAN_END_PHASE(display, phase, n, total)                 \
-        guac_timestamp phase_end = guac_timestamp_current();                  \
+        uint64_t phase_usec = guac_display_usec_current() - phase_start;      \
+        guac_metrics_add(&guac_display_metrics(display)->plan_usec[n - 1],    \
+                phase_usec);                                                  \
         guac_client_log(display->client, GUAC_LOG_TRACE, "Render planning "   \
                 "phase %i/%i (%s): %ims", n, total, phase,                    \
-                (int) (phase_end - phase_start));                             \
+                (int) (phase_usec / 1000));                                   \
     } while (0)
 
 void guac_display_end_frame(guac_display* display) {
@@ -114,6 +119,8 @@ static int PFW_LFW_guac_display_frame_complete(guac_display* display) {
     guac_client* client = display->client;
     int retval = 0;
 
+    display->keyframe_generation++;
+
     display->last_frame.layers = display->pending_frame.layers;
     for (guac_display_layer* current = display->pending_frame.layers;
             current != NULL; current = current->pending_frame.next) {
@@ -203,6 +210,9 @@ static int PFW_LFW_guac_display_frame_complete(guac_display* display) {
 
         }
 
+        /* Drop any cached encodings of regions that are no longer current */
+        LFW_guac_display_layer_invalidate_keyframe(current);
+
         /* Commit any change in layer opacity */
         if (current->pending_frame.opacity != current->last_frame.opacity) {
 
@@ -252,6 +262,10 @@ static int PFW_LFW_guac_display_frame_complete(guac_display* display) {
         current->last_frame.search_for_copies = current->pending_frame.search_for_copies;
         current->pending_frame.search_for_copies = 0;
 
+        /* Hints apply only to the frame for which they were provided */
+        current->pending_frame_hint_count = 0;
+        current->pending_frame_hint_failures = 0;
+
         /* Commit any change in lossless setting (no need to synchronize this
          * to the client - it affects only how last_frame is interpreted) */
         current->last_frame.lossless = current->pending_frame.lossless;
@@ -318,8 +332,12 @@ void guac_display_end_multiple_frames(guac_display* display, int frames) {
         (display->ops.state.value & GUAC_FIFO_STATE_NONEMPTY) || display->active_workers;
     guac_fifo_unlock(&display->ops);
 
-    if (defer_frame)
+    guac_metrics* metrics = guac_display_metrics(display);
+
+    if (defer_frame) {
+        guac_metrics_add(&metrics->frames_deferred, 1);
         goto finished_with_pending_frame_lock;
+    }
 
     guac_rwlock_acquire_write_lock(&display->last_frame.lock);
 
@@ -330,29 +348,44 @@ void guac_display_end_multiple_frames(guac_display* display, int frames) {
      * display that have changed, but is naive in the sense that it only
      * produces draw operations covering 64x64 cells. There is room for
      * optimization of those operations, which will be performed by further
-     * passes. */
+     * passes.
+     *
+     * Regions of the display that have been continuously updated for some
+     * time are additionally removed from the plan here, and instead streamed
+     * as video to users that support it. */
     GUAC_DISPLAY_PLAN_BEGIN_PHASE();
     plan = PFW_LFR_guac_display_plan_create(display);
-    GUAC_DISPLAY_PLAN_END_PHASE(display, "draft", 1, 5);
+    if (plan != NULL)
+        PFW_LFW_guac_display_plan_rewrite_as_video(plan);
+    GUAC_DISPLAY_PLAN_END_PHASE(display, "draft", 1, GUAC_DISPLAY_PLAN_PHASES);
 
     if (plan != NULL) {
 
         display->pending_frame.timestamp = plan->frame_end;
 
-        /* PASS 1: Identify draw operations that only apply a single color, and
-         * replace those operations with simple rectangle draws. */
+        /* PASS 1: Replace draw operations with simple rectangle draws or
+         * copies wherever explicitly hinted (or wherever content appears to
+         * have been scrolled by any offset), and then identify any remaining
+         * draw operations that only apply a single color, replacing those
+         * operations with simple rectangle draws as well. */
         GUAC_DISPLAY_PLAN_BEGIN_PHASE();
+        PFW_LFR_guac_display_plan_rewrite_as_hinted(plan);
+        if (PFW_LFR_guac_display_plan_detect_scrolls(plan))
+            PFW_LFR_guac_display_plan_rewrite_as_hinted(plan);
         PFR_guac_display_plan_rewrite_as_rects(plan);
-        GUAC_DISPLAY_PLAN_END_PHASE(display, "rects", 2, 5);
+        GUAC_DISPLAY_PLAN_END_PHASE(display, "rects", 2, GUAC_DISPLAY_PLAN_PHASES);
 
         /* PASS 2 (and 3): Index all modified cells by their graphical contents and
          * search the previous frame for occurrences of the same content. Where any
          * draws could instead be represented as copies from the previous frame, do
-         * so instead of sending new image data. */
+         * so instead of sending new image data. Any remaining draws of content
+         * that was sent within an earlier frame are likewise replaced with copies
+         * from the client-side cache. */
         GUAC_DISPLAY_PLAN_BEGIN_PHASE();
         PFR_guac_display_plan_index_dirty_cells(plan);
         PFR_LFR_guac_display_plan_rewrite_as_copies(plan);
-        GUAC_DISPLAY_PLAN_END_PHASE(display, "search", 3, 5);
+        PFR_LFW_guac_display_plan_rewrite_as_cached(plan);
+        GUAC_DISPLAY_PLAN_END_PHASE(display, "search", 3, GUAC_DISPLAY_PLAN_PHASES);
 
         /* PASS 4 (and 5): Combine adjacent updates in horizontal and vertical
          * directions where doing so would be more efficient. The goal of these
@@ -362,7 +395,7 @@ void guac_display_end_multiple_frames(guac_display* display, int frames) {
         GUAC_DISPLAY_PLAN_BEGIN_PHASE();
         PFW_guac_display_plan_combine_horizontally(plan);
         PFW_guac_display_plan_combine_vertically(plan);
-        GUAC_DISPLAY_PLAN_END_PHASE(display, "combine", 4, 5);
+        GUAC_DISPLAY_PLAN_END_PHASE(display, "combine", 4, GUAC_DISPLAY_PLAN_PHASES);
 
     }
 
@@ -377,7 +410,18 @@ void guac_display_end_multiple_frames(guac_display* display, int frames) {
 
     GUAC_DISPLAY_PLAN_BEGIN_PHASE();
     frame_nonempty = PFW_LFW_guac_display_frame_complete(display);
-    GUAC_DISPLAY_PLAN_END_PHASE(display, "commit", 5, 5);
+    GUAC_DISPLAY_PLAN_END_PHASE(display, "commit", 5, GUAC_DISPLAY_PLAN_PHASES);
+
+    /* Update performance counters now that the contents of the frame are
+     * known */
+    if (frame_nonempty) {
+
+        guac_metrics_add(&metrics->frames, 1);
+        if (display->last_frame.frames > 1)
+            guac_metrics_add(&metrics->frames_combined,
+                    display->last_frame.frames - 1);
+
+    }
 
     guac_rwlock_release_lock(&display->last_frame.lock);
 
@@ -418,4 +462,11 @@ finished_with_pending_frame_lock:
      * the pending frame lock to avoid contending with drawing operations. */
     guac_display_free_removed_layers(display, removed_layers);
 
+    /* Processing lag is calculated (only if exported) after all display locks
+     * have been released, as doing so requires acquiring the lock on the user
+     * list */
+    if (display->client->metrics != NULL)
+        guac_metrics_set(&metrics->processing_lag,
+                guac_client_get_processing_lag(display->client));
+
 }
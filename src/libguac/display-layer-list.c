@@ -362,6 +362,8 @@ void guac_display_free_removed_layers(guac_display* display,
 
         guac_mem_free(current->last_frame.buffer);
         guac_mem_free(current->pending_frame_cells);
+        guac_display_layer_free_keyframe(current);
+        guac_display_layer_free_video(current);
 
         pthread_mutex_destroy(&current->path_lock);
 
@@ -334,3 +334,55 @@ void guac_display_layer_close_cairo(guac_display_layer* layer, guac_display_laye
     guac_rwlock_release_lock(&display->pending_frame.lock);
 
 }
+
+/**
+ * Stores the given hint within the pending frame of the given layer. If the
+ * maximum number of hints have already been stored for the pending frame, or
+ * if the hinted region is empty, the hint is ignored.
+ *
+ * @param layer
+ *     The layer that the hint applies to.
+ *
+ * @param hint
+ *     The hint to store.
+ */
+static void guac_display_layer_add_hint(guac_display_layer* layer,
+        const guac_display_hint* hint) {
+
+    guac_display* display = layer->display;
+    guac_rwlock_acquire_write_lock(&display->pending_frame.lock);
+
+    if (!guac_rect_is_empty(&hint->dest)
+            && layer->pending_frame_hint_count < GUAC_DISPLAY_MAX_HINTS)
+        layer->pending_frame_hints[layer->pending_frame_hint_count++] = *hint;
+
+    guac_rwlock_release_lock(&display->pending_frame.lock);
+
+}
+
+void guac_display_layer_hint_fill(guac_display_layer* layer,
+        const guac_rect* dst, uint32_t color) {
+
+    guac_display_hint hint = {
+        .type = GUAC_DISPLAY_HINT_FILL,
+        .dest = *dst,
+        .color = color
+    };
+
+    guac_display_layer_add_hint(layer, &hint);
+
+}
+
+void guac_display_layer_hint_copy(guac_display_layer* layer,
+        const guac_rect* dst, int src_x, int src_y) {
+
+    guac_display_hint hint = {
+        .type = GUAC_DISPLAY_HINT_COPY,
+        .dest = *dst,
+        .src_x = src_x,
+        .src_y = src_y
+    };
+
+    guac_display_layer_add_hint(layer, &hint);
+
+}
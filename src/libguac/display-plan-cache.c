@@ -0,0 +1,514 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "display-plan.h"
+#include "display-priv.h"
+#include "guacamole/client.h"
+#include "guacamole/display.h"
+#include "guacamole/layer.h"
+#include "guacamole/mem.h"
+#include "guacamole/protocol.h"
+#include "guacamole/rect.h"
+#include "guacamole/socket.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Returns the index within the hash table of the given cache (and within its
+ * admission table) that corresponds to the given hash.
+ *
+ * @param cache
+ *     The cache containing the hash table.
+ *
+ * @param hash
+ *     The hash to locate within the hash table.
+ *
+ * @return
+ *     The index within the hash table that corresponds to the given hash.
+ */
+static size_t LFW_guac_display_cache_index(guac_display_cache* cache,
+        uint64_t hash) {
+    return (hash ^ (hash >> 32)) & cache->bucket_mask;
+}
+
+/**
+ * Returns the hash bucket within the given cache that would contain entries
+ * having the given hash.
+ *
+ * @param cache
+ *     The cache containing the desired bucket.
+ *
+ * @param hash
+ *     The hash of the entries that the bucket would contain.
+ *
+ * @return
+ *     A pointer to the head of the bucket that would contain entries having
+ *     the given hash.
+ */
+static guac_display_cache_entry** LFW_guac_display_cache_bucket(
+        guac_display_cache* cache, uint64_t hash) {
+    return &cache->buckets[LFW_guac_display_cache_index(cache, hash)];
+}
+
+/**
+ * Returns the entry within the given cache that has the given hash, if any.
+ *
+ * @param cache
+ *     The cache to search.
+ *
+ * @param hash
+ *     The hash of the entry to search for.
+ *
+ * @return
+ *     The entry having the given hash, or NULL if there is no such entry.
+ */
+static guac_display_cache_entry* LFW_guac_display_cache_find(
+        guac_display_cache* cache, uint64_t hash) {
+
+    guac_display_cache_entry* current = *LFW_guac_display_cache_bucket(cache, hash);
+    while (current != NULL) {
+
+        if (current->hash == hash)
+            return current;
+
+        current = current->next_in_bucket;
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Removes the given entry from the least-recently used list of the given
+ * cache.
+ *
+ * @param cache
+ *     The cache containing the entry.
+ *
+ * @param entry
+ *     The entry to remove.
+ */
+static void LFW_guac_display_cache_unlink(guac_display_cache* cache,
+        guac_display_cache_entry* entry) {
+
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        cache->head = entry->next;
+
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+
+    entry->next = NULL;
+    entry->prev = NULL;
+
+}
+
+/**
+ * Adds the given entry to the head of the least-recently used list of the
+ * given cache, marking that entry as the most-recently used. The entry must
+ * not currently be within that list.
+ *
+ * @param cache
+ *     The cache that should contain the entry.
+ *
+ * @param entry
+ *     The entry to add.
+ */
+static void LFW_guac_display_cache_link(guac_display_cache* cache,
+        guac_display_cache_entry* entry) {
+
+    entry->prev = NULL;
+    entry->next = cache->head;
+
+    if (cache->head != NULL)
+        cache->head->prev = entry;
+    else
+        cache->tail = entry;
+
+    cache->head = entry;
+
+}
+
+/**
+ * Evicts the given entry from the given cache, disposing of its client-side
+ * buffer. The image data allocated for the entry is retained such that it
+ * may be reused by a future entry.
+ *
+ * @param display
+ *     The display that owns the cache.
+ *
+ * @param entry
+ *     The entry to evict.
+ */
+static void LFW_guac_display_cache_evict(guac_display* display,
+        guac_display_cache_entry* entry) {
+
+    guac_display_cache* cache = &display->cache;
+    guac_client* client = display->client;
+
+    /* Remove from hash table */
+    guac_display_cache_entry** current = LFW_guac_display_cache_bucket(cache, entry->hash);
+    while (*current != NULL) {
+
+        if (*current == entry) {
+            *current = entry->next_in_bucket;
+            break;
+        }
+
+        current = &(*current)->next_in_bucket;
+
+    }
+
+    entry->next_in_bucket = NULL;
+    LFW_guac_display_cache_unlink(cache, entry);
+
+    guac_protocol_send_dispose(client->socket, entry->buffer);
+    guac_client_free_buffer(client, entry->buffer);
+    entry->buffer = NULL;
+
+}
+
+/**
+ * Evicts all entries from the cache of the given display, disposing of all
+ * associated client-side buffers.
+ *
+ * @param display
+ *     The display whose cache should be cleared.
+ */
+static void LFW_guac_display_cache_clear(guac_display* display) {
+
+    guac_display_cache* cache = &display->cache;
+
+    while (cache->tail != NULL)
+        LFW_guac_display_cache_evict(display, cache->tail);
+
+    if (cache->admission != NULL)
+        memset(cache->admission, 0, sizeof(uint64_t) * (cache->bucket_mask + 1));
+
+    cache->length = 0;
+    cache->pending_count = 0;
+
+}
+
+/**
+ * Clears the cache of the given display and resizes that cache to its
+ * requested capacity. The storage for the resized cache is allocated only
+ * when first needed.
+ *
+ * @param display
+ *     The display whose cache should be resized.
+ */
+static void PFR_LFW_guac_display_cache_resize(guac_display* display) {
+
+    guac_display_cache* cache = &display->cache;
+
+    LFW_guac_display_cache_clear(display);
+
+    if (cache->entries != NULL) {
+        for (int i = 0; i < cache->capacity; i++)
+            guac_mem_free(cache->entries[i].data);
+    }
+
+    guac_mem_free(cache->entries);
+    guac_mem_free(cache->buckets);
+    guac_mem_free(cache->admission);
+    guac_mem_free(cache->pending);
+
+    cache->capacity = cache->requested_capacity;
+
+}
+
+/**
+ * Allocates the storage for the cache of the given display if that storage
+ * has not already been allocated. The cache must have a non-zero capacity.
+ *
+ * @param display
+ *     The display whose cache storage should be allocated.
+ */
+static void LFW_guac_display_cache_init(guac_display* display) {
+
+    guac_display_cache* cache = &display->cache;
+    if (cache->entries != NULL)
+        return;
+
+    /* Use at least as many buckets as entries, rounded up to the nearest
+     * power of two */
+    size_t bucket_count = 1;
+    while (bucket_count < (size_t) cache->capacity)
+        bucket_count <<= 1;
+
+    cache->entries = guac_mem_zalloc(sizeof(guac_display_cache_entry), cache->capacity);
+    cache->buckets = guac_mem_zalloc(sizeof(guac_display_cache_entry*), bucket_count);
+    cache->admission = guac_mem_zalloc(sizeof(uint64_t), bucket_count);
+    cache->pending = guac_mem_alloc(sizeof(guac_display_cache_entry*), cache->capacity);
+    cache->bucket_mask = bucket_count - 1;
+
+}
+
+/**
+ * Returns whether the image data stored within the given cache entry is
+ * identical to the given cell of the pending frame of the given layer.
+ *
+ * @param entry
+ *     The cache entry to compare.
+ *
+ * @param layer
+ *     The layer containing the cell.
+ *
+ * @param cell
+ *     The cell within the pending frame of the layer to compare. This cell
+ *     must be exactly GUAC_DISPLAY_CELL_SIZE x GUAC_DISPLAY_CELL_SIZE pixels.
+ *
+ * @return
+ *     Non-zero if the entry contains exactly the same image data as the
+ *     cell, zero otherwise.
+ */
+static int PFR_guac_display_cache_entry_matches(const guac_display_cache_entry* entry,
+        const guac_display_layer* layer, const guac_rect* cell) {
+
+    size_t stride = layer->pending_frame.buffer_stride;
+    const unsigned char* buffer = GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(layer->pending_frame, *cell);
+
+    size_t row_length = GUAC_DISPLAY_CELL_SIZE * GUAC_DISPLAY_LAYER_RAW_BPP;
+    const unsigned char* data = entry->data;
+
+    for (int y = 0; y < GUAC_DISPLAY_CELL_SIZE; y++) {
+
+        if (memcmp(buffer, data, row_length))
+            return 0;
+
+        buffer += stride;
+        data += row_length;
+
+    }
+
+    return 1;
+
+}
+
+/**
+ * Adds the given cell of the pending frame of the given layer to the cache of
+ * the given display, evicting the least-recently used entry if the cache is
+ * full. The client-side buffer of the new entry is populated only after the
+ * current frame has been sent, by LFR_guac_display_cache_write(). If no entry
+ * can be evicted without affecting the current frame, the cell is not added.
+ *
+ * @param display
+ *     The display whose cache should receive the cell.
+ *
+ * @param layer
+ *     The layer containing the cell.
+ *
+ * @param cell
+ *     The cell within the pending frame of the layer to add. This cell must
+ *     be exactly GUAC_DISPLAY_CELL_SIZE x GUAC_DISPLAY_CELL_SIZE pixels.
+ *
+ * @param hash
+ *     The hash of the image data within the cell.
+ */
+static void PFR_LFW_guac_display_cache_add(guac_display* display,
+        guac_display_layer* layer, const guac_rect* cell, uint64_t hash) {
+
+    guac_display_cache* cache = &display->cache;
+
+    /* Replace any existing entry having the same hash (a collision), unless
+     * that entry is already in use for the current frame */
+    guac_display_cache_entry* entry = LFW_guac_display_cache_find(cache, hash);
+    if (entry != NULL) {
+        if (entry->frame == cache->frame)
+            return;
+        LFW_guac_display_cache_evict(display, entry);
+    }
+
+    /* Use an entry that has never been used, if any remain */
+    else if (cache->length < cache->capacity)
+        entry = &cache->entries[cache->length++];
+
+    /* Otherwise, reuse the least-recently used entry, so long as it is not
+     * in use for the current frame */
+    else {
+        entry = cache->tail;
+        if (entry == NULL || entry->frame == cache->frame)
+            return;
+        LFW_guac_display_cache_evict(display, entry);
+    }
+
+    if (entry->data == NULL)
+        entry->data = guac_mem_alloc(GUAC_DISPLAY_CACHE_ENTRY_SIZE);
+
+    /* Retain a copy of the cell such that future matches can be verified */
+    size_t stride = layer->pending_frame.buffer_stride;
+    const unsigned char* buffer = GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(layer->pending_frame, *cell);
+
+    size_t row_length = GUAC_DISPLAY_CELL_SIZE * GUAC_DISPLAY_LAYER_RAW_BPP;
+    unsigned char* data = entry->data;
+
+    for (int y = 0; y < GUAC_DISPLAY_CELL_SIZE; y++) {
+        memcpy(data, buffer, row_length);
+        buffer += stride;
+        data += row_length;
+    }
+
+    entry->hash = hash;
+    entry->buffer = guac_client_alloc_buffer(display->client);
+    entry->source = layer->layer;
+    entry->source_x = cell->left;
+    entry->source_y = cell->top;
+    entry->frame = cache->frame;
+
+    guac_display_cache_entry** bucket = LFW_guac_display_cache_bucket(cache, hash);
+    entry->next_in_bucket = *bucket;
+    *bucket = entry;
+
+    LFW_guac_display_cache_link(cache, entry);
+    cache->pending[cache->pending_count++] = entry;
+
+}
+
+void PFR_LFW_guac_display_plan_rewrite_as_cached(guac_display_plan* plan) {
+
+    guac_display* display = plan->display;
+    guac_display_cache* cache = &display->cache;
+
+    /* Discard all cached content if it may not be present for all users */
+    if (cache->reset) {
+        LFW_guac_display_cache_clear(display);
+        cache->reset = 0;
+    }
+
+    if (cache->requested_capacity != cache->capacity)
+        PFR_LFW_guac_display_cache_resize(display);
+
+    if (cache->capacity == 0)
+        return;
+
+    LFW_guac_display_cache_init(display);
+    cache->frame++;
+
+    guac_display_plan_operation* op = plan->ops;
+    for (int i = 0; i < plan->length; i++, op++) {
+
+        if (op->type != GUAC_DISPLAY_PLAN_OPERATION_IMG || !op->hash_valid)
+            continue;
+
+        /* Only opaque layers are cached, as the alpha channel of cached
+         * content could otherwise blend with the content of the buffer */
+        guac_display_layer* layer = op->layer;
+        if (!layer->opaque || layer->pending_frame.buffer == NULL)
+            continue;
+
+        guac_rect cell;
+        guac_rect_init(&cell,
+                op->dest.left & ~(GUAC_DISPLAY_CELL_SIZE - 1),
+                op->dest.top  & ~(GUAC_DISPLAY_CELL_SIZE - 1),
+                GUAC_DISPLAY_CELL_SIZE, GUAC_DISPLAY_CELL_SIZE);
+
+        /* Replace the draw operation with a copy of the entire cell from the
+         * cache if the cell was previously sent (and is not merely pending
+         * within the current frame) */
+        guac_display_cache_entry* entry = LFW_guac_display_cache_find(cache, op->hash);
+        if (entry != NULL && entry->source == NULL
+                && PFR_guac_display_cache_entry_matches(entry, layer, &cell)) {
+
+            op->type = GUAC_DISPLAY_PLAN_OPERATION_COPY;
+            op->src.layer_rect.layer = entry->buffer;
+            guac_rect_init(&op->src.layer_rect.rect, 0, 0,
+                    GUAC_DISPLAY_CELL_SIZE, GUAC_DISPLAY_CELL_SIZE);
+            op->dest = cell;
+
+            LFW_guac_display_cache_unlink(cache, entry);
+            LFW_guac_display_cache_link(cache, entry);
+            entry->frame = cache->frame;
+            continue;
+
+        }
+
+        /* Neither regions covered by video nor content that is updated as
+         * frequently as video are worth caching */
+        if (op->content == GUAC_DISPLAY_CONTENT_VIDEO
+                || LFR_guac_display_layer_is_video_covered(layer, &cell))
+            continue;
+
+        /* Cache only cells that have been drawn before, merely noting the
+         * hashes of cells being drawn for the first time. A collision within
+         * the admission table simply replaces the older hash. */
+        uint64_t* admission = &cache->admission[LFW_guac_display_cache_index(cache, op->hash)];
+        if (*admission != op->hash) {
+            *admission = op->hash;
+            continue;
+        }
+
+        PFR_LFW_guac_display_cache_add(display, layer, &cell, op->hash);
+
+    }
+
+}
+
+void LFR_guac_display_cache_write(guac_display* display) {
+
+    guac_display_cache* cache = &display->cache;
+    guac_socket* socket = display->client->socket;
+
+    for (int i = 0; i < cache->pending_count; i++) {
+
+        guac_display_cache_entry* entry = cache->pending[i];
+
+        guac_protocol_send_copy(socket, entry->source,
+                entry->source_x, entry->source_y,
+                GUAC_DISPLAY_CELL_SIZE, GUAC_DISPLAY_CELL_SIZE,
+                GUAC_COMP_OVER, entry->buffer, 0, 0);
+
+        entry->source = NULL;
+
+    }
+
+    cache->pending_count = 0;
+
+}
+
+void guac_display_cache_free(guac_display* display) {
+
+    guac_display_cache* cache = &display->cache;
+
+    /* Buffers are freed without being disposed, as the connection is
+     * closing */
+    if (cache->entries != NULL) {
+        for (int i = 0; i < cache->capacity; i++) {
+
+            guac_display_cache_entry* entry = &cache->entries[i];
+            if (entry->buffer != NULL)
+                guac_client_free_buffer(display->client, entry->buffer);
+
+            guac_mem_free(entry->data);
+
+        }
+    }
+
+    guac_mem_free(cache->entries);
+    guac_mem_free(cache->buckets);
+    guac_mem_free(cache->admission);
+    guac_mem_free(cache->pending);
+
+}
@@ -120,6 +120,14 @@ static int guac_display_plan_should_combine(const guac_display_plan_operation* o
     if (op_a->layer != op_b->layer)
         return 0;
 
+    /* Operations that were removed or replaced in favor of a video cannot be
+     * combined, as doing so would redraw part of that video as an image */
+    if (op_a->type == GUAC_DISPLAY_PLAN_OPERATION_VIDEO
+            || op_b->type == GUAC_DISPLAY_PLAN_OPERATION_VIDEO
+            || op_a->type == GUAC_DISPLAY_PLAN_OPERATION_NOP
+            || op_b->type == GUAC_DISPLAY_PLAN_OPERATION_NOP)
+        return 0;
+
     /* Simulate combination */
     guac_rect combined = op_a->dest;
     guac_rect_extend(&combined, &op_b->dest);
@@ -131,7 +139,9 @@ static int guac_display_plan_should_combine(const guac_display_plan_operation* o
 
             /* Copy operations can be combined if they are perfectly adjacent
              * (exactly share an edge) and copy from the same source layer in
-             * the same direction */
+             * the same direction. Copies that do not meet these criteria
+             * cannot be combined at all, as extending the source rect of one
+             * copy to cover the other would copy the wrong content. */
             case GUAC_DISPLAY_PLAN_OPERATION_COPY:
                 if (op_a->src.layer_rect.layer == op_b->src.layer_rect.layer
                         && guac_display_plan_has_common_edge(op_a, op_b)) {
@@ -146,7 +156,7 @@ static int guac_display_plan_should_combine(const guac_display_plan_operation* o
                         && !guac_display_plan_rect_crosses_boundary(&combined);
 
                 }
-                break;
+                return 0;
 
             /* Rectangle-drawing operations can be combined if they are
              * perfectly adjacent (exactly share an edge) and draw the same
@@ -234,6 +244,19 @@ static int guac_display_plan_combine_if_improved(guac_display_plan_operation* op
         else if (op_a->type == GUAC_DISPLAY_PLAN_OPERATION_COPY)
             guac_rect_extend(&op_a->src.layer_rect.rect, &op_b->src.layer_rect.rect);
 
+        /* The combined operation is classified according to whichever
+         * operation covers more modified pixels, and is considered updated
+         * as often as the more frequently updated of the two */
+        if (op_b->dirty_size > op_a->dirty_size)
+            op_a->content = op_b->content;
+
+        if (op_b->update_interval < op_a->update_interval)
+            op_a->update_interval = op_b->update_interval;
+
+        if (op_a->content == GUAC_DISPLAY_CONTENT_PHOTO
+                && op_a->update_interval <= GUAC_DISPLAY_VIDEO_UPDATE_INTERVAL)
+            op_a->content = GUAC_DISPLAY_CONTENT_VIDEO;
+
         op_a->dirty_size += op_b->dirty_size;
 
         if (op_b->last_frame > op_a->last_frame)
@@ -0,0 +1,282 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "display-plan.h"
+#include "display-priv.h"
+#include "guacamole/display.h"
+#include "guacamole/mem.h"
+#include "guacamole/rect.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Returns whether the given rectangle of the pending frame of the given layer
+ * consists entirely of the given color. The alpha channel is ignored for
+ * opaque layers.
+ *
+ * @param layer
+ *     The layer to check.
+ *
+ * @param rect
+ *     The rectangle within the pending frame of the layer to check.
+ *
+ * @param color
+ *     The color that every pixel of the rectangle is expected to have, in
+ *     ARGB format.
+ *
+ * @return
+ *     Non-zero if every pixel within the rectangle has the given color, zero
+ *     otherwise.
+ */
+static int PFR_guac_display_layer_is_filled(const guac_display_layer* layer,
+        const guac_rect* rect, uint32_t color) {
+
+    uint32_t mask = layer->opaque ? 0x00FFFFFF : 0xFFFFFFFF;
+    color &= mask;
+
+    size_t stride = layer->pending_frame.buffer_stride;
+    const unsigned char* buffer = GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(layer->pending_frame, *rect);
+
+    /* Verify the first row pixel by pixel */
+    int width = guac_rect_width(rect);
+    const uint32_t* first = (const uint32_t*) buffer;
+    for (int x = 0; x < width; x++) {
+        if ((first[x] & mask) != color)
+            return 0;
+    }
+
+    /* All remaining rows need only be identical to the first */
+    size_t row_length = guac_mem_ckd_mul_or_die(width, GUAC_DISPLAY_LAYER_RAW_BPP);
+    const unsigned char* current = buffer;
+    for (int y = rect->top + 1; y < rect->bottom; y++) {
+        current += stride;
+        if (memcmp(buffer, current, row_length))
+            return 0;
+    }
+
+    return 1;
+
+}
+
+/**
+ * Returns whether the given rectangle of the pending frame of the given layer
+ * is identical to the given rectangle of the last frame of that layer. The
+ * two rectangles must be the same size.
+ *
+ * @param layer
+ *     The layer to check.
+ *
+ * @param dst
+ *     The rectangle within the pending frame of the layer to check.
+ *
+ * @param src
+ *     The rectangle within the last frame of the layer that the pending frame
+ *     is expected to match.
+ *
+ * @return
+ *     Non-zero if both rectangles contain identical image data, zero
+ *     otherwise.
+ */
+static int PFR_LFR_guac_display_layer_is_copied(const guac_display_layer* layer,
+        const guac_rect* dst, const guac_rect* src) {
+
+    size_t dst_stride = layer->pending_frame.buffer_stride;
+    const unsigned char* dst_buffer = GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(layer->pending_frame, *dst);
+
+    size_t src_stride = layer->last_frame.buffer_stride;
+    const unsigned char* src_buffer = GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(layer->last_frame, *src);
+
+    size_t row_length = guac_mem_ckd_mul_or_die(guac_rect_width(dst), GUAC_DISPLAY_LAYER_RAW_BPP);
+    for (int y = dst->top; y < dst->bottom; y++) {
+
+        if (memcmp(dst_buffer, src_buffer, row_length))
+            return 0;
+
+        dst_buffer += dst_stride;
+        src_buffer += src_stride;
+
+    }
+
+    return 1;
+
+}
+
+/**
+ * Rewrites the given draw operation as a simple rect if the given fill hint
+ * accurately describes the contents of the region drawn.
+ *
+ * @param op
+ *     The draw operation to rewrite.
+ *
+ * @param hint
+ *     The fill hint that wholly contains the region drawn by the operation.
+ *
+ * @return
+ *     Non-zero if the operation was rewritten, zero if the hint does not
+ *     accurately describe the region drawn.
+ */
+static int PFR_guac_display_plan_apply_fill_hint(guac_display_plan_operation* op,
+        const guac_display_hint* hint) {
+
+    guac_display_layer* layer = op->layer;
+
+    if (!PFR_guac_display_layer_is_filled(layer, &op->dest, hint->color))
+        return 0;
+
+    /* Use the color actually drawn, ignoring the alpha channel for opaque
+     * layers */
+    uint32_t color = *((const uint32_t*) GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(layer->pending_frame, op->dest));
+    if (layer->opaque)
+        color |= 0xFF000000;
+
+    op->type = GUAC_DISPLAY_PLAN_OPERATION_RECT;
+    op->src.color = color;
+    return 1;
+
+}
+
+/**
+ * Rewrites the given draw operation as a copy from the last frame of the same
+ * layer if the given copy hint accurately describes the contents of the region
+ * drawn.
+ *
+ * @param op
+ *     The draw operation to rewrite.
+ *
+ * @param hint
+ *     The copy hint that wholly contains the region drawn by the operation.
+ *
+ * @return
+ *     Non-zero if the operation was rewritten, zero if the hint does not
+ *     accurately describe the region drawn.
+ */
+static int PFR_LFR_guac_display_plan_apply_copy_hint(guac_display_plan_operation* op,
+        const guac_display_hint* hint) {
+
+    guac_display_layer* layer = op->layer;
+    if (layer->last_frame.buffer == NULL)
+        return 0;
+
+    /* Locate the portion of the hinted source that corresponds to the region
+     * drawn by the operation */
+    guac_rect src = op->dest;
+    int dx = hint->src_x - hint->dest.left;
+    int dy = hint->src_y - hint->dest.top;
+    src.left   += dx;
+    src.right  += dx;
+    src.top    += dy;
+    src.bottom += dy;
+
+    guac_rect bounds = {
+        .left   = 0,
+        .top    = 0,
+        .right  = layer->last_frame.width,
+        .bottom = layer->last_frame.height
+    };
+
+    if (!guac_rect_contains(&bounds, &src))
+        return 0;
+
+    /* Regions covered by video cannot be used as a source */
+    if (LFR_guac_display_layer_is_video_covered(layer, &src))
+        return 0;
+
+    if (!PFR_LFR_guac_display_layer_is_copied(layer, &op->dest, &src))
+        return 0;
+
+    op->type = GUAC_DISPLAY_PLAN_OPERATION_COPY;
+    op->src.layer_rect.layer = layer->last_frame_buffer;
+    op->src.layer_rect.rect = src;
+    return 1;
+
+}
+
+/**
+ * Rewrites the given draw operation using the most recently provided hint
+ * that wholly contains the region drawn and accurately describes its
+ * contents, if any. Older hints are tried only if newer hints containing the
+ * same region turn out to be inaccurate.
+ *
+ * @param op
+ *     The draw operation to rewrite.
+ *
+ * @return
+ *     Zero if no hint contains the region drawn or if the operation was
+ *     rewritten, non-zero if at least one hint contains the region drawn but
+ *     no such hint accurately describes its contents.
+ */
+static int PFR_LFR_guac_display_plan_apply_hints(guac_display_plan_operation* op) {
+
+    const guac_display_layer* layer = op->layer;
+    int failed = 0;
+
+    for (int i = layer->pending_frame_hint_count - 1; i >= 0; i--) {
+
+        const guac_display_hint* hint = &layer->pending_frame_hints[i];
+        if (!guac_rect_contains(&hint->dest, &op->dest))
+            continue;
+
+        switch (hint->type) {
+
+            case GUAC_DISPLAY_HINT_FILL:
+                if (PFR_guac_display_plan_apply_fill_hint(op, hint))
+                    return 0;
+                break;
+
+            case GUAC_DISPLAY_HINT_COPY:
+                if (PFR_LFR_guac_display_plan_apply_copy_hint(op, hint))
+                    return 0;
+                break;
+
+        }
+
+        failed = 1;
+
+    }
+
+    return failed;
+
+}
+
+void PFW_LFR_guac_display_plan_rewrite_as_hinted(guac_display_plan* plan) {
+
+    guac_display_plan_operation* op = plan->ops;
+    for (int i = 0; i < plan->length; i++, op++) {
+
+        if (op->type != GUAC_DISPLAY_PLAN_OPERATION_IMG)
+            continue;
+
+        /* NOTE: As with the rects pass, operations referring to layers whose
+         * buffers have been replaced with NULL are simply left untouched */
+        guac_display_layer* layer = op->layer;
+        if (layer->pending_frame_hint_count == 0 || layer->pending_frame.buffer == NULL)
+            continue;
+
+        /* Hints that turn out to be inaccurate are no substitute for
+         * searching the last frame for the content drawn, even if a search
+         * was not otherwise requested for the layer */
+        if (PFR_LFR_guac_display_plan_apply_hints(op)) {
+            layer->pending_frame_hint_failures++;
+            layer->pending_frame.search_for_copies = 1;
+        }
+
+    }
+
+}
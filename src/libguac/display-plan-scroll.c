@@ -0,0 +1,449 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "display-plan.h"
+#include "display-priv.h"
+#include "guacamole/display.h"
+#include "guacamole/mem.h"
+#include "guacamole/rect.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The hash of a single row or column of image data, along with the location
+ * of that row or column.
+ */
+typedef struct guac_display_scroll_line {
+
+    /**
+     * The hash of the image data within the row or column.
+     */
+    uint64_t hash;
+
+    /**
+     * The offset of the row or column from the top or left edge of the
+     * region being searched.
+     */
+    int index;
+
+} guac_display_scroll_line;
+
+/**
+ * Comparator for qsort() and bsearch() which orders guac_display_scroll_line
+ * structures by hash.
+ *
+ * @param a
+ *     A pointer to the first guac_display_scroll_line to compare.
+ *
+ * @param b
+ *     A pointer to the second guac_display_scroll_line to compare.
+ *
+ * @return
+ *     A negative value if the first line has a smaller hash than the second,
+ *     a positive value if the first line has a larger hash than the second,
+ *     or zero if both hashes are equal.
+ */
+static int guac_display_scroll_line_cmp(const void* a, const void* b) {
+
+    uint64_t hash_a = ((const guac_display_scroll_line*) a)->hash;
+    uint64_t hash_b = ((const guac_display_scroll_line*) b)->hash;
+
+    if (hash_a < hash_b) return -1;
+    if (hash_a > hash_b) return 1;
+    return 0;
+
+}
+
+/**
+ * Calculates the hash of each row of the given rectangular region of the
+ * buffer of the given layer state.
+ *
+ * @param layer_state
+ *     The layer state containing the image buffer to hash.
+ *
+ * @param rect
+ *     The rectangular region within the image buffer that should be hashed.
+ *
+ * @param hashes
+ *     An array having at least as many elements as there are rows in the
+ *     given rectangle, which will receive the hash of each row.
+ */
+static void guac_display_scroll_hash_rows(const guac_display_layer_state* layer_state,
+        const guac_rect* rect, uint64_t* hashes) {
+
+    size_t stride = layer_state->buffer_stride;
+    const unsigned char* data = GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(*layer_state, *rect);
+
+    int width = guac_rect_width(rect);
+    for (int y = rect->top; y < rect->bottom; y++) {
+
+        const uint32_t* row = (const uint32_t*) data;
+        data += stride;
+
+        uint64_t hash = 0;
+        for (int x = 0; x < width; x++)
+            hash = ((hash * 31) << 1) + row[x];
+
+        *(hashes++) = hash;
+
+    }
+
+}
+
+/**
+ * Calculates the hash of each column of the given rectangular region of the
+ * buffer of the given layer state. The region is traversed row by row, such
+ * that the hashes of all columns are calculated in a single pass.
+ *
+ * @param layer_state
+ *     The layer state containing the image buffer to hash.
+ *
+ * @param rect
+ *     The rectangular region within the image buffer that should be hashed.
+ *
+ * @param hashes
+ *     An array having at least as many elements as there are columns in the
+ *     given rectangle, which will receive the hash of each column.
+ */
+static void guac_display_scroll_hash_columns(const guac_display_layer_state* layer_state,
+        const guac_rect* rect, uint64_t* hashes) {
+
+    size_t stride = layer_state->buffer_stride;
+    const unsigned char* data = GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(*layer_state, *rect);
+
+    int width = guac_rect_width(rect);
+    for (int x = 0; x < width; x++)
+        hashes[x] = 0;
+
+    for (int y = rect->top; y < rect->bottom; y++) {
+
+        const uint32_t* row = (const uint32_t*) data;
+        data += stride;
+
+        for (int x = 0; x < width; x++)
+            hashes[x] = ((hashes[x] * 31) << 1) + row[x];
+
+    }
+
+}
+
+/**
+ * Searches the given hashes of the rows (or columns) of a region for a
+ * consistent shift between the last frame and the pending frame. Each changed
+ * line of the pending frame whose content occurs exactly once within the last
+ * frame votes for the offset between those two lines, and the longest run of
+ * consecutive lines that match at the most popular offset is returned.
+ *
+ * @param last
+ *     The hashes of each line of the region within the last frame.
+ *
+ * @param pending
+ *     The hashes of each line of the region within the pending frame.
+ *
+ * @param length
+ *     The number of lines within the region.
+ *
+ * @param offset
+ *     Pointer to an int that will receive the offset from each line of the
+ *     pending frame to its original location in the last frame, if a shift
+ *     is found.
+ *
+ * @param start
+ *     Pointer to an int that will receive the first line of the pending
+ *     frame that is shifted, if a shift is found.
+ *
+ * @param end
+ *     Pointer to an int that will receive the line immediately after the last
+ *     line of the pending frame that is shifted, if a shift is found.
+ *
+ * @return
+ *     Non-zero if at least GUAC_DISPLAY_SCROLL_MIN_LENGTH consecutive lines
+ *     were found to be shifted by the same non-zero offset, zero otherwise.
+ */
+static int guac_display_scroll_find_shift(const uint64_t* last,
+        const uint64_t* pending, int length, int* offset, int* start,
+        int* end) {
+
+    guac_display_scroll_line* lines = guac_mem_alloc(sizeof(guac_display_scroll_line), length);
+    for (int i = 0; i < length; i++) {
+        lines[i].hash = last[i];
+        lines[i].index = i;
+    }
+
+    qsort(lines, length, sizeof(guac_display_scroll_line), guac_display_scroll_line_cmp);
+
+    /* Retain only the lines whose content is unique within the last frame
+     * (blank lines and other repeated content cannot indicate where a line
+     * came from) */
+    int unique = 0;
+    for (int i = 0; i < length; ) {
+
+        int j = i + 1;
+        while (j < length && lines[j].hash == lines[i].hash)
+            j++;
+
+        if (j == i + 1)
+            lines[unique++] = lines[i];
+
+        i = j;
+
+    }
+
+    /* Each changed line votes for the offset to its original location */
+    int* votes = guac_mem_zalloc(sizeof(int), length, 2);
+    for (int i = 0; i < length; i++) {
+
+        if (pending[i] == last[i])
+            continue;
+
+        guac_display_scroll_line key = { .hash = pending[i] };
+        guac_display_scroll_line* match = bsearch(&key, lines, unique,
+                sizeof(guac_display_scroll_line), guac_display_scroll_line_cmp);
+
+        if (match != NULL)
+            votes[match->index - i + length]++;
+
+    }
+
+    int best = 0;
+    int best_votes = 0;
+    for (int i = 0; i < length * 2; i++) {
+        if (i != length && votes[i] > best_votes) {
+            best = i - length;
+            best_votes = votes[i];
+        }
+    }
+
+    guac_mem_free(votes);
+    guac_mem_free(lines);
+
+    if (best_votes == 0)
+        return 0;
+
+    /* Locate the longest run of lines that match at the chosen offset */
+    int first = best < 0 ? -best : 0;
+    int last_line = best > 0 ? length - best : length;
+
+    int run_start = first;
+    int best_length = 0;
+    for (int i = first; i < last_line; i++) {
+
+        if (pending[i] != last[i + best]) {
+            run_start = i + 1;
+            continue;
+        }
+
+        if (i + 1 - run_start > best_length) {
+            best_length = i + 1 - run_start;
+            *start = run_start;
+            *end = i + 1;
+        }
+
+    }
+
+    if (best_length < GUAC_DISPLAY_SCROLL_MIN_LENGTH)
+        return 0;
+
+    *offset = best;
+    return 1;
+
+}
+
+/**
+ * Returns the number of frames that should be skipped before a layer is next
+ * searched for scrolling, given the number of consecutive searches of that
+ * layer that have found nothing.
+ *
+ * @param misses
+ *     The number of consecutive searches that have not found any scroll.
+ *
+ * @return
+ *     The number of frames to skip before searching again, which is zero
+ *     until GUAC_DISPLAY_SCROLL_MAX_MISSES is reached and never exceeds
+ *     GUAC_DISPLAY_SCROLL_MAX_BACKOFF.
+ */
+static int guac_display_scroll_backoff(int misses) {
+
+    if (misses < GUAC_DISPLAY_SCROLL_MAX_MISSES)
+        return 0;
+
+    int backoff = 1;
+    for (int i = GUAC_DISPLAY_SCROLL_MAX_MISSES; i < misses
+            && backoff < GUAC_DISPLAY_SCROLL_MAX_BACKOFF; i++)
+        backoff <<= 1;
+
+    return backoff;
+
+}
+
+/**
+ * Stores the given detected scroll as a hint for the pending frame of the
+ * given layer. The hint is stored ahead of all other hints, such that any
+ * hints provided explicitly for the same region take priority. The layer must
+ * have room for at least one more hint.
+ *
+ * @param layer
+ *     The layer that the hint applies to.
+ *
+ * @param hint
+ *     The hint to store.
+ */
+static void PFW_guac_display_layer_add_scroll_hint(guac_display_layer* layer,
+        const guac_display_hint* hint) {
+
+    memmove(&layer->pending_frame_hints[1], &layer->pending_frame_hints[0],
+            sizeof(guac_display_hint) * layer->pending_frame_hint_count);
+
+    layer->pending_frame_hints[0] = *hint;
+    layer->pending_frame_hint_count++;
+
+}
+
+/**
+ * Searches the modified region of the given layer for content that has been
+ * shifted vertically or horizontally since the last frame, storing a copy
+ * hint for the largest such region found.
+ *
+ * @param layer
+ *     The layer to search.
+ *
+ * @return
+ *     Non-zero if a scroll was detected and stored as a hint, zero otherwise.
+ */
+static int PFW_LFR_guac_display_layer_detect_scroll(guac_display_layer* layer) {
+
+    /* NOTE: As with other passes, layers whose buffers have been replaced
+     * with NULL are simply ignored */
+    if (layer->pending_frame.buffer == NULL || layer->last_frame.buffer == NULL)
+        return 0;
+
+    if (layer->pending_frame_hint_count >= GUAC_DISPLAY_MAX_HINTS)
+        return 0;
+
+    /* Any copy hints provided for the layer are trusted over detection, so
+     * long as those hints have proven accurate */
+    if (layer->pending_frame_hint_failures == 0) {
+        for (int i = 0; i < layer->pending_frame_hint_count; i++) {
+            if (layer->pending_frame_hints[i].type == GUAC_DISPLAY_HINT_COPY)
+                return 0;
+        }
+    }
+
+    /* Only content present within both frames can have been shifted */
+    guac_rect region = layer->pending_frame.dirty;
+    guac_rect last_frame_bounds = {
+        .left   = 0,
+        .top    = 0,
+        .right  = layer->last_frame.width,
+        .bottom = layer->last_frame.height
+    };
+
+    guac_rect_constrain(&region, &last_frame_bounds);
+
+    /* Regions streamed as video change continuously and would only add to the
+     * cost of searching */
+    if (LFR_guac_display_layer_is_video_covered(layer, &region))
+        return 0;
+
+    int width = guac_rect_width(&region);
+    int height = guac_rect_height(&region);
+    if (width < GUAC_DISPLAY_SCROLL_MIN_SIZE || height < GUAC_DISPLAY_SCROLL_MIN_SIZE)
+        return 0;
+
+    /* Searching involves hashing the entire region within both frames, and
+     * is done only occasionally for layers whose large updates have recently
+     * not been scrolls (video, animations, etc.) */
+    if (layer->scroll_backoff > 0) {
+        layer->scroll_backoff--;
+        return 0;
+    }
+
+    int length = width > height ? width : height;
+    uint64_t* last_hashes = guac_mem_alloc(sizeof(uint64_t), length);
+    uint64_t* pending_hashes = guac_mem_alloc(sizeof(uint64_t), length);
+
+    guac_display_hint hint = { .type = GUAC_DISPLAY_HINT_COPY };
+    int offset, start, end;
+    int detected = 0;
+
+    /* Vertical scrolling is by far the most common, and is checked first */
+    guac_display_scroll_hash_rows(&layer->last_frame, &region, last_hashes);
+    guac_display_scroll_hash_rows(&layer->pending_frame, &region, pending_hashes);
+    if (guac_display_scroll_find_shift(last_hashes, pending_hashes, height, &offset, &start, &end)) {
+        guac_rect_init(&hint.dest, region.left, region.top + start, width, end - start);
+        hint.src_x = region.left;
+        hint.src_y = region.top + start + offset;
+        PFW_guac_display_layer_add_scroll_hint(layer, &hint);
+        detected = 1;
+    }
+
+    /* Otherwise, check for horizontal scrolling */
+    else {
+
+        guac_display_scroll_hash_columns(&layer->last_frame, &region, last_hashes);
+        guac_display_scroll_hash_columns(&layer->pending_frame, &region, pending_hashes);
+        if (guac_display_scroll_find_shift(last_hashes, pending_hashes, width, &offset, &start, &end)) {
+            guac_rect_init(&hint.dest, region.left + start, region.top, end - start, height);
+            hint.src_x = region.left + start + offset;
+            hint.src_y = region.top;
+            PFW_guac_display_layer_add_scroll_hint(layer, &hint);
+            detected = 1;
+        }
+
+    }
+
+    guac_mem_free(pending_hashes);
+    guac_mem_free(last_hashes);
+
+    /* Back off exponentially from searching layers that repeatedly do not
+     * scroll, resuming every search as soon as a scroll is found */
+    if (detected)
+        layer->scroll_misses = 0;
+
+    else {
+
+        /* Further misses are not counted once the backoff has reached its
+         * maximum, as they could not increase it */
+        if (guac_display_scroll_backoff(layer->scroll_misses) < GUAC_DISPLAY_SCROLL_MAX_BACKOFF)
+            layer->scroll_misses++;
+
+        layer->scroll_backoff = guac_display_scroll_backoff(layer->scroll_misses);
+
+    }
+
+    return detected;
+
+}
+
+int PFW_LFR_guac_display_plan_detect_scrolls(guac_display_plan* plan) {
+
+    int detected = 0;
+
+    guac_display* display = plan->display;
+    guac_display_layer* current = display->pending_frame.layers;
+    while (current != NULL) {
+        detected |= PFW_LFR_guac_display_layer_detect_scroll(current);
+        current = current->pending_frame.next;
+    }
+
+    return detected;
+
+}
@@ -221,7 +221,8 @@ static void guac_display_cell_init_rect(guac_rect* rect, int x, int y) {
 
 /**
  * Callback for guac_hash_foreach_image_rect() which stores the given operation
- * in the ops_by_hash table of the given display plan.
+ * in the ops_by_hash table of the given display plan, additionally recording
+ * the hash of the operation's cell within the operation itself.
  *
  * @param plan
  *     The display plan to store the given operation in.
@@ -243,7 +244,13 @@ static void guac_display_cell_init_rect(guac_rect* rect, int x, int y) {
  *     within the ops_by_hash table of the given display plan.
  */
 static void guac_display_plan_index_op_for_cell(guac_display_plan* plan, int x, int y, uint64_t hash, void* closure) {
-    guac_display_plan_store_indexed_op(plan, hash, (guac_display_plan_operation*) closure);
+
+    guac_display_plan_operation* op = (guac_display_plan_operation*) closure;
+    op->hash = hash;
+    op->hash_valid = 1;
+
+    guac_display_plan_store_indexed_op(plan, hash, op);
+
 }
 
 void PFR_guac_display_plan_index_dirty_cells(guac_display_plan* plan) {
@@ -376,6 +383,13 @@ static void PFR_LFR_guac_display_plan_find_copies(guac_display_plan* plan,
 
     guac_display_layer* copy_from_layer = (guac_display_layer*) closure;
 
+    guac_rect src_rect;
+    guac_rect_init(&src_rect, x, y, GUAC_DISPLAY_CELL_SIZE, GUAC_DISPLAY_CELL_SIZE);
+
+    /* Regions covered by video cannot be used as a source */
+    if (LFR_guac_display_layer_is_video_covered(copy_from_layer, &src_rect))
+        return;
+
     /* Transform the matching operation into a copy of the current region if
      * any operations match, banning the underlying hash from further checks if
      * a collision occurs */
@@ -384,9 +398,6 @@ static void PFR_LFR_guac_display_plan_find_copies(guac_display_plan* plan,
 
         guac_display_layer* copy_to_layer = op->layer;
 
-        guac_rect src_rect;
-        guac_rect_init(&src_rect, x, y, GUAC_DISPLAY_CELL_SIZE, GUAC_DISPLAY_CELL_SIZE);
-
         guac_rect dst_rect;
         guac_display_cell_init_rect(&dst_rect, op->dest.left, op->dest.top);
 
@@ -0,0 +1,359 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "display-plan.h"
+#include "display-priv.h"
+#include "encode-video.h"
+#include "guacamole/client.h"
+#include "guacamole/layer.h"
+#include "guacamole/mem.h"
+#include "guacamole/metrics.h"
+#include "guacamole/protocol.h"
+#include "guacamole/rect.h"
+#include "guacamole/socket.h"
+#include "guacamole/timestamp.h"
+
+#include <cairo/cairo.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+
+void guac_display_layer_free_video(guac_display_layer* layer) {
+
+    guac_display_video* video = layer->video;
+    if (video == NULL)
+        return;
+
+    guac_client* client = layer->display->client;
+
+#ifdef ENABLE_VIDEO_ENCODING
+    if (video->encoder != NULL)
+        guac_video_encoder_free(video->encoder);
+#endif
+
+    /* Remove the layer playing the video, revealing the underlying layer */
+    guac_protocol_send_dispose(client->socket, video->layer);
+    guac_client_free_layer(client, video->layer);
+
+    guac_mem_free(layer->video);
+
+}
+
+int LFR_guac_display_layer_is_video_covered(guac_display_layer* layer,
+        const guac_rect* rect) {
+
+    guac_display_video* video = layer->video;
+    return video != NULL && guac_rect_intersects(rect, &video->rect);
+
+}
+
+void LFR_guac_display_layer_write_video(guac_display_layer* layer) {
+
+#ifdef ENABLE_VIDEO_ENCODING
+    guac_display_video* video = layer->video;
+    if (video == NULL || !video->modified || video->failed)
+        return;
+
+    guac_display* display = layer->display;
+    guac_rect* rect = &video->rect;
+
+    uint64_t encode_start = guac_display_usec_current();
+
+    if (guac_video_encoder_write(video->encoder,
+                GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(layer->last_frame, *rect),
+                layer->last_frame.buffer_stride, display->last_frame.timestamp))
+        video->failed = 1;
+
+    video->modified = 0;
+
+    uint64_t encode_usec = guac_display_usec_current() - encode_start;
+
+    /* Track encoding time */
+    guac_metrics* metrics = guac_display_metrics(display);
+    guac_metrics_add(&metrics->encode_usec[GUAC_DISPLAY_ENCODING_VIDEO], encode_usec);
+    guac_metrics_add(&metrics->encode_count[GUAC_DISPLAY_ENCODING_VIDEO], 1);
+    guac_metrics_add(&metrics->encode_pixels[GUAC_DISPLAY_ENCODING_VIDEO],
+            guac_rect_width(rect) * guac_rect_height(rect));
+#endif
+
+}
+
+#ifdef ENABLE_VIDEO_ENCODING
+
+/**
+ * Ends the video covering part of the given layer, first restoring the
+ * contents of the region covered by that video within both the underlying
+ * layer and the client-side copy of the last frame. The contents restored are
+ * those of the last frame, and thus match the final frame of the video.
+ *
+ * @param layer
+ *     The layer whose video should be ended.
+ */
+static void LFW_guac_display_layer_end_video(guac_display_layer* layer) {
+
+    guac_display_video* video = layer->video;
+    guac_client* client = layer->display->client;
+    guac_socket* socket = client->socket;
+
+    guac_rect rect = video->rect;
+    guac_rect bounds;
+    guac_rect_init(&bounds, 0, 0, layer->last_frame.width, layer->last_frame.height);
+    guac_rect_constrain(&rect, &bounds);
+
+    if (!guac_rect_is_empty(&rect)) {
+
+        int x = rect.left;
+        int y = rect.top;
+        int width = guac_rect_width(&rect);
+        int height = guac_rect_height(&rect);
+
+        cairo_surface_t* surface = cairo_image_surface_create_for_data(
+                GUAC_DISPLAY_LAYER_STATE_MUTABLE_BUFFER(layer->last_frame, rect),
+                CAIRO_FORMAT_RGB24, width, height, layer->last_frame.buffer_stride);
+
+        guac_client_stream_png(client, socket, GUAC_COMP_OVER, layer->layer,
+                x, y, surface);
+
+        cairo_surface_destroy(surface);
+
+        guac_protocol_send_copy(socket, layer->layer, x, y, width, height,
+                GUAC_COMP_OVER, layer->last_frame_buffer, x, y);
+
+    }
+
+    guac_client_log(client, GUAC_LOG_DEBUG, "Ending video covering %ix%i "
+            "region of layer %i.", guac_rect_width(&video->rect),
+            guac_rect_height(&video->rect), layer->layer->index);
+
+    guac_display_layer_free_video(layer);
+
+}
+
+/**
+ * Begins streaming the region of the given layer that has been identified as
+ * containing continuously-updated content (the layer's video_candidate) as
+ * video. If no video format is supported by all connected users, or the video
+ * cannot be started, the layer is left unchanged and tracking of that region
+ * starts over.
+ *
+ * @param layer
+ *     The layer to begin streaming video for.
+ *
+ * @param timestamp
+ *     The time at which the video starts.
+ */
+static void LFW_guac_display_layer_start_video(guac_display_layer* layer,
+        guac_timestamp timestamp) {
+
+    guac_client* client = layer->display->client;
+    guac_socket* socket = client->socket;
+
+    /* Fall back to images for the time being if any user lacks support for
+     * all formats that can be encoded */
+    const char* mimetype = guac_video_encoder_select_mimetype(client);
+    if (mimetype == NULL) {
+        layer->video_candidate_frames = 0;
+        return;
+    }
+
+    guac_rect* rect = &layer->video_candidate;
+    int width = guac_rect_width(rect);
+    int height = guac_rect_height(rect);
+
+    /* Play the video within a child layer covering the region, beneath any
+     * other children of the layer */
+    guac_layer* overlay = guac_client_alloc_layer(client);
+    guac_protocol_send_size(socket, overlay, width, height);
+    guac_protocol_send_move(socket, overlay, layer->layer,
+            rect->left, rect->top, INT_MIN);
+
+    guac_video_encoder* encoder = guac_video_encoder_alloc(client, socket,
+            overlay, mimetype, width, height, timestamp);
+
+    if (encoder == NULL) {
+        guac_client_log(client, GUAC_LOG_DEBUG, "Unable to stream %ix%i "
+                "region of layer %i as \"%s\" video. Falling back to "
+                "images.", width, height, layer->layer->index, mimetype);
+        guac_protocol_send_dispose(socket, overlay);
+        guac_client_free_layer(client, overlay);
+        layer->video_candidate_frames = 0;
+        return;
+    }
+
+    guac_display_video* video = guac_mem_zalloc(sizeof(guac_display_video));
+    video->rect = *rect;
+    video->layer = overlay;
+    video->encoder = encoder;
+    video->users = client->connected_users;
+    video->last_update = timestamp;
+    layer->video = video;
+
+    guac_client_log(client, GUAC_LOG_DEBUG, "Streaming %ix%i region of "
+            "layer %i as \"%s\" video.", width, height, layer->layer->index,
+            mimetype);
+
+}
+
+/**
+ * Updates the tracking of continuously-updated content within the given
+ * layer to account for the operations of the given plan, starting or ending
+ * video for that layer as necessary. Draw operations that fall entirely
+ * within a region being streamed as video are replaced with NOPs.
+ *
+ * @param plan
+ *     The display plan being rewritten.
+ *
+ * @param layer
+ *     The layer to update.
+ */
+static void PFW_LFW_guac_display_layer_rewrite_as_video(guac_display_plan* plan,
+        guac_display_layer* layer) {
+
+    guac_client* client = plan->display->client;
+    guac_timestamp now = plan->frame_end;
+
+    guac_rect bounds;
+    guac_rect_init(&bounds, 0, 0, layer->pending_frame.width, layer->pending_frame.height);
+
+    /* Only lossy, opaque, visible layers may contain video */
+    int eligible = layer->opaque && !layer->pending_frame.lossless
+        && layer->layer->index >= 0;
+
+    /* Determine the cell-aligned region containing all continuously-updated
+     * content within this frame of the layer */
+    guac_rect region;
+    guac_rect_init(&region, 0, 0, 0, 0);
+
+    guac_display_plan_operation* op = plan->ops;
+    for (size_t i = 0; i < plan->length; i++, op++) {
+        if (op->layer == layer && op->type == GUAC_DISPLAY_PLAN_OPERATION_IMG
+                && op->content == GUAC_DISPLAY_CONTENT_VIDEO)
+            guac_rect_extend(&region, &op->dest);
+    }
+
+    if (!guac_rect_is_empty(&region)) {
+
+        guac_rect_align(&region, GUAC_DISPLAY_CELL_SIZE_EXPONENT);
+        guac_rect_constrain(&region, &bounds);
+
+        /* Video dimensions must be even */
+        region.right  -= guac_rect_width(&region)  & 1;
+        region.bottom -= guac_rect_height(&region) & 1;
+
+    }
+
+    /* Track how long continuously-updated content has remained within the
+     * same region, restarting whenever that region grows or moves */
+    if (!guac_rect_is_empty(&region)) {
+
+        if (guac_rect_is_empty(&layer->video_candidate)
+                || !guac_rect_intersects(&layer->video_candidate, &region)) {
+            layer->video_candidate = region;
+            layer->video_candidate_frames = 1;
+        }
+
+        else if (guac_rect_contains(&layer->video_candidate, &region))
+            layer->video_candidate_frames++;
+
+        else {
+            guac_rect_extend(&layer->video_candidate, &region);
+            layer->video_candidate_frames = 1;
+        }
+
+        layer->video_candidate_updated = now;
+
+    }
+
+    else if (now - layer->video_candidate_updated > GUAC_DISPLAY_VIDEO_TIMEOUT) {
+        guac_rect_init(&layer->video_candidate, 0, 0, 0, 0);
+        layer->video_candidate_frames = 0;
+    }
+
+    int candidate_stable = layer->video_candidate_frames >= GUAC_DISPLAY_VIDEO_MIN_FRAMES;
+
+    /* End any existing video that is no longer appropriate */
+    guac_display_video* video = layer->video;
+    if (video != NULL) {
+
+        /* Note whether the region covered by the video has changed */
+        op = plan->ops;
+        for (size_t i = 0; i < plan->length; i++, op++) {
+            if (op->layer == layer && op->type == GUAC_DISPLAY_PLAN_OPERATION_IMG
+                    && guac_rect_intersects(&op->dest, &video->rect)) {
+                video->last_update = now;
+                break;
+            }
+        }
+
+        if (!eligible
+                || video->failed
+                || video->users != client->connected_users
+                || !guac_rect_contains(&bounds, &video->rect)
+                || now - video->last_update > GUAC_DISPLAY_VIDEO_TIMEOUT
+                || (candidate_stable && !guac_rect_contains(&video->rect, &layer->video_candidate)))
+            LFW_guac_display_layer_end_video(layer);
+
+    }
+
+    /* Begin streaming video for regions that have been continuously updated
+     * for long enough */
+    if (layer->video == NULL && eligible && candidate_stable
+            && guac_rect_width(&layer->video_candidate)
+                * guac_rect_height(&layer->video_candidate) >= GUAC_DISPLAY_VIDEO_MIN_AREA)
+        LFW_guac_display_layer_start_video(layer, now);
+
+    /* Remove all draws that are now handled by the video, replacing the first
+     * such draw with an operation that encodes the next frame of that video */
+    video = layer->video;
+    if (video != NULL) {
+        int video_op_added = 0;
+        op = plan->ops;
+        for (size_t i = 0; i < plan->length; i++, op++) {
+            if (op->layer == layer && op->type == GUAC_DISPLAY_PLAN_OPERATION_IMG
+                    && guac_rect_contains(&video->rect, &op->dest)) {
+
+                if (video_op_added)
+                    op->type = GUAC_DISPLAY_PLAN_OPERATION_NOP;
+
+                else {
+                    op->type = GUAC_DISPLAY_PLAN_OPERATION_VIDEO;
+                    op->dest = video->rect;
+                    video->modified = 1;
+                    video_op_added = 1;
+                }
+
+            }
+        }
+    }
+
+}
+
+#endif
+
+void PFW_LFW_guac_display_plan_rewrite_as_video(guac_display_plan* plan) {
+
+#ifdef ENABLE_VIDEO_ENCODING
+    guac_display_layer* current = plan->display->pending_frame.layers;
+    while (current != NULL) {
+        PFW_LFW_guac_display_layer_rewrite_as_video(plan, current);
+        current = current->pending_frame.next;
+    }
+#endif
+
+}
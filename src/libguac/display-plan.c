@@ -140,6 +140,175 @@ static size_t guac_display_memcmp(const uint32_t* restrict buffer_a,
 
 }
 
+int guac_display_png_optimality(const unsigned char* buffer, size_t stride,
+        int width, int height) {
+
+    int x, y;
+
+    int num_same = 0;
+    int num_different = 1;
+
+    /* Image must be at least 1x1 */
+    if (width < 1 || height < 1)
+        return 0;
+
+    /* For each row */
+    for (y = 0; y < height; y++) {
+
+        uint32_t* row = (uint32_t*) buffer;
+        uint32_t last_pixel = *(row++) | 0xFF000000;
+
+        /* For each pixel in current row */
+        for (x = 1; x < width; x++) {
+
+            /* Get next pixel */
+            uint32_t current_pixel = *(row++) | 0xFF000000;
+
+            /* Update same/different counts according to pixel value */
+            if (current_pixel == last_pixel)
+                num_same++;
+            else
+                num_different++;
+
+            last_pixel = current_pixel;
+
+        }
+
+        /* Advance to next row */
+        buffer += stride;
+
+    }
+
+    /* Return rough approximation of optimality for PNG compression. As PNG
+     * leverages lossless DEFLATE compression (which works by reducing the
+     * number of bytes required to represent repeated data), an approximation
+     * of the amount of repeated image data within the image is a reasonable
+     * approximation for how well an image will compress. */
+    return 0x100 * num_same / num_different - 0x400;
+
+}
+
+/**
+ * Returns the smoothed interval between updates to the given cell, in
+ * milliseconds. Cells whose update interval has not yet been measured are
+ * treated as having been updated as long ago as is tracked.
+ *
+ * @param cell
+ *     The cell whose update interval should be returned.
+ *
+ * @return
+ *     The smoothed interval between updates to the given cell, in
+ *     milliseconds.
+ */
+static int PFR_guac_display_layer_cell_update_interval(
+        const guac_display_layer_cell* cell) {
+
+    if (!cell->update_interval_measured)
+        return GUAC_DISPLAY_MAX_UPDATE_INTERVAL;
+
+    /* Round to the nearest millisecond */
+    return (cell->update_interval
+            + (1 << (GUAC_DISPLAY_UPDATE_INTERVAL_FRACTION_BITS - 1)))
+        >> GUAC_DISPLAY_UPDATE_INTERVAL_FRACTION_BITS;
+
+}
+
+/**
+ * Updates the update frequency history and content classification of the
+ * given cell to account for a frame that modifies that cell. The contents of
+ * the cell are rescanned only if the cell has not yet been classified or has
+ * been updated GUAC_DISPLAY_RECLASSIFY_INTERVAL times since it was last
+ * classified, such that the cost of scanning is amortized across frames.
+ *
+ * @param layer
+ *     The layer containing the cell.
+ *
+ * @param cell
+ *     The cell being modified.
+ *
+ * @param x
+ *     The X coordinate of the cell within the pending_frame_cells array of
+ *     the layer, in cells.
+ *
+ * @param y
+ *     The Y coordinate of the cell within the pending_frame_cells array of
+ *     the layer, in cells.
+ *
+ * @param frame_end
+ *     The timestamp of the frame modifying the cell.
+ */
+static void PFW_guac_display_layer_cell_classify(guac_display_layer* layer,
+        guac_display_layer_cell* cell, int x, int y, guac_timestamp frame_end) {
+
+    /* No interval can be measured for cells that have never been modified */
+    if (cell->last_frame != 0) {
+
+        int interval = GUAC_DISPLAY_MAX_UPDATE_INTERVAL;
+        if (frame_end - cell->last_frame < interval)
+            interval = frame_end - cell->last_frame;
+
+        interval <<= GUAC_DISPLAY_UPDATE_INTERVAL_FRACTION_BITS;
+
+        /* Seed the average with the first interval actually measured, and
+         * smooth the update interval over time thereafter such that a region
+         * that occasionally pauses is not immediately considered static */
+        if (!cell->update_interval_measured) {
+            cell->update_interval = interval;
+            cell->update_interval_measured = 1;
+        }
+        else
+            cell->update_interval += (interval - cell->update_interval)
+                / (1 << GUAC_DISPLAY_UPDATE_INTERVAL_WEIGHT);
+
+    }
+
+    /* Rescan cell contents only periodically */
+    if (cell->content != GUAC_DISPLAY_CONTENT_UNKNOWN
+            && ++cell->updates_since_classified < GUAC_DISPLAY_RECLASSIFY_INTERVAL)
+        return;
+
+    guac_rect bounds = {
+        .left = 0,
+        .top = 0,
+        .right = layer->pending_frame.width,
+        .bottom = layer->pending_frame.height
+    };
+
+    guac_rect cell_rect;
+    guac_rect_init(&cell_rect, x * GUAC_DISPLAY_CELL_SIZE, y * GUAC_DISPLAY_CELL_SIZE,
+            GUAC_DISPLAY_CELL_SIZE, GUAC_DISPLAY_CELL_SIZE);
+    guac_rect_constrain(&cell_rect, &bounds);
+
+    int optimality = guac_display_png_optimality(
+            GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(layer->pending_frame, cell_rect),
+            layer->pending_frame.buffer_stride,
+            guac_rect_width(&cell_rect), guac_rect_height(&cell_rect));
+
+    /* Classify unknown cells purely by their contents, while requiring
+     * previously-classified cells to more strongly favor the opposite
+     * classification before being reclassified */
+    switch (cell->content) {
+
+        case GUAC_DISPLAY_CONTENT_TEXT:
+            if (optimality < -GUAC_DISPLAY_CONTENT_HYSTERESIS)
+                cell->content = GUAC_DISPLAY_CONTENT_PHOTO;
+            break;
+
+        case GUAC_DISPLAY_CONTENT_PHOTO:
+            if (optimality > GUAC_DISPLAY_CONTENT_HYSTERESIS)
+                cell->content = GUAC_DISPLAY_CONTENT_TEXT;
+            break;
+
+        default:
+            cell->content = (optimality < 0) ?
+                GUAC_DISPLAY_CONTENT_PHOTO : GUAC_DISPLAY_CONTENT_TEXT;
+
+    }
+
+    cell->updates_since_classified = 0;
+
+}
+
 guac_display_plan* PFW_LFR_guac_display_plan_create(guac_display* display) {
 
     guac_display_layer* current;
@@ -335,6 +504,16 @@ guac_display_plan* PFW_LFR_guac_display_plan_create(guac_display* display) {
                     current_op->dirty_size = cell->dirty_size;
                     current_op->last_frame = cell->last_frame;
                     current_op->current_frame = frame_end;
+                    current_op->hash_valid = 0;
+
+                    /* Complex content that is updated frequently is treated
+                     * as video */
+                    PFW_guac_display_layer_cell_classify(current, cell, x, y, frame_end);
+                    current_op->content = cell->content;
+                    current_op->update_interval = PFR_guac_display_layer_cell_update_interval(cell);
+                    if (cell->content == GUAC_DISPLAY_CONTENT_PHOTO
+                            && current_op->update_interval <= GUAC_DISPLAY_VIDEO_UPDATE_INTERVAL)
+                        current_op->content = GUAC_DISPLAY_CONTENT_VIDEO;
 
                     cell->related_op = current_op;
                     cell->dirty_size = 0;
@@ -369,6 +548,37 @@ void guac_display_plan_free(guac_display_plan* plan) {
     guac_mem_free(plan);
 }
 
+/**
+ * Ensures the operation FIFO of the given display can hold at least the given
+ * number of operations, replacing its storage with larger storage if
+ * necessary. The ops FIFO of the display MUST already be locked.
+ *
+ * @param display
+ *     The display whose operation FIFO should be grown.
+ *
+ * @param count
+ *     The number of operations that the FIFO must be able to hold.
+ */
+static void guac_display_plan_reserve_ops(guac_display* display, size_t count) {
+
+    size_t max_items = display->ops.max_items;
+    if (count <= max_items)
+        return;
+
+    /* Grow geometrically to avoid repeated reallocation as the display
+     * grows */
+    while (max_items < count)
+        max_items *= 2;
+
+    guac_display_plan_operation* old_items = display->ops_items;
+    display->ops_items = guac_mem_alloc(max_items,
+            sizeof(guac_display_plan_operation));
+
+    guac_fifo_relocate(&display->ops, display->ops_items, max_items);
+    guac_mem_free(old_items);
+
+}
+
 void guac_display_plan_apply(guac_display_plan* plan) {
 
     guac_display* display = plan->display;
@@ -379,6 +589,14 @@ void guac_display_plan_apply(guac_display_plan* plan) {
      * AFTER the non-image instructions have finished being written */
     guac_fifo_lock(&display->ops);
 
+    /* Ensure the FIFO can hold every operation of this frame, plus the NOP
+     * that may be added to mark the end of the frame. As frames are deferred
+     * while the workers are busy, the FIFO never needs to hold more than a
+     * single frame's worth of operations, and that number is bounded by the
+     * size of the layers involved. */
+    guac_display_plan_reserve_ops(display, display->ops.item_count
+            + plan->length + 1);
+
     /* Immediately send instructions for all updates that do not involve
      * significant processing (do not involve encoding anything). This allows
      * us to use the worker threads solely for encoding, reducing contention
@@ -76,12 +76,104 @@
  */
 #define GUAC_DISPLAY_JPEG_FRAMERATE 3
 
+/**
+ * The smoothed interval between updates, in milliseconds, at or below which
+ * photographic content is considered video and sent using lossy compression.
+ * This is the interval equivalent of GUAC_DISPLAY_JPEG_FRAMERATE.
+ */
+#define GUAC_DISPLAY_VIDEO_UPDATE_INTERVAL (1000 / GUAC_DISPLAY_JPEG_FRAMERATE)
+
+/**
+ * The number of consecutive frames that must update continuously-updated
+ * content within the same region of a layer before that region is streamed
+ * as video.
+ */
+#define GUAC_DISPLAY_VIDEO_MIN_FRAMES 10
+
+/**
+ * The minimum area of a region of a layer, in pixels, that may be streamed as
+ * video. Smaller regions are cheap enough to send as individual images that
+ * the overhead of starting a video is not worthwhile.
+ */
+#define GUAC_DISPLAY_VIDEO_MIN_AREA (256 * 256)
+
+/**
+ * The amount of time that a region being streamed as video may go without
+ * changing, in milliseconds, before the video is ended and the region is once
+ * again sent as individual images.
+ */
+#define GUAC_DISPLAY_VIDEO_TIMEOUT 1000
+
+/**
+ * The minimum width and height of the modified region of a layer, in pixels,
+ * that will be checked for scrolling. Smaller regions are cheap enough to send
+ * as images that searching them for shifted content is not worthwhile.
+ */
+#define GUAC_DISPLAY_SCROLL_MIN_SIZE 128
+
+/**
+ * The minimum number of consecutive rows (or columns) that must match the
+ * previous frame at the same offset for a region to be considered scrolled.
+ */
+#define GUAC_DISPLAY_SCROLL_MIN_LENGTH 64
+
+/**
+ * The number of consecutive frames that may be searched for scrolling without
+ * finding any before searching of that layer is backed off. Once backed off,
+ * the number of frames skipped between searches doubles with each further
+ * unsuccessful search, up to GUAC_DISPLAY_SCROLL_MAX_BACKOFF.
+ */
+#define GUAC_DISPLAY_SCROLL_MAX_MISSES 4
+
+/**
+ * The maximum number of frames that may be skipped between searches for
+ * scrolling within a layer that has not recently scrolled.
+ */
+#define GUAC_DISPLAY_SCROLL_MAX_BACKOFF 16
+
 /**
  * Minimum JPEG bitmap size (area). If the bitmap is smaller than this threshold,
  * it should be compressed as a PNG image to avoid the JPEG compression tax.
  */
 #define GUAC_DISPLAY_JPEG_MIN_BITMAP_SIZE 4096
 
+/**
+ * The longest interval between updates to a cell, in milliseconds, that will
+ * be tracked. Longer intervals are clamped to this value such that a region
+ * which resumes frequent updates after a long pause is promptly recognized as
+ * such.
+ */
+#define GUAC_DISPLAY_MAX_UPDATE_INTERVAL 1000
+
+/**
+ * The weight given to the most recent interval between updates when updating
+ * the smoothed update interval of a cell, as the exponent of a power of two.
+ * With a value of 2, each new interval contributes 1/4 of the result.
+ */
+#define GUAC_DISPLAY_UPDATE_INTERVAL_WEIGHT 2
+
+/**
+ * The number of fractional bits used to store the smoothed update interval of
+ * each cell, such that the average can converge on its target despite each
+ * new interval contributing only a fraction of the difference.
+ */
+#define GUAC_DISPLAY_UPDATE_INTERVAL_FRACTION_BITS 8
+
+/**
+ * The number of updates to a cell after which its contents are rescanned and
+ * reclassified. Cells that have never been classified are always scanned.
+ */
+#define GUAC_DISPLAY_RECLASSIFY_INTERVAL 8
+
+/**
+ * The amount by which the PNG optimality of the contents of an
+ * already-classified cell must favor the opposite classification before that
+ * cell is actually reclassified. This prevents regions that are borderline
+ * between classifications from alternating between lossless and lossy
+ * encoding from one frame to the next.
+ */
+#define GUAC_DISPLAY_CONTENT_HYSTERESIS 0x100
+
 /**
  * The JPEG compression min block size, as the exponent of a power of two. This
  * defines the optimal rectangle block size factor for JPEG compression.
@@ -141,10 +233,54 @@ typedef enum guac_display_plan_operation_type {
     /**
      * Draw arbitrary image data to the destination rect.
      */
-    GUAC_DISPLAY_PLAN_OPERATION_IMG
+    GUAC_DISPLAY_PLAN_OPERATION_IMG,
+
+    /**
+     * Encode and send the next frame of the video covering the destination
+     * rect. Like IMG operations, this is handled by the worker threads rather
+     * than during the initial, single-threaded flush step.
+     */
+    GUAC_DISPLAY_PLAN_OPERATION_VIDEO
 
 } guac_display_plan_operation_type;
 
+/**
+ * The nature of the image data within a region of a layer, as determined by
+ * periodically scanning the contents of each cell and tracking how often each
+ * cell is updated.
+ */
+typedef enum guac_display_content {
+
+    /**
+     * The contents of the region have not yet been classified.
+     */
+    GUAC_DISPLAY_CONTENT_UNKNOWN = 0,
+
+    /**
+     * The region contains large areas of repeated color, such as text or
+     * typical user interface elements, and will compress best with lossless
+     * compression like PNG.
+     */
+    GUAC_DISPLAY_CONTENT_TEXT,
+
+    /**
+     * The region contains photographic or otherwise complex image data that
+     * would compress better with lossy compression, but is not updated often
+     * enough for the loss of quality to be worthwhile.
+     */
+    GUAC_DISPLAY_CONTENT_PHOTO,
+
+    /**
+     * The region contains photographic or otherwise complex image data that
+     * is updated at least GUAC_DISPLAY_JPEG_FRAMERATE times per second, and
+     * should be sent using lossy compression where allowed. This
+     * classification is determined for each operation and is never stored
+     * within a guac_display_layer_cell.
+     */
+    GUAC_DISPLAY_CONTENT_VIDEO
+
+} guac_display_content;
+
 /**
  * A reference to a rectangular region of image data within a layer of the
  * remote Guacamole display.
@@ -205,6 +341,37 @@ typedef struct guac_display_plan_operation {
      */
     guac_timestamp current_frame;
 
+    /**
+     * The nature of the image data within the destination rect, as
+     * classified for the cells covered by this operation. If the operation
+     * covers cells of differing classifications, this is the classification
+     * of the cells covering the most modified pixels.
+     */
+    guac_display_content content;
+
+    /**
+     * The smoothed interval between updates to the region covered by this
+     * operation, in milliseconds. If the operation covers multiple cells, this
+     * is the interval of the most frequently updated cell.
+     */
+    int update_interval;
+
+    /**
+     * The hash of the full GUAC_DISPLAY_CELL_SIZE x GUAC_DISPLAY_CELL_SIZE
+     * cell containing this operation, as calculated when indexing the
+     * operation by PFR_guac_display_plan_index_dirty_cells(). This value is
+     * meaningful only if hash_valid is non-zero, and only prior to combining
+     * operations.
+     */
+    uint64_t hash;
+
+    /**
+     * Non-zero if the hash member of this operation has been calculated, zero
+     * otherwise. Operations within cells that are not wholly within the
+     * bounds of their layer are never hashed.
+     */
+    int hash_valid;
+
     union {
 
         /**
@@ -326,6 +493,62 @@ guac_display_plan* PFW_LFR_guac_display_plan_create(guac_display* display);
  */
 void guac_display_plan_free(guac_display_plan* plan);
 
+/**
+ * Walks through all operations currently in the given guac_display_plan,
+ * tracking the regions of each layer that contain continuously-updated
+ * content. Regions that have contained such content for at least
+ * GUAC_DISPLAY_VIDEO_MIN_FRAMES frames are streamed as video to connected
+ * users that support doing so, and draw operations that fall within those
+ * regions are removed from the plan. Videos that are no longer appropriate
+ * are ended, restoring the contents of the underlying layer.
+ *
+ * This function has no effect if libguac was built without support for
+ * video encoding.
+ *
+ * @param plan
+ *     The guac_display_plan to modify.
+ */
+void PFW_LFW_guac_display_plan_rewrite_as_video(guac_display_plan* plan);
+
+/**
+ * Searches the modified region of each layer within the given
+ * guac_display_plan for content that has been shifted vertically or
+ * horizontally by an arbitrary offset since the last frame, such as when a
+ * document is scrolled. The largest such region found within each layer is
+ * stored as a copy hint for that layer, to be verified and applied by
+ * PFW_LFR_guac_display_plan_rewrite_as_hinted(). Layers that have received
+ * copy hints for the pending frame are not searched unless at least one hint
+ * for that layer failed verification when the plan was last rewritten using
+ * hints. Layers whose recent searches have repeatedly found nothing are
+ * searched only occasionally (see GUAC_DISPLAY_SCROLL_MAX_MISSES).
+ *
+ * @param plan
+ *     The guac_display_plan whose layers should be searched.
+ *
+ * @return
+ *     Non-zero if at least one scroll was detected and stored as a hint, zero
+ *     otherwise.
+ */
+int PFW_LFR_guac_display_plan_detect_scrolls(guac_display_plan* plan);
+
+/**
+ * Walks through all operations currently in the given guac_display_plan,
+ * replacing draw operations with simple rects or copies wherever the changes
+ * drawn are wholly described by a hint provided via
+ * guac_display_layer_hint_fill() or guac_display_layer_hint_copy(). Each hint
+ * is verified against the image data of the layer before use, and draw
+ * operations covered only partially by a hint are left untouched. If newer
+ * hints do not accurately describe a draw operation, older hints containing
+ * the same region are tried in turn. Draw operations whose hints all fail
+ * verification are counted within pending_frame_hint_failures of their
+ * layer, and that layer is marked for the copy search performed by
+ * PFR_LFR_guac_display_plan_rewrite_as_copies().
+ *
+ * @param plan
+ *     The guac_display_plan to modify.
+ */
+void PFW_LFR_guac_display_plan_rewrite_as_hinted(guac_display_plan* plan);
+
 /**
  * Walks through all operations currently in the given guac_display_plan,
  * replacing draw operations with simple rects wherever draws consist only of a
@@ -359,6 +582,21 @@ void PFR_guac_display_plan_index_dirty_cells(guac_display_plan* plan);
  */
 void PFR_LFR_guac_display_plan_rewrite_as_copies(guac_display_plan* plan);
 
+/**
+ * Walks through all operations currently in the given guac_display_plan,
+ * replacing draw operations with copies from the display's client-side cache
+ * of recently-sent cells wherever the cell being drawn is already present in
+ * that cache. Cells that are drawn and not already cached are added to the
+ * cache if they have recently been drawn before, evicting the least-recently
+ * used cells as necessary. Only
+ * operations whose cells have been hashed by
+ * PFR_guac_display_plan_index_dirty_cells() are considered.
+ *
+ * @param plan
+ *     The guac_display_plan to modify.
+ */
+void PFR_LFW_guac_display_plan_rewrite_as_cached(guac_display_plan* plan);
+
 /**
  * Walks through all operations currently in the given guac_display_plan,
  * combining horizontally-adjacent operations wherever doing so appears to be
@@ -21,13 +21,16 @@
 #define GUAC_DISPLAY_PRIV_H
 
 #include "display-plan.h"
+#include "encode-video.h"
 #include "guacamole/client.h"
 #include "guacamole/display.h"
 #include "guacamole/fifo.h"
+#include "guacamole/metrics.h"
 #include "guacamole/rect.h"
 #include "guacamole/socket.h"
 
 #include <pthread.h>
+#include <stdint.h>
 
 /**
  * The maximum amount of time to wait after flushing a frame when compensating
@@ -140,16 +143,20 @@
     ((pixels + GUAC_DISPLAY_CELL_SIZE - 1) / GUAC_DISPLAY_CELL_SIZE)
 
 /**
- * The size of the operation FIFO read by the display worker threads. This
- * value is the number of operation slots in the FIFO, not bytes. The amount of
- * space currently specified here is roughly sufficient 8 worst-case frames
- * worth of outstanding operations.
+ * The initial size of the operation FIFO read by the display worker threads.
+ * This value is the number of operation slots in the FIFO, not bytes. The
+ * FIFO is automatically grown as needed to hold all operations of a frame,
+ * and thus only ever grows as large as the actual display requires.
  */
-#define GUAC_DISPLAY_WORKER_FIFO_SIZE (                                       \
-            GUAC_DISPLAY_MAX_WIDTH * GUAC_DISPLAY_MAX_HEIGHT                  \
-                / GUAC_DISPLAY_CELL_SIZE                                      \
-                / GUAC_DISPLAY_CELL_SIZE                                      \
-                * 8)
+#define GUAC_DISPLAY_WORKER_FIFO_INITIAL_SIZE 256
+
+/**
+ * The maximum number of operations that a display worker thread will remove
+ * from the operation FIFO at once. Larger batches reduce contention on the
+ * FIFO lock, while smaller batches distribute the work of a frame more evenly
+ * across worker threads.
+ */
+#define GUAC_DISPLAY_WORKER_BATCH_SIZE 4
 
 /**
  * Returns the memory address of the given rectangle within the mutable image
@@ -245,6 +252,102 @@
  */
 #define GUAC_DISPLAY_RENDER_THREAD_STATE_FRAME_READY 4
 
+/**
+ * Bitwise flag that is set on the state of a guac_display_render_thread when
+ * all frames explicitly marked with guac_display_render_thread_notify_frame()
+ * have been flushed.
+ */
+#define GUAC_DISPLAY_RENDER_THREAD_STATE_IDLE 8
+
+/**
+ * The number of render planning phases whose timings are tracked within
+ * guac_metrics.
+ */
+#define GUAC_DISPLAY_PLAN_PHASES GUAC_METRICS_PLAN_PHASES
+
+/**
+ * The image encodings that may be used by guac_display worker threads to send
+ * updated image data. Each value is identical to that of the corresponding
+ * guac_metrics_encoding.
+ */
+typedef enum guac_display_encoding {
+
+    /**
+     * Lossless PNG.
+     */
+    GUAC_DISPLAY_ENCODING_PNG = GUAC_METRICS_ENCODING_PNG,
+
+    /**
+     * Lossy JPEG.
+     */
+    GUAC_DISPLAY_ENCODING_JPEG = GUAC_METRICS_ENCODING_JPEG,
+
+    /**
+     * Lossy or lossless WebP.
+     */
+    GUAC_DISPLAY_ENCODING_WEBP = GUAC_METRICS_ENCODING_WEBP,
+
+    /**
+     * Lossy video (H.264 or VP8).
+     */
+    GUAC_DISPLAY_ENCODING_VIDEO = GUAC_METRICS_ENCODING_VIDEO,
+
+    /**
+     * The total number of image encodings. This is not an actual encoding.
+     */
+    GUAC_DISPLAY_ENCODINGS = GUAC_METRICS_ENCODINGS
+
+} guac_display_encoding;
+
+/**
+ * Returns the performance counters that should be updated for the given
+ * display. If the client of the display has its own guac_metrics (as assigned
+ * by guacd), those counters are used. Otherwise, counters private to the
+ * display are used, such that the same counters remain available for
+ * benchmarking.
+ *
+ * @param display
+ *     The guac_display whose performance counters should be returned.
+ *
+ * @return
+ *     The performance counters of the given display.
+ */
+guac_metrics* guac_display_metrics(guac_display* display);
+
+/**
+ * Returns the current time in microseconds, relative to an arbitrary point
+ * in time. The value returned is suitable only for measuring durations.
+ *
+ * @return
+ *     An arbitrary timestamp, in microseconds.
+ */
+uint64_t guac_display_usec_current(void);
+
+/**
+ * Guesses whether the given image data would be better compressed as PNG or
+ * using a lossy format like JPEG. Positive values indicate PNG is likely to be
+ * superior, while negative values indicate the opposite.
+ *
+ * @param buffer
+ *     The first pixel of the image data to check, stored as 32-bit ARGB.
+ *
+ * @param stride
+ *     The number of bytes in each row of the image data.
+ *
+ * @param width
+ *     The width of the image data, in pixels.
+ *
+ * @param height
+ *     The height of the image data, in pixels.
+ *
+ * @return
+ *     Positive values if PNG compression is likely to perform better than
+ *     lossy alternatives, or negative values if PNG is likely to perform
+ *     worse.
+ */
+int guac_display_png_optimality(const unsigned char* buffer, size_t stride,
+        int width, int height);
+
 /**
  * The state of the mouse cursor, as independently tracked by the render
  * thread. The mouse cursor state may be reported by
@@ -332,6 +435,36 @@ typedef struct guac_display_layer_cell {
      */
     guac_timestamp last_frame;
 
+    /**
+     * The exponentially-weighted moving average of the number of milliseconds
+     * between frames that modified this cell, clamped to
+     * GUAC_DISPLAY_MAX_UPDATE_INTERVAL, as a fixed-point value having
+     * GUAC_DISPLAY_UPDATE_INTERVAL_FRACTION_BITS fractional bits. This value
+     * is meaningful only if update_interval_measured is non-zero.
+     */
+    int update_interval;
+
+    /**
+     * Non-zero if at least one interval between frames that modified this
+     * cell has been measured, zero otherwise. The average stored within
+     * update_interval is seeded with the first such interval.
+     */
+    int update_interval_measured;
+
+    /**
+     * The classification of the image data within this cell as of the last
+     * time the cell was scanned. This will be GUAC_DISPLAY_CONTENT_UNKNOWN if
+     * the cell has never been scanned, and will otherwise be either
+     * GUAC_DISPLAY_CONTENT_TEXT or GUAC_DISPLAY_CONTENT_PHOTO.
+     */
+    guac_display_content content;
+
+    /**
+     * The number of frames that have modified this cell since its contents
+     * were last scanned and classified.
+     */
+    int updates_since_classified;
+
     /**
      * The region of this cell that has been modified since the last frame was
      * flushed. If the cell has not been modified at all, this will be an empty
@@ -493,6 +626,341 @@ typedef struct guac_display_layer_state {
 
 } guac_display_layer_state;
 
+/**
+ * The width and height of each tile that the contents of a layer are divided
+ * into when synchronizing joining users, and when caching encoded copies of
+ * the last frame for those users, in pixels. This is a multiple of both
+ * GUAC_DISPLAY_CELL_SIZE and the block sizes of JPEG and WebP.
+ */
+#define GUAC_DISPLAY_DUP_TILE_SIZE 256
+
+/**
+ * A cached PNG encoding of a single tile of the last frame of a layer, used to
+ * synchronize joining users without re-encoding unchanged regions.
+ */
+typedef struct guac_display_keyframe_tile {
+
+    /**
+     * The PNG-encoded contents of this tile, or NULL if no valid encoding is
+     * currently cached.
+     */
+    unsigned char* data;
+
+    /**
+     * The number of bytes within data.
+     */
+    size_t length;
+
+    /**
+     * The value of the keyframe_generation of the display at the time this
+     * tile was last invalidated (or created). A copy of this tile encoded
+     * from the last frame may only be stored here if this value has not
+     * changed since the copy was made.
+     */
+    uint64_t generation;
+
+} guac_display_keyframe_tile;
+
+/**
+ * The maximum number of hints that may be provided for each layer within a
+ * single pending frame. Any further hints are ignored.
+ */
+#define GUAC_DISPLAY_MAX_HINTS 64
+
+/**
+ * The type of change described by a guac_display_hint.
+ */
+typedef enum guac_display_hint_type {
+
+    /**
+     * The hinted region was filled with a single color.
+     */
+    GUAC_DISPLAY_HINT_FILL,
+
+    /**
+     * The hinted region was copied from elsewhere within the same layer.
+     */
+    GUAC_DISPLAY_HINT_COPY
+
+} guac_display_hint_type;
+
+/**
+ * A description of a change made to a layer within the pending frame, as
+ * provided by the code drawing to that layer. Hints allow the changes within
+ * a frame to be represented as simple rects or copies without searching the
+ * image data of the layer for such optimizations. Hints are verified before
+ * use and thus need not be accurate.
+ */
+typedef struct guac_display_hint {
+
+    /**
+     * The type of change described by this hint.
+     */
+    guac_display_hint_type type;
+
+    /**
+     * The region of the layer that was changed.
+     */
+    guac_rect dest;
+
+    /**
+     * The color that the region was filled with, in ARGB format. This value
+     * is meaningful only for hints of type GUAC_DISPLAY_HINT_FILL.
+     */
+    uint32_t color;
+
+    /**
+     * The X coordinate of the upper-left corner of the region of the layer
+     * that was copied, as of the last frame. This value is meaningful only for
+     * hints of type GUAC_DISPLAY_HINT_COPY.
+     */
+    int src_x;
+
+    /**
+     * The Y coordinate of the upper-left corner of the region of the layer
+     * that was copied, as of the last frame. This value is meaningful only for
+     * hints of type GUAC_DISPLAY_HINT_COPY.
+     */
+    int src_y;
+
+} guac_display_hint;
+
+/**
+ * A rectangular region of a layer that is currently being streamed to
+ * connected users as video, rather than as individual images. The video is
+ * played within a dedicated child layer that covers the region, such that the
+ * underlying layer need not be updated until the video ends.
+ */
+typedef struct guac_display_video {
+
+    /**
+     * The region of the parent layer covered by the video. The width and
+     * height of this region are always even.
+     */
+    guac_rect rect;
+
+    /**
+     * The child layer that plays the video.
+     */
+    guac_layer* layer;
+
+    /**
+     * The encoder producing the video, or NULL if libguac was built without
+     * support for video encoding.
+     */
+    guac_video_encoder* encoder;
+
+    /**
+     * The number of users connected at the time the video began. Users that
+     * join after the video begins will not have received its start, and the
+     * video must be restarted to include them.
+     */
+    int users;
+
+    /**
+     * The time that the contents of the region covered by the video last
+     * changed.
+     */
+    guac_timestamp last_update;
+
+    /**
+     * Non-zero if the contents of the region covered by the video changed in
+     * the last frame, and a new frame of video must be encoded, zero
+     * otherwise.
+     */
+    int modified;
+
+    /**
+     * Non-zero if encoding of the video has failed, and the video should be
+     * ended, zero otherwise.
+     */
+    int failed;
+
+} guac_display_video;
+
+/**
+ * The number of bytes of image data within each cell stored within the
+ * client-side cache of a guac_display. Each cached cell occupies this amount
+ * of memory both on the client and within guacd, where a copy is retained to
+ * verify matches.
+ */
+#define GUAC_DISPLAY_CACHE_ENTRY_SIZE \
+    (GUAC_DISPLAY_CELL_SIZE * GUAC_DISPLAY_CELL_SIZE * GUAC_DISPLAY_LAYER_RAW_BPP)
+
+/**
+ * A single cell of image data that has been sent to connected clients and is
+ * retained within a dedicated client-side off-screen buffer for later reuse.
+ */
+typedef struct guac_display_cache_entry guac_display_cache_entry;
+
+struct guac_display_cache_entry {
+
+    /**
+     * The hash of the cached image data, as calculated for the cell from which
+     * that data was cached.
+     */
+    uint64_t hash;
+
+    /**
+     * The client-side off-screen buffer containing the cached image data at
+     * its upper-left corner.
+     */
+    guac_layer* buffer;
+
+    /**
+     * A copy of the cached image data, used to verify that cells with the
+     * same hash truly contain the same data. The stride of this image data is
+     * exactly GUAC_DISPLAY_CELL_SIZE pixels.
+     */
+    unsigned char* data;
+
+    /**
+     * The layer that the cached image data must still be copied from to
+     * populate the client-side buffer, or NULL if the client-side buffer is
+     * already populated.
+     */
+    const guac_layer* source;
+
+    /**
+     * The X coordinate of the upper-left corner of the cell within the source
+     * layer that the cached image data must be copied from. This value is
+     * meaningful only if source is non-NULL.
+     */
+    int source_x;
+
+    /**
+     * The Y coordinate of the upper-left corner of the cell within the source
+     * layer that the cached image data must be copied from. This value is
+     * meaningful only if source is non-NULL.
+     */
+    int source_y;
+
+    /**
+     * The value of the frame member of the guac_display_cache at the time
+     * this entry was last used or added.
+     */
+    uint64_t frame;
+
+    /**
+     * The next most-recently used entry, or NULL if this is the
+     * least-recently used entry.
+     */
+    guac_display_cache_entry* next;
+
+    /**
+     * The next least-recently used entry, or NULL if this is the
+     * most-recently used entry.
+     */
+    guac_display_cache_entry* prev;
+
+    /**
+     * The next entry within the same hash bucket, or NULL if this is the last
+     * such entry.
+     */
+    guac_display_cache_entry* next_in_bucket;
+
+};
+
+/**
+ * Cache of recently-sent cells of image data, stored within client-side
+ * off-screen buffers such that recurring content can be drawn with simple
+ * copies rather than resending that content. Cells are admitted to the cache
+ * only once they have been drawn at least twice, and entries are evicted in
+ * least-recently used order once the cache is full.
+ *
+ * IMPORTANT: The display-level last_frame.lock MUST be acquired for writing
+ * before modifying or reading the members of this structure, with the
+ * exception of (1) the pending entries, which are written to the client-side
+ * buffers by the worker thread that completes each frame, (2) the reset flag,
+ * which may be set while holding last_frame.lock for reading only if the
+ * render_state flag is also locked, and (3) the requested_capacity, which is
+ * instead guarded by the display-level pending_frame.lock.
+ */
+typedef struct guac_display_cache {
+
+    /**
+     * The maximum number of entries that the cache may contain.
+     */
+    int capacity;
+
+    /**
+     * The capacity most recently requested via guac_display_set_cache_size().
+     * The cache is cleared and resized to match this value the next time a
+     * frame is flushed.
+     */
+    int requested_capacity;
+
+    /**
+     * Non-zero if the contents of the cache may not be present for all
+     * connected clients, such as after a user has joined the connection, and
+     * the cache must be cleared before it is next used.
+     */
+    int reset;
+
+    /**
+     * All entries of the cache, or NULL if no entries have yet been
+     * allocated. This array has exactly capacity entries.
+     */
+    guac_display_cache_entry* entries;
+
+    /**
+     * The number of entries within the entries array that are currently in
+     * use.
+     */
+    int length;
+
+    /**
+     * Hash table of all entries currently in use, indexed by hash. The number
+     * of buckets in this table is always a power of two.
+     */
+    guac_display_cache_entry** buckets;
+
+    /**
+     * One less than the number of buckets in the buckets table.
+     */
+    size_t bucket_mask;
+
+    /**
+     * The hashes of cells that have recently been drawn without being added
+     * to the cache, indexed by hash in the same manner as the buckets table
+     * (and having the same number of elements). A cell is added to the cache
+     * only if it is drawn again while its hash remains within this table,
+     * such that content that is drawn only once (scrolling text, animation,
+     * etc.) never incurs the cost of being copied into the cache.
+     */
+    uint64_t* admission;
+
+    /**
+     * The most-recently used entry, or NULL if the cache is empty.
+     */
+    guac_display_cache_entry* head;
+
+    /**
+     * The least-recently used entry, or NULL if the cache is empty.
+     */
+    guac_display_cache_entry* tail;
+
+    /**
+     * All entries added within the current frame whose client-side buffers
+     * have not yet been populated. This array has exactly capacity entries.
+     */
+    guac_display_cache_entry** pending;
+
+    /**
+     * The number of entries within the pending array.
+     */
+    int pending_count;
+
+    /**
+     * The number of frames that have used the cache thus far. Entries that
+     * have been used or added within the current frame are never evicted, as
+     * instructions referencing their client-side buffers may not yet have
+     * been sent.
+     */
+    uint64_t frame;
+
+} guac_display_cache;
+
 struct guac_display_layer {
 
     /**
@@ -549,6 +1017,70 @@ struct guac_display_layer {
      */
     guac_layer* last_frame_buffer;
 
+    /**
+     * Cached PNG encodings of each GUAC_DISPLAY_DUP_TILE_SIZE tile of this
+     * layer as of the last frame, in row-major order, or NULL if the last
+     * frame of this layer is empty. Tiles are invalidated as they change, and
+     * are encoded only when needed to synchronize joining users.
+     *
+     * IMPORTANT: The display-level last_frame.lock MUST be acquired for
+     * writing before resizing this array or invalidating its tiles. The tiles
+     * of this array may otherwise be read or stored while holding the
+     * last_frame.lock for reading, but only if the display-level
+     * keyframe_lock is also held.
+     */
+    guac_display_keyframe_tile* keyframe;
+
+    /**
+     * The width of the keyframe array, in tiles.
+     */
+    int keyframe_width;
+
+    /**
+     * The height of the keyframe array, in tiles.
+     */
+    int keyframe_height;
+
+    /**
+     * The cell-aligned region of this layer that has most recently contained
+     * continuously-updated (GUAC_DISPLAY_CONTENT_VIDEO) content, or an empty
+     * rect if no such region is currently being tracked.
+     *
+     * IMPORTANT: The display-level last_frame.lock MUST be acquired for
+     * writing before modifying or reading this member.
+     */
+    guac_rect video_candidate;
+
+    /**
+     * The number of consecutive frames that have updated continuously-updated
+     * content only within video_candidate.
+     *
+     * IMPORTANT: The display-level last_frame.lock MUST be acquired for
+     * writing before modifying or reading this member.
+     */
+    int video_candidate_frames;
+
+    /**
+     * The time that continuously-updated content was last seen within
+     * video_candidate.
+     *
+     * IMPORTANT: The display-level last_frame.lock MUST be acquired for
+     * writing before modifying or reading this member.
+     */
+    guac_timestamp video_candidate_updated;
+
+    /**
+     * The region of this layer currently being streamed as video, or NULL if
+     * no part of this layer is being streamed as video.
+     *
+     * IMPORTANT: The display-level last_frame.lock MUST be acquired before
+     * reading this member, and MUST be acquired for writing before modifying
+     * this member or the contents of the guac_display_video (with the
+     * exception of the modified and failed flags, which are updated by the
+     * worker thread that completes each frame).
+     */
+    guac_display_video* video;
+
     /* ---------------- LAYER PENDING FRAME STATE ---------------- */
 
     /**
@@ -609,6 +1141,53 @@ struct guac_display_layer {
      */
     size_t pending_frame_cells_height;
 
+    /**
+     * All hints provided for the pending frame of this layer, in the order
+     * they were provided.
+     *
+     * IMPORTANT: The display-level pending_frame.lock MUST be acquired before
+     * modifying or reading this member.
+     */
+    guac_display_hint pending_frame_hints[GUAC_DISPLAY_MAX_HINTS];
+
+    /**
+     * The number of hints currently stored within pending_frame_hints.
+     *
+     * IMPORTANT: The display-level pending_frame.lock MUST be acquired before
+     * modifying or reading this member.
+     */
+    int pending_frame_hint_count;
+
+    /**
+     * The number of draw operations within the current display plan that
+     * were wholly contained by at least one hint for the pending frame of
+     * this layer, but whose contents were not accurately described by any
+     * such hint.
+     *
+     * IMPORTANT: The display-level pending_frame.lock MUST be acquired before
+     * modifying or reading this member.
+     */
+    int pending_frame_hint_failures;
+
+    /**
+     * The number of consecutive searches for scrolling within this layer that
+     * have found nothing. This count stops increasing once searches have been
+     * backed off by GUAC_DISPLAY_SCROLL_MAX_BACKOFF frames.
+     *
+     * IMPORTANT: The display-level pending_frame.lock MUST be acquired before
+     * modifying or reading this member.
+     */
+    int scroll_misses;
+
+    /**
+     * The number of upcoming frames that should not be searched for scrolling
+     * within this layer, as this layer has not recently scrolled.
+     *
+     * IMPORTANT: The display-level pending_frame.lock MUST be acquired before
+     * modifying or reading this member.
+     */
+    int scroll_backoff;
+
     /**
      * The next layer within the list of layers that have been removed from
      * the pending frame and are awaiting destruction, or NULL if this is the
@@ -796,9 +1375,14 @@ struct guac_display {
     guac_fifo ops;
 
     /**
-     * Storage for any items within the ops fifo.
+     * Storage for any items within the ops fifo. This storage is replaced
+     * with larger storage by guac_display_plan_apply() if a frame requires
+     * more operations than the FIFO can currently hold.
+     *
+     * IMPORTANT: This member must only be accessed or modified while the ops
+     * FIFO is locked.
      */
-    guac_display_plan_operation ops_items[GUAC_DISPLAY_WORKER_FIFO_SIZE];
+    guac_display_plan_operation* ops_items;
 
     /**
      * The current number of active worker threads.
@@ -827,8 +1411,121 @@ struct guac_display {
      */
     guac_flag render_state;
 
+    /**
+     * Performance counters used if the client of this display does not have
+     * its own guac_metrics. These counters should not be accessed directly.
+     * Use guac_display_metrics() instead.
+     */
+    guac_metrics metrics;
+
+    /**
+     * The number of frames that have been committed to last_frame, used to
+     * determine whether tiles of the cached keyframes of each layer have
+     * been invalidated. This value may only be modified while holding the
+     * last_frame.lock for writing.
+     */
+    uint64_t keyframe_generation;
+
+    /**
+     * Lock which guards storage of newly-encoded tiles within the cached
+     * keyframes of each layer while last_frame.lock is held only for reading.
+     */
+    pthread_mutex_t keyframe_lock;
+
+    /**
+     * Cache of recently-sent cells of image data stored within client-side
+     * off-screen buffers.
+     */
+    guac_display_cache cache;
+
 };
 
+/**
+ * Invalidates any cached encodings of tiles of the given layer that have
+ * changed in the last frame, resizing the layer's cached keyframe to match
+ * the size of the last frame if necessary. This function must be invoked for
+ * every layer each time a frame is committed to last_frame, after the size
+ * and dirty rect of that frame have been updated. The display-level
+ * last_frame.lock MUST be held for writing.
+ *
+ * @param layer
+ *     The layer whose cached keyframe should be updated.
+ */
+void LFW_guac_display_layer_invalidate_keyframe(guac_display_layer* layer);
+
+/**
+ * Frees all cached encodings of tiles of the given layer, as well as the
+ * array containing those tiles.
+ *
+ * @param layer
+ *     The layer whose cached keyframe should be freed.
+ */
+void guac_display_layer_free_keyframe(guac_display_layer* layer);
+
+/**
+ * Encodes the contents of the last frame of the given layer as the next frame
+ * of the video covering part of that layer, if any, and if that region has
+ * changed. This function is invoked by a worker thread when processing the
+ * GUAC_DISPLAY_PLAN_OPERATION_VIDEO operation created for that layer, and thus
+ * does not block any other worker while the frame is encoded.
+ *
+ * @param layer
+ *     The layer whose video should be updated.
+ */
+void LFR_guac_display_layer_write_video(guac_display_layer* layer);
+
+/**
+ * Ends the video covering part of the given layer, if any, freeing the layer
+ * and encoder associated with that video. The underlying layer is NOT
+ * updated, and will still contain the contents that were present when the
+ * video began.
+ *
+ * @param layer
+ *     The layer whose video should be freed.
+ */
+void guac_display_layer_free_video(guac_display_layer* layer);
+
+/**
+ * Returns whether any part of the given rectangle of the given layer is
+ * covered by video. Regions covered by video are not kept up-to-date within
+ * the client-side copy of the last frame, and thus cannot be used as the
+ * source of a copy nor cached, and their continuous changes are not worth
+ * searching for scrolls.
+ *
+ * @param layer
+ *     The layer to test.
+ *
+ * @param rect
+ *     The rectangle to test, in the coordinate space of the given layer.
+ *
+ * @return
+ *     Non-zero if any part of the given rectangle is covered by video, zero
+ *     otherwise.
+ */
+int LFR_guac_display_layer_is_video_covered(guac_display_layer* layer,
+        const guac_rect* rect);
+
+/**
+ * Sends the instructions required to populate the client-side buffers of any
+ * cache entries added within the current frame. This function is invoked by
+ * the worker thread completing each frame, after all other graphical updates
+ * for that frame have been sent.
+ *
+ * @param display
+ *     The display whose cache should be updated.
+ */
+void LFR_guac_display_cache_write(guac_display* display);
+
+/**
+ * Frees all entries of the cache of the given display, including the
+ * associated client-side buffers. No instructions are sent to connected
+ * clients.
+ *
+ * @param display
+ *     The display whose cache should be freed.
+ */
+void guac_display_cache_free(guac_display* display);
+
 /**
  * Allocates and inserts a new element into the given linked list of display
  * layers, associating it with the given layer and surface.
@@ -178,6 +178,13 @@ static void* guac_display_render_loop(void* data) {
 
         guac_display_end_multiple_frames(display, rendered_frames);
 
+        /* Signal that all explicitly marked frames have been flushed, unless
+         * another has since been marked */
+        guac_flag_lock(&render_thread->state);
+        if (!(render_thread->state.value & GUAC_DISPLAY_RENDER_THREAD_STATE_FRAME_READY))
+            guac_flag_set(&render_thread->state, GUAC_DISPLAY_RENDER_THREAD_STATE_IDLE);
+        guac_flag_unlock(&render_thread->state);
+
     }
 
     return NULL;
@@ -193,6 +200,9 @@ guac_display_render_thread* guac_display_render_thread_create(guac_display* disp
     render_thread->frames = 0;
     render_thread->cursor_state = (guac_display_render_thread_cursor_state) { 0 };
 
+    /* No frames have yet been marked, and thus none are awaiting flush */
+    guac_flag_set(&render_thread->state, GUAC_DISPLAY_RENDER_THREAD_STATE_IDLE);
+
     /* Start render thread (this will immediately begin blocking until frame
      * modification or readiness is signalled) */
     pthread_create(&render_thread->thread, NULL, guac_display_render_loop, render_thread);
@@ -207,10 +217,23 @@ void guac_display_render_thread_notify_modified(guac_display_render_thread* rend
 
 void guac_display_render_thread_notify_frame(guac_display_render_thread* render_thread) {
     guac_flag_set_and_lock(&render_thread->state, GUAC_DISPLAY_RENDER_THREAD_STATE_FRAME_READY);
+    guac_flag_clear(&render_thread->state, GUAC_DISPLAY_RENDER_THREAD_STATE_IDLE);
     render_thread->frames++;
     guac_flag_unlock(&render_thread->state);
 }
 
+int guac_display_render_thread_wait_for_idle(guac_display_render_thread* render_thread,
+        int msec_timeout) {
+
+    if (!guac_flag_timedwait_and_lock(&render_thread->state,
+                GUAC_DISPLAY_RENDER_THREAD_STATE_IDLE, msec_timeout))
+        return 0;
+
+    guac_flag_unlock(&render_thread->state);
+    return 1;
+
+}
+
 void guac_display_render_thread_notify_user_moved_mouse(guac_display_render_thread* render_thread,
         guac_user* user, int x, int y, int mask) {
 
@@ -17,12 +17,16 @@
  * under the License.
  */
 
+#include "client-priv.h"
 #include "display-plan.h"
 #include "display-priv.h"
+#include "encode-jpeg.h"
+#include "encode-png.h"
 #include "guacamole/client.h"
 #include "guacamole/display.h"
 #include "guacamole/fifo.h"
 #include "guacamole/layer.h"
+#include "guacamole/metrics.h"
 #include "guacamole/proctitle.h"
 #include "guacamole/protocol-types.h"
 #include "guacamole/protocol.h"
@@ -31,11 +35,40 @@
 #include "guacamole/socket.h"
 #include "guacamole/timestamp.h"
 
+#ifdef ENABLE_WEBP
+#include "encode-webp.h"
+#endif
+
 #include <inttypes.h>
-#include <limits.h>
 #include <cairo/cairo.h>
 #include <pthread.h>
 
+/**
+ * The image encoders owned by a single worker thread. Each worker reuses its
+ * own encoders for every image it encodes, avoiding the cost of recreating
+ * encoder state and scratch buffers for each (typically small) image.
+ */
+typedef struct guac_display_worker_encoders {
+
+    /**
+     * The encoder used for all PNG images.
+     */
+    guac_png_encoder* png;
+
+    /**
+     * The encoder used for all JPEG images.
+     */
+    guac_jpeg_encoder* jpeg;
+
+#ifdef ENABLE_WEBP
+    /**
+     * The encoder used for all WebP images.
+     */
+    guac_webp_encoder* webp;
+#endif
+
+} guac_display_worker_encoders;
+
 /**
  * Returns a new Cairo surface representing the contents of the given dirty
  * rectangle from the given layer. The returned surface must eventually be
@@ -152,143 +185,180 @@ static int guac_display_suggest_quality(guac_client* client) {
 }
 
 /**
- * Guesses whether a rectangle within a particular layer would be better
- * compressed as PNG or using a lossy format like JPEG. Positive values
- * indicate PNG is likely to be superior, while negative values indicate the
- * opposite.
- *
- * @param layer
- *     The layer containing the image data to check.
- *
- * @param rect
- *     The rect to check within the given layer.
- *
- * @return
- *     Positive values if PNG compression is likely to perform better than
- *     lossy alternatives, or negative values if PNG is likely to perform
- *     worse.
- */
-static int LFR_guac_display_layer_png_optimality(guac_display_layer* layer,
-        const guac_rect* rect) {
-
-    int x, y;
-
-    int num_same = 0;
-    int num_different = 1;
-
-    /* Get buffer from layer */
-    size_t stride = layer->last_frame.buffer_stride;
-    const unsigned char* buffer = GUAC_DISPLAY_LAYER_STATE_CONST_BUFFER(layer->last_frame, *rect);
-
-    /* Image must be at least 1x1 */
-    if (rect->right - rect->left < 1 || rect->bottom - rect->top< 1)
-        return 0;
-
-    /* For each row */
-    for (y = rect->top; y < rect->bottom; y++) {
-
-        uint32_t* row = (uint32_t*) buffer;
-        uint32_t last_pixel = *(row++) | 0xFF000000;
-
-        /* For each pixel in current row */
-        for (x = rect->left + 1; x < rect->right; x++) {
-
-            /* Get next pixel */
-            uint32_t current_pixel = *(row++) | 0xFF000000;
-
-            /* Update same/different counts according to pixel value */
-            if (current_pixel == last_pixel)
-                num_same++;
-            else
-                num_different++;
-
-            last_pixel = current_pixel;
-
-        }
-
-        /* Advance to next row */
-        buffer += stride;
-
-    }
-
-    /* Return rough approximation of optimality for PNG compression. As PNG
-     * leverages lossless DEFLATE compression (which works by reducing the
-     * number of bytes required to represent repeated data), an approximation
-     * of the amount of repeated image data within the image is a reasonable
-     * approximation for how well an image will compress. */
-    return 0x100 * num_same / num_different - 0x400;
-
-}
-
-/**
- * Returns whether the given rectangle would be optimally encoded as JPEG
- * rather than PNG.
+ * Returns whether the image data modified by the given operation would be
+ * optimally encoded as JPEG rather than PNG.
  *
  * @param layer
  *     The layer to be queried.
  *
- * @param rect
- *     The rectangle to check.
- *
- * @param framerate
- *     The rate that the region covered by the given rectangle has historically
- *     been being updated within the given layer, in frames per second.
+ * @param op
+ *     The operation to check.
  *
  * @return
- *     Non-zero if the rectangle would be optimally encoded as JPEG, zero
+ *     Non-zero if the image data would be optimally encoded as JPEG, zero
  *     otherwise.
  */
 static int LFR_guac_display_layer_should_use_jpeg(guac_display_layer* layer,
-        const guac_rect* rect, int framerate) {
+        const guac_display_plan_operation* op) {
 
     /* Do not use JPEG if lossless quality is required */
     if (layer->last_frame.lossless)
         return 0;
 
+    const guac_rect* rect = &op->dest;
     int rect_width = rect->right - rect->left;
     int rect_height = rect->bottom - rect->top;
     int rect_size = rect_width * rect_height;
 
     /* JPEG is preferred if:
-     * - frame rate is high enough
-     * - image size is large enough
-     * - PNG is not more optimal based on image contents */
-    return framerate >= GUAC_DISPLAY_JPEG_FRAMERATE
-        && rect_size > GUAC_DISPLAY_JPEG_MIN_BITMAP_SIZE
-        && LFR_guac_display_layer_png_optimality(layer, rect) < 0;
+     * - the modified region has been classified as video (complex content
+     *   that is updated frequently)
+     * - image size is large enough */
+    return op->content == GUAC_DISPLAY_CONTENT_VIDEO
+        && rect_size > GUAC_DISPLAY_JPEG_MIN_BITMAP_SIZE;
 
 }
 
 /**
- * Returns whether the given rectangle would be optimally encoded as WebP
- * rather than PNG.
+ * Returns whether the image data modified by the given operation would be
+ * optimally encoded as WebP rather than PNG.
  *
  * @param layer
  *     The layer to be queried.
  *
- * @param rect
- *     The rectangle to check.
- *
- * @param framerate
- *     The rate that the region covered by the given rectangle has historically
- *     been being updated within the given layer, in frames per second.
+ * @param op
+ *     The operation to check.
  *
  * @return
- *     Non-zero if the rectangle would be optimally encoded as WebP, zero
+ *     Non-zero if the image data would be optimally encoded as WebP, zero
  *     otherwise.
  */
 static int LFR_guac_display_layer_should_use_webp(guac_display_layer* layer,
-        const guac_rect* rect, int framerate) {
+        const guac_display_plan_operation* op) {
 
     /* Do not use WebP if not supported */
     if (!guac_client_supports_webp(layer->display->client))
         return 0;
 
-    /* WebP is preferred if:
-     * - frame rate is high enough
-     * - PNG is not more optimal based on image contents */
-    return framerate >= GUAC_DISPLAY_JPEG_FRAMERATE
-        && LFR_guac_display_layer_png_optimality(layer, rect) < 0;
+    /* WebP is preferred if the modified region has been classified as video
+     * (complex content that is updated frequently) */
+    return op->content == GUAC_DISPLAY_CONTENT_VIDEO;
+
+}
+
+/**
+ * Performs the given graphical operation, sending the corresponding
+ * instructions to all connected clients. The last_frame lock of the display
+ * MUST already be held for reading.
+ *
+ * @param display
+ *     The display that the operation applies to.
+ *
+ * @param encoders
+ *     The encoders of the worker thread performing the operation.
+ *
+ * @param op
+ *     The operation to perform.
+ */
+static void guac_display_worker_process_operation(guac_display* display,
+        guac_display_worker_encoders* encoders, guac_display_plan_operation* op) {
+
+    guac_client* client = display->client;
+    guac_socket* socket = client->socket;
+
+    guac_display_layer* display_layer = op->layer;
+    switch (op->type) {
+
+        case GUAC_DISPLAY_PLAN_OPERATION_IMG:
+
+            guac_rect* dirty = &op->dest;
+
+            /* TODO: Additionally take estimated encoding times into
+             * account when choosing between PNG/WebP/JPEG, dividing the
+             * time allowed per update proportionately based on the
+             * dirty_size of the update. The nature of the content and how
+             * often it is updated are already tracked per cell by the
+             * display plan (see guac_display_content). */
+
+            /* TODO: Stream PNG/WebP/JPEG using progressive encoding such
+             * that a frame that is currently being encoded can be
+             * preempted by the next frame, with the connected client then
+             * simply receiving a lower-quality intermediate frame. If
+             * necessary, progressive encoding can be achieved by manually
+             * dividing images into multiple reduced-resolution stages,
+             * such that each image streamed is actually only one quarter
+             * the size of the original image. Compositing via Guacamole
+             * protocol instructions can reassemble those stages. */
+
+            cairo_surface_t* rect = LFR_guac_display_layer_cairo_rect(display_layer, dirty);
+            const guac_layer* layer = display_layer->layer;
+
+            /* Clear relevant rect of destination layer if necessary to
+             * ensure fresh data is not drawn on top of old data for layers
+             * with alpha transparency */
+            guac_display_layer_clear_non_opaque(display_layer, dirty);
+
+            guac_display_encoding encoding;
+            uint64_t encode_start = guac_display_usec_current();
+
+            /* Prefer WebP when reasonable */
+            if (LFR_guac_display_layer_should_use_webp(display_layer, op)) {
+                encoding = GUAC_DISPLAY_ENCODING_WEBP;
+#ifdef ENABLE_WEBP
+                guac_client_stream_webp_with_encoder(client, encoders->webp,
+                        socket, GUAC_COMP_OVER, layer, dirty->left, dirty->top,
+                        rect, guac_display_suggest_quality(client),
+                        display_layer->last_frame.lossless ? 1 : 0);
+#endif
+            }
+
+            /* If not WebP, JPEG is the next best (lossy) choice */
+            else if (display_layer->opaque && LFR_guac_display_layer_should_use_jpeg(display_layer, op)) {
+                encoding = GUAC_DISPLAY_ENCODING_JPEG;
+                guac_client_stream_jpeg_with_encoder(client, encoders->jpeg,
+                        socket, GUAC_COMP_OVER, layer, dirty->left, dirty->top,
+                        rect, guac_display_suggest_quality(client));
+            }
+
+            /* Use PNG if no lossy formats are appropriate */
+            else {
+                encoding = GUAC_DISPLAY_ENCODING_PNG;
+                guac_client_stream_png_with_encoder(client, encoders->png,
+                        socket, GUAC_COMP_OVER, layer, dirty->left, dirty->top,
+                        rect);
+            }
+
+            uint64_t encode_usec = guac_display_usec_current() - encode_start;
+
+            /* Track encoding time */
+            guac_metrics* metrics = guac_display_metrics(display);
+            guac_metrics_add(&metrics->encode_usec[encoding], encode_usec);
+            guac_metrics_add(&metrics->encode_count[encoding], 1);
+            guac_metrics_add(&metrics->encode_pixels[encoding],
+                    guac_rect_width(dirty) * guac_rect_height(dirty));
+
+            cairo_surface_destroy(rect);
+            break;
+
+        case GUAC_DISPLAY_PLAN_OPERATION_VIDEO:
+            LFR_guac_display_layer_write_video(display_layer);
+            break;
+
+        case GUAC_DISPLAY_PLAN_OPERATION_COPY:
+        case GUAC_DISPLAY_PLAN_OPERATION_RECT:
+            guac_client_log(client, GUAC_LOG_DEBUG, "Operation type %i "
+                    "should NOT be present in the set of operations given "
+                    "to guac_display worker thread. All operations except "
+                    "IMG, VIDEO, and NOP are handled during the initial, "
+                    "single-threaded flush step. This is likely a bug.",
+                    op->type);
+            break;
+
+        case GUAC_DISPLAY_PLAN_OPERATION_NOP:
+            /* Do nothing */
+            break;
+
+    }
 
 }
 
@@ -298,15 +368,27 @@ void* guac_display_worker_thread(void* data) {
      * sends graphical updates for dirty layer regions. */
     guac_thread_name_set("display-wrk");
 
-    int framerate;
     int has_outstanding_frames = 0;
 
     guac_display* display = (guac_display*) data;
     guac_client* client = display->client;
-    guac_socket* socket = client->socket;
 
-    guac_display_plan_operation op;
-    while (guac_fifo_dequeue_and_lock(&display->ops, &op)) {
+    /* Pull several operations at once to reduce contention on the FIFO */
+    guac_display_plan_operation ops[GUAC_DISPLAY_WORKER_BATCH_SIZE];
+    size_t op_count;
+
+    /* Each worker encodes images using its own encoders, reused for the
+     * lifetime of the worker */
+    guac_display_worker_encoders encoders = {
+        .png = guac_png_encoder_alloc(),
+        .jpeg = guac_jpeg_encoder_alloc(),
+#ifdef ENABLE_WEBP
+        .webp = guac_webp_encoder_alloc()
+#endif
+    };
+
+    while ((op_count = guac_fifo_dequeue_multiple_and_lock(&display->ops,
+                    ops, GUAC_DISPLAY_WORKER_BATCH_SIZE)) > 0) {
 
         /* Notify any watchers of render_state that a frame is now in progress */
         guac_flag_set_and_lock(&display->render_state, GUAC_DISPLAY_RENDER_STATE_FRAME_IN_PROGRESS);
@@ -320,78 +402,8 @@ void* guac_display_worker_thread(void* data) {
         guac_fifo_unlock(&display->ops);
 
         guac_rwlock_acquire_read_lock(&display->last_frame.lock);
-        guac_display_layer* display_layer = op.layer;
-        switch (op.type) {
-
-            case GUAC_DISPLAY_PLAN_OPERATION_IMG:
-
-                framerate = INT_MAX;
-                if (op.current_frame > op.last_frame)
-                    framerate = 1000 / (op.current_frame - op.last_frame);
-
-                guac_rect* dirty = &op.dest;
-
-                /* TODO: Determine whether to use PNG/WebP/JPEG purely
-                 * based on whether lossless encoding is required, the
-                 * expected time until another frame is received (time
-                 * since last frame), and estimated encoding times. The
-                 * time allowed per update should be divided up
-                 * proportionately based on the dirty_size of the update. */
-
-                /* TODO: Stream PNG/WebP/JPEG using progressive encoding such
-                 * that a frame that is currently being encoded can be
-                 * preempted by the next frame, with the connected client then
-                 * simply receiving a lower-quality intermediate frame. If
-                 * necessary, progressive encoding can be achieved by manually
-                 * dividing images into multiple reduced-resolution stages,
-                 * such that each image streamed is actually only one quarter
-                 * the size of the original image. Compositing via Guacamole
-                 * protocol instructions can reassemble those stages. */
-
-                cairo_surface_t* rect = LFR_guac_display_layer_cairo_rect(display_layer, dirty);
-                const guac_layer* layer = display_layer->layer;
-
-                /* Clear relevant rect of destination layer if necessary to
-                 * ensure fresh data is not drawn on top of old data for layers
-                 * with alpha transparency */
-                guac_display_layer_clear_non_opaque(display_layer, dirty);
-
-                /* Prefer WebP when reasonable */
-                if (LFR_guac_display_layer_should_use_webp(display_layer, dirty, framerate))
-                    guac_client_stream_webp(client, socket, GUAC_COMP_OVER, layer,
-                            dirty->left, dirty->top, rect,
-                            guac_display_suggest_quality(client),
-                            display_layer->last_frame.lossless ? 1 : 0);
-
-                /* If not WebP, JPEG is the next best (lossy) choice */
-                else if (display_layer->opaque && LFR_guac_display_layer_should_use_jpeg(display_layer, dirty, framerate))
-                    guac_client_stream_jpeg(client, socket, GUAC_COMP_OVER, layer,
-                            dirty->left, dirty->top, rect,
-                            guac_display_suggest_quality(client));
-
-                /* Use PNG if no lossy formats are appropriate */
-                else
-                    guac_client_stream_png(client, socket, GUAC_COMP_OVER,
-                            layer, dirty->left, dirty->top, rect);
-
-                cairo_surface_destroy(rect);
-                break;
-
-            case GUAC_DISPLAY_PLAN_OPERATION_COPY:
-            case GUAC_DISPLAY_PLAN_OPERATION_RECT:
-                guac_client_log(client, GUAC_LOG_DEBUG, "Operation type %i "
-                        "should NOT be present in the set of operations given "
-                        "to guac_display worker thread. All operations except "
-                        "IMG and NOP are handled during the initial, "
-                        "single-threaded flush step. This is likely a bug.",
-                        op.type);
-                break;
-
-            case GUAC_DISPLAY_PLAN_OPERATION_NOP:
-                /* Do nothing */
-                break;
-
-        }
+        for (size_t i = 0; i < op_count; i++)
+            guac_display_worker_process_operation(display, &encoders, &ops[i]);
 
         guac_fifo_lock(&display->ops);
 
@@ -448,6 +460,10 @@ void* guac_display_worker_thread(void* data) {
 
             }
 
+            /* Populate the client-side buffers of any cells newly added to
+             * the cache, now that those cells have been fully drawn */
+            LFR_guac_display_cache_write(display);
+
             /* This is now absolutely everything for the current frame,
              * and it's safe to flush any outstanding data */
             guac_socket_flush(client->socket);
@@ -475,6 +491,12 @@ void* guac_display_worker_thread(void* data) {
 
     }
 
+    guac_png_encoder_free(encoders.png);
+    guac_jpeg_encoder_free(encoders.jpeg);
+#ifdef ENABLE_WEBP
+    guac_webp_encoder_free(encoders.webp);
+#endif
+
     return NULL;
 
 }
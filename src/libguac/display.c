@@ -24,6 +24,7 @@
 #include "guacamole/fifo.h"
 #include "guacamole/layer.h"
 #include "guacamole/mem.h"
+#include "guacamole/metrics.h"
 #include "guacamole/protocol.h"
 #include "guacamole/rect.h"
 #include "guacamole/rwlock.h"
@@ -36,10 +37,17 @@
 #endif
 
 #include <cairo/cairo.h>
+#include <limits.h>
 #include <pthread.h>
 #include <sched.h>
+#include <stdint.h>
+#include <sys/time.h>
 #include <unistd.h>
 
+#ifdef HAVE_CLOCK_GETTIME
+#include <time.h>
+#endif
+
 /**
  * The number of worker threads to create per processor.
  */
@@ -110,6 +118,41 @@ static unsigned long guac_display_nproc(void) {
 
 }
 
+guac_metrics* guac_display_metrics(guac_display* display) {
+
+    guac_metrics* metrics = display->client->metrics;
+    if (metrics != NULL)
+        return metrics;
+
+    return &display->metrics;
+
+}
+
+uint64_t guac_display_usec_current(void) {
+
+#ifdef HAVE_CLOCK_GETTIME
+
+    struct timespec current;
+
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &current);
+#else
+    clock_gettime(CLOCK_REALTIME, &current);
+#endif
+
+    return (uint64_t) current.tv_sec * 1000000 + current.tv_nsec / 1000;
+
+#else
+
+    struct timeval current;
+    gettimeofday(&current, NULL);
+
+    return (uint64_t) current.tv_sec * 1000000 + current.tv_usec;
+
+#endif
+
+}
+
 guac_display* guac_display_alloc(guac_client* client) {
 
     /* Allocate and init core properties (really just the client pointer) */
@@ -128,14 +171,22 @@ guac_display* guac_display_alloc(guac_client* client) {
     display->cursor_buffer = guac_display_alloc_buffer(display, 0);
 
     /* Init operation FIFO used by worker threads */
+    display->ops_items = guac_mem_alloc(GUAC_DISPLAY_WORKER_FIFO_INITIAL_SIZE,
+            sizeof(guac_display_plan_operation));
     guac_fifo_init(&display->ops, display->ops_items,
-            GUAC_DISPLAY_WORKER_FIFO_SIZE, sizeof(guac_display_plan_operation));
+            GUAC_DISPLAY_WORKER_FIFO_INITIAL_SIZE, sizeof(guac_display_plan_operation));
 
     /* Init flag used to notify threads that need to monitor whether a frame is
      * currently being rendered */
     guac_flag_init(&display->render_state);
     guac_flag_set(&display->render_state, GUAC_DISPLAY_RENDER_STATE_FRAME_NOT_IN_PROGRESS);
 
+    pthread_mutex_init(&display->keyframe_lock, NULL);
+    guac_metrics_init(&display->metrics);
+
+    /* The client-side cache is allocated as needed when frames are flushed */
+    display->cache.requested_capacity = GUAC_DISPLAY_DEFAULT_CACHE_SIZE / GUAC_DISPLAY_CACHE_ENTRY_SIZE;
+
     int cpu_count = guac_display_nproc();
     if (cpu_count <= 0) {
         guac_client_log(client, GUAC_LOG_WARNING, "Number of available "
@@ -216,7 +267,10 @@ void guac_display_free(guac_display* display) {
 
     /* All locks, FIFOs, etc. are now unused and can be safely destroyed */
     guac_flag_destroy(&display->render_state);
+    pthread_mutex_destroy(&display->keyframe_lock);
+    guac_display_cache_free(display);
     guac_fifo_destroy(&display->ops);
+    guac_mem_free(display->ops_items);
 
     /* Remove any layers remaining in the pending frame (by definition, all other
      * layers must already have been marked for removal) */
@@ -235,111 +289,6 @@ void guac_display_free(guac_display* display) {
 
 }
 
-void guac_display_dup(guac_display* display, guac_socket* socket) {
-
-    guac_client* client = display->client;
-    guac_rwlock_acquire_read_lock(&display->last_frame.lock);
-
-    /* Wait for any pending frame to finish being sent to established users of
-     * the connection before syncing any new users (doing otherwise could
-     * result in trailing instructions of that pending frame getting sent to
-     * new users after they finish joining, even though they are already in
-     * sync with that frame, and those trailing instructions may not have the
-     * intended meaning in context of the new users' remote displays) */
-    guac_flag_wait_and_lock(&display->render_state,
-            GUAC_DISPLAY_RENDER_STATE_FRAME_NOT_IN_PROGRESS);
-
-    /* Sync the state of all layers/buffers */
-    guac_display_layer* current = display->last_frame.layers;
-    while (current != NULL) {
-
-        const guac_layer* layer = current->layer;
-
-        /* Determine layer bounds from last frame, NOT pending frame as
-         * provided by guac_display_layer_get_bounds() */
-        guac_rect layer_bounds = {
-            .left   = 0,
-            .top    = 0,
-            .right  = current->last_frame.width,
-            .bottom = current->last_frame.height
-        };
-
-        int width = guac_rect_width(&layer_bounds);
-        int height = guac_rect_height(&layer_bounds);
-        guac_protocol_send_size(socket, layer, width, height);
-
-        if (width > 0 && height > 0) {
-
-            /* Get Cairo surface covering layer bounds */
-            unsigned char* buffer = GUAC_DISPLAY_LAYER_STATE_MUTABLE_BUFFER(current->last_frame, layer_bounds);
-            cairo_surface_t* rect = cairo_image_surface_create_for_data(buffer,
-                        current->opaque ? CAIRO_FORMAT_RGB24 : CAIRO_FORMAT_ARGB32,
-                        width, height, current->last_frame.buffer_stride);
-
-            /* Send PNG for rect */
-            guac_client_stream_png(client, socket, GUAC_COMP_OVER, layer, 0, 0, rect);
-
-            /* Resync copy of previous frame */
-            guac_protocol_send_copy(socket,
-                    layer, 0, 0, width, height,
-                    GUAC_COMP_OVER, current->last_frame_buffer, 0, 0);
-
-            cairo_surface_destroy(rect);
-
-        }
-
-        /* Resync any properties that are specific to non-buffer layers */
-        if (current->layer->index > 0) {
-
-            /* Resync layer opacity */
-            guac_protocol_send_shade(socket, current->layer,
-                    current->last_frame.opacity);
-
-            /* Resync layer position/hierarchy */
-            guac_protocol_send_move(socket, current->layer,
-                    current->last_frame.parent,
-                    current->last_frame.x,
-                    current->last_frame.y,
-                    current->last_frame.z);
-
-        }
-
-        /* Resync multitouch support */
-        if (current->layer->index >= 0) {
-            guac_protocol_send_set_int(socket, current->layer,
-                    GUAC_PROTOCOL_LAYER_PARAMETER_MULTI_TOUCH,
-                    current->last_frame.touches);
-        }
-
-        current = current->last_frame.next;
-
-    }
-
-    /* Avoid sending a zero-size cursor instruction if no cursor has been set */
-    guac_display_layer* cursor = display->cursor_buffer;
-    if (cursor->last_frame.width > 0 && cursor->last_frame.height > 0)
-        guac_protocol_send_cursor(socket,
-                display->last_frame.cursor_hotspot_x,
-                display->last_frame.cursor_hotspot_y,
-                cursor->layer, 0, 0,
-                cursor->last_frame.width,
-                cursor->last_frame.height);
-
-    /* Synchronize mouse location */
-    guac_protocol_send_mouse(socket, display->last_frame.cursor_x, display->last_frame.cursor_y,
-            display->last_frame.cursor_mask, client->last_sent_timestamp);
-
-    /* The initial frame synchronizing the newly-joined users is now complete */
-    guac_protocol_send_sync(socket, client->last_sent_timestamp, display->last_frame.frames);
-
-    /* Further rendering for the current connection can now safely continue */
-    guac_flag_unlock(&display->render_state);
-    guac_rwlock_release_lock(&display->last_frame.lock);
-
-    guac_socket_flush(socket);
-
-}
-
 void guac_display_notify_user_left(guac_display* display, guac_user* user) {
     guac_rwlock_acquire_write_lock(&display->pending_frame.lock);
 
@@ -363,6 +312,18 @@ void guac_display_notify_user_moved_mouse(guac_display* display, guac_user* user
 
 }
 
+void guac_display_set_cache_size(guac_display* display, size_t size) {
+
+    size_t capacity = size / GUAC_DISPLAY_CACHE_ENTRY_SIZE;
+    if (capacity > INT_MAX)
+        capacity = INT_MAX;
+
+    guac_rwlock_acquire_write_lock(&display->pending_frame.lock);
+    display->cache.requested_capacity = capacity;
+    guac_rwlock_release_lock(&display->pending_frame.lock);
+
+}
+
 guac_display_layer* guac_display_default_layer(guac_display* display) {
     return display->default_layer;
 }
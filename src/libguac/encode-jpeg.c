@@ -62,6 +62,34 @@ typedef struct guac_jpeg_destination_mgr {
 
 } guac_jpeg_destination_mgr;
 
+struct guac_jpeg_encoder {
+
+    /**
+     * The libjpeg compression structure, created once and reused for each
+     * image.
+     */
+    struct jpeg_compress_struct cinfo;
+
+    /**
+     * The libjpeg error handler associated with cinfo.
+     */
+    struct jpeg_error_mgr jerr;
+
+#ifndef JCS_EXTENSIONS
+    /**
+     * Buffer receiving each scanline of the image currently being encoded,
+     * converted from BGRx to RGB.
+     */
+    unsigned char* scanline;
+
+    /**
+     * The number of bytes allocated for the scanline buffer.
+     */
+    size_t scanline_size;
+#endif
+
+};
+
 /**
  * Initializes the destination structure of the given compression structure.
  *
@@ -163,8 +191,31 @@ static void jpeg_guac_dest(j_compress_ptr cinfo, guac_socket* socket,
 
 }
 
-int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface, int quality) {
+guac_jpeg_encoder* guac_jpeg_encoder_alloc(void) {
+
+    guac_jpeg_encoder* encoder = guac_mem_zalloc(sizeof(guac_jpeg_encoder));
+
+    encoder->cinfo.err = jpeg_std_error(&encoder->jerr);
+    jpeg_create_compress(&encoder->cinfo);
+
+    return encoder;
+
+}
+
+void guac_jpeg_encoder_free(guac_jpeg_encoder* encoder) {
+
+    jpeg_destroy_compress(&encoder->cinfo);
+
+#ifndef JCS_EXTENSIONS
+    guac_mem_free(encoder->scanline);
+#endif
+
+    guac_mem_free(encoder);
+
+}
+
+int guac_jpeg_encoder_write(guac_jpeg_encoder* encoder, guac_socket* socket,
+        guac_stream* stream, cairo_surface_t* surface, int quality) {
 
     /* Get image surface properties and data */
     cairo_format_t format = cairo_image_surface_get_format(surface);
@@ -184,46 +235,50 @@ int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
     /* Flush pending operations to surface */
     cairo_surface_flush(surface);
 
-    /* Prepare JPEG bits */
-    struct jpeg_compress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    cinfo.err = jpeg_std_error(&jerr);
-    jpeg_create_compress(&cinfo);
+    /* Reuse JPEG bits from any previous image */
+    j_compress_ptr cinfo = &encoder->cinfo;
 
     /* Write JPEG directly to given stream */
-    jpeg_guac_dest(&cinfo, socket, stream);
+    jpeg_guac_dest(cinfo, socket, stream);
 
-    cinfo.image_width = width; /* image width and height, in pixels */
-    cinfo.image_height = height;
-    cinfo.arith_code = TRUE;
+    cinfo->image_width = width; /* image width and height, in pixels */
+    cinfo->image_height = height;
+    cinfo->arith_code = TRUE;
 
 #ifdef JCS_EXTENSIONS
     /* The Turbo JPEG extensions allows us to use the Cairo surface
      * (BGRx) as input without converting it */
-    cinfo.input_components = 4;
-    cinfo.in_color_space = JCS_EXT_BGRX;
+    cinfo->input_components = 4;
+    cinfo->in_color_space = JCS_EXT_BGRX;
 #else
     /* Standard JPEG supports RGB as input so we will have to convert
      * the contents of the Cairo surface from (BGRx) to RGB */
-    cinfo.input_components = 3;
-    cinfo.in_color_space = JCS_RGB;
+    cinfo->input_components = 3;
+    cinfo->in_color_space = JCS_RGB;
+
+    /* Ensure the buffer for the write scan line, which is where we will put
+     * the converted pixels (BGRx -> RGB), is large enough */
+    size_t scanline_size = guac_mem_ckd_mul_or_die(width, cinfo->input_components);
+    if (scanline_size > encoder->scanline_size) {
+        guac_mem_free(encoder->scanline);
+        encoder->scanline = guac_mem_alloc(scanline_size);
+        encoder->scanline_size = scanline_size;
+    }
 
-    /* Create a buffer for the write scan line which is where we will
-     * put the converted pixels (BGRx -> RGB) */
-    unsigned char *scanline_data = guac_mem_zalloc(cinfo.image_width, cinfo.input_components);
+    unsigned char *scanline_data = encoder->scanline;
 #endif
 
     /* Initialize the JPEG compressor */
-    jpeg_set_defaults(&cinfo);
-    jpeg_set_quality(&cinfo, quality, TRUE /* limit to baseline-JPEG values */);
-    jpeg_start_compress(&cinfo, TRUE);
+    jpeg_set_defaults(cinfo);
+    jpeg_set_quality(cinfo, quality, TRUE /* limit to baseline-JPEG values */);
+    jpeg_start_compress(cinfo, TRUE);
 
     JSAMPROW row_pointer[1]; /* pointer to a single row */
 
     /* Write scanlines to be used in JPEG compression */
-    while (cinfo.next_scanline < cinfo.image_height) {
+    while (cinfo->next_scanline < cinfo->image_height) {
 
-        int row_offset = stride * cinfo.next_scanline;
+        int row_offset = stride * cinfo->next_scanline;
 
 #ifdef JCS_EXTENSIONS
         /* In Turbo JPEG we can use the raw BGRx scanline  */
@@ -247,19 +302,22 @@ int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
         row_pointer[0] = scanline_data;
 #endif
 
-        jpeg_write_scanlines(&cinfo, row_pointer, 1);
+        jpeg_write_scanlines(cinfo, row_pointer, 1);
     }
 
-#ifndef JCS_EXTENSIONS
-    guac_mem_free(scanline_data);
-#endif
-
-    /* Finalize compression */
-    jpeg_finish_compress(&cinfo);
-
-    /* Clean up */
-    jpeg_destroy_compress(&cinfo);
+    /* Finalize compression (the compression structure may now be reused) */
+    jpeg_finish_compress(cinfo);
     return 0;
 
 }
 
+int guac_jpeg_write(guac_socket* socket, guac_stream* stream,
+        cairo_surface_t* surface, int quality) {
+
+    guac_jpeg_encoder* encoder = guac_jpeg_encoder_alloc();
+    int result = guac_jpeg_encoder_write(encoder, socket, stream, surface, quality);
+    guac_jpeg_encoder_free(encoder);
+
+    return result;
+
+}
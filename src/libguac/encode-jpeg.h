@@ -25,6 +25,58 @@
 
 #include <cairo/cairo.h>
 
+/**
+ * Reusable state for encoding JPEG images, including the libjpeg compression
+ * structure and any scratch buffers required for each image. Encoding many
+ * images with the same guac_jpeg_encoder avoids recreating that state for
+ * every image. A guac_jpeg_encoder may be used by only one thread at a time.
+ */
+typedef struct guac_jpeg_encoder guac_jpeg_encoder;
+
+/**
+ * Allocates a new guac_jpeg_encoder. The encoder must eventually be freed
+ * with guac_jpeg_encoder_free().
+ *
+ * @return
+ *     A newly-allocated guac_jpeg_encoder.
+ */
+guac_jpeg_encoder* guac_jpeg_encoder_alloc(void);
+
+/**
+ * Frees the given guac_jpeg_encoder, including its libjpeg compression
+ * structure and all associated scratch buffers.
+ *
+ * @param encoder
+ *     The guac_jpeg_encoder to free.
+ */
+void guac_jpeg_encoder_free(guac_jpeg_encoder* encoder);
+
+/**
+ * Encodes the given surface as a JPEG using the given encoder, and sends the
+ * resulting data over the given stream and socket as blobs. This is identical
+ * to guac_jpeg_write(), except that the state of the given encoder is reused.
+ *
+ * @param encoder
+ *     The encoder to use to encode the surface.
+ *
+ * @param socket
+ *     The socket to send JPEG blobs over.
+ *
+ * @param stream
+ *     The stream to associate with each blob.
+ *
+ * @param surface
+ *     The Cairo surface to write to the given stream and socket as JPEG blobs.
+ *
+ * @param quality
+ *     JPEG image quality.
+ *
+ * @return
+ *     Zero if the encoding operation is successful, non-zero otherwise.
+ */
+int guac_jpeg_encoder_write(guac_jpeg_encoder* encoder, guac_socket* socket,
+        guac_stream* stream, cairo_surface_t* surface, int quality);
+
 /**
  * Encodes the given surface as a JPEG, and sends the resulting data over the
  * given stream and socket as blobs.
@@ -43,7 +43,8 @@
 typedef struct guac_png_write_state {
 
     /**
-     * The socket over which all PNG blobs will be written.
+     * The socket over which all PNG blobs will be written, or NULL if PNG data
+     * should instead be accumulated within the output buffer.
      */
     guac_socket* socket;
 
@@ -62,8 +63,55 @@ typedef struct guac_png_write_state {
      */
     int buffer_size;
 
+    /**
+     * All PNG data written thus far, if PNG data is being accumulated in
+     * memory rather than written to a socket (socket is NULL).
+     */
+    unsigned char* output;
+
+    /**
+     * The number of bytes of PNG data stored within the output buffer.
+     */
+    size_t output_length;
+
+    /**
+     * The number of bytes allocated for the output buffer.
+     */
+    size_t output_size;
+
 } guac_png_write_state;
 
+struct guac_png_encoder {
+
+    /**
+     * The palette of the image currently being encoded, rebuilt for each
+     * image.
+     */
+    guac_palette palette;
+
+    /**
+     * The palette index of each pixel of the image currently being encoded,
+     * stored row by row.
+     */
+    png_byte* indices;
+
+    /**
+     * The number of bytes allocated for the indices buffer.
+     */
+    size_t indices_size;
+
+    /**
+     * Pointers to the start of each row within the indices buffer.
+     */
+    png_byte** rows;
+
+    /**
+     * The number of row pointers allocated for the rows array.
+     */
+    int rows_size;
+
+};
+
 /**
  * Writes the contents of the PNG write state as a blob to its associated
  * socket.
@@ -73,9 +121,34 @@ typedef struct guac_png_write_state {
  */
 static void guac_png_flush_data(guac_png_write_state* write_state) {
 
-    /* Send blob */
-    guac_protocol_send_blob(write_state->socket, write_state->stream,
-            write_state->buffer, write_state->buffer_size);
+    /* Accumulate data in memory if there is no socket */
+    if (write_state->socket == NULL) {
+
+        size_t required = guac_mem_ckd_add_or_die(write_state->output_length,
+                write_state->buffer_size);
+
+        /* Grow output buffer geometrically as needed */
+        if (required > write_state->output_size) {
+
+            size_t new_size = guac_mem_ckd_mul_or_die(write_state->output_size, 2);
+            if (new_size < required)
+                new_size = required;
+
+            write_state->output = guac_mem_realloc_or_die(write_state->output, new_size);
+            write_state->output_size = new_size;
+
+        }
+
+        memcpy(write_state->output + write_state->output_length,
+                write_state->buffer, write_state->buffer_size);
+        write_state->output_length += write_state->buffer_size;
+
+    }
+
+    /* Otherwise, send blob */
+    else
+        guac_protocol_send_blob(write_state->socket, write_state->stream,
+                write_state->buffer, write_state->buffer_size);
 
     /* Clear buffer */
     write_state->buffer_size = 0;
@@ -167,39 +240,29 @@ static cairo_status_t guac_png_cairo_write_handler(void* closure,
  * Implementation of guac_png_write() which uses Cairo's own PNG encoder to
  * write PNG data, rather than using libpng directly.
  *
- * @param socket
- *     The socket to send PNG blobs over.
- *
- * @param stream
- *     The stream to associate with each blob.
+ * @param write_state
+ *     The initialized write state that should receive the PNG data.
  *
  * @param surface
- *     The Cairo surface to write to the given stream and socket as PNG blobs.
+ *     The Cairo surface to write as PNG.
  *
  * @return
  *     Zero if the encoding operation is successful, non-zero otherwise.
  */
-static int guac_png_cairo_write(guac_socket* socket, guac_stream* stream,
+static int guac_png_cairo_write(guac_png_write_state* write_state,
         cairo_surface_t* surface) {
 
-    guac_png_write_state write_state;
-
-    /* Init write state */
-    write_state.socket = socket;
-    write_state.stream = stream;
-    write_state.buffer_size = 0;
-
     /* Write surface as PNG */
     if (cairo_surface_write_to_png_stream(surface,
                 guac_png_cairo_write_handler,
-                &write_state) != CAIRO_STATUS_SUCCESS) {
+                write_state) != CAIRO_STATUS_SUCCESS) {
         guac_error = GUAC_STATUS_INTERNAL_ERROR;
         guac_error_message = "Cairo PNG backend failed";
         return -1;
     }
 
     /* Flush remaining PNG data */
-    guac_png_flush_data(&write_state);
+    guac_png_flush_data(write_state);
     return 0;
 
 }
@@ -264,18 +327,67 @@ static void guac_png_flush_handler(png_structp png) {
 
 }
 
-int guac_png_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface) {
+/**
+ * Ensures the scratch buffers of the given encoder are large enough to store
+ * the palette indices of an image having the given dimensions, reallocating
+ * those buffers if necessary, and updates the row pointers of the encoder
+ * accordingly.
+ *
+ * @param encoder
+ *     The encoder whose scratch buffers should be prepared.
+ *
+ * @param width
+ *     The width of the image, in pixels.
+ *
+ * @param height
+ *     The height of the image, in pixels.
+ */
+static void guac_png_encoder_reserve(guac_png_encoder* encoder, int width,
+        int height) {
+
+    size_t required = guac_mem_ckd_mul_or_die(width, height);
+    if (required > encoder->indices_size) {
+        guac_mem_free(encoder->indices);
+        encoder->indices = guac_mem_alloc(required);
+        encoder->indices_size = required;
+    }
+
+    if (height > encoder->rows_size) {
+        guac_mem_free(encoder->rows);
+        encoder->rows = guac_mem_alloc(sizeof(png_byte*), height);
+        encoder->rows_size = height;
+    }
+
+    for (int y = 0; y < height; y++)
+        encoder->rows[y] = encoder->indices + (size_t) y * width;
+
+}
+
+/**
+ * Encodes the given surface as a PNG using the given encoder, writing the
+ * resulting data to the given write state.
+ *
+ * @param encoder
+ *     The encoder whose palette and scratch buffers should be used.
+ *
+ * @param write_state
+ *     The initialized write state that should receive the PNG data.
+ *
+ * @param surface
+ *     The Cairo surface to write as PNG.
+ *
+ * @return
+ *     Zero if the encoding operation is successful, non-zero otherwise.
+ */
+static int guac_png_write_surface(guac_png_encoder* encoder,
+        guac_png_write_state* write_state, cairo_surface_t* surface) {
 
     png_structp png;
     png_infop png_info;
-    png_byte** png_rows;
     int bpp;
 
     int x, y;
 
-    guac_png_write_state write_state;
-
     /* Get image surface properties and data */
     cairo_format_t format = cairo_image_surface_get_format(surface);
     int width = cairo_image_surface_get_width(surface);
@@ -285,17 +397,16 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
 
     /* If not RGB24, use Cairo PNG writer */
     if (format != CAIRO_FORMAT_RGB24 || data == NULL)
-        return guac_png_cairo_write(socket, stream, surface);
+        return guac_png_cairo_write(write_state, surface);
 
     /* Flush pending operations to surface */
     cairo_surface_flush(surface);
 
-    /* Attempt to build palette */
-    guac_palette* palette = guac_palette_alloc(surface);
-
-    /* If not possible, resort to Cairo PNG writer */
-    if (palette == NULL)
-        return guac_png_cairo_write(socket, stream, surface);
+    /* Attempt to build palette, resorting to Cairo PNG writer if not
+     * possible */
+    guac_palette* palette = &encoder->palette;
+    if (guac_palette_build(palette, surface))
+        return guac_png_cairo_write(write_state, surface);
 
     /* Calculate BPP from palette size */
     if      (palette->size <= 2)  bpp = 1;
@@ -303,10 +414,31 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     else if (palette->size <= 16) bpp = 4;
     else                          bpp = 8;
 
+    /* Copy data from surface into PNG data */
+    guac_png_encoder_reserve(encoder, width, height);
+    for (y=0; y<height; y++) {
+
+        png_byte* row = encoder->rows[y];
+
+        /* Copy data from surface into current row */
+        for (x=0; x<width; x++) {
+
+            /* Get pixel color */
+            int color = ((uint32_t*) data)[x] & 0xFFFFFF;
+
+            /* Set index in row */
+            row[x] = guac_palette_find(palette, color);
+
+        }
+
+        /* Advance to next data row */
+        data += stride;
+
+    }
+
     /* Set up PNG writer */
     png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!png) {
-        guac_palette_free(palette);
         guac_error = GUAC_STATUS_INTERNAL_ERROR;
         guac_error_message = "libpng failed to create write structure";
         return -1;
@@ -315,7 +447,6 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     png_info = png_create_info_struct(png);
     if (!png_info) {
         png_destroy_write_struct(&png, NULL);
-        guac_palette_free(palette);
         guac_error = GUAC_STATUS_INTERNAL_ERROR;
         guac_error_message = "libpng failed to create info structure";
         return -1;
@@ -324,46 +455,16 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     /* Set error handler */
     if (setjmp(png_jmpbuf(png))) {
         png_destroy_write_struct(&png, &png_info);
-        guac_palette_free(palette);
         guac_error = GUAC_STATUS_IO_ERROR;
         guac_error_message = "libpng output error";
         return -1;
     }
 
-    /* Init write state */
-    write_state.socket = socket;
-    write_state.stream = stream;
-    write_state.buffer_size = 0;
-
     /* Set up writer */
-    png_set_write_fn(png, &write_state,
+    png_set_write_fn(png, write_state,
             guac_png_write_handler,
             guac_png_flush_handler);
 
-    /* Copy data from surface into PNG data */
-    png_rows = (png_byte**) guac_mem_alloc(sizeof(png_byte*), height);
-    for (y=0; y<height; y++) {
-
-        /* Allocate new PNG row */
-        png_byte* row = (png_byte*) guac_mem_alloc(sizeof(png_byte), width);
-        png_rows[y] = row;
-
-        /* Copy data from surface into current row */
-        for (x=0; x<width; x++) {
-
-            /* Get pixel color */
-            int color = ((uint32_t*) data)[x] & 0xFFFFFF;
-
-            /* Set index in row */
-            row[x] = guac_palette_find(palette, color);
-
-        }
-
-        /* Advance to next data row */
-        data += stride;
-
-    }
-
     /* Write image info */
     png_set_IHDR(
         png,
@@ -381,23 +482,74 @@ int guac_png_write(guac_socket* socket, guac_stream* stream,
     png_set_PLTE(png, png_info, palette->colors, palette->size);
 
     /* Write image */
-    png_set_rows(png, png_info, png_rows);
+    png_set_rows(png, png_info, encoder->rows);
     png_write_png(png, png_info, PNG_TRANSFORM_PACKING, NULL);
 
     /* Finish write */
     png_destroy_write_struct(&png, &png_info);
 
-    /* Free palette */
-    guac_palette_free(palette);
-
-    /* Free PNG data */
-    for (y=0; y<height; y++)
-        guac_mem_free(png_rows[y]);
-    guac_mem_free(png_rows);
-
     /* Ensure all data is written */
-    guac_png_flush_data(&write_state);
+    guac_png_flush_data(write_state);
     return 0;
 
 }
 
+guac_png_encoder* guac_png_encoder_alloc(void) {
+    return guac_mem_zalloc(sizeof(guac_png_encoder));
+}
+
+void guac_png_encoder_free(guac_png_encoder* encoder) {
+    guac_mem_free(encoder->indices);
+    guac_mem_free(encoder->rows);
+    guac_mem_free(encoder);
+}
+
+int guac_png_encoder_write(guac_png_encoder* encoder, guac_socket* socket,
+        guac_stream* stream, cairo_surface_t* surface) {
+
+    guac_png_write_state write_state = {
+        .socket = socket,
+        .stream = stream,
+        .buffer_size = 0
+    };
+
+    return guac_png_write_surface(encoder, &write_state, surface);
+
+}
+
+int guac_png_write(guac_socket* socket, guac_stream* stream,
+        cairo_surface_t* surface) {
+
+    guac_png_encoder* encoder = guac_png_encoder_alloc();
+    int result = guac_png_encoder_write(encoder, socket, stream, surface);
+    guac_png_encoder_free(encoder);
+
+    return result;
+
+}
+
+int guac_png_encode(cairo_surface_t* surface, unsigned char** data,
+        size_t* length) {
+
+    guac_png_write_state write_state = {
+        .socket = NULL,
+        .buffer_size = 0,
+        .output = NULL,
+        .output_length = 0,
+        .output_size = 0
+    };
+
+    guac_png_encoder* encoder = guac_png_encoder_alloc();
+    int result = guac_png_write_surface(encoder, &write_state, surface);
+    guac_png_encoder_free(encoder);
+
+    if (result) {
+        guac_mem_free(write_state.output);
+        return -1;
+    }
+
+    *data = write_state.output;
+    *length = write_state.output_length;
+    return 0;
+
+}
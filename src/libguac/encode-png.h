@@ -25,6 +25,54 @@
 
 #include <cairo/cairo.h>
 
+/**
+ * Reusable state for encoding PNG images, including the palette and scratch
+ * buffers required for each image. Encoding many images with the same
+ * guac_png_encoder avoids reallocating that state for every image. A
+ * guac_png_encoder may be used by only one thread at a time.
+ */
+typedef struct guac_png_encoder guac_png_encoder;
+
+/**
+ * Allocates a new guac_png_encoder. The encoder must eventually be freed with
+ * guac_png_encoder_free().
+ *
+ * @return
+ *     A newly-allocated guac_png_encoder.
+ */
+guac_png_encoder* guac_png_encoder_alloc(void);
+
+/**
+ * Frees the given guac_png_encoder and all associated scratch buffers.
+ *
+ * @param encoder
+ *     The guac_png_encoder to free.
+ */
+void guac_png_encoder_free(guac_png_encoder* encoder);
+
+/**
+ * Encodes the given surface as a PNG using the given encoder, and sends the
+ * resulting data over the given stream and socket as blobs. This is identical
+ * to guac_png_write(), except that the state of the given encoder is reused.
+ *
+ * @param encoder
+ *     The encoder to use to encode the surface.
+ *
+ * @param socket
+ *     The socket to send PNG blobs over.
+ *
+ * @param stream
+ *     The stream to associate with each blob.
+ *
+ * @param surface
+ *     The Cairo surface to write to the given stream and socket as PNG blobs.
+ *
+ * @return
+ *     Zero if the encoding operation is successful, non-zero otherwise.
+ */
+int guac_png_encoder_write(guac_png_encoder* encoder, guac_socket* socket,
+        guac_stream* stream, cairo_surface_t* surface);
+
 /**
  * Encodes the given surface as a PNG, and sends the resulting data over the
  * given stream and socket as blobs.
@@ -44,5 +92,27 @@
 int guac_png_write(guac_socket* socket, guac_stream* stream,
         cairo_surface_t* surface);
 
+/**
+ * Encodes the given surface as a PNG, storing the resulting data in a newly
+ * allocated buffer rather than sending that data over a socket.
+ *
+ * @param surface
+ *     The Cairo surface to encode as PNG.
+ *
+ * @param data
+ *     Pointer to the pointer that should receive the newly-allocated buffer
+ *     containing the PNG data. This buffer must eventually be freed with
+ *     guac_mem_free(). If encoding fails, the pointer is not modified.
+ *
+ * @param length
+ *     Pointer to the size_t that should receive the size of the PNG data, in
+ *     bytes. If encoding fails, the size_t is not modified.
+ *
+ * @return
+ *     Zero if the encoding operation is successful, non-zero otherwise.
+ */
+int guac_png_encode(cairo_surface_t* surface, unsigned char** data,
+        size_t* length);
+
 #endif
 
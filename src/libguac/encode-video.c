@@ -0,0 +1,551 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "encode-video.h"
+#include "guacamole/client.h"
+#include "guacamole/mem.h"
+#include "guacamole/protocol.h"
+#include "guacamole/socket.h"
+#include "guacamole/stream.h"
+#include "guacamole/timestamp.h"
+#include "guacamole/user.h"
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/dict.h>
+#include <libavutil/frame.h>
+#include <libavutil/mem.h>
+#include <libswscale/swscale.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The size of the buffer used by libavformat when writing encoded video, in
+ * bytes. Each time this buffer fills, its contents are sent as blobs.
+ */
+#define GUAC_VIDEO_ENCODER_IO_BUFFER_SIZE 8192
+
+/**
+ * A video format that may be encoded by guac_video_encoder, along with the
+ * libavcodec/libavformat configuration required to produce that format with
+ * minimal latency.
+ */
+typedef struct guac_video_format {
+
+    /**
+     * The mimetype of the video format, as advertised by clients that
+     * support it.
+     */
+    const char* mimetype;
+
+    /**
+     * The name of the libavcodec encoder that should be used.
+     */
+    const char* codec_name;
+
+    /**
+     * Options for the encoder, as a string of "key=value" pairs separated by
+     * colons.
+     */
+    const char* codec_options;
+
+    /**
+     * The name of the libavformat container format that should be used.
+     */
+    const char* container_name;
+
+    /**
+     * Options for the container, as a string of "key=value" pairs separated
+     * by colons.
+     */
+    const char* container_options;
+
+} guac_video_format;
+
+/**
+ * All video formats supported by guac_video_encoder, in order of
+ * preference, terminated by an entry having a NULL mimetype.
+ */
+static const guac_video_format guac_video_formats[] = {
+
+    /* VP8 in WebM */
+    {
+        .mimetype          = "video/webm",
+        .codec_name        = "libvpx",
+        .codec_options     = "deadline=realtime:cpu-used=8:lag-in-frames=0",
+        .container_name    = "webm",
+        .container_options = "live=1"
+    },
+
+    /* H.264 in fragmented MP4 */
+    {
+        .mimetype          = "video/mp4",
+        .codec_name        = "libx264",
+        .codec_options     = "preset=ultrafast:tune=zerolatency",
+        .container_name    = "mp4",
+        .container_options = "movflags=frag_keyframe+empty_moov+default_base_moof"
+    },
+
+    { .mimetype = NULL }
+
+};
+
+struct guac_video_encoder {
+
+    /**
+     * The client associated with the video.
+     */
+    guac_client* client;
+
+    /**
+     * The socket over which the video is being sent.
+     */
+    guac_socket* socket;
+
+    /**
+     * The stream carrying the encoded video.
+     */
+    guac_stream* stream;
+
+    /**
+     * The libavformat context of the container format, which writes to the
+     * stream through a custom I/O context.
+     */
+    AVFormatContext* container;
+
+    /**
+     * The video stream within the container.
+     */
+    AVStream* output_stream;
+
+    /**
+     * The libavcodec encoding context.
+     */
+    AVCodecContext* context;
+
+    /**
+     * The libswscale context used to convert 32-bit RGB image data to the
+     * YUV format required by the encoder.
+     */
+    struct SwsContext* converter;
+
+    /**
+     * The frame that receives converted image data prior to encoding.
+     */
+    AVFrame* frame;
+
+    /**
+     * The packet that receives encoded data prior to being written to the
+     * container.
+     */
+    AVPacket* packet;
+
+    /**
+     * The time at which the video started.
+     */
+    guac_timestamp start;
+
+    /**
+     * The presentation timestamp of the most recently encoded frame, in
+     * milliseconds relative to the start of the video, or -1 if no frames
+     * have yet been encoded.
+     */
+    int64_t last_pts;
+
+};
+
+/**
+ * Returns the video format having the given mimetype, if supported.
+ *
+ * @param mimetype
+ *     The mimetype of the video format to return.
+ *
+ * @return
+ *     The video format having the given mimetype, or NULL if there is no
+ *     such format or libavcodec lacks the required encoder.
+ */
+static const guac_video_format* guac_video_format_find(const char* mimetype) {
+
+    for (const guac_video_format* format = guac_video_formats;
+            format->mimetype != NULL; format++) {
+
+        if (strcmp(format->mimetype, mimetype) == 0) {
+            if (avcodec_find_encoder_by_name(format->codec_name) == NULL)
+                return NULL;
+            return format;
+        }
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * The state of a check for support of a particular video format across all
+ * users of a client.
+ */
+typedef struct guac_video_support_check {
+
+    /**
+     * The mimetype of the video format being checked.
+     */
+    const char* mimetype;
+
+    /**
+     * Non-zero if all users checked thus far support the video format, zero
+     * otherwise.
+     */
+    int supported;
+
+} guac_video_support_check;
+
+/**
+ * Callback which is invoked by guac_video_encoder_select_mimetype() for each
+ * user of a client, updating the given guac_video_support_check to reflect
+ * whether that user supports the video format being checked.
+ *
+ * @param user
+ *     The user to check for video support.
+ *
+ * @param data
+ *     The guac_video_support_check describing the video format being checked
+ *     and whether all users checked thus far support that format.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_video_support_callback(guac_user* user, void* data) {
+
+    guac_video_support_check* check = (guac_video_support_check*) data;
+    if (!check->supported)
+        return NULL;
+
+    /* Users that have not declared any supported video formats support
+     * none */
+    const char** mimetype = user->info.video_mimetypes;
+    check->supported = 0;
+    if (mimetype == NULL)
+        return NULL;
+
+    for (; *mimetype != NULL; mimetype++) {
+        if (strcmp(*mimetype, check->mimetype) == 0) {
+            check->supported = 1;
+            break;
+        }
+    }
+
+    return NULL;
+
+}
+
+const char* guac_video_encoder_select_mimetype(guac_client* client) {
+
+    if (client->connected_users == 0)
+        return NULL;
+
+    for (const guac_video_format* format = guac_video_formats;
+            format->mimetype != NULL; format++) {
+
+        if (avcodec_find_encoder_by_name(format->codec_name) == NULL)
+            continue;
+
+        guac_video_support_check check = {
+            .mimetype = format->mimetype,
+            .supported = 1
+        };
+
+        guac_client_foreach_user(client, guac_video_support_callback, &check);
+        if (check.supported)
+            return format->mimetype;
+
+    }
+
+    return NULL;
+
+}
+
+/**
+ * Write callback for the custom libavformat I/O context of a video encoder,
+ * sending the given encoded data as blobs along the video's stream.
+ *
+ * @param opaque
+ *     The guac_video_encoder whose data is being written.
+ *
+ * @param buf
+ *     The data to write.
+ *
+ * @param buf_size
+ *     The number of bytes to write.
+ *
+ * @return
+ *     The number of bytes written, or a negative libavformat error code if
+ *     the data could not be sent.
+ */
+#if LIBAVFORMAT_VERSION_MAJOR >= 61
+static int guac_video_encoder_write_packet(void* opaque, const uint8_t* buf,
+        int buf_size) {
+#else
+static int guac_video_encoder_write_packet(void* opaque, uint8_t* buf,
+        int buf_size) {
+#endif
+
+    guac_video_encoder* encoder = (guac_video_encoder*) opaque;
+
+    if (guac_protocol_send_blobs(encoder->socket, encoder->stream, buf, buf_size))
+        return AVERROR(EIO);
+
+    return buf_size;
+
+}
+
+/**
+ * Frees all resources associated with the given video encoder, without
+ * flushing any buffered frames or ending its stream.
+ *
+ * @param encoder
+ *     The video encoder to free.
+ */
+static void guac_video_encoder_cleanup(guac_video_encoder* encoder) {
+
+    av_frame_free(&encoder->frame);
+    av_packet_free(&encoder->packet);
+    sws_freeContext(encoder->converter);
+    avcodec_free_context(&encoder->context);
+
+    if (encoder->container != NULL) {
+
+        if (encoder->container->pb != NULL) {
+            av_freep(&encoder->container->pb->buffer);
+            avio_context_free(&encoder->container->pb);
+        }
+
+        avformat_free_context(encoder->container);
+
+    }
+
+    guac_mem_free(encoder);
+
+}
+
+/**
+ * Encodes the given frame, writing any resulting packets to the container
+ * and flushing the container such that the client receives all data
+ * required to display the frame.
+ *
+ * @param encoder
+ *     The video encoder to use.
+ *
+ * @param frame
+ *     The frame to encode, or NULL to flush all frames buffered within the
+ *     encoder.
+ *
+ * @return
+ *     Zero if encoding succeeded, non-zero otherwise.
+ */
+static int guac_video_encoder_encode(guac_video_encoder* encoder, AVFrame* frame) {
+
+    if (avcodec_send_frame(encoder->context, frame) < 0)
+        return 1;
+
+    for (;;) {
+
+        int result = avcodec_receive_packet(encoder->context, encoder->packet);
+        if (result == AVERROR(EAGAIN) || result == AVERROR_EOF)
+            break;
+
+        if (result < 0)
+            return 1;
+
+        av_packet_rescale_ts(encoder->packet, encoder->context->time_base,
+                encoder->output_stream->time_base);
+        encoder->packet->stream_index = encoder->output_stream->index;
+
+        result = av_write_frame(encoder->container, encoder->packet);
+        av_packet_unref(encoder->packet);
+
+        if (result < 0)
+            return 1;
+
+    }
+
+    /* End the current cluster/fragment such that the frame can be played
+     * immediately */
+    av_write_frame(encoder->container, NULL);
+    avio_flush(encoder->container->pb);
+
+    return 0;
+
+}
+
+guac_video_encoder* guac_video_encoder_alloc(guac_client* client,
+        guac_socket* socket, const guac_layer* layer, const char* mimetype,
+        int width, int height, guac_timestamp timestamp) {
+
+    AVDictionary* options = NULL;
+    int result;
+
+    const guac_video_format* format = guac_video_format_find(mimetype);
+    if (format == NULL)
+        return NULL;
+
+    const AVCodec* codec = avcodec_find_encoder_by_name(format->codec_name);
+
+    guac_video_encoder* encoder = guac_mem_zalloc(sizeof(guac_video_encoder));
+    encoder->client = client;
+    encoder->socket = socket;
+    encoder->start = timestamp;
+    encoder->last_pts = -1;
+
+    /* Frames are timestamped in milliseconds, as Guacamole frames have no
+     * fixed rate */
+    AVCodecContext* context = encoder->context = avcodec_alloc_context3(codec);
+    if (context == NULL)
+        goto fail;
+
+    context->width = width;
+    context->height = height;
+    context->pix_fmt = AV_PIX_FMT_YUV420P;
+    context->time_base = (AVRational) { 1, 1000 };
+    context->bit_rate = (int64_t) width * height * GUAC_VIDEO_ENCODER_BITRATE_PER_PIXEL;
+    context->gop_size = GUAC_VIDEO_ENCODER_KEYFRAME_INTERVAL;
+    context->max_b_frames = 0;
+
+    if (avformat_alloc_output_context2(&encoder->container, NULL,
+                format->container_name, NULL) < 0)
+        goto fail;
+
+    if (encoder->container->oformat->flags & AVFMT_GLOBALHEADER)
+        context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    av_dict_parse_string(&options, format->codec_options, "=", ":", 0);
+    result = avcodec_open2(context, codec, &options);
+    av_dict_free(&options);
+
+    if (result < 0)
+        goto fail;
+
+    encoder->output_stream = avformat_new_stream(encoder->container, NULL);
+    if (encoder->output_stream == NULL)
+        goto fail;
+
+    encoder->output_stream->time_base = context->time_base;
+    if (avcodec_parameters_from_context(encoder->output_stream->codecpar, context) < 0)
+        goto fail;
+
+    /* Write all container data to the stream rather than a file */
+    unsigned char* io_buffer = av_malloc(GUAC_VIDEO_ENCODER_IO_BUFFER_SIZE);
+    if (io_buffer == NULL)
+        goto fail;
+
+    encoder->container->pb = avio_alloc_context(io_buffer,
+            GUAC_VIDEO_ENCODER_IO_BUFFER_SIZE, 1, encoder, NULL,
+            guac_video_encoder_write_packet, NULL);
+
+    if (encoder->container->pb == NULL) {
+        av_free(io_buffer);
+        goto fail;
+    }
+
+    encoder->container->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    /* Allocate storage for converted and encoded data */
+    encoder->frame = av_frame_alloc();
+    encoder->packet = av_packet_alloc();
+    if (encoder->frame == NULL || encoder->packet == NULL)
+        goto fail;
+
+    encoder->frame->format = context->pix_fmt;
+    encoder->frame->width = width;
+    encoder->frame->height = height;
+    if (av_frame_get_buffer(encoder->frame, 0) < 0)
+        goto fail;
+
+    encoder->converter = sws_getContext(width, height, AV_PIX_FMT_RGB32,
+            width, height, AV_PIX_FMT_YUV420P, SWS_POINT, NULL, NULL, NULL);
+    if (encoder->converter == NULL)
+        goto fail;
+
+    /* Begin video stream */
+    encoder->stream = guac_client_alloc_stream(client);
+    if (encoder->stream == NULL)
+        goto fail;
+
+    guac_protocol_send_video(socket, encoder->stream, layer, mimetype);
+
+    av_dict_parse_string(&options, format->container_options, "=", ":", 0);
+    result = avformat_write_header(encoder->container, &options);
+    av_dict_free(&options);
+
+    if (result < 0) {
+        guac_protocol_send_end(socket, encoder->stream);
+        guac_client_free_stream(client, encoder->stream);
+        goto fail;
+    }
+
+    avio_flush(encoder->container->pb);
+    return encoder;
+
+fail:
+    guac_client_log(client, GUAC_LOG_DEBUG, "Unable to begin encoding "
+            "\"%s\" video.", mimetype);
+    guac_video_encoder_cleanup(encoder);
+    return NULL;
+
+}
+
+int guac_video_encoder_write(guac_video_encoder* encoder,
+        const unsigned char* buffer, size_t stride, guac_timestamp timestamp) {
+
+    /* Presentation timestamps must strictly increase */
+    int64_t pts = timestamp - encoder->start;
+    if (pts <= encoder->last_pts)
+        pts = encoder->last_pts + 1;
+
+    encoder->last_pts = pts;
+
+    if (av_frame_make_writable(encoder->frame) < 0)
+        return 1;
+
+    const uint8_t* src[] = { buffer };
+    const int src_stride[] = { stride };
+    sws_scale(encoder->converter, src, src_stride, 0, encoder->frame->height,
+            encoder->frame->data, encoder->frame->linesize);
+
+    encoder->frame->pts = pts;
+    return guac_video_encoder_encode(encoder, encoder->frame);
+
+}
+
+void guac_video_encoder_free(guac_video_encoder* encoder) {
+
+    /* Flush any remaining frames */
+    guac_video_encoder_encode(encoder, NULL);
+    av_write_trailer(encoder->container);
+    avio_flush(encoder->container->pb);
+
+    guac_protocol_send_end(encoder->socket, encoder->stream);
+    guac_client_free_stream(encoder->client, encoder->stream);
+
+    guac_video_encoder_cleanup(encoder);
+
+}
+
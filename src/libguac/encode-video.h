@@ -0,0 +1,134 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_ENCODE_VIDEO_H
+#define GUAC_ENCODE_VIDEO_H
+
+#include "guacamole/client-types.h"
+#include "guacamole/layer-types.h"
+#include "guacamole/socket-types.h"
+#include "guacamole/timestamp-types.h"
+
+#include <stddef.h>
+
+/**
+ * The number of bits per second of encoded video to allow for each pixel of
+ * the encoded region.
+ */
+#define GUAC_VIDEO_ENCODER_BITRATE_PER_PIXEL 2
+
+/**
+ * The maximum number of frames between keyframes of encoded video.
+ */
+#define GUAC_VIDEO_ENCODER_KEYFRAME_INTERVAL 50
+
+/**
+ * A video which is actively being encoded and streamed to a layer via the
+ * Guacamole "video" instruction. The structure of this object is private to
+ * encode-video.c, which is compiled only if libguac was built with support
+ * for libavcodec (ENABLE_VIDEO_ENCODING is defined). None of the functions
+ * declared here may be used otherwise.
+ */
+typedef struct guac_video_encoder guac_video_encoder;
+
+/**
+ * Returns the mimetype of a video format which can be encoded by libguac and
+ * is supported by every user of the given client, if any.
+ *
+ * @param client
+ *     The client whose users should be checked for video support.
+ *
+ * @return
+ *     The mimetype of a supported video format, or NULL if there is no such
+ *     format.
+ */
+const char* guac_video_encoder_select_mimetype(guac_client* client);
+
+/**
+ * Allocates a new video encoder which streams video of the given format and
+ * dimensions to the given layer, sending the "video" instruction that begins
+ * that stream.
+ *
+ * @param client
+ *     The client associated with the video. The stream carrying the video
+ *     will be allocated from this client.
+ *
+ * @param socket
+ *     The socket over which the video should be sent.
+ *
+ * @param layer
+ *     The layer that should play the video.
+ *
+ * @param mimetype
+ *     The mimetype of the video format to use, as returned by
+ *     guac_video_encoder_select_mimetype().
+ *
+ * @param width
+ *     The width of the video, in pixels. This must be even.
+ *
+ * @param height
+ *     The height of the video, in pixels. This must be even.
+ *
+ * @param timestamp
+ *     The time at which the video starts. The timestamps of all frames are
+ *     relative to this time.
+ *
+ * @return
+ *     A newly-allocated video encoder, which must eventually be freed with
+ *     guac_video_encoder_free(), or NULL if the encoder could not be
+ *     allocated.
+ */
+guac_video_encoder* guac_video_encoder_alloc(guac_client* client,
+        guac_socket* socket, const guac_layer* layer, const char* mimetype,
+        int width, int height, guac_timestamp timestamp);
+
+/**
+ * Encodes the given image data as the next frame of the given video, sending
+ * the resulting data as blobs along the video's stream.
+ *
+ * @param encoder
+ *     The video encoder to use.
+ *
+ * @param buffer
+ *     The first pixel of the image data to encode, stored as 32-bit RGB, with
+ *     dimensions identical to those of the video.
+ *
+ * @param stride
+ *     The number of bytes in each row of image data.
+ *
+ * @param timestamp
+ *     The time at which the frame was rendered.
+ *
+ * @return
+ *     Zero if the frame was successfully encoded, non-zero otherwise.
+ */
+int guac_video_encoder_write(guac_video_encoder* encoder,
+        const unsigned char* buffer, size_t stride, guac_timestamp timestamp);
+
+/**
+ * Flushes any frames still buffered within the encoder, ends the video's
+ * stream, and frees the given encoder.
+ *
+ * @param encoder
+ *     The video encoder to free.
+ */
+void guac_video_encoder_free(guac_video_encoder* encoder);
+
+#endif
+
@@ -19,6 +19,7 @@
 
 #include "encode-webp.h"
 #include "guacamole/error.h"
+#include "guacamole/mem.h"
 #include "guacamole/protocol.h"
 #include "guacamole/stream.h"
 #include "palette.h"
@@ -59,6 +60,31 @@ typedef struct guac_webp_stream_writer {
 
 } guac_webp_stream_writer;
 
+struct guac_webp_encoder {
+
+    /**
+     * The WebP encoder configuration most recently used, or uninitialized if
+     * configured is zero.
+     */
+    WebPConfig config;
+
+    /**
+     * Non-zero if config has been initialized, zero otherwise.
+     */
+    int configured;
+
+    /**
+     * The quality that config was initialized for.
+     */
+    int quality;
+
+    /**
+     * The lossless setting that config was initialized for.
+     */
+    int lossless;
+
+};
+
 /**
  * Writes the contents of the WebP stream writer as a blob to its associated
  * socket.
@@ -160,14 +186,68 @@ static int guac_webp_stream_write(const uint8_t* data, size_t data_size,
     return 1;
 }
 
-int guac_webp_write(guac_socket* socket, guac_stream* stream,
-        cairo_surface_t* surface, int quality, int lossless) {
+/**
+ * Updates the configuration of the given encoder for the given quality and
+ * lossless settings, if that configuration is not already up-to-date.
+ *
+ * @param encoder
+ *     The encoder whose configuration should be updated.
+ *
+ * @param quality
+ *     The WebP image quality to configure the encoder for.
+ *
+ * @param lossless
+ *     Zero to configure the encoder for lossy images, non-zero for lossless.
+ *
+ * @return
+ *     Zero if the encoder is now configured, non-zero if the configuration
+ *     is invalid.
+ */
+static int guac_webp_encoder_configure(guac_webp_encoder* encoder,
+        int quality, int lossless) {
+
+    if (encoder->configured && encoder->quality == quality
+            && encoder->lossless == lossless)
+        return 0;
+
+    encoder->configured = 0;
+
+    /* Configure WebP compression bits */
+    WebPConfig* config = &encoder->config;
+    if (!WebPConfigPreset(config, WEBP_PRESET_DEFAULT, quality))
+        return -1;
+
+    /* Add additional tuning */
+    config->lossless = lossless;
+    config->quality = quality;
+    config->thread_level = 0; /* NOT multi-threaded (threading results in unnecessary overhead vs. the worker threads used by guac_display) */
+    config->method = 2; /* Compression method (0=fast/larger, 6=slow/smaller) */
+
+    /* Validate configuration */
+    if (!WebPValidateConfig(config))
+        return -1;
+
+    encoder->configured = 1;
+    encoder->quality = quality;
+    encoder->lossless = lossless;
+    return 0;
+
+}
+
+guac_webp_encoder* guac_webp_encoder_alloc(void) {
+    return guac_mem_zalloc(sizeof(guac_webp_encoder));
+}
+
+void guac_webp_encoder_free(guac_webp_encoder* encoder) {
+    guac_mem_free(encoder);
+}
+
+int guac_webp_encoder_write(guac_webp_encoder* encoder, guac_socket* socket,
+        guac_stream* stream, cairo_surface_t* surface, int quality,
+        int lossless) {
 
     guac_webp_stream_writer writer;
     WebPPicture picture;
-    uint32_t* argb_output;
-
-    int x, y;
 
     int width = cairo_image_surface_get_width(surface);
     int height = cairo_image_surface_get_height(surface);
@@ -184,21 +264,8 @@ int guac_webp_write(guac_socket* socket, guac_stream* stream,
     /* Flush pending operations to surface */
     cairo_surface_flush(surface);
 
-    /* Configure WebP compression bits */
-    WebPConfig config;
-    if (!WebPConfigPreset(&config, WEBP_PRESET_DEFAULT, quality))
-        return -1;
-
-    /* Add additional tuning */
-    config.lossless = lossless;
-    config.quality = quality;
-    config.thread_level = 0; /* NOT multi-threaded (threading results in unnecessary overhead vs. the worker threads used by guac_display) */
-    config.method = 2; /* Compression method (0=fast/larger, 6=slow/smaller) */
-
-    /* Validate configuration */
-    if (!WebPValidateConfig(&config)) {
+    if (guac_webp_encoder_configure(encoder, quality, lossless))
         return -1;
-    }
 
     /* Set up WebP picture */
     if (!WebPPictureInit(&picture)) {
@@ -208,47 +275,25 @@ int guac_webp_write(guac_socket* socket, guac_stream* stream,
     picture.width = width;
     picture.height = height;
 
-    /* Allocate and init writer */
-    if (!WebPPictureAlloc(&picture)) {
+    /* Import image data directly from the Cairo surface, which stores each
+     * pixel in native-endian ARGB and thus BGRA byte order, ignoring the
+     * alpha channel if the surface is opaque */
+    int imported = (format == CAIRO_FORMAT_ARGB32)
+        ? WebPPictureImportBGRA(&picture, data, stride)
+        : WebPPictureImportBGRX(&picture, data, stride);
+
+    if (!imported) {
+        WebPPictureFree(&picture);
         return -1;
     }
+
+    /* Init writer */
     picture.writer = guac_webp_stream_write;
     picture.custom_ptr = &writer;
     guac_webp_stream_writer_init(&writer, socket, stream);
 
-    /* Copy image data into WebP picture */
-    argb_output = picture.argb;
-    for (y = 0; y < height; y++) {
-
-        /* Get pixels at start of each row */
-        uint32_t* src = (uint32_t*) data;
-        uint32_t* dst = argb_output;
-
-        /* For each pixel in row */
-        for (x = 0; x < width; x++) {
-
-            /* Pull pixel data, removing alpha channel if necessary */
-            uint32_t src_pixel = *src;
-            if (format != CAIRO_FORMAT_ARGB32)
-                src_pixel |= 0xFF000000;
-
-            /* Store converted pixel data */
-            *dst = src_pixel;
-
-            /* Next pixel */
-            src++;
-            dst++;
-
-        }
-
-        /* Next row */
-        data += stride;
-        argb_output += picture.argb_stride;
-
-    }
-
     /* Encode image */
-    const int result = WebPEncode(&config, &picture) ? 0 : -1;
+    const int result = WebPEncode(&encoder->config, &picture) ? 0 : -1;
 
     /* Free picture */
     WebPPictureFree(&picture);
@@ -260,3 +305,14 @@ int guac_webp_write(guac_socket* socket, guac_stream* stream,
 
 }
 
+int guac_webp_write(guac_socket* socket, guac_stream* stream,
+        cairo_surface_t* surface, int quality, int lossless) {
+
+    guac_webp_encoder* encoder = guac_webp_encoder_alloc();
+    int result = guac_webp_encoder_write(encoder, socket, stream, surface,
+            quality, lossless);
+    guac_webp_encoder_free(encoder);
+
+    return result;
+
+}
@@ -25,6 +25,61 @@
 
 #include <cairo/cairo.h>
 
+/**
+ * Reusable state for encoding WebP images, including the encoder
+ * configuration most recently used. Encoding many images with the same
+ * guac_webp_encoder avoids recalculating that configuration for every image.
+ * A guac_webp_encoder may be used by only one thread at a time.
+ */
+typedef struct guac_webp_encoder guac_webp_encoder;
+
+/**
+ * Allocates a new guac_webp_encoder. The encoder must eventually be freed
+ * with guac_webp_encoder_free().
+ *
+ * @return
+ *     A newly-allocated guac_webp_encoder.
+ */
+guac_webp_encoder* guac_webp_encoder_alloc(void);
+
+/**
+ * Frees the given guac_webp_encoder.
+ *
+ * @param encoder
+ *     The guac_webp_encoder to free.
+ */
+void guac_webp_encoder_free(guac_webp_encoder* encoder);
+
+/**
+ * Encodes the given surface as a WebP using the given encoder, and sends the
+ * resulting data over the given stream and socket as blobs. This is identical
+ * to guac_webp_write(), except that the state of the given encoder is reused.
+ *
+ * @param encoder
+ *     The encoder to use to encode the surface.
+ *
+ * @param socket
+ *     The socket to send WebP blobs over.
+ *
+ * @param stream
+ *     The stream to associate with each blob.
+ *
+ * @param surface
+ *     The Cairo surface to write to the given stream and socket as WebP blobs.
+ *
+ * @param quality
+ *     The WebP image quality to use, as accepted by guac_webp_write().
+ *
+ * @param lossless
+ *     Zero for a lossy image, non-zero for lossless.
+ *
+ * @return
+ *     Zero if the encoding operation is successful, non-zero otherwise.
+ */
+int guac_webp_encoder_write(guac_webp_encoder* encoder, guac_socket* socket,
+        guac_stream* stream, cairo_surface_t* surface, int quality,
+        int lossless);
+
 /**
  * Encodes the given surface as a WebP, and sends the resulting data over the
  * given stream and socket as blobs.
@@ -40,6 +40,40 @@ void guac_fifo_init(guac_fifo* fifo, void* items,
 
 }
 
+void guac_fifo_relocate(guac_fifo* fifo, void* items, size_t max_items) {
+
+    char* old_items = ((char*) fifo) + fifo->items_offset;
+
+    /* Abort program execution entirely if the new storage cannot contain the
+     * items already present (this should never happen and indicates a bug) */
+    if (fifo->item_count > max_items)
+        abort();
+
+    /* Copy existing items such that the first item is at the beginning of
+     * the new storage, taking into account that the items may wrap around
+     * the end of the old storage */
+    size_t first_part = fifo->max_items - fifo->head;
+    if (first_part > fifo->item_count)
+        first_part = fifo->item_count;
+
+    memcpy(items, old_items + fifo->item_size * fifo->head,
+            fifo->item_size * first_part);
+
+    memcpy(((char*) items) + fifo->item_size * first_part, old_items,
+            fifo->item_size * (fifo->item_count - first_part));
+
+    fifo->items_offset = (char*) items - (char*) fifo;
+    fifo->max_items = max_items;
+    fifo->head = 0;
+
+    /* Update readiness for further items to match new capacity */
+    if (fifo->item_count < fifo->max_items)
+        guac_flag_set(&fifo->state, GUAC_FIFO_STATE_READY);
+    else
+        guac_flag_clear(&fifo->state, GUAC_FIFO_STATE_READY);
+
+}
+
 void guac_fifo_destroy(guac_fifo* fifo) {
     guac_flag_destroy(&fifo->state);
 }
@@ -187,6 +221,64 @@ int guac_fifo_dequeue_and_lock(guac_fifo* fifo, void* item) {
 
 }
 
+size_t guac_fifo_dequeue_multiple(guac_fifo* fifo, void* items,
+        size_t max_items) {
+
+    size_t count = guac_fifo_dequeue_multiple_and_lock(fifo, items, max_items);
+    if (count == 0)
+        return 0;
+
+    guac_flag_unlock(&fifo->state);
+    return count;
+
+}
+
+size_t guac_fifo_dequeue_multiple_and_lock(guac_fifo* fifo, void* items,
+        size_t max_items) {
+
+    /* Block indefinitely while waiting for an item to be added, but bail out
+     * if the fifo becomes invalid */
+    guac_flag_wait_and_lock(&fifo->state,
+            GUAC_FIFO_STATE_NONEMPTY | GUAC_FIFO_STATE_INVALID);
+
+    if (fifo->state.value & GUAC_FIFO_STATE_INVALID || max_items == 0) {
+        guac_flag_unlock(&fifo->state);
+        return 0;
+    }
+
+    size_t count = fifo->item_count;
+    if (count > max_items)
+        count = max_items;
+
+    /* Copy all requested items with at most two copies, as the items may wrap
+     * around the end of the storage array */
+    char* fifo_items = ((char*) fifo) + fifo->items_offset;
+
+    size_t first_part = fifo->max_items - fifo->head;
+    if (first_part > count)
+        first_part = count;
+
+    memcpy(items, fifo_items + fifo->item_size * fifo->head,
+            fifo->item_size * first_part);
+
+    memcpy(((char*) items) + fifo->item_size * first_part, fifo_items,
+            fifo->item_size * (count - first_part));
+
+    /* Advance past all removed items */
+    fifo->item_count -= count;
+    fifo->head = (fifo->head + count) % fifo->max_items;
+
+    /* Keep state flag up-to-date with respect to non-emptiness ... */
+    if (fifo->item_count == 0)
+        guac_flag_clear(&fifo->state, GUAC_FIFO_STATE_NONEMPTY);
+
+    /* ... and readiness for further items */
+    guac_flag_set(&fifo->state, GUAC_FIFO_STATE_READY);
+
+    return count;
+
+}
+
 int guac_fifo_timed_dequeue_and_lock(guac_fifo* fifo,
         void* item, int msec_timeout) {
 
@@ -30,11 +30,13 @@
 #include "client-types.h"
 #include "client-constants.h"
 #include "layer-types.h"
+#include "metrics-types.h"
 #include "object-types.h"
 #include "pool-types.h"
 #include "rwlock.h"
 #include "socket-types.h"
 #include "stream-types.h"
+#include "timer-types.h"
 #include "timestamp-types.h"
 #include "user-fntypes.h"
 #include "user-types.h"
@@ -182,25 +184,16 @@ struct guac_client {
 
     /**
      * Lock which is acquired when the pending users list is being manipulated,
-     * or iterated, or when checking/altering the
-     * __pending_users_thread_started flag.
+     * or iterated.
      */
     guac_rwlock __pending_users_lock;
 
     /**
-     * A timer that will periodically synchronize the list of pending users,
-     * emptying the list once synchronization is complete. Only for internal
-     * use within the client. This will be NULL until the first user joins
-     * the connection, as it is lazily instantiated at that time.
+     * A timer that synchronizes the list of pending users, emptying the list
+     * once synchronization is complete. This timer is scheduled each time a
+     * user joins the connection. Only for internal use within the client.
      */
-    pthread_t __pending_users_thread;
-
-    /**
-     * Whether the pending users thread has started for this guac_client. The
-     * __pending_users_lock must be acquired before checking or altering this
-     * value.
-     */
-    int __pending_users_thread_started;
+    guac_timer* __pending_users_timer;
 
     /**
      * The first user within the list of connected users who have not yet had
@@ -311,6 +304,14 @@ struct guac_client {
      */
     void* __plugin_handle;
 
+    /**
+     * Performance counters for this connection, or NULL if performance
+     * counters are not being tracked. This is not assigned by libguac, but
+     * may be assigned by the process hosting the connection (such as guacd)
+     * to a guac_metrics that is initialized and read by that process.
+     */
+    guac_metrics* metrics;
+
 };
 
 /**
@@ -49,6 +49,13 @@
  */
 #define GUAC_DISPLAY_LAYER_RAW_BPP 4
 
+/**
+ * The default approximate amount of memory, in bytes, that each client may
+ * use to cache recently-sent graphical content for reuse, as may be
+ * overridden with guac_display_set_cache_size().
+ */
+#define GUAC_DISPLAY_DEFAULT_CACHE_SIZE (16 * 1024 * 1024)
+
 /**
  * @}
  */
@@ -251,6 +251,12 @@ void guac_display_free(guac_display* display);
  * new users join a particular guac_client, this function should be used to
  * synchronize those users with the current display state.
  *
+ * The display state is copied and then encoded in parallel, with rendering
+ * for established users continuing while encoding is in progress. Any changes
+ * made by frames rendered in the meantime are sent before this function
+ * returns, such that the users at the other end of the given socket are fully
+ * in sync with the most recent frame.
+ *
  * @param display
  *     The display that should be synchronized to all users at the other end of
  *     the given guac_socket.
@@ -476,6 +482,26 @@ void guac_display_set_cursor(guac_display* display,
  */
 void guac_display_set_cursor_hotspot(guac_display* display, int x, int y);
 
+/**
+ * Sets the approximate amount of memory, in bytes, that each connected client
+ * may use to cache recently-sent graphical content. Cached content is stored
+ * within client-side off-screen buffers, allowing content that recurs after
+ * having been replaced (such as a window that is switched away from and back)
+ * to be drawn with simple copies rather than being sent again. An equal amount
+ * of memory is used within guacd to verify that cached content matches. By
+ * default, GUAC_DISPLAY_DEFAULT_CACHE_SIZE bytes may be used. The new size
+ * takes effect when the next frame is flushed, at which point any content
+ * already cached is discarded.
+ *
+ * @param display
+ *     The guac_display to set the cache size of.
+ *
+ * @param size
+ *     The approximate amount of memory that each connected client may use
+ *     for cached content, in bytes, or zero to disable caching.
+ */
+void guac_display_set_cache_size(guac_display* display, size_t size);
+
 /**
  * Stores the current bounding rectangle of the given layer in the given
  * guac_rect. The boundary stored will be the boundary of the current pending
@@ -741,6 +767,57 @@ guac_display_layer_cairo_context* guac_display_layer_open_cairo(guac_display_lay
  */
 void guac_display_layer_close_cairo(guac_display_layer* layer, guac_display_layer_cairo_context* context);
 
+/**
+ * Hints that the given rectangle of the given layer has been filled with a
+ * single color as part of the current pending frame. Where the hint proves
+ * accurate, the region will be sent to connected clients as a simple
+ * rectangle without searching the image data of the layer for such
+ * optimizations. Inaccurate hints are harmless, and cause the last frame of
+ * the layer to be searched for the content drawn instead.
+ *
+ * Hints are provided in addition to, not in place of, drawing the change
+ * itself. The region must still be drawn to the layer and marked as dirty
+ * through a raw or Cairo context.
+ *
+ * @param layer
+ *     The layer that was drawn to.
+ *
+ * @param dst
+ *     The rectangular area that was filled.
+ *
+ * @param color
+ *     The color that the area was filled with, in ARGB format.
+ */
+void guac_display_layer_hint_fill(guac_display_layer* layer,
+        const guac_rect* dst, uint32_t color);
+
+/**
+ * Hints that the given rectangle of the given layer has been replaced with a
+ * copy of another rectangle of the same layer, as that rectangle appeared in
+ * the last frame. Where the hint proves accurate, the region will be sent to
+ * connected clients as a copy without searching the image data of the layer
+ * for such optimizations. Inaccurate hints are harmless, and cause the last
+ * frame of the layer to be searched for the content drawn instead.
+ *
+ * Hints are provided in addition to, not in place of, drawing the change
+ * itself. The region must still be drawn to the layer and marked as dirty
+ * through a raw or Cairo context.
+ *
+ * @param layer
+ *     The layer that was drawn to.
+ *
+ * @param dst
+ *     The rectangular area that was replaced with copied data.
+ *
+ * @param src_x
+ *     The X coordinate of the upper-left corner of the area copied.
+ *
+ * @param src_y
+ *     The Y coordinate of the upper-left corner of the area copied.
+ */
+void guac_display_layer_hint_copy(guac_display_layer* layer,
+        const guac_rect* dst, int src_x, int src_y);
+
 /**
  * Creates and starts a rendering thread for the given guac_display. The
  * returned thread must eventually be freed with a call to
@@ -795,6 +872,28 @@ void guac_display_render_thread_notify_modified(guac_display_render_thread* rend
  */
 void guac_display_render_thread_notify_frame(guac_display_render_thread* render_thread);
 
+/**
+ * Waits no longer than the given number of milliseconds for the given render
+ * thread to finish flushing all frames explicitly marked with
+ * guac_display_render_thread_notify_frame(). As the render thread delays
+ * flushing frames to compensate for client-side processing lag, this allows
+ * protocol implementations to avoid requesting or decoding further updates
+ * from the remote desktop server until connected clients are able to receive
+ * them.
+ *
+ * @param render_thread
+ *     The render thread to wait for.
+ *
+ * @param msec_timeout
+ *     The maximum number of milliseconds to wait.
+ *
+ * @return
+ *     Non-zero if all explicitly marked frames have been flushed, zero if
+ *     the time limit elapsed before all such frames were flushed.
+ */
+int guac_display_render_thread_wait_for_idle(guac_display_render_thread* render_thread,
+        int msec_timeout);
+
 /**
  * Notifies the given render thread that a specific user has changed the state
  * of the mouse, such as through moving the pointer or pressing/releasing a
@@ -109,6 +109,28 @@ struct guac_fifo {
 void guac_fifo_init(guac_fifo* fifo, void* items,
         size_t max_items, size_t item_size);
 
+/**
+ * Moves all items currently within the given FIFO into new storage, which
+ * the FIFO will use for all further items. The previous storage is no longer
+ * referenced by the FIFO after this function returns and may be freed. This
+ * allows FIFOs to start small and grow as needed. The FIFO MUST already be
+ * locked by the current thread.
+ *
+ * @param fifo
+ *     The FIFO to relocate.
+ *
+ * @param items
+ *     The storage that the base implementation should use for queued items.
+ *     This storage MUST be large enough to contain the maximum number of items
+ *     as a contiguous array.
+ *
+ * @param max_items
+ *     The maximum number of items supported by the provided storage. This
+ *     value MUST NOT be less than the number of items currently within the
+ *     FIFO.
+ */
+void guac_fifo_relocate(guac_fifo* fifo, void* items, size_t max_items);
+
 /**
  * Releases all underlying resources used by the given guac_fifo, such as
  * pthread mutexes and conditions. The given guac_fifo MAY NOT be used after
@@ -256,6 +278,55 @@ int guac_fifo_dequeue(guac_fifo* fifo, void* item);
  */
 int guac_fifo_dequeue_and_lock(guac_fifo* fifo, void* item);
 
+/**
+ * Removes up to the given number of the oldest items from the FIFO, storing
+ * copies of those items within the provided array. Only a single lock
+ * acquisition is required regardless of the number of items removed. If the
+ * FIFO is currently empty, this function will block until at least one item
+ * has been added to the FIFO or until the FIFO becomes invalid.
+ *
+ * @param fifo
+ *     The FIFO to remove items from.
+ *
+ * @param items
+ *     The array that should receive copies of the removed items, in order.
+ *     This array must be large enough to contain max_items items.
+ *
+ * @param max_items
+ *     The maximum number of items to remove.
+ *
+ * @return
+ *     The number of items removed, or zero if items cannot be removed from
+ *     the FIFO because the FIFO has been invalidated.
+ */
+size_t guac_fifo_dequeue_multiple(guac_fifo* fifo, void* items,
+        size_t max_items);
+
+/**
+ * Atomically removes up to the given number of the oldest items from the
+ * FIFO, storing copies of those items within the provided array. If this
+ * function successfully removes any items, the FIFO is left locked after this
+ * function returns. If the FIFO is currently empty, this function will block
+ * until at least one item has been added to the FIFO or until the FIFO
+ * becomes invalid.
+ *
+ * @param fifo
+ *     The FIFO to remove items from.
+ *
+ * @param items
+ *     The array that should receive copies of the removed items, in order.
+ *     This array must be large enough to contain max_items items.
+ *
+ * @param max_items
+ *     The maximum number of items to remove.
+ *
+ * @return
+ *     The number of items removed, or zero if items cannot be removed from
+ *     the FIFO because the FIFO has been invalidated.
+ */
+size_t guac_fifo_dequeue_multiple_and_lock(guac_fifo* fifo, void* items,
+        size_t max_items);
+
 /**
  * Removes the oldest (first) item from the FIFO, storing a copy of that item
  * within the provided buffer. If the FIFO is currently empty, this function
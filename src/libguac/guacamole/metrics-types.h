@@ -0,0 +1,42 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_METRICS_TYPES_H
+#define GUAC_METRICS_TYPES_H
+
+/**
+ * Type definitions related to per-connection performance metrics.
+ *
+ * @file metrics-types.h
+ */
+
+/**
+ * Performance counters describing a single connection. These counters may be
+ * safely included in shared memory, such that they can be read by a process
+ * other than the process handling the connection.
+ */
+typedef struct guac_metrics guac_metrics;
+
+/**
+ * Performance counters describing a single user of a connection.
+ */
+typedef struct guac_metrics_user guac_metrics_user;
+
+#endif
+
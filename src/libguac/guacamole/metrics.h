@@ -0,0 +1,289 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_METRICS_H
+#define GUAC_METRICS_H
+
+/**
+ * Provides counters for tracking the performance of a connection. All
+ * counters are updated atomically, and are safe to be placed in shared memory
+ * and read from other processes while being updated.
+ *
+ * @defgroup metrics guac_metrics
+ * @{
+ */
+
+/**
+ * @file metrics.h
+ */
+
+#include "metrics-types.h"
+
+#include <stdint.h>
+
+/**
+ * The maximum number of concurrent users of a single connection that may be
+ * tracked individually. Users beyond this limit still contribute to the
+ * overall connection counters.
+ */
+#define GUAC_METRICS_MAX_USERS 64
+
+/**
+ * The number of bytes to allocate for each stored user ID, including the
+ * null terminator. Longer user IDs are truncated.
+ */
+#define GUAC_METRICS_USER_ID_SIZE 64
+
+/**
+ * The state of a guac_metrics_user slot that is not associated with any user.
+ */
+#define GUAC_METRICS_USER_FREE 0
+
+/**
+ * The state of a guac_metrics_user slot that has been claimed for a user but
+ * whose user ID is still being populated.
+ */
+#define GUAC_METRICS_USER_CLAIMED 1
+
+/**
+ * The state of a guac_metrics_user slot that is associated with a connected
+ * user, and may be read.
+ */
+#define GUAC_METRICS_USER_ACTIVE 2
+
+/**
+ * The number of phases of frame planning whose durations are tracked
+ * individually. In order, these phases are drafting the plan, rewriting the
+ * plan as scrolls and rectangles, searching for copies and cached cells,
+ * combining operations, and committing the frame.
+ */
+#define GUAC_METRICS_PLAN_PHASES 5
+
+/**
+ * The image encodings for which encoding time is tracked.
+ */
+typedef enum guac_metrics_encoding {
+
+    /**
+     * Lossless PNG encoding.
+     */
+    GUAC_METRICS_ENCODING_PNG,
+
+    /**
+     * Lossy JPEG encoding.
+     */
+    GUAC_METRICS_ENCODING_JPEG,
+
+    /**
+     * WebP encoding, either lossy or lossless.
+     */
+    GUAC_METRICS_ENCODING_WEBP,
+
+    /**
+     * Inter-frame video encoding (H.264 or VP8), as used for regions of the
+     * display that are updated continuously.
+     */
+    GUAC_METRICS_ENCODING_VIDEO,
+
+    /**
+     * The total number of distinct encodings. This is not itself a valid
+     * encoding.
+     */
+    GUAC_METRICS_ENCODINGS
+
+} guac_metrics_encoding;
+
+struct guac_metrics_user {
+
+    /**
+     * The state of this slot: GUAC_METRICS_USER_FREE,
+     * GUAC_METRICS_USER_CLAIMED, or GUAC_METRICS_USER_ACTIVE. Other members
+     * of this structure should only be read if the state is
+     * GUAC_METRICS_USER_ACTIVE.
+     */
+    int state;
+
+    /**
+     * The unique ID of the user, as assigned by guac_user_alloc().
+     */
+    char user_id[GUAC_METRICS_USER_ID_SIZE];
+
+    /**
+     * The total number of bytes sent to the user.
+     */
+    uint64_t bytes_sent;
+
+};
+
+struct guac_metrics {
+
+    /**
+     * The total number of frames flushed to connected users by guac_display.
+     */
+    uint64_t frames;
+
+    /**
+     * The total number of times rendering of a frame by guac_display was
+     * deferred because the previous frame was still being encoded.
+     */
+    uint64_t frames_deferred;
+
+    /**
+     * The total number of frames that were combined into subsequent frames
+     * rather than being flushed individually, typically due to deferral.
+     */
+    uint64_t frames_combined;
+
+    /**
+     * The total amount of time spent planning the contents of frames, in
+     * microseconds, where each element corresponds to a phase of frame
+     * planning (see GUAC_METRICS_PLAN_PHASES).
+     */
+    uint64_t plan_usec[GUAC_METRICS_PLAN_PHASES];
+
+    /**
+     * The total amount of time spent encoding images, in microseconds, where
+     * each element corresponds to the guac_metrics_encoding of the same
+     * value.
+     */
+    uint64_t encode_usec[GUAC_METRICS_ENCODINGS];
+
+    /**
+     * The total number of images encoded, where each element corresponds to
+     * the guac_metrics_encoding of the same value.
+     */
+    uint64_t encode_count[GUAC_METRICS_ENCODINGS];
+
+    /**
+     * The total number of pixels encoded, where each element corresponds to
+     * the guac_metrics_encoding of the same value.
+     */
+    uint64_t encode_pixels[GUAC_METRICS_ENCODINGS];
+
+    /**
+     * The total number of input events (mouse, keyboard, and touch) received
+     * from all users.
+     */
+    uint64_t input_events;
+
+    /**
+     * The most recently measured processing lag of the connection, in
+     * milliseconds, as would be returned by guac_client_get_processing_lag().
+     */
+    uint64_t processing_lag;
+
+    /**
+     * The total number of bytes sent to all users, including users that
+     * have since left the connection.
+     */
+    uint64_t bytes_sent;
+
+    /**
+     * Per-user counters for each connected user.
+     */
+    guac_metrics_user users[GUAC_METRICS_MAX_USERS];
+
+};
+
+/**
+ * Resets all counters within the given guac_metrics to zero and marks all
+ * per-user slots as free.
+ *
+ * @param metrics
+ *     The guac_metrics to initialize.
+ */
+void guac_metrics_init(guac_metrics* metrics);
+
+/**
+ * Atomically adds the given value to the given counter.
+ *
+ * @param counter
+ *     The counter to increase.
+ *
+ * @param value
+ *     The value to add.
+ */
+void guac_metrics_add(uint64_t* counter, uint64_t value);
+
+/**
+ * Atomically replaces the value of the given counter.
+ *
+ * @param counter
+ *     The counter to update.
+ *
+ * @param value
+ *     The new value of the counter.
+ */
+void guac_metrics_set(uint64_t* counter, uint64_t value);
+
+/**
+ * Atomically reads the current value of the given counter.
+ *
+ * @param counter
+ *     The counter to read.
+ *
+ * @return
+ *     The current value of the counter.
+ */
+uint64_t guac_metrics_get(const uint64_t* counter);
+
+/**
+ * Claims a free per-user slot within the given guac_metrics for the user
+ * having the given ID. The slot must be released with
+ * guac_metrics_user_release() when the user leaves.
+ *
+ * @param metrics
+ *     The guac_metrics containing the per-user slots.
+ *
+ * @param user_id
+ *     The unique ID of the user.
+ *
+ * @return
+ *     The claimed slot, or NULL if all slots are in use.
+ */
+guac_metrics_user* guac_metrics_user_claim(guac_metrics* metrics,
+        const char* user_id);
+
+/**
+ * Releases the given per-user slot, previously claimed with
+ * guac_metrics_user_claim(), such that it may be reused by another user.
+ *
+ * @param user
+ *     The slot to release.
+ */
+void guac_metrics_user_release(guac_metrics_user* user);
+
+/**
+ * Returns whether the given per-user slot is currently associated with a
+ * connected user, and thus may be read.
+ *
+ * @param user
+ *     The slot to test.
+ *
+ * @return
+ *     Non-zero if the slot is associated with a connected user, zero
+ *     otherwise.
+ */
+int guac_metrics_user_is_active(const guac_metrics_user* user);
+
+/**
+ * @}
+ */
+
+#endif
@@ -234,6 +234,23 @@ void guac_rect_shrink(guac_rect* rect, int max_width, int max_height);
  */
 int guac_rect_intersects(const guac_rect* a, const guac_rect* b);
 
+/**
+ * Returns whether the given outer rectangle wholly contains the given inner
+ * rectangle. An empty inner rectangle is contained only if it lies within the
+ * bounds of the outer rectangle.
+ *
+ * @param outer
+ *     The rectangle that may contain the other rectangle.
+ *
+ * @param inner
+ *     The rectangle that may be contained by the other rectangle.
+ *
+ * @return
+ *     Non-zero if the outer rectangle wholly contains the inner rectangle,
+ *     zero otherwise.
+ */
+int guac_rect_contains(const guac_rect* outer, const guac_rect* inner);
+
 /**
  * Returns whether the given rectangle is empty. A rectangle is empty if it has
  * no area (has an effective width or height of zero).
@@ -63,8 +63,13 @@ typedef struct guac_socket_ssl_data {
 } guac_socket_ssl_data;
 
 /**
- * Creates a new guac_socket which will use SSL for all communication. Freeing
- * this guac_socket will automatically close the associated file descriptor.
+ * Creates a new guac_socket which will use SSL for all communication. Data
+ * written to the guac_socket is buffered until flushed, with each flush
+ * sending the buffered data within as few TLS records as possible. If the
+ * given SSL_CTX has kernel TLS enabled (SSL_OP_ENABLE_KTLS) and the kernel
+ * supports it for the negotiated cipher, encryption of data sent after the
+ * handshake will automatically be performed by the kernel. Freeing this
+ * guac_socket will automatically close the associated file descriptor.
  *
  * @param context
  *     The SSL_CTX structure describing the desired SSL configuration.
@@ -27,9 +27,11 @@
  */
 
 #include "client-types.h"
+#include "metrics-types.h"
 #include "socket-constants.h"
 #include "socket-fntypes.h"
 #include "socket-types.h"
+#include "timer-types.h"
 #include "timestamp-types.h"
 
 #include <pthread.h>
@@ -109,14 +111,17 @@ struct guac_socket {
     char __encoded_buf[GUAC_SOCKET_BASE64_ENCODED_BUFFER_SIZE];
 
     /**
-     * Whether automatic keep-alive is enabled.
+     * The timer which periodically sends keep-alive pings, or NULL if
+     * automatic keep-alive is not enabled.
      */
-    int __keep_alive_enabled;
+    guac_timer* __keep_alive_timer;
 
     /**
-     * The keep-alive thread.
+     * The number of threads currently writing an instruction to or flushing
+     * this guac_socket. Keep-alive pings are only sent while this is zero,
+     * such that the keep-alive timer never waits on a blocked writer.
      */
-    pthread_t __keep_alive_thread;
+    int __writers;
 
 };
 
@@ -155,13 +160,32 @@ void guac_socket_require_keep_alive(guac_socket* socket);
 void guac_socket_instruction_begin(guac_socket* socket);
 
 /**
- * Marks the end of a Guacamole protocol instruction.
+ * Marks the end of a Guacamole protocol instruction. If the current thread
+ * has been buffering the instruction, the buffered instruction is written to
+ * the socket before this function returns. Any error while writing the
+ * buffered instruction is reflected in guac_error; use
+ * guac_socket_instruction_end_checked() to determine whether such an error
+ * occurred.
  *
  * @param socket
  *     The guac_socket ending an instruction.
  */
 void guac_socket_instruction_end(guac_socket* socket);
 
+/**
+ * Marks the end of a Guacamole protocol instruction, exactly as
+ * guac_socket_instruction_end() does, additionally returning whether any
+ * buffered instruction was successfully written to the socket.
+ *
+ * @param socket
+ *     The guac_socket ending an instruction.
+ *
+ * @return
+ *     Zero on success, or non-zero if an error occurs while writing the
+ *     buffered instruction, in which case guac_error is set appropriately.
+ */
+int guac_socket_instruction_end_checked(guac_socket* socket);
+
 /**
  * Allocates and initializes a new guac_socket object with the given open
  * file descriptor. The file descriptor will be automatically closed when
@@ -233,6 +257,32 @@ guac_socket* guac_socket_nest(guac_socket* parent, int index);
  */
 guac_socket* guac_socket_tee(guac_socket* primary, guac_socket* secondary);
 
+/**
+ * Allocates and initializes a new guac_socket which delegates all operations
+ * to the given guac_socket, counting the number of bytes written within the
+ * given guac_metrics. When the returned guac_socket is freed, the wrapped
+ * guac_socket is also freed. If an error occurs while allocating the
+ * guac_socket object, NULL is returned, and guac_error is set appropriately.
+ *
+ * @param socket
+ *     The guac_socket to which all socket operations should be delegated.
+ *
+ * @param metrics
+ *     The guac_metrics whose total count of bytes sent should be updated as
+ *     data is written.
+ *
+ * @param user
+ *     The per-user counters whose count of bytes sent should be updated as
+ *     data is written, or NULL if only the total count should be updated.
+ *
+ * @return
+ *     A newly allocated guac_socket object which delegates all operations to
+ *     the given guac_socket, or NULL if an error occurs while allocating the
+ *     guac_socket object.
+ */
+guac_socket* guac_socket_meter(guac_socket* socket, guac_metrics* metrics,
+        guac_metrics_user* user);
+
 /**
  * Allocates and initializes a new guac_socket which duplicates all
  * instructions written across the sockets of each connected user of the
@@ -0,0 +1,50 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_TIMER_FNTYPES_H
+#define GUAC_TIMER_FNTYPES_H
+
+/**
+ * @addtogroup timer
+ * @{
+ */
+
+/**
+ * Function type definitions related to the process-wide timer facility
+ * (guac_timer).
+ *
+ * @file timer-fntypes.h
+ */
+
+/**
+ * Callback which is invoked by the process-wide timer thread when a scheduled
+ * guac_timer elapses. As all timers within the process share the same
+ * thread, callbacks should return promptly.
+ *
+ * @param data
+ *     The arbitrary data provided when the timer was allocated.
+ */
+typedef void guac_timer_callback(void* data);
+
+/**
+ * @}
+ */
+
+#endif
+
@@ -0,0 +1,47 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_TIMER_TYPES_H
+#define GUAC_TIMER_TYPES_H
+
+/**
+ * @addtogroup timer
+ * @{
+ */
+
+/**
+ * Provides type definitions related to the process-wide timer facility
+ * (guac_timer).
+ *
+ * @file timer-types.h
+ */
+
+/**
+ * Opaque representation of a callback which is invoked by the process-wide
+ * timer thread after a given delay, and optionally repeated at a fixed
+ * interval thereafter.
+ */
+typedef struct guac_timer guac_timer;
+
+/**
+ * @}
+ */
+
+#endif
+
@@ -0,0 +1,107 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_TIMER_H
+#define GUAC_TIMER_H
+
+#include "timer-fntypes.h"
+#include "timer-types.h"
+
+/**
+ * Process-wide facility for invoking callbacks after a delay or at a regular
+ * interval. All timers within a process share a single thread, which is
+ * started automatically when a timer is first scheduled, and which sleeps
+ * until the next timer elapses or the set of scheduled timers changes.
+ *
+ * @defgroup timer guac_timer
+ * @{
+ */
+
+/**
+ * Provides a process-wide timer facility (guac_timer), allowing periodic or
+ * event-driven tasks to share a single thread rather than each requiring a
+ * dedicated thread that polls at a fixed interval.
+ *
+ * @file timer.h
+ */
+
+/**
+ * Allocates a new guac_timer which invokes the given callback when it
+ * elapses. The timer is not initially scheduled and will not elapse until
+ * guac_timer_schedule() is called.
+ *
+ * @param callback
+ *     The callback to invoke each time the timer elapses.
+ *
+ * @param data
+ *     Arbitrary data to pass to the callback.
+ *
+ * @return
+ *     A newly-allocated guac_timer, which must eventually be freed with
+ *     guac_timer_free().
+ */
+guac_timer* guac_timer_alloc(guac_timer_callback* callback, void* data);
+
+/**
+ * Schedules the given timer to elapse after the given delay, replacing any
+ * schedule previously set for that timer. If an interval is given, the timer
+ * will continue to elapse at that interval until cancelled. The timer's
+ * callback may safely reschedule or cancel the timer.
+ *
+ * @param timer
+ *     The timer to schedule.
+ *
+ * @param delay
+ *     The number of milliseconds to wait before the timer first elapses. If
+ *     zero, the timer will elapse as soon as possible.
+ *
+ * @param interval
+ *     The number of milliseconds between each subsequent time that the timer
+ *     elapses, or zero if the timer should elapse only once.
+ */
+void guac_timer_schedule(guac_timer* timer, int delay, int interval);
+
+/**
+ * Cancels any pending schedule of the given timer. If the timer's callback is
+ * currently running within the timer thread, this function blocks until that
+ * callback has returned, unless called from within the callback itself.
+ * Once this function returns, the callback will not be invoked again unless
+ * the timer is rescheduled.
+ *
+ * @param timer
+ *     The timer to cancel.
+ */
+void guac_timer_cancel(guac_timer* timer);
+
+/**
+ * Cancels the given timer as with guac_timer_cancel() and frees all
+ * associated resources. The timer MUST NOT be freed from within its own
+ * callback.
+ *
+ * @param timer
+ *     The timer to free.
+ */
+void guac_timer_free(guac_timer* timer);
+
+/**
+ * @}
+ */
+
+#endif
+
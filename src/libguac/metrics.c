@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "guacamole/metrics.h"
+#include "guacamole/string.h"
+
+#include <stdint.h>
+#include <string.h>
+
+void guac_metrics_init(guac_metrics* metrics) {
+    memset(metrics, 0, sizeof(guac_metrics));
+}
+
+void guac_metrics_add(uint64_t* counter, uint64_t value) {
+    __atomic_add_fetch(counter, value, __ATOMIC_RELAXED);
+}
+
+void guac_metrics_set(uint64_t* counter, uint64_t value) {
+    __atomic_store_n(counter, value, __ATOMIC_RELAXED);
+}
+
+uint64_t guac_metrics_get(const uint64_t* counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+guac_metrics_user* guac_metrics_user_claim(guac_metrics* metrics,
+        const char* user_id) {
+
+    for (int i = 0; i < GUAC_METRICS_MAX_USERS; i++) {
+
+        guac_metrics_user* user = &metrics->users[i];
+
+        /* Skip slots that are already in use */
+        int expected = GUAC_METRICS_USER_FREE;
+        if (!__atomic_compare_exchange_n(&user->state, &expected,
+                    GUAC_METRICS_USER_CLAIMED, 0, __ATOMIC_ACQUIRE,
+                    __ATOMIC_RELAXED))
+            continue;
+
+        guac_strlcpy(user->user_id, user_id, sizeof(user->user_id));
+        guac_metrics_set(&user->bytes_sent, 0);
+
+        /* Publish slot only after it has been fully populated */
+        __atomic_store_n(&user->state, GUAC_METRICS_USER_ACTIVE, __ATOMIC_RELEASE);
+        return user;
+
+    }
+
+    /* No free slots remain */
+    return NULL;
+
+}
+
+void guac_metrics_user_release(guac_metrics_user* user) {
+    __atomic_store_n(&user->state, GUAC_METRICS_USER_FREE, __ATOMIC_RELEASE);
+}
+
+int guac_metrics_user_is_active(const guac_metrics_user* user) {
+    return __atomic_load_n(&user->state, __ATOMIC_ACQUIRE)
+        == GUAC_METRICS_USER_ACTIVE;
+}
@@ -27,7 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-guac_palette* guac_palette_alloc(cairo_surface_t* surface) {
+int guac_palette_build(guac_palette* palette, cairo_surface_t* surface) {
 
     int x, y;
 
@@ -36,8 +36,11 @@ guac_palette* guac_palette_alloc(cairo_surface_t* surface) {
     int stride = cairo_image_surface_get_stride(surface);
     unsigned char* data = cairo_image_surface_get_data(surface);
 
-    /* Allocate palette */
-    guac_palette* palette = (guac_palette*) guac_mem_zalloc(sizeof(guac_palette));
+    /* Clear only the entries used by the previous contents of the palette */
+    for (int i = 0; i < palette->size; i++)
+        palette->entries[palette->slots[i]].index = 0;
+
+    palette->size = 0;
 
     for (y=0; y<height; y++) {
         for (x=0; x<width; x++) {
@@ -61,10 +64,8 @@ guac_palette* guac_palette_alloc(cairo_surface_t* surface) {
                     png_color* c;
 
                     /* Stop if already at capacity */
-                    if (palette->size == 256) {
-                        guac_palette_free(palette);
-                        return NULL;
-                    }
+                    if (palette->size == 256)
+                        return 1;
 
                     /* Store in palette */
                     c = &(palette->colors[palette->size]);
@@ -73,6 +74,7 @@ guac_palette* guac_palette_alloc(cairo_surface_t* surface) {
                     c->red   = (color >> 16) & 0xFF;
 
                     /* Add color to map */
+                    palette->slots[palette->size] = hash;
                     entry->index = ++palette->size;
                     entry->color = color;
 
@@ -95,6 +97,20 @@ guac_palette* guac_palette_alloc(cairo_surface_t* surface) {
 
     }
 
+    return 0;
+
+}
+
+guac_palette* guac_palette_alloc(cairo_surface_t* surface) {
+
+    /* Allocate palette */
+    guac_palette* palette = (guac_palette*) guac_mem_zalloc(sizeof(guac_palette));
+
+    if (guac_palette_build(palette, surface)) {
+        guac_palette_free(palette);
+        return NULL;
+    }
+
     return palette;
 
 }
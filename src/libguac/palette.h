@@ -36,9 +36,34 @@ typedef struct guac_palette {
     png_color colors[256];
     int size;
 
+    /**
+     * The index within entries of each color stored within the palette, such
+     * that only those entries need be cleared when the palette is rebuilt.
+     */
+    int slots[256];
+
 } guac_palette;
 
 guac_palette* guac_palette_alloc(cairo_surface_t* surface);
+
+/**
+ * Rebuilds the given palette such that it contains exactly the colors used
+ * within the given surface, reusing the storage of the palette rather than
+ * allocating a new one. The palette must have been allocated with
+ * guac_palette_alloc() or initialized to all zeroes.
+ *
+ * @param palette
+ *     The palette to rebuild.
+ *
+ * @param surface
+ *     The surface whose colors should be stored within the palette.
+ *
+ * @return
+ *     Zero if the palette was rebuilt successfully, non-zero if the surface
+ *     contains more than 256 colors and cannot be represented by a palette.
+ */
+int guac_palette_build(guac_palette* palette, cairo_surface_t* surface);
+
 int guac_palette_find(guac_palette* palette, int color);
 void guac_palette_free(guac_palette* palette);
 
@@ -26,6 +26,7 @@
 #include "guacamole/stream.h"
 #include "guacamole/unicode.h"
 #include "palette.h"
+#include "socket-priv.h"
 
 #include <cairo/cairo.h>
 
@@ -80,9 +81,19 @@ ssize_t __guac_socket_write_length_string(guac_socket* socket, const char* str)
 
 ssize_t __guac_socket_write_length_int(guac_socket* socket, int64_t i) {
 
-    char buffer[128];
-    snprintf(buffer, sizeof(buffer), "%"PRIi64, i);
-    return __guac_socket_write_length_string(socket, buffer);
+    char value[GUAC_SOCKET_INT_MAX_LENGTH];
+    int value_length = guac_socket_format_int(value, i);
+
+    /* Decimal integers are pure ASCII, thus the length of the value in
+     * characters is simply its length in bytes */
+    char buffer[GUAC_SOCKET_INT_MAX_LENGTH * 2 + 1];
+    int length = guac_socket_format_int(buffer, value_length);
+    buffer[length++] = '.';
+
+    memcpy(buffer + length, value, value_length);
+    length += value_length;
+
+    return guac_socket_write(socket, buffer, length);
 
 }
 
@@ -143,7 +154,7 @@ int guac_protocol_send_ack(guac_socket* socket, guac_stream* stream,
         || __guac_socket_write_length_int(socket, status)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -170,7 +181,7 @@ int guac_protocol_send_args(guac_socket* socket, const char** args) {
 
     guac_socket_instruction_begin(socket);
     ret_val = __guac_protocol_send_args(socket, args);
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
 
     return ret_val;
 
@@ -191,7 +202,7 @@ int guac_protocol_send_argv(guac_socket* socket, guac_stream* stream,
         || __guac_socket_write_length_string(socket, name)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -219,7 +230,7 @@ int guac_protocol_send_arc(guac_socket* socket, const guac_layer* layer,
         || guac_socket_write_string(socket, ",")
         || guac_socket_write_string(socket, negative ? "1.1" : "1.0")
         || guac_socket_write_string(socket, ";");
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
 
     return ret_val;
 
@@ -237,7 +248,7 @@ int guac_protocol_send_audio(guac_socket* socket, const guac_stream* stream,
         || guac_socket_write_string(socket, ",")
         || __guac_socket_write_length_string(socket, mimetype)
         || guac_socket_write_string(socket, ";");
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
 
     return ret_val;
 
@@ -261,7 +272,7 @@ int guac_protocol_send_blob(guac_socket* socket, const guac_stream* stream,
         || guac_socket_flush_base64(socket)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -310,7 +321,7 @@ int guac_protocol_send_body(guac_socket* socket, const guac_object* object,
         || __guac_socket_write_length_string(socket, name)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -337,7 +348,7 @@ int guac_protocol_send_cfill(guac_socket* socket,
         || __guac_socket_write_length_int(socket, a)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -352,7 +363,7 @@ int guac_protocol_send_close(guac_socket* socket, const guac_layer* layer) {
         || __guac_socket_write_length_int(socket, layer->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -375,7 +386,7 @@ int guac_protocol_send_connect(guac_socket* socket, const char** args) {
 
     guac_socket_instruction_begin(socket);
     ret_val = __guac_protocol_send_connect(socket, args);
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
 
     return ret_val;
 
@@ -391,7 +402,7 @@ int guac_protocol_send_clip(guac_socket* socket, const guac_layer* layer) {
         || __guac_socket_write_length_int(socket, layer->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -409,7 +420,7 @@ int guac_protocol_send_clipboard(guac_socket* socket, const guac_stream* stream,
         || __guac_socket_write_length_string(socket, mimetype)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -442,7 +453,7 @@ int guac_protocol_send_copy(guac_socket* socket,
         || __guac_socket_write_length_int(socket, dsty)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -476,7 +487,7 @@ int guac_protocol_send_cstroke(guac_socket* socket,
         || __guac_socket_write_length_int(socket, a)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -503,7 +514,7 @@ int guac_protocol_send_cursor(guac_socket* socket, int x, int y,
         || __guac_socket_write_length_int(socket, h)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -531,7 +542,7 @@ int guac_protocol_send_curve(guac_socket* socket, const guac_layer* layer,
         || __guac_socket_write_length_int(socket, y)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -541,7 +552,7 @@ int guac_protocol_send_disconnect(guac_socket* socket) {
 
     guac_socket_instruction_begin(socket);
     ret_val = guac_socket_write_string(socket, "10.disconnect;");
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -556,7 +567,7 @@ int guac_protocol_send_dispose(guac_socket* socket, const guac_layer* layer) {
         || __guac_socket_write_length_int(socket, layer->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -585,7 +596,7 @@ int guac_protocol_send_distort(guac_socket* socket, const guac_layer* layer,
         || __guac_socket_write_length_double(socket, f)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -600,7 +611,7 @@ int guac_protocol_send_end(guac_socket* socket, const guac_stream* stream) {
         || __guac_socket_write_length_int(socket, stream->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -618,7 +629,7 @@ int guac_protocol_send_error(guac_socket* socket, const char* error,
         || __guac_socket_write_length_int(socket, status)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -639,7 +650,7 @@ int vguac_protocol_send_log(guac_socket* socket, const char* format,
         || __guac_socket_write_length_string(socket, message)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -669,7 +680,7 @@ int guac_protocol_send_msg(guac_socket* socket, guac_message_type msg,
         || guac_socket_write_array(socket, args)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -689,7 +700,7 @@ int guac_protocol_send_file(guac_socket* socket, const guac_stream* stream,
         || __guac_socket_write_length_string(socket, name)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -707,7 +718,7 @@ int guac_protocol_send_filesystem(guac_socket* socket,
         || __guac_socket_write_length_string(socket, name)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -722,7 +733,7 @@ int guac_protocol_send_identity(guac_socket* socket, const guac_layer* layer) {
         || __guac_socket_write_length_int(socket, layer->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -740,7 +751,7 @@ int guac_protocol_send_key(guac_socket* socket, int keysym, int pressed,
         || __guac_socket_write_length_int(socket, timestamp)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -761,7 +772,7 @@ int guac_protocol_send_lfill(guac_socket* socket,
         || __guac_socket_write_length_int(socket, srcl->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -781,7 +792,7 @@ int guac_protocol_send_line(guac_socket* socket, const guac_layer* layer,
         || __guac_socket_write_length_int(socket, y)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -809,7 +820,7 @@ int guac_protocol_send_lstroke(guac_socket* socket,
         || __guac_socket_write_length_int(socket, srcl->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -831,7 +842,7 @@ int guac_protocol_send_mouse(guac_socket* socket, int x, int y,
         || __guac_socket_write_length_int(socket, timestamp)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -862,7 +873,7 @@ int guac_protocol_send_touch(guac_socket* socket, int id, int x, int y,
         || __guac_socket_write_length_int(socket, timestamp)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -886,7 +897,7 @@ int guac_protocol_send_move(guac_socket* socket, const guac_layer* layer,
         || __guac_socket_write_length_int(socket, z)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -901,7 +912,7 @@ int guac_protocol_send_name(guac_socket* socket, const char* name) {
         || __guac_socket_write_length_string(socket, name)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -919,7 +930,7 @@ int guac_protocol_send_nest(guac_socket* socket, int index,
         || __guac_socket_write_length_string(socket, data)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -930,7 +941,7 @@ int guac_protocol_send_nop(guac_socket* socket) {
 
     guac_socket_instruction_begin(socket);
     ret_val = guac_socket_write_string(socket, "3.nop;");
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
 
     return ret_val;
 
@@ -951,7 +962,7 @@ int guac_protocol_send_pipe(guac_socket* socket, const guac_stream* stream,
         || __guac_socket_write_length_string(socket, name)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -978,7 +989,7 @@ int guac_protocol_send_img(guac_socket* socket, const guac_stream* stream,
         || __guac_socket_write_length_int(socket, y)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -993,7 +1004,7 @@ int guac_protocol_send_pop(guac_socket* socket, const guac_layer* layer) {
         || __guac_socket_write_length_int(socket, layer->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1008,7 +1019,7 @@ int guac_protocol_send_push(guac_socket* socket, const guac_layer* layer) {
         || __guac_socket_write_length_int(socket, layer->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1023,7 +1034,7 @@ int guac_protocol_send_ready(guac_socket* socket, const char* id) {
         || __guac_socket_write_length_string(socket, id)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1047,7 +1058,7 @@ int guac_protocol_send_rect(guac_socket* socket,
         || __guac_socket_write_length_int(socket, height)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1063,7 +1074,7 @@ int guac_protocol_send_required(guac_socket* socket, const char** required) {
         || guac_socket_write_string(socket, ";")
         || guac_socket_flush(socket);
     
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
 
     return ret_val;
     
@@ -1079,7 +1090,7 @@ int guac_protocol_send_reset(guac_socket* socket, const guac_layer* layer) {
         || __guac_socket_write_length_int(socket, layer->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1099,7 +1110,7 @@ int guac_protocol_send_set(guac_socket* socket, const guac_layer* layer,
         || __guac_socket_write_length_string(socket, value)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1119,7 +1130,7 @@ int guac_protocol_send_set_int(guac_socket* socket, const guac_layer* layer,
         || __guac_socket_write_length_int(socket, value)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1134,7 +1145,7 @@ int guac_protocol_send_select(guac_socket* socket, const char* protocol) {
         || __guac_socket_write_length_string(socket, protocol)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1152,7 +1163,7 @@ int guac_protocol_send_shade(guac_socket* socket, const guac_layer* layer,
         || __guac_socket_write_length_int(socket, a)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1172,7 +1183,7 @@ int guac_protocol_send_size(guac_socket* socket, const guac_layer* layer,
         || __guac_socket_write_length_int(socket, h)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1192,7 +1203,7 @@ int guac_protocol_send_start(guac_socket* socket, const guac_layer* layer,
         || __guac_socket_write_length_int(socket, y)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1210,7 +1221,7 @@ int guac_protocol_send_sync(guac_socket* socket, guac_timestamp timestamp,
         || __guac_socket_write_length_int(socket, frames)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1243,7 +1254,7 @@ int guac_protocol_send_transfer(guac_socket* socket,
         || __guac_socket_write_length_int(socket, dsty)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1272,7 +1283,7 @@ int guac_protocol_send_transform(guac_socket* socket, const guac_layer* layer,
         || __guac_socket_write_length_double(socket, f)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1288,7 +1299,7 @@ int guac_protocol_send_undefine(guac_socket* socket,
         || __guac_socket_write_length_int(socket, object->index)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1307,7 +1318,7 @@ int guac_protocol_send_video(guac_socket* socket, const guac_stream* stream,
         || guac_socket_write_string(socket, ",")
         || __guac_socket_write_length_string(socket, mimetype)
         || guac_socket_write_string(socket, ";");
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
 
     return ret_val;
 
@@ -1415,7 +1426,7 @@ int guac_protocol_send_usbdisconnect(guac_socket* socket,
         || __guac_socket_write_length_string(socket, device_id)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
@@ -1435,7 +1446,7 @@ int guac_protocol_send_usbdata(guac_socket* socket, const char* device_id,
         || __guac_socket_write_length_string(socket, data)
         || guac_socket_write_string(socket, ";");
 
-    guac_socket_instruction_end(socket);
+    ret_val = guac_socket_instruction_end_checked(socket) || ret_val;
     return ret_val;
 
 }
\ No newline at end of file
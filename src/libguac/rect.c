@@ -163,6 +163,13 @@ int guac_rect_intersects(const guac_rect* a, const guac_rect* b) {
 
 }
 
+int guac_rect_contains(const guac_rect* outer, const guac_rect* inner) {
+    return inner->left   >= outer->left
+        && inner->top    >= outer->top
+        && inner->right  <= outer->right
+        && inner->bottom <= outer->bottom;
+}
+
 int guac_rect_is_empty(const guac_rect* rect) {
     return rect->right <= rect->left || rect->bottom <= rect->top;
 }
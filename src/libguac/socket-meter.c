@@ -0,0 +1,241 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "guacamole/mem.h"
+#include "guacamole/metrics.h"
+#include "guacamole/socket.h"
+
+#include <stdlib.h>
+
+/**
+ * Data specific to the metered implementation of guac_socket.
+ */
+typedef struct guac_socket_meter_data {
+
+    /**
+     * The guac_socket to which all socket operations should be delegated.
+     */
+    guac_socket* socket;
+
+    /**
+     * The connection-wide counters to update as data is written.
+     */
+    guac_metrics* metrics;
+
+    /**
+     * The per-user counters to update as data is written, or NULL if no
+     * per-user counters are being updated.
+     */
+    guac_metrics_user* user;
+
+} guac_socket_meter_data;
+
+/**
+ * Callback function which delegates the read operation to the wrapped
+ * socket.
+ *
+ * @param socket
+ *     The metered socket to read from.
+ *
+ * @param buf
+ *     The buffer to read data into.
+ *
+ * @param count
+ *     The maximum number of bytes to read into the given buffer.
+ *
+ * @return
+ *     The value returned by guac_socket_read() when invoked on the wrapped
+ *     socket with the given parameters.
+ */
+static ssize_t __guac_socket_meter_read_handler(guac_socket* socket,
+        void* buf, size_t count) {
+
+    guac_socket_meter_data* data = (guac_socket_meter_data*) socket->data;
+
+    /* Delegate read to wrapped socket */
+    return guac_socket_read(data->socket, buf, count);
+
+}
+
+/**
+ * Callback function which writes the given data to the wrapped socket,
+ * counting the number of bytes written.
+ *
+ * @param socket
+ *     The metered socket to write through.
+ *
+ * @param buf
+ *     The buffer of data to write.
+ *
+ * @param count
+ *     The number of bytes in the buffer to be written.
+ *
+ * @return
+ *     The number of bytes written if the write was successful, or -1 if an
+ *     error occurs.
+ */
+static ssize_t __guac_socket_meter_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    guac_socket_meter_data* data = (guac_socket_meter_data*) socket->data;
+
+    /* Delegate write to wrapped socket */
+    if (guac_socket_write(data->socket, buf, count))
+        return -1;
+
+    /* Count only data that was successfully written */
+    guac_metrics_add(&data->metrics->bytes_sent, count);
+    if (data->user != NULL)
+        guac_metrics_add(&data->user->bytes_sent, count);
+
+    return count;
+
+}
+
+/**
+ * Callback function which delegates the flush operation to the wrapped
+ * socket.
+ *
+ * @param socket
+ *     The metered socket to flush.
+ *
+ * @return
+ *     The value returned by guac_socket_flush() when invoked on the wrapped
+ *     socket.
+ */
+static ssize_t __guac_socket_meter_flush_handler(guac_socket* socket) {
+
+    guac_socket_meter_data* data = (guac_socket_meter_data*) socket->data;
+
+    /* Delegate flush to wrapped socket */
+    return guac_socket_flush(data->socket);
+
+}
+
+/**
+ * Callback function which delegates the lock operation to the wrapped
+ * socket.
+ *
+ * @param socket
+ *     The metered socket on which guac_socket_instruction_begin() was
+ *     invoked.
+ */
+static void __guac_socket_meter_lock_handler(guac_socket* socket) {
+
+    guac_socket_meter_data* data = (guac_socket_meter_data*) socket->data;
+
+    /* Delegate lock to wrapped socket */
+    guac_socket_instruction_begin(data->socket);
+
+}
+
+/**
+ * Callback function which delegates the unlock operation to the wrapped
+ * socket.
+ *
+ * @param socket
+ *     The metered socket on which guac_socket_instruction_end() was invoked.
+ */
+static void __guac_socket_meter_unlock_handler(guac_socket* socket) {
+
+    guac_socket_meter_data* data = (guac_socket_meter_data*) socket->data;
+
+    /* Delegate unlock to wrapped socket */
+    guac_socket_instruction_end(data->socket);
+
+}
+
+/**
+ * Callback function which delegates the select operation to the wrapped
+ * socket.
+ *
+ * @param socket
+ *     The metered socket on which guac_socket_select() was invoked.
+ *
+ * @param usec_timeout
+ *     The timeout to specify when invoking guac_socket_select() on the
+ *     wrapped socket.
+ *
+ * @return
+ *     The value returned by guac_socket_select() when invoked with the
+ *     given parameters on the wrapped socket.
+ */
+static int __guac_socket_meter_select_handler(guac_socket* socket,
+        int usec_timeout) {
+
+    guac_socket_meter_data* data = (guac_socket_meter_data*) socket->data;
+
+    /* Delegate select to wrapped socket */
+    return guac_socket_select(data->socket, usec_timeout);
+
+}
+
+/**
+ * Callback function which frees all underlying data associated with the
+ * given metered socket, including the wrapped socket.
+ *
+ * @param socket
+ *     The metered socket being freed.
+ *
+ * @return
+ *     Always zero.
+ */
+static int __guac_socket_meter_free_handler(guac_socket* socket) {
+
+    guac_socket_meter_data* data = (guac_socket_meter_data*) socket->data;
+
+    /* Free wrapped socket */
+    guac_socket_free(data->socket);
+
+    /* Freeing the metered socket always succeeds */
+    guac_mem_free(data);
+    return 0;
+
+}
+
+guac_socket* guac_socket_meter(guac_socket* socket, guac_metrics* metrics,
+        guac_metrics_user* user) {
+
+    guac_socket_meter_data* data = guac_mem_alloc(sizeof(guac_socket_meter_data));
+    data->socket = socket;
+    data->metrics = metrics;
+    data->user = user;
+
+    /* Associate meter-specific data with new socket */
+    guac_socket* meter = guac_socket_alloc();
+    if (meter == NULL) {
+        guac_mem_free(data);
+        return NULL;
+    }
+
+    meter->data = data;
+
+    /* Assign handlers */
+    meter->read_handler   = __guac_socket_meter_read_handler;
+    meter->write_handler  = __guac_socket_meter_write_handler;
+    meter->select_handler = __guac_socket_meter_select_handler;
+    meter->flush_handler  = __guac_socket_meter_flush_handler;
+    meter->lock_handler   = __guac_socket_meter_lock_handler;
+    meter->unlock_handler = __guac_socket_meter_unlock_handler;
+    meter->free_handler   = __guac_socket_meter_free_handler;
+
+    return meter;
+
+}
+
@@ -0,0 +1,62 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_SOCKET_PRIV_H
+#define GUAC_SOCKET_PRIV_H
+
+#include <stdint.h>
+
+/**
+ * The maximum number of characters required to represent any signed 64-bit
+ * integer in decimal, including the leading minus sign of negative values but
+ * excluding any null terminator.
+ */
+#define GUAC_SOCKET_INT_MAX_LENGTH 20
+
+/**
+ * The number of bytes of each thread's instruction buffer. Instructions are
+ * accumulated within this buffer between calls to
+ * guac_socket_instruction_begin() and guac_socket_instruction_end() such that
+ * each instruction is handed to the underlying socket implementation with a
+ * single write. Instructions larger than this buffer are written in
+ * buffer-sized pieces.
+ */
+#define GUAC_SOCKET_INSTRUCTION_BUFFER_SIZE 8192
+
+/**
+ * Formats the given signed 64-bit integer in decimal, storing the resulting
+ * characters within the given buffer. This function is equivalent to
+ * snprintf() with the "%" PRIi64 format, except that the result is not
+ * null-terminated and the relatively expensive format string parsing of the
+ * printf() family is avoided.
+ *
+ * @param buffer
+ *     The buffer to store the formatted integer within. This buffer must be at
+ *     least GUAC_SOCKET_INT_MAX_LENGTH bytes long.
+ *
+ * @param value
+ *     The integer to format.
+ *
+ * @return
+ *     The number of characters stored within the buffer.
+ */
+int guac_socket_format_int(char* buffer, int64_t value);
+
+#endif
+
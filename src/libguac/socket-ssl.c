@@ -25,9 +25,50 @@
 
 #include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <openssl/ssl.h>
 
+/**
+ * The number of bytes to buffer within each SSL socket before flushing. This
+ * is the maximum amount of plaintext that may be sent within a single TLS
+ * record, such that each flush of a full buffer produces exactly one record.
+ */
+#define GUAC_SOCKET_SSL_OUTPUT_BUFFER_SIZE 16384
+
+/**
+ * The complete internal state of an SSL socket, including the output buffer,
+ * which is not part of the public guac_socket_ssl_data structure. As the
+ * public structure is the first member, the data of any SSL socket may still
+ * be treated as a guac_socket_ssl_data.
+ */
+typedef struct guac_socket_ssl_buffered_data {
+
+    /**
+     * The publicly-visible SSL socket data.
+     */
+    guac_socket_ssl_data base;
+
+    /**
+     * The number of bytes currently in the main write buffer.
+     */
+    int written;
+
+    /**
+     * The main write buffer. Bytes written go here before being flushed
+     * through the SSL connection, such that many small writes are sent within
+     * a single TLS record rather than each requiring its own.
+     */
+    char out_buf[GUAC_SOCKET_SSL_OUTPUT_BUFFER_SIZE];
+
+    /**
+     * Lock which protects access to the internal buffer of this socket,
+     * guaranteeing atomicity of writes and flushes.
+     */
+    pthread_mutex_t buffer_lock;
+
+} guac_socket_ssl_buffered_data;
+
 static ssize_t __guac_socket_ssl_read_handler(guac_socket* socket,
         void* buf, size_t count) {
 
@@ -47,25 +88,180 @@ static ssize_t __guac_socket_ssl_read_handler(guac_socket* socket,
 
 }
 
-static ssize_t __guac_socket_ssl_write_handler(guac_socket* socket,
+/**
+ * Writes the entire contents of the given buffer through the SSL connection
+ * associated with the given socket, retrying as necessary until the whole
+ * buffer is written, and aborting if an error occurs.
+ *
+ * @param socket
+ *     The guac_socket associated with the SSL connection to which the given
+ *     buffer should be written.
+ *
+ * @param buf
+ *     The buffer of data to write to the given guac_socket.
+ *
+ * @param count
+ *     The number of bytes within the given buffer.
+ *
+ * @return
+ *     Zero if the entire buffer was written successfully, non-zero if an
+ *     error occurs.
+ */
+static int __guac_socket_ssl_write(guac_socket* socket,
         const void* buf, size_t count) {
 
-    /* Write data to socket */
     guac_socket_ssl_data* data = (guac_socket_ssl_data*) socket->data;
-    int retval;
+    const char* buffer = buf;
 
-    retval = SSL_write(data->ssl, buf, count);
+    /* Write until completely written */
+    while (count > 0) {
+
+        int retval = SSL_write(data->ssl, buffer, count);
+
+        /* Record errors in guac_error */
+        if (retval <= 0) {
+            guac_error = GUAC_STATUS_SEE_ERRNO;
+            guac_error_message = "Error writing data to secure socket";
+            return 1;
+        }
+
+        /* Advance buffer to next chunk */
+        buffer += retval;
+        count  -= retval;
 
-    /* Record errors in guac_error */
-    if (retval <= 0) {
-        guac_error = GUAC_STATUS_SEE_ERRNO;
-        guac_error_message = "Error writing data to secure socket";
     }
 
+    return 0;
+
+}
+
+/**
+ * Flushes the contents of the output buffer of the given socket immediately,
+ * without first locking access to the output buffer. This function must ONLY
+ * be called if the buffer lock has already been acquired.
+ *
+ * @param socket
+ *     The guac_socket to flush.
+ *
+ * @return
+ *     Zero if the flush operation was successful, non-zero otherwise.
+ */
+static ssize_t __guac_socket_ssl_flush(guac_socket* socket) {
+
+    guac_socket_ssl_buffered_data* data = (guac_socket_ssl_buffered_data*) socket->data;
+
+    /* Flush remaining bytes in buffer */
+    if (data->written > 0) {
+
+        /* Write ALL bytes in buffer immediately */
+        if (__guac_socket_ssl_write(socket, data->out_buf, data->written))
+            return 1;
+
+        data->written = 0;
+    }
+
+    return 0;
+
+}
+
+/**
+ * Flushes the internal buffer of the given guac_socket, writing all data
+ * through the underlying SSL connection.
+ *
+ * @param socket
+ *     The guac_socket to flush.
+ *
+ * @return
+ *     Zero if the flush operation was successful, non-zero otherwise.
+ */
+static ssize_t __guac_socket_ssl_flush_handler(guac_socket* socket) {
+
+    int retval;
+    guac_socket_ssl_buffered_data* data = (guac_socket_ssl_buffered_data*) socket->data;
+
+    /* Acquire exclusive access to buffer */
+    pthread_mutex_lock(&(data->buffer_lock));
+
+    /* Flush contents of buffer */
+    retval = __guac_socket_ssl_flush(socket);
+
+    /* Relinquish exclusive access to buffer */
+    pthread_mutex_unlock(&(data->buffer_lock));
+
     return retval;
 
 }
 
+/**
+ * Appends the provided data to the internal buffer for future writing. The
+ * actual write attempt will occur only upon flush, or when the internal buffer
+ * is full, in which case the full buffer is sent as a single TLS record.
+ *
+ * @param socket
+ *     The guac_socket being write to.
+ *
+ * @param buf
+ *     The arbitrary buffer containing the data to be written.
+ *
+ * @param count
+ *     The number of bytes contained within the buffer.
+ *
+ * @return
+ *     The number of bytes written, or -1 if an error occurs.
+ */
+static ssize_t __guac_socket_ssl_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    size_t original_count = count;
+    const char* current = buf;
+    guac_socket_ssl_buffered_data* data = (guac_socket_ssl_buffered_data*) socket->data;
+
+    /* Acquire exclusive access to buffer */
+    pthread_mutex_lock(&(data->buffer_lock));
+
+    /* Append to buffer, flush if necessary */
+    while (count > 0) {
+
+        int chunk_size;
+        int remaining = sizeof(data->out_buf) - data->written;
+
+        /* If no space left in buffer, flush and retry */
+        if (remaining == 0) {
+
+            /* Abort if error occurs during flush */
+            if (__guac_socket_ssl_flush(socket)) {
+                pthread_mutex_unlock(&(data->buffer_lock));
+                return -1;
+            }
+
+            /* Retry buffer append */
+            continue;
+
+        }
+
+        /* Calculate size of chunk to be written to buffer */
+        chunk_size = count;
+        if (chunk_size > remaining)
+            chunk_size = remaining;
+
+        /* Update output buffer */
+        memcpy(data->out_buf + data->written, current, chunk_size);
+        data->written += chunk_size;
+
+        /* Update provided buffer */
+        current += chunk_size;
+        count   -= chunk_size;
+
+    }
+
+    /* Relinquish exclusive access to buffer */
+    pthread_mutex_unlock(&(data->buffer_lock));
+
+    /* All bytes have been written, possibly some to the internal buffer */
+    return original_count;
+
+}
+
 static int __guac_socket_ssl_select_handler(guac_socket* socket, int usec_timeout) {
 
     guac_socket_ssl_data* data = (guac_socket_ssl_data*) socket->data;
@@ -96,9 +292,13 @@ static int __guac_socket_ssl_free_handler(guac_socket* socket) {
     /* Close file descriptor */
     close(data->fd);
 
+    guac_socket_ssl_buffered_data* buffered_data =
+        (guac_socket_ssl_buffered_data*) data;
+
     pthread_mutex_destroy(&(data->socket_lock));
+    pthread_mutex_destroy(&(buffered_data->buffer_lock));
 
-    guac_mem_free(data);
+    guac_mem_free(buffered_data);
     return 0;
 }
 
@@ -141,7 +341,9 @@ guac_socket* guac_socket_open_secure(SSL_CTX* context, int fd) {
 
     /* Allocate socket and associated data */
     guac_socket* socket = guac_socket_alloc();
-    guac_socket_ssl_data* data = guac_mem_alloc(sizeof(guac_socket_ssl_data));
+    guac_socket_ssl_buffered_data* buffered_data =
+        guac_mem_alloc(sizeof(guac_socket_ssl_buffered_data));
+    guac_socket_ssl_data* data = &(buffered_data->base);
 
     /* Init SSL */
     data->context = context;
@@ -154,7 +356,7 @@ guac_socket* guac_socket_open_secure(SSL_CTX* context, int fd) {
         guac_error = GUAC_STATUS_INTERNAL_ERROR;
         guac_error_message = "SSL accept failed";
 
-        guac_mem_free(data);
+        guac_mem_free(buffered_data);
         guac_socket_free(socket);
         SSL_free(ssl);
         return NULL;
@@ -164,14 +366,17 @@ guac_socket* guac_socket_open_secure(SSL_CTX* context, int fd) {
     pthread_mutexattr_init(&lock_attributes);
     pthread_mutexattr_setpshared(&lock_attributes, PTHREAD_PROCESS_SHARED);
     pthread_mutex_init(&(data->socket_lock), &lock_attributes);
+    pthread_mutex_init(&(buffered_data->buffer_lock), &lock_attributes);
 
     /* Store file descriptor as socket data */
     data->fd = fd;
+    buffered_data->written = 0;
     socket->data = data;
 
     /* Set read/write handlers */
     socket->read_handler   = __guac_socket_ssl_read_handler;
     socket->write_handler  = __guac_socket_ssl_write_handler;
+    socket->flush_handler  = __guac_socket_ssl_flush_handler;
     socket->select_handler = __guac_socket_ssl_select_handler;
     socket->free_handler   = __guac_socket_ssl_free_handler;
     socket->lock_handler   = __guac_socket_ssl_lock_handler;
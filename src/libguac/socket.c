@@ -17,11 +17,12 @@
  * under the License.
  */
 
+#include "socket-priv.h"
 #include "guacamole/mem.h"
 #include "guacamole/error.h"
-#include "guacamole/proctitle.h"
 #include "guacamole/protocol.h"
 #include "guacamole/socket.h"
+#include "guacamole/timer.h"
 #include "guacamole/timestamp.h"
 
 #include <errno.h>
@@ -43,46 +44,175 @@ char __guac_socket_BASE64_CHARACTERS[64] = {
     '8', '9', '+', '/'
 };
 
-static void* __guac_socket_keep_alive_thread(void* data) {
+/**
+ * Per-thread buffer which receives all data written to a particular
+ * guac_socket while this thread is writing an instruction to that socket (ie:
+ * between calls to guac_socket_instruction_begin() and
+ * guac_socket_instruction_end()). Buffering instructions in this way allows
+ * each instruction to be handed to the underlying socket implementation with
+ * a single call to its write handler, rather than one call (and one
+ * acquisition of any locks taken by that handler) for each individual
+ * element.
+ */
+typedef struct guac_socket_instruction_buffer {
 
-    /* Thread name keep-alive: periodically sends keep-alive NOPs on an
-     * otherwise idle socket. */
-    guac_thread_name_set("keep-alive");
+    /**
+     * The socket that this thread is currently writing an instruction to, or
+     * NULL if no instruction is currently being buffered.
+     */
+    guac_socket* socket;
 
-    int old_cancelstate;
+    /**
+     * The number of outstanding calls to guac_socket_instruction_begin() for
+     * the socket associated with this buffer.
+     */
+    int depth;
 
-    /* Socket keep-alive loop */
-    guac_socket* socket = (guac_socket*) data;
-    while (socket->state == GUAC_SOCKET_OPEN) {
+    /**
+     * The number of bytes currently stored within the buffer.
+     */
+    size_t length;
 
-        /* Send NOP keep-alive if it's been a while since the last output */
-        guac_timestamp timestamp = guac_timestamp_current();
-        if (timestamp - socket->last_write_timestamp >
-                GUAC_SOCKET_KEEP_ALIVE_INTERVAL) {
+    /**
+     * The buffered instruction data that has not yet been written to the
+     * socket.
+     */
+    char buffer[GUAC_SOCKET_INSTRUCTION_BUFFER_SIZE];
 
-            /* Send NOP */
-            if (guac_protocol_send_nop(socket)
-                || guac_socket_flush(socket))
-                break;
+} guac_socket_instruction_buffer;
 
-        }
+/**
+ * The key used to store and retrieve the instruction buffer of the current
+ * thread.
+ */
+static pthread_key_t __guac_socket_instruction_buffer_key;
 
-        /* Calculate sleep interval every loop as nanosleep updates it
-           with the remaining time interval */
-        struct timespec interval;
-        interval.tv_sec  =  GUAC_SOCKET_KEEP_ALIVE_INTERVAL / 1000;
-        interval.tv_nsec = (GUAC_SOCKET_KEEP_ALIVE_INTERVAL % 1000) * 1000000L;
+/**
+ * Pthread once control object for initializing the instruction buffer key.
+ */
+static pthread_once_t __guac_socket_instruction_buffer_key_init =
+    PTHREAD_ONCE_INIT;
 
-        /* Sleep until next keep-alive check, but allow thread cancellation
-         * during that sleep */
-        int sleep_result;
-        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        GUAC_RETRY_EINTR(sleep_result, nanosleep(&interval, &interval));
-        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+/**
+ * Frees the given instruction buffer. This function is invoked automatically
+ * when the thread owning the buffer exits.
+ *
+ * @param data
+ *     The guac_socket_instruction_buffer to free.
+ */
+static void __guac_socket_free_instruction_buffer(void* data) {
+    guac_mem_free(data);
+}
+
+/**
+ * Creates the key used to store and retrieve the instruction buffer of each
+ * thread. This function is invoked only once, via pthread_once().
+ */
+static void __guac_socket_alloc_instruction_buffer_key(void) {
+    pthread_key_create(&__guac_socket_instruction_buffer_key,
+            __guac_socket_free_instruction_buffer);
+}
+
+/**
+ * Returns the instruction buffer of the current thread, allocating that
+ * buffer if necessary.
+ *
+ * @return
+ *     The instruction buffer of the current thread, or NULL if the buffer
+ *     could not be allocated.
+ */
+static guac_socket_instruction_buffer* __guac_socket_get_instruction_buffer(void) {
+
+    pthread_once(&__guac_socket_instruction_buffer_key_init,
+            __guac_socket_alloc_instruction_buffer_key);
+
+    guac_socket_instruction_buffer* instruction_buffer =
+        pthread_getspecific(__guac_socket_instruction_buffer_key);
+
+    /* Allocate buffer for current thread if not yet allocated */
+    if (instruction_buffer == NULL) {
+
+        instruction_buffer = guac_mem_alloc(sizeof(guac_socket_instruction_buffer));
+        if (instruction_buffer == NULL)
+            return NULL;
+
+        instruction_buffer->socket = NULL;
+        instruction_buffer->depth = 0;
+        instruction_buffer->length = 0;
+
+        pthread_setspecific(__guac_socket_instruction_buffer_key,
+                instruction_buffer);
 
     }
 
-    return NULL;
+    return instruction_buffer;
+
+}
+
+/**
+ * Returns the instruction buffer of the current thread if that buffer is
+ * currently accumulating an instruction for the given socket. Unlike
+ * __guac_socket_get_instruction_buffer(), this function never allocates a
+ * new buffer.
+ *
+ * @param socket
+ *     The socket that the returned buffer must be associated with.
+ *
+ * @return
+ *     The instruction buffer of the current thread, or NULL if the current
+ *     thread is not buffering an instruction for the given socket.
+ */
+static guac_socket_instruction_buffer* __guac_socket_get_bound_instruction_buffer(
+        guac_socket* socket) {
+
+    pthread_once(&__guac_socket_instruction_buffer_key_init,
+            __guac_socket_alloc_instruction_buffer_key);
+
+    guac_socket_instruction_buffer* instruction_buffer =
+        pthread_getspecific(__guac_socket_instruction_buffer_key);
+
+    if (instruction_buffer == NULL || instruction_buffer->socket != socket)
+        return NULL;
+
+    return instruction_buffer;
+
+}
+
+/**
+ * Callback invoked periodically by a guac_timer for each socket requiring
+ * keep-alive, sending a NOP if nothing has been written to the socket for
+ * GUAC_SOCKET_KEEP_ALIVE_INTERVAL milliseconds. As this callback runs on the
+ * process-wide timer thread, the NOP is skipped entirely if any other thread
+ * is currently writing to or flushing the socket, rather than waiting on a
+ * write that may be blocked by a slow connection. Keep-alive stops once the
+ * socket is closed or a NOP cannot be sent.
+ *
+ * @param data
+ *     The guac_socket requiring keep-alive.
+ */
+static void __guac_socket_keep_alive(void* data) {
+
+    guac_socket* socket = (guac_socket*) data;
+
+    /* Send NOP keep-alive if it's been a while since the last output */
+    guac_timestamp timestamp = guac_timestamp_current();
+    if (socket->state != GUAC_SOCKET_OPEN
+            || timestamp - socket->last_write_timestamp <=
+                GUAC_SOCKET_KEEP_ALIVE_INTERVAL)
+        return;
+
+    /* Do not wait on other writers (the socket is not idle anyway) */
+    int writers = 0;
+    if (!__atomic_compare_exchange_n(&socket->__writers, &writers, 1, 0,
+                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;
+
+    /* Send NOP, giving up on keep-alive entirely if that fails */
+    if (guac_protocol_send_nop(socket)
+        || guac_socket_flush(socket))
+        guac_timer_cancel(socket->__keep_alive_timer);
+
+    __atomic_sub_fetch(&socket->__writers, 1, __ATOMIC_RELEASE);
 
 }
 
@@ -101,7 +231,24 @@ static ssize_t __guac_socket_write(guac_socket* socket,
 
 }
 
-ssize_t guac_socket_write(guac_socket* socket,
+/**
+ * Writes the entire contents of the given buffer to the given socket,
+ * invoking the write handler of that socket as many times as necessary and
+ * bypassing any instruction buffer of the current thread.
+ *
+ * @param socket
+ *     The guac_socket to write the given buffer to.
+ *
+ * @param buf
+ *     The buffer to read from.
+ *
+ * @param count
+ *     The number of bytes to write.
+ *
+ * @return
+ *     Zero on success, or non-zero if an error occurs while writing.
+ */
+static ssize_t __guac_socket_write_fully(guac_socket* socket,
         const void* buf, size_t count) {
 
     const char* buffer = buf;
@@ -124,6 +271,62 @@ ssize_t guac_socket_write(guac_socket* socket,
 
 }
 
+/**
+ * Writes all data currently stored within the given instruction buffer to
+ * the socket associated with that buffer, leaving the buffer empty.
+ *
+ * @param instruction_buffer
+ *     The instruction buffer to flush.
+ *
+ * @return
+ *     Zero on success, or non-zero if an error occurs while writing.
+ */
+static ssize_t __guac_socket_flush_instruction_buffer(
+        guac_socket_instruction_buffer* instruction_buffer) {
+
+    size_t length = instruction_buffer->length;
+    if (length == 0)
+        return 0;
+
+    instruction_buffer->length = 0;
+    return __guac_socket_write_fully(instruction_buffer->socket,
+            instruction_buffer->buffer, length);
+
+}
+
+ssize_t guac_socket_write(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    /* Write directly if not within an instruction being buffered for this
+     * socket by the current thread */
+    guac_socket_instruction_buffer* instruction_buffer =
+        __guac_socket_get_bound_instruction_buffer(socket);
+
+    if (instruction_buffer == NULL)
+        return __guac_socket_write_fully(socket, buf, count);
+
+    /* Flush buffered data if there is insufficient space for the new data */
+    size_t available = sizeof(instruction_buffer->buffer)
+        - instruction_buffer->length;
+
+    if (count > available) {
+
+        if (__guac_socket_flush_instruction_buffer(instruction_buffer))
+            return 1;
+
+        /* Data which would not fit even within an empty buffer is written
+         * directly */
+        if (count > sizeof(instruction_buffer->buffer))
+            return __guac_socket_write_fully(socket, buf, count);
+
+    }
+
+    memcpy(instruction_buffer->buffer + instruction_buffer->length, buf, count);
+    instruction_buffer->length += count;
+    return 0;
+
+}
+
 ssize_t guac_socket_read(guac_socket* socket, void* buf, size_t count) {
 
     /* If handler defined, call it. */
@@ -163,7 +366,8 @@ guac_socket* guac_socket_alloc(void) {
     socket->last_write_timestamp = guac_timestamp_current();
 
     /* No keep alive ping by default */
-    socket->__keep_alive_enabled = 0;
+    socket->__keep_alive_timer = NULL;
+    socket->__writers = 0;
 
     /* No handlers yet */
     socket->read_handler   = NULL;
@@ -180,33 +384,87 @@ guac_socket* guac_socket_alloc(void) {
 
 void guac_socket_require_keep_alive(guac_socket* socket) {
 
-    /* Start keep-alive thread */
-    socket->__keep_alive_enabled = 1;
-    pthread_create(&(socket->__keep_alive_thread), NULL,
-                __guac_socket_keep_alive_thread, (void*) socket);
+    /* Check for idle output at the keep-alive interval using the
+     * process-wide timer thread */
+    socket->__keep_alive_timer = guac_timer_alloc(__guac_socket_keep_alive, socket);
+    guac_timer_schedule(socket->__keep_alive_timer,
+            GUAC_SOCKET_KEEP_ALIVE_INTERVAL, GUAC_SOCKET_KEEP_ALIVE_INTERVAL);
 
 }
 
 void guac_socket_instruction_begin(guac_socket* socket) {
 
+    /* Begin buffering the instruction unless this thread is already
+     * buffering an instruction for a different socket (as happens for the
+     * sockets underlying broadcast and tee sockets, which receive each
+     * buffered instruction as a single write anyway) */
+    guac_socket_instruction_buffer* instruction_buffer =
+        __guac_socket_get_instruction_buffer();
+
+    if (instruction_buffer != NULL) {
+
+        if (instruction_buffer->socket == NULL) {
+            instruction_buffer->socket = socket;
+            instruction_buffer->depth = 0;
+            instruction_buffer->length = 0;
+        }
+
+        if (instruction_buffer->socket == socket)
+            instruction_buffer->depth++;
+
+    }
+
+    __atomic_add_fetch(&socket->__writers, 1, __ATOMIC_ACQUIRE);
+
     /* Call instruction begin handler if defined */
     if (socket->lock_handler)
         socket->lock_handler(socket);
 
 }
 
-void guac_socket_instruction_end(guac_socket* socket) {
+int guac_socket_instruction_end_checked(guac_socket* socket) {
+
+    int retval = 0;
+
+    /* Write the buffered instruction while the socket is still locked */
+    guac_socket_instruction_buffer* instruction_buffer =
+        __guac_socket_get_bound_instruction_buffer(socket);
+
+    if (instruction_buffer != NULL && --instruction_buffer->depth <= 0) {
+        if (__guac_socket_flush_instruction_buffer(instruction_buffer))
+            retval = 1;
+        instruction_buffer->socket = NULL;
+    }
 
     /* Call instruction end handler if defined */
     if (socket->unlock_handler)
         socket->unlock_handler(socket);
 
+    __atomic_sub_fetch(&socket->__writers, 1, __ATOMIC_RELEASE);
+
+    return retval;
+
+}
+
+void guac_socket_instruction_end(guac_socket* socket) {
+    guac_socket_instruction_end_checked(socket);
 }
 
 void guac_socket_free(guac_socket* socket) {
 
+    /* Stop keep-alive, if enabled, before the socket is torn down */
+    if (socket->__keep_alive_timer != NULL)
+        guac_timer_free(socket->__keep_alive_timer);
+
     guac_socket_flush(socket);
 
+    /* Ensure the current thread no longer refers to the freed socket */
+    guac_socket_instruction_buffer* instruction_buffer =
+        __guac_socket_get_bound_instruction_buffer(socket);
+
+    if (instruction_buffer != NULL)
+        instruction_buffer->socket = NULL;
+
     /* Call free handler if defined */
     if (socket->free_handler)
         socket->free_handler(socket);
@@ -214,22 +472,42 @@ void guac_socket_free(guac_socket* socket) {
     /* Mark as closed */
     socket->state = GUAC_SOCKET_CLOSED;
 
-    /* Stop keep-alive thread, if enabled */
-    if (socket->__keep_alive_enabled) {
-        pthread_cancel(socket->__keep_alive_thread);
-        pthread_join(socket->__keep_alive_thread, NULL);
-    }
-
     guac_mem_free(socket);
 }
 
+int guac_socket_format_int(char* buffer, int64_t value) {
+
+    char digits[GUAC_SOCKET_INT_MAX_LENGTH];
+    int length = 0;
+
+    /* Work with the magnitude as an unsigned value such that INT64_MIN does
+     * not overflow */
+    uint64_t magnitude = (value < 0) ? -((uint64_t) value) : (uint64_t) value;
+
+    /* Produce digits in reverse order */
+    do {
+        digits[length++] = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    /* Store sign, if any, followed by digits in the proper order */
+    int offset = 0;
+    if (value < 0)
+        buffer[offset++] = '-';
+
+    while (length > 0)
+        buffer[offset++] = digits[--length];
+
+    return offset;
+
+}
+
 ssize_t guac_socket_write_int(guac_socket* socket, int64_t i) {
 
-    char buffer[128];
-    int length;
+    char buffer[GUAC_SOCKET_INT_MAX_LENGTH];
 
     /* Write provided integer as a string */
-    length = snprintf(buffer, sizeof(buffer), "%"PRIi64, i);
+    int length = guac_socket_format_int(buffer, i);
     return guac_socket_write(socket, buffer, length);
 
 }
@@ -387,11 +665,22 @@ ssize_t guac_socket_write_base64(guac_socket* socket, const void* buf, size_t co
 
 ssize_t guac_socket_flush(guac_socket* socket) {
 
-    /* If handler defined, call it. */
-    if (socket->flush_handler)
-        return socket->flush_handler(socket);
+    ssize_t retval = 0;
+    __atomic_add_fetch(&socket->__writers, 1, __ATOMIC_ACQUIRE);
 
-    /* Otherwise, do nothing */
-    return 0;
+    /* Include any partially-buffered instruction */
+    guac_socket_instruction_buffer* instruction_buffer =
+        __guac_socket_get_bound_instruction_buffer(socket);
+
+    if (instruction_buffer != NULL
+            && __guac_socket_flush_instruction_buffer(instruction_buffer))
+        retval = 1;
+
+    /* If handler defined, call it. Otherwise, do nothing. */
+    else if (socket->flush_handler)
+        retval = socket->flush_handler(socket);
+
+    __atomic_sub_fetch(&socket->__writers, 1, __ATOMIC_RELEASE);
+    return retval;
 
 }
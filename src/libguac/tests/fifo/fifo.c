@@ -296,3 +296,102 @@ void test_fifo__interleaved(void) {
 
 }
 
+/**
+ * Verify that multiple items can be dequeued at once, including items that
+ * wrap around the end of the fifo storage, and that no more than the
+ * requested number of items is dequeued.
+ */
+void test_fifo__dequeue_multiple(void) {
+
+    test_fifo fifo;
+    test_fifo_init(&fifo, TEST_VALUES);
+
+    test_event events[TEST_FIFO_MAX_ITEMS];
+
+    /* Advance head such that subsequent items wrap around the end of the
+     * items array */
+    for (int i = 0; i < 3; i++) {
+        test_event event = { .test_value = TEST_VALUES[i] };
+        CU_ASSERT_TRUE(guac_fifo_enqueue((guac_fifo*) &fifo, &event));
+    }
+
+    CU_ASSERT_EQUAL(guac_fifo_dequeue_multiple((guac_fifo*) &fifo, events,
+                TEST_FIFO_MAX_ITEMS), 3);
+    CU_ASSERT_EQUAL(events[0].test_value, TEST_VALUES[0]);
+    CU_ASSERT_EQUAL(events[1].test_value, TEST_VALUES[1]);
+    CU_ASSERT_EQUAL(events[2].test_value, TEST_VALUES[2]);
+
+    /* Fill fifo completely (wrapping) */
+    for (int i = 0; i < TEST_FIFO_MAX_ITEMS; i++) {
+        test_event event = { .test_value = TEST_VALUES[3 + i] };
+        CU_ASSERT_TRUE(guac_fifo_enqueue((guac_fifo*) &fifo, &event));
+    }
+
+    /* Only the requested number of items should be dequeued */
+    CU_ASSERT_EQUAL(guac_fifo_dequeue_multiple((guac_fifo*) &fifo, events, 3), 3);
+    CU_ASSERT_EQUAL(events[0].test_value, TEST_VALUES[3]);
+    CU_ASSERT_EQUAL(events[1].test_value, TEST_VALUES[4]);
+    CU_ASSERT_EQUAL(events[2].test_value, TEST_VALUES[5]);
+
+    CU_ASSERT_EQUAL(guac_fifo_dequeue_multiple((guac_fifo*) &fifo, events,
+                TEST_FIFO_MAX_ITEMS), 1);
+    CU_ASSERT_EQUAL(events[0].test_value, TEST_VALUES[6]);
+
+    /* An invalidated fifo should yield no items */
+    guac_fifo_invalidate((guac_fifo*) &fifo);
+    CU_ASSERT_EQUAL(guac_fifo_dequeue_multiple((guac_fifo*) &fifo, events,
+                TEST_FIFO_MAX_ITEMS), 0);
+
+    test_fifo_destroy(&fifo);
+
+}
+
+/**
+ * Verify that relocating a full fifo whose items wrap around the end of its
+ * storage preserves the order of those items and allows further items to be
+ * added up to the new capacity.
+ */
+void test_fifo__relocate(void) {
+
+    test_fifo fifo;
+    test_fifo_init(&fifo, TEST_VALUES);
+
+    test_event event;
+
+    /* Fill fifo such that its items wrap around the end of storage */
+    for (int i = 0; i < 2; i++) {
+        event.test_value = TEST_VALUES[i];
+        CU_ASSERT_TRUE(guac_fifo_enqueue((guac_fifo*) &fifo, &event));
+        CU_ASSERT_TRUE(guac_fifo_dequeue((guac_fifo*) &fifo, &event));
+    }
+
+    for (int i = 0; i < TEST_FIFO_MAX_ITEMS; i++) {
+        event.test_value = TEST_VALUES[i];
+        CU_ASSERT_TRUE(guac_fifo_enqueue((guac_fifo*) &fifo, &event));
+    }
+
+    /* Move items into larger storage */
+    test_event* items = calloc(TEST_FIFO_MAX_ITEMS * 2, sizeof(test_event));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(items);
+
+    guac_fifo_lock((guac_fifo*) &fifo);
+    guac_fifo_relocate((guac_fifo*) &fifo, items, TEST_FIFO_MAX_ITEMS * 2);
+    guac_fifo_unlock((guac_fifo*) &fifo);
+
+    /* The fifo should now accept additional items */
+    for (int i = TEST_FIFO_MAX_ITEMS; i < TEST_FIFO_MAX_ITEMS * 2; i++) {
+        event.test_value = TEST_VALUES[i];
+        CU_ASSERT_TRUE(guac_fifo_enqueue((guac_fifo*) &fifo, &event));
+    }
+
+    /* All items should be read back in order */
+    for (int i = 0; i < TEST_FIFO_MAX_ITEMS * 2; i++) {
+        CU_ASSERT_TRUE(guac_fifo_timed_dequeue((guac_fifo*) &fifo, &event,
+                    TEST_TIMEOUT));
+        CU_ASSERT_EQUAL(event.test_value, TEST_VALUES[i]);
+    }
+
+    test_fifo_destroy(&fifo);
+    free(items);
+
+}
@@ -0,0 +1,94 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/metrics.h>
+
+#include <string.h>
+
+/**
+ * Test which verifies that guac_metrics_user_claim() assigns each user a
+ * distinct slot, and that released slots become available for reuse.
+ */
+void test_metrics__user_claim_release(void) {
+
+    guac_metrics metrics;
+    guac_metrics_init(&metrics);
+
+    guac_metrics_user* first = guac_metrics_user_claim(&metrics, "first");
+    guac_metrics_user* second = guac_metrics_user_claim(&metrics, "second");
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(first);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(second);
+    CU_ASSERT_PTR_NOT_EQUAL(first, second);
+
+    CU_ASSERT_STRING_EQUAL(first->user_id, "first");
+    CU_ASSERT_STRING_EQUAL(second->user_id, "second");
+    CU_ASSERT_TRUE(guac_metrics_user_is_active(first));
+    CU_ASSERT_TRUE(guac_metrics_user_is_active(second));
+
+    /* Counters of a reused slot must start from zero */
+    guac_metrics_add(&first->bytes_sent, 1234);
+    guac_metrics_user_release(first);
+    CU_ASSERT_FALSE(guac_metrics_user_is_active(first));
+
+    guac_metrics_user* third = guac_metrics_user_claim(&metrics, "third");
+    CU_ASSERT_PTR_EQUAL(third, first);
+    CU_ASSERT_STRING_EQUAL(third->user_id, "third");
+    CU_ASSERT_EQUAL(guac_metrics_get(&third->bytes_sent), 0);
+
+}
+
+/**
+ * Test which verifies that guac_metrics_user_claim() fails once all
+ * GUAC_METRICS_MAX_USERS slots have been claimed.
+ */
+void test_metrics__user_claim_exhausted(void) {
+
+    guac_metrics metrics;
+    guac_metrics_init(&metrics);
+
+    for (int i = 0; i < GUAC_METRICS_MAX_USERS; i++)
+        CU_ASSERT_PTR_NOT_NULL(guac_metrics_user_claim(&metrics, "user"));
+
+    CU_ASSERT_PTR_NULL(guac_metrics_user_claim(&metrics, "user"));
+
+}
+
+/**
+ * Test which verifies that counters are accumulated by guac_metrics_add() and
+ * replaced by guac_metrics_set().
+ */
+void test_metrics__counters(void) {
+
+    guac_metrics metrics;
+    guac_metrics_init(&metrics);
+
+    CU_ASSERT_EQUAL(guac_metrics_get(&metrics.frames), 0);
+
+    guac_metrics_add(&metrics.frames, 3);
+    guac_metrics_add(&metrics.frames, 4);
+    CU_ASSERT_EQUAL(guac_metrics_get(&metrics.frames), 7);
+
+    guac_metrics_set(&metrics.processing_lag, 42);
+    guac_metrics_set(&metrics.processing_lag, 17);
+    CU_ASSERT_EQUAL(guac_metrics_get(&metrics.processing_lag), 17);
+
+}
+
@@ -0,0 +1,67 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/rect.h>
+
+/**
+ * Test which verifies containment testing via guac_rect_contains().
+ */
+void test_rect__contains(void) {
+
+    guac_rect outer;
+    guac_rect inner;
+
+    /* NOTE: This rectangle will extend from (10, 10) inclusive to (20, 20) exclusive */
+    guac_rect_init(&outer, 10, 10, 10, 10);
+
+    /* Rectangle is contained by itself */
+    CU_ASSERT_TRUE(guac_rect_contains(&outer, &outer));
+
+    /* Rectangle that is entirely inside the other */
+    guac_rect_init(&inner, 11, 11, 5, 5);
+    CU_ASSERT_TRUE(guac_rect_contains(&outer, &inner));
+    CU_ASSERT_FALSE(guac_rect_contains(&inner, &outer));
+
+    /* Rectangle that shares the upper and left edges */
+    guac_rect_init(&inner, 10, 10, 5, 5);
+    CU_ASSERT_TRUE(guac_rect_contains(&outer, &inner));
+
+    /* Rectangle that shares the lower and right edges */
+    guac_rect_init(&inner, 15, 15, 5, 5);
+    CU_ASSERT_TRUE(guac_rect_contains(&outer, &inner));
+
+    /* Rectangle that extends one pixel past the lower-right corner */
+    guac_rect_init(&inner, 16, 16, 5, 5);
+    CU_ASSERT_FALSE(guac_rect_contains(&outer, &inner));
+
+    /* Rectangle that extends one pixel past the upper-left corner */
+    guac_rect_init(&inner, 9, 9, 5, 5);
+    CU_ASSERT_FALSE(guac_rect_contains(&outer, &inner));
+
+    /* Rectangle that merely intersects the other */
+    guac_rect_init(&inner, 5, 15, 10, 10);
+    CU_ASSERT_FALSE(guac_rect_contains(&outer, &inner));
+
+    /* Rectangle that does not intersect at all */
+    guac_rect_init(&inner, 25, 25, 5, 5);
+    CU_ASSERT_FALSE(guac_rect_contains(&outer, &inner));
+
+}
+
@@ -0,0 +1,134 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/protocol.h>
+#include <guacamole/socket.h>
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+/**
+ * Data recorded by a test socket as its write handler is invoked.
+ */
+typedef struct test_socket_data {
+
+    /**
+     * The number of times the write handler has been invoked.
+     */
+    int writes;
+
+    /**
+     * The number of bytes written thus far.
+     */
+    size_t length;
+
+    /**
+     * All data written thus far.
+     */
+    char buffer[1024];
+
+} test_socket_data;
+
+/**
+ * Write handler for the test socket which records each write within the
+ * test_socket_data associated with the socket.
+ */
+static ssize_t test_socket_write_handler(guac_socket* socket,
+        const void* buf, size_t count) {
+
+    test_socket_data* data = (test_socket_data*) socket->data;
+
+    if (data->length + count > sizeof(data->buffer))
+        return -1;
+
+    memcpy(data->buffer + data->length, buf, count);
+    data->length += count;
+    data->writes++;
+
+    return count;
+
+}
+
+/**
+ * Verifies that each instruction written via the guac_protocol_send_*()
+ * functions is passed to the write handler of the underlying socket as a
+ * single write, and that integers (including the most negative 64-bit
+ * integer) are formatted correctly.
+ */
+void test_socket__buffered_instruction(void) {
+
+    test_socket_data data = { 0 };
+
+    guac_socket* socket = guac_socket_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    socket->data = &data;
+    socket->write_handler = test_socket_write_handler;
+
+    /* Each instruction should be written in one piece */
+    CU_ASSERT_EQUAL(guac_protocol_send_sync(socket, 12345, 1), 0);
+    CU_ASSERT_EQUAL(data.writes, 1);
+
+    CU_ASSERT_EQUAL(guac_protocol_send_sync(socket, INT64_MIN, 0), 0);
+    CU_ASSERT_EQUAL(data.writes, 2);
+
+    CU_ASSERT_EQUAL(guac_protocol_send_sync(socket, -7, 100), 0);
+    CU_ASSERT_EQUAL(data.writes, 3);
+
+    /* Writes outside of any instruction are not buffered */
+    CU_ASSERT_EQUAL(guac_socket_write_int(socket, 9876543210), 0);
+    CU_ASSERT_EQUAL(data.writes, 4);
+
+    char expected[] =
+        "4.sync,5.12345,1.1;"
+        "4.sync,20.-9223372036854775808,1.0;"
+        "4.sync,2.-7,3.100;"
+        "9876543210";
+
+    CU_ASSERT_EQUAL_FATAL(data.length, strlen(expected));
+    CU_ASSERT_NSTRING_EQUAL(data.buffer, expected, data.length);
+
+    guac_socket_free(socket);
+
+}
+
+/**
+ * Verifies that a failure to write a buffered instruction to the underlying
+ * socket is reported by the guac_protocol_send_*() function that sent that
+ * instruction.
+ */
+void test_socket__buffered_instruction_error(void) {
+
+    /* Leave no space for further writes, such that all writes fail */
+    test_socket_data data = { .length = sizeof(data.buffer) };
+
+    guac_socket* socket = guac_socket_alloc();
+    CU_ASSERT_PTR_NOT_NULL_FATAL(socket);
+
+    socket->data = &data;
+    socket->write_handler = test_socket_write_handler;
+
+    CU_ASSERT_NOT_EQUAL(guac_protocol_send_sync(socket, 12345, 1), 0);
+    CU_ASSERT_EQUAL(data.writes, 0);
+
+    guac_socket_free(socket);
+
+}
@@ -0,0 +1,171 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <CUnit/CUnit.h>
+#include <guacamole/flag.h>
+#include <guacamole/timer.h>
+#include <guacamole/timestamp.h>
+
+/**
+ * The maximum number of milliseconds to wait for a timer to elapse.
+ */
+#define TEST_TIMEOUT 1000
+
+/**
+ * The interval of repeating test timers, in milliseconds.
+ */
+#define TEST_INTERVAL 10
+
+/**
+ * Flag set each time a test timer elapses.
+ */
+#define TEST_EVENT_ELAPSED 1
+
+/**
+ * The state of a test timer, recording each time the timer elapses.
+ */
+typedef struct test_timer_state {
+
+    /**
+     * Flag which is set with TEST_EVENT_ELAPSED each time the timer elapses.
+     * The lock of this flag guards count.
+     */
+    guac_flag elapsed;
+
+    /**
+     * The number of times the timer has elapsed.
+     */
+    int count;
+
+} test_timer_state;
+
+/**
+ * Timer callback which records that the timer has elapsed within the given
+ * test_timer_state.
+ *
+ * @param data
+ *     The test_timer_state of the timer.
+ */
+static void test_timer_callback(void* data) {
+
+    test_timer_state* state = (test_timer_state*) data;
+
+    guac_flag_set_and_lock(&state->elapsed, TEST_EVENT_ELAPSED);
+    state->count++;
+    guac_flag_unlock(&state->elapsed);
+
+}
+
+/**
+ * Returns the number of times the timer associated with the given
+ * test_timer_state has elapsed.
+ *
+ * @param state
+ *     The test_timer_state of the timer.
+ *
+ * @return
+ *     The number of times the timer has elapsed.
+ */
+static int test_timer_count(test_timer_state* state) {
+
+    guac_flag_lock(&state->elapsed);
+    int count = state->count;
+    guac_flag_unlock(&state->elapsed);
+
+    return count;
+
+}
+
+/**
+ * Test which verifies that a timer scheduled without delay elapses exactly
+ * once.
+ */
+void test_timer__once(void) {
+
+    test_timer_state state = { .count = 0 };
+    guac_flag_init(&state.elapsed);
+
+    guac_timer* timer = guac_timer_alloc(test_timer_callback, &state);
+    guac_timer_schedule(timer, 0, 0);
+
+    CU_ASSERT_TRUE(guac_flag_timedwait_and_lock(&state.elapsed,
+                TEST_EVENT_ELAPSED, TEST_TIMEOUT));
+    guac_flag_unlock(&state.elapsed);
+
+    guac_timestamp_msleep(TEST_INTERVAL * 5);
+    CU_ASSERT_EQUAL(test_timer_count(&state), 1);
+
+    guac_timer_free(timer);
+    guac_flag_destroy(&state.elapsed);
+
+}
+
+/**
+ * Test which verifies that a repeating timer continues to elapse until
+ * cancelled, and does not elapse at all after being cancelled.
+ */
+void test_timer__repeat(void) {
+
+    test_timer_state state = { .count = 0 };
+    guac_flag_init(&state.elapsed);
+
+    guac_timer* timer = guac_timer_alloc(test_timer_callback, &state);
+    guac_timer_schedule(timer, 0, TEST_INTERVAL);
+
+    /* Wait for the timer to elapse several times */
+    guac_timestamp start = guac_timestamp_current();
+    while (test_timer_count(&state) < 3
+            && guac_timestamp_current() - start < TEST_TIMEOUT)
+        guac_timestamp_msleep(TEST_INTERVAL);
+
+    guac_timer_cancel(timer);
+
+    int count = test_timer_count(&state);
+    CU_ASSERT(count >= 3);
+
+    guac_timestamp_msleep(TEST_INTERVAL * 5);
+    CU_ASSERT_EQUAL(test_timer_count(&state), count);
+
+    guac_timer_free(timer);
+    guac_flag_destroy(&state.elapsed);
+
+}
+
+/**
+ * Test which verifies that a timer cancelled before its delay has passed
+ * never elapses.
+ */
+void test_timer__cancel(void) {
+
+    test_timer_state state = { .count = 0 };
+    guac_flag_init(&state.elapsed);
+
+    guac_timer* timer = guac_timer_alloc(test_timer_callback, &state);
+    guac_timer_schedule(timer, TEST_INTERVAL * 5, 0);
+    guac_timer_cancel(timer);
+
+    CU_ASSERT_FALSE(guac_flag_timedwait_and_lock(&state.elapsed,
+                TEST_EVENT_ELAPSED, TEST_INTERVAL * 10));
+    CU_ASSERT_EQUAL(test_timer_count(&state), 0);
+
+    guac_timer_free(timer);
+    guac_flag_destroy(&state.elapsed);
+
+}
+
@@ -0,0 +1,319 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "guacamole/flag.h"
+#include "guacamole/mem.h"
+#include "guacamole/proctitle.h"
+#include "guacamole/timer.h"
+#include "guacamole/timestamp.h"
+
+#include <pthread.h>
+
+/**
+ * Flag set when the set of scheduled timers has changed, such that the timer
+ * thread must reevaluate how long it should sleep.
+ */
+#define GUAC_TIMER_STATE_CHANGED 1
+
+/**
+ * Flag set when the timer thread has finished invoking the callback of a
+ * timer.
+ */
+#define GUAC_TIMER_STATE_CALLBACK_COMPLETE 2
+
+struct guac_timer {
+
+    /**
+     * The callback to invoke each time this timer elapses.
+     */
+    guac_timer_callback* callback;
+
+    /**
+     * The arbitrary data to pass to the callback.
+     */
+    void* data;
+
+    /**
+     * The number of milliseconds between each time this timer elapses, or
+     * zero if this timer elapses only once.
+     */
+    int interval;
+
+    /**
+     * The time at which this timer will next elapse. This value is only
+     * meaningful while the timer is scheduled.
+     */
+    guac_timestamp due;
+
+    /**
+     * Non-zero if this timer is currently within the queue of scheduled
+     * timers, zero otherwise.
+     */
+    int scheduled;
+
+    /**
+     * The scheduled timer that elapses after this timer, or NULL if this is
+     * the last scheduled timer.
+     */
+    guac_timer* next;
+
+};
+
+/**
+ * Once control guarding the process-wide initialization of the timer
+ * facility.
+ */
+static pthread_once_t guac_timer_init_once = PTHREAD_ONCE_INIT;
+
+/**
+ * The state of the timer facility. The lock of this flag guards all other
+ * process-wide timer state, as well as the scheduling of each timer.
+ */
+static guac_flag guac_timer_state;
+
+/**
+ * All scheduled timers, in the order that they will elapse.
+ */
+static guac_timer* guac_timer_queue = NULL;
+
+/**
+ * The timer whose callback is currently being invoked by the timer thread, or
+ * NULL if no callback is running.
+ */
+static guac_timer* guac_timer_running = NULL;
+
+/**
+ * Whether the timer thread has been started within the current process.
+ */
+static int guac_timer_thread_started = 0;
+
+/**
+ * The thread which invokes the callbacks of all timers within the current
+ * process. This value is only meaningful if guac_timer_thread_started is
+ * non-zero.
+ */
+static pthread_t guac_timer_thread;
+
+/**
+ * Resets all timer state within the child of a fork(). The timer thread is
+ * not duplicated by fork(), and timers scheduled by the parent are not the
+ * concern of the child, so the child starts afresh with no scheduled timers
+ * and starts its own timer thread as needed.
+ */
+static void guac_timer_atfork_child(void) {
+
+    guac_timer* current = guac_timer_queue;
+    while (current != NULL) {
+        current->scheduled = 0;
+        current = current->next;
+    }
+
+    guac_timer_queue = NULL;
+    guac_timer_running = NULL;
+    guac_timer_thread_started = 0;
+
+    guac_flag_init(&guac_timer_state);
+
+}
+
+/**
+ * Initializes the process-wide timer state. This function is invoked only
+ * once, via pthread_once().
+ */
+static void guac_timer_init(void) {
+    guac_flag_init(&guac_timer_state);
+    pthread_atfork(NULL, NULL, guac_timer_atfork_child);
+}
+
+/**
+ * Inserts the given timer into the queue of scheduled timers, after all
+ * timers that will elapse at or before the same time. The lock of
+ * guac_timer_state must already be held.
+ *
+ * @param timer
+ *     The timer to insert. This timer must not already be scheduled.
+ */
+static void guac_timer_insert(guac_timer* timer) {
+
+    guac_timer** current = &guac_timer_queue;
+    while (*current != NULL && (*current)->due <= timer->due)
+        current = &(*current)->next;
+
+    timer->next = *current;
+    timer->scheduled = 1;
+    *current = timer;
+
+}
+
+/**
+ * Removes the given timer from the queue of scheduled timers, if present. The
+ * lock of guac_timer_state must already be held.
+ *
+ * @param timer
+ *     The timer to remove.
+ */
+static void guac_timer_remove(guac_timer* timer) {
+
+    if (!timer->scheduled)
+        return;
+
+    guac_timer** current = &guac_timer_queue;
+    while (*current != timer)
+        current = &(*current)->next;
+
+    *current = timer->next;
+    timer->next = NULL;
+    timer->scheduled = 0;
+
+}
+
+/**
+ * The start routine of the timer thread, which sleeps until the next timer
+ * elapses or the set of scheduled timers changes, invoking the callback of
+ * each timer as it elapses.
+ *
+ * @param data
+ *     Unused.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_timer_thread_routine(void* data) {
+
+    /* Thread name timer: invokes the callbacks of all timers within the
+     * process, such as keep-alives and promotion of joining users. */
+    guac_thread_name_set("timer");
+
+    guac_flag_lock(&guac_timer_state);
+
+    for (;;) {
+
+        guac_timer* timer = guac_timer_queue;
+        guac_timestamp now = guac_timestamp_current();
+
+        /* Sleep until the next timer elapses or the schedule changes,
+         * clearing the changed flag beforehand (while the lock is held) such
+         * that no change can be missed */
+        if (timer == NULL || timer->due > now) {
+
+            guac_flag_clear(&guac_timer_state, GUAC_TIMER_STATE_CHANGED);
+            guac_flag_unlock(&guac_timer_state);
+
+            if (timer == NULL)
+                guac_flag_wait_and_lock(&guac_timer_state, GUAC_TIMER_STATE_CHANGED);
+
+            else if (!guac_flag_timedwait_and_lock(&guac_timer_state,
+                        GUAC_TIMER_STATE_CHANGED, timer->due - now))
+                guac_flag_lock(&guac_timer_state);
+
+            continue;
+
+        }
+
+        /* Repeating timers are rescheduled before their callback is invoked,
+         * such that the callback may freely cancel or reschedule the timer */
+        guac_timer_remove(timer);
+        if (timer->interval > 0) {
+
+            /* Skip any intervals that have been missed entirely rather than
+             * invoking the callback repeatedly to catch up */
+            timer->due += timer->interval;
+            if (timer->due <= now)
+                timer->due = now + timer->interval;
+
+            guac_timer_insert(timer);
+
+        }
+
+        /* Invoke callback without holding the lock, such that the callback
+         * may itself schedule timers */
+        guac_timer_running = timer;
+        guac_flag_unlock(&guac_timer_state);
+
+        timer->callback(timer->data);
+
+        guac_flag_lock(&guac_timer_state);
+        guac_timer_running = NULL;
+        guac_flag_set(&guac_timer_state, GUAC_TIMER_STATE_CALLBACK_COMPLETE);
+
+    }
+
+    return NULL;
+
+}
+
+guac_timer* guac_timer_alloc(guac_timer_callback* callback, void* data) {
+
+    guac_timer* timer = guac_mem_zalloc(sizeof(guac_timer));
+    timer->callback = callback;
+    timer->data = data;
+
+    return timer;
+
+}
+
+void guac_timer_schedule(guac_timer* timer, int delay, int interval) {
+
+    pthread_once(&guac_timer_init_once, guac_timer_init);
+    guac_flag_lock(&guac_timer_state);
+
+    /* Start the timer thread upon first use */
+    if (!guac_timer_thread_started) {
+        pthread_create(&guac_timer_thread, NULL, guac_timer_thread_routine, NULL);
+        pthread_detach(guac_timer_thread);
+        guac_timer_thread_started = 1;
+    }
+
+    guac_timer_remove(timer);
+
+    timer->due = guac_timestamp_current() + delay;
+    timer->interval = interval;
+    guac_timer_insert(timer);
+
+    /* Wake the timer thread to reevaluate the schedule */
+    guac_flag_set(&guac_timer_state, GUAC_TIMER_STATE_CHANGED);
+    guac_flag_unlock(&guac_timer_state);
+
+}
+
+void guac_timer_cancel(guac_timer* timer) {
+
+    pthread_once(&guac_timer_init_once, guac_timer_init);
+    guac_flag_lock(&guac_timer_state);
+
+    guac_timer_remove(timer);
+
+    /* Wait for any in-progress invocation of the callback to complete,
+     * unless this is that invocation */
+    while (guac_timer_running == timer
+            && !pthread_equal(pthread_self(), guac_timer_thread)) {
+        guac_flag_clear(&guac_timer_state, GUAC_TIMER_STATE_CALLBACK_COMPLETE);
+        guac_flag_unlock(&guac_timer_state);
+        guac_flag_wait_and_lock(&guac_timer_state, GUAC_TIMER_STATE_CALLBACK_COMPLETE);
+    }
+
+    guac_flag_unlock(&guac_timer_state);
+
+}
+
+void guac_timer_free(guac_timer* timer) {
+    guac_timer_cancel(timer);
+    guac_mem_free(timer);
+}
+
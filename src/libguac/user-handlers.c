@@ -19,6 +19,7 @@
 
 #include "guacamole/mem.h"
 #include "guacamole/client.h"
+#include "guacamole/metrics.h"
 #include "guacamole/object.h"
 #include "guacamole/protocol.h"
 #include "guacamole/stream.h"
@@ -163,7 +164,24 @@ int __guac_handle_sync(guac_user* user, int argc, char** argv) {
     return 0;
 }
 
+/**
+ * Counts a single input event received from the given user within the
+ * performance counters of the associated connection, if such counters are
+ * being tracked.
+ *
+ * @param user
+ *     The user that sent the input event.
+ */
+static void __guac_count_input_event(guac_user* user) {
+
+    guac_metrics* metrics = user->client->metrics;
+    if (metrics != NULL)
+        guac_metrics_add(&metrics->input_events, 1);
+
+}
+
 int __guac_handle_touch(guac_user* user, int argc, char** argv) {
+    __guac_count_input_event(user);
     if (user->touch_handler)
         return user->touch_handler(
             user,
@@ -179,6 +197,7 @@ int __guac_handle_touch(guac_user* user, int argc, char** argv) {
 }
 
 int __guac_handle_mouse(guac_user* user, int argc, char** argv) {
+    __guac_count_input_event(user);
     if (user->mouse_handler)
         return user->mouse_handler(
             user,
@@ -190,6 +209,7 @@ int __guac_handle_mouse(guac_user* user, int argc, char** argv) {
 }
 
 int __guac_handle_key(guac_user* user, int argc, char** argv) {
+    __guac_count_input_event(user);
     if (user->key_handler)
         return user->key_handler(
             user,
@@ -70,6 +70,10 @@ int guac_kubernetes_user_join_handler(guac_user* user, int argc, char** argv) {
 
     }
 
+    /* Ensure the next clipboard broadcast reaches the joining user */
+    if (kubernetes_client->term != NULL)
+        guac_terminal_clipboard_invalidate(kubernetes_client->term);
+
     /* Only handle events if not read-only */
     if (!settings->read_only) {
 
@@ -699,7 +699,8 @@ int guac_rdp_clipboard_handler(guac_user* user, guac_stream* stream,
     stream->end_handler = guac_rdp_clipboard_end_handler;
 
     /* Clear any current contents, assigning the mimetype the data which will
-     * be received */
+     * be received (data which not all users will have) */
+    guac_common_clipboard_invalidate(clipboard->clipboard);
     guac_common_clipboard_reset(clipboard->clipboard, mimetype);
 
     /* Report clipboard within recording */
@@ -0,0 +1,277 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "channels/common-svc.h"
+#include "channels/rdpdr/rdpdr-fs-io.h"
+#include "channels/rdpdr/rdpdr.h"
+#include "fs.h"
+#include "rdp.h"
+
+#include <guacamole/client.h>
+#include <guacamole/fifo.h>
+#include <guacamole/flag.h>
+#include <guacamole/mem.h>
+#include <guacamole/proctitle.h>
+#include <winpr/nt.h>
+#include <winpr/stream.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * Performs the given read request, reading directly into the I/O completion
+ * that is sent in response.
+ *
+ * @param io
+ *     The worker pool handling the request.
+ *
+ * @param request
+ *     The read request to perform.
+ */
+static void guac_rdpdr_fs_io_read(guac_rdpdr_fs_io* io,
+        guac_rdpdr_fs_io_request* request) {
+
+    guac_rdpdr_device* device = request->device;
+
+    wStream* output_stream = guac_rdpdr_new_io_completion(device,
+            request->completion_id, STATUS_SUCCESS, 4 + request->length);
+
+    /* Read into space immediately following the Length field */
+    size_t length_position = Stream_GetPosition(output_stream);
+    Stream_Seek(output_stream, 4);
+
+    int bytes_read = guac_rdp_fs_read((guac_rdp_fs*) device->data,
+            request->file_id, request->offset, Stream_Pointer(output_stream),
+            request->length);
+
+    /* If error, replace IoStatus of completion header and send no data */
+    if (bytes_read < 0) {
+        Stream_SetPosition(output_stream, length_position - 4);
+        Stream_Write_UINT32(output_stream, guac_rdp_fs_get_status(bytes_read));
+        Stream_Write_UINT32(output_stream, 0); /* Length */
+    }
+
+    /* Otherwise, send bytes read */
+    else {
+        Stream_SetPosition(output_stream, length_position);
+        Stream_Write_UINT32(output_stream, bytes_read); /* Length */
+        Stream_Seek(output_stream, bytes_read);         /* ReadData */
+    }
+
+    guac_rdp_common_svc_write(io->svc, output_stream);
+
+}
+
+/**
+ * Performs the given write request, freeing the data written once the write
+ * has been performed.
+ *
+ * @param io
+ *     The worker pool handling the request.
+ *
+ * @param request
+ *     The write request to perform.
+ */
+static void guac_rdpdr_fs_io_write(guac_rdpdr_fs_io* io,
+        guac_rdpdr_fs_io_request* request) {
+
+    guac_rdpdr_device* device = request->device;
+    guac_rdp_fs* fs = (guac_rdp_fs*) device->data;
+    wStream* output_stream;
+
+    int bytes_written = guac_rdp_fs_write(fs, request->file_id,
+            request->offset, request->data, request->length);
+
+    guac_mem_free(request->data);
+
+    /* If error, return invalid parameter */
+    if (bytes_written < 0) {
+        output_stream = guac_rdpdr_new_io_completion(device,
+                request->completion_id, guac_rdp_fs_get_status(bytes_written), 5);
+        Stream_Write_UINT32(output_stream, 0); /* Length */
+        Stream_Write_UINT8(output_stream, 0);  /* Padding */
+    }
+
+    /* Otherwise, send success */
+    else {
+        output_stream = guac_rdpdr_new_io_completion(device,
+                request->completion_id, STATUS_SUCCESS, 5);
+        Stream_Write_UINT32(output_stream, bytes_written); /* Length */
+        Stream_Write_UINT8(output_stream, 0);              /* Padding */
+    }
+
+    guac_rdp_common_svc_write(io->svc, output_stream);
+
+}
+
+/**
+ * Releases the generic RDP message lock, if held by the current thread. The
+ * worker threads send each I/O completion while holding that lock, and any
+ * thread that waits on those workers while holding the lock (such as the
+ * RDPDR channel handler, which runs while FreeRDP events are being handled)
+ * would otherwise deadlock.
+ *
+ * @param io
+ *     The worker pool that the current thread is about to wait on.
+ *
+ * @return
+ *     Zero if the message lock was released and must be reacquired with
+ *     guac_rdpdr_fs_io_restore_message_lock(), non-zero if the lock was not
+ *     held.
+ */
+static int guac_rdpdr_fs_io_release_message_lock(guac_rdpdr_fs_io* io) {
+    guac_rdp_client* rdp_client = (guac_rdp_client*) io->svc->client->data;
+    return pthread_mutex_unlock(&(rdp_client->message_lock));
+}
+
+/**
+ * Restores the state of the generic RDP message lock after a prior call to
+ * guac_rdpdr_fs_io_release_message_lock().
+ *
+ * @param io
+ *     The worker pool that the current thread has finished waiting on.
+ *
+ * @param unlock_status
+ *     The value returned by the corresponding call to
+ *     guac_rdpdr_fs_io_release_message_lock().
+ */
+static void guac_rdpdr_fs_io_restore_message_lock(guac_rdpdr_fs_io* io,
+        int unlock_status) {
+
+    guac_rdp_client* rdp_client = (guac_rdp_client*) io->svc->client->data;
+    if (!unlock_status)
+        pthread_mutex_lock(&(rdp_client->message_lock));
+
+}
+
+/**
+ * Worker thread which continuously performs queued read/write requests
+ * until the request queue is invalidated.
+ *
+ * @param data
+ *     The guac_rdpdr_fs_io that the thread belongs to.
+ *
+ * @return
+ *     Always NULL.
+ */
+static void* guac_rdpdr_fs_io_worker_thread(void* data) {
+
+    /* Thread name rdpdr-io: performs reads/writes for the redirected drive */
+    guac_thread_name_set("rdpdr-io");
+
+    guac_rdpdr_fs_io* io = (guac_rdpdr_fs_io*) data;
+    guac_rdpdr_fs_io_request request;
+
+    while (guac_fifo_dequeue(&io->requests, &request)) {
+
+        if (request.type == GUAC_RDPDR_FS_IO_READ)
+            guac_rdpdr_fs_io_read(io, &request);
+        else
+            guac_rdpdr_fs_io_write(io, &request);
+
+        /* Signal idle once all submitted requests are complete */
+        guac_flag_lock(&io->state);
+        if (--io->pending == 0)
+            guac_flag_set(&io->state, GUAC_RDPDR_FS_IO_STATE_IDLE);
+        guac_flag_unlock(&io->state);
+
+    }
+
+    return NULL;
+
+}
+
+guac_rdpdr_fs_io* guac_rdpdr_fs_io_alloc(guac_rdp_common_svc* svc) {
+
+    guac_rdpdr_fs_io* io = guac_mem_zalloc(sizeof(guac_rdpdr_fs_io));
+    io->svc = svc;
+
+    guac_fifo_init(&io->requests, io->request_items,
+            GUAC_RDPDR_FS_IO_MAX_REQUESTS, sizeof(guac_rdpdr_fs_io_request));
+
+    guac_flag_init(&io->state);
+    guac_flag_set(&io->state, GUAC_RDPDR_FS_IO_STATE_IDLE);
+
+    for (int i = 0; i < GUAC_RDPDR_FS_IO_THREADS; i++)
+        pthread_create(&io->threads[i], NULL, guac_rdpdr_fs_io_worker_thread, io);
+
+    return io;
+
+}
+
+void guac_rdpdr_fs_io_submit(guac_rdpdr_fs_io* io,
+        const guac_rdpdr_fs_io_request* request) {
+
+    guac_flag_lock(&io->state);
+    io->pending++;
+    guac_flag_clear(&io->state, GUAC_RDPDR_FS_IO_STATE_IDLE);
+    guac_flag_unlock(&io->state);
+
+    /* Queueing blocks while the queue is full, which requires that the
+     * workers be able to send their completions */
+    int unlock_status = guac_rdpdr_fs_io_release_message_lock(io);
+    int queued = guac_fifo_enqueue(&io->requests, request);
+    guac_rdpdr_fs_io_restore_message_lock(io, unlock_status);
+
+    /* Requests can only fail to be queued if the pool is being freed */
+    if (!queued) {
+
+        guac_mem_free_const(request->data);
+
+        guac_flag_lock(&io->state);
+        if (--io->pending == 0)
+            guac_flag_set(&io->state, GUAC_RDPDR_FS_IO_STATE_IDLE);
+        guac_flag_unlock(&io->state);
+
+    }
+
+}
+
+void guac_rdpdr_fs_io_drain(guac_rdpdr_fs_io* io) {
+
+    int unlock_status = guac_rdpdr_fs_io_release_message_lock(io);
+
+    guac_flag_wait_and_lock(&io->state, GUAC_RDPDR_FS_IO_STATE_IDLE);
+    guac_flag_unlock(&io->state);
+
+    guac_rdpdr_fs_io_restore_message_lock(io, unlock_status);
+
+}
+
+void guac_rdpdr_fs_io_free(guac_rdpdr_fs_io* io) {
+
+    int unlock_status = guac_rdpdr_fs_io_release_message_lock(io);
+
+    /* Complete all outstanding requests before stopping the workers */
+    guac_flag_wait_and_lock(&io->state, GUAC_RDPDR_FS_IO_STATE_IDLE);
+    guac_flag_unlock(&io->state);
+    guac_fifo_invalidate(&io->requests);
+
+    for (int i = 0; i < GUAC_RDPDR_FS_IO_THREADS; i++)
+        pthread_join(io->threads[i], NULL);
+
+    guac_rdpdr_fs_io_restore_message_lock(io, unlock_status);
+
+    guac_fifo_destroy(&io->requests);
+    guac_flag_destroy(&io->state);
+    guac_mem_free(io);
+
+}
+
@@ -0,0 +1,218 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_RDP_CHANNELS_RDPDR_FS_IO_H
+#define GUAC_RDP_CHANNELS_RDPDR_FS_IO_H
+
+/**
+ * Asynchronous handling of drive read and write requests. Reads and writes
+ * are performed by a pool of worker threads using positional I/O, with each
+ * I/O request being completed as soon as its own read or write finishes,
+ * regardless of the order in which the requests were received. This allows
+ * the RDP server to keep several requests outstanding at once.
+ *
+ * @file rdpdr-fs-io.h
+ */
+
+#include "channels/common-svc.h"
+#include "channels/rdpdr/rdpdr.h"
+
+#include <guacamole/fifo.h>
+#include <guacamole/flag.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+/**
+ * The number of worker threads performing drive I/O for each redirected
+ * drive.
+ */
+#define GUAC_RDPDR_FS_IO_THREADS 4
+
+/**
+ * The maximum number of read/write requests that may be queued for the
+ * worker threads at any one time. Further requests block the channel thread
+ * until space is available.
+ */
+#define GUAC_RDPDR_FS_IO_MAX_REQUESTS 64
+
+/**
+ * Flag value of the "state" member of guac_rdpdr_fs_io which is set whenever
+ * no read/write requests are queued or in progress.
+ */
+#define GUAC_RDPDR_FS_IO_STATE_IDLE 1
+
+/**
+ * The type of a queued drive I/O request.
+ */
+typedef enum guac_rdpdr_fs_io_type {
+
+    /**
+     * Read from a file, sending the data read within the I/O completion.
+     */
+    GUAC_RDPDR_FS_IO_READ,
+
+    /**
+     * Write data to a file.
+     */
+    GUAC_RDPDR_FS_IO_WRITE
+
+} guac_rdpdr_fs_io_type;
+
+/**
+ * A single read or write request queued for handling by a drive I/O worker
+ * thread.
+ */
+typedef struct guac_rdpdr_fs_io_request {
+
+    /**
+     * Whether this request is a read or a write.
+     */
+    guac_rdpdr_fs_io_type type;
+
+    /**
+     * The device that received the request.
+     */
+    guac_rdpdr_device* device;
+
+    /**
+     * The completion ID of the I/O request, to be included in the resulting
+     * I/O completion.
+     */
+    int completion_id;
+
+    /**
+     * The ID of the file being read or written.
+     */
+    int file_id;
+
+    /**
+     * The offset within the file at which the read or write should start.
+     */
+    uint64_t offset;
+
+    /**
+     * The number of bytes to read or write.
+     */
+    uint32_t length;
+
+    /**
+     * The data to write, copied out of the request PDU. This data is freed
+     * once the write has been performed. For reads, this will be NULL.
+     */
+    void* data;
+
+} guac_rdpdr_fs_io_request;
+
+/**
+ * Pool of worker threads which perform drive reads and writes on behalf of
+ * the RDPDR channel.
+ */
+struct guac_rdpdr_fs_io {
+
+    /**
+     * The SVC of the RDPDR channel that I/O completions should be sent over.
+     */
+    guac_rdp_common_svc* svc;
+
+    /**
+     * Queue of read/write requests awaiting a worker thread.
+     */
+    guac_fifo requests;
+
+    /**
+     * Storage for the items of the requests FIFO.
+     */
+    guac_rdpdr_fs_io_request request_items[GUAC_RDPDR_FS_IO_MAX_REQUESTS];
+
+    /**
+     * The number of requests that have been submitted but not yet completed.
+     *
+     * IMPORTANT: This member must only be accessed or modified while the
+     * state flag is locked.
+     */
+    unsigned int pending;
+
+    /**
+     * The current state of this pool. The GUAC_RDPDR_FS_IO_STATE_IDLE flag is
+     * set whenever no requests are pending.
+     */
+    guac_flag state;
+
+    /**
+     * The worker threads performing I/O.
+     */
+    pthread_t threads[GUAC_RDPDR_FS_IO_THREADS];
+
+};
+
+/**
+ * Allocates a new pool of drive I/O worker threads which send I/O
+ * completions over the given SVC.
+ *
+ * @param svc
+ *     The SVC of the RDPDR channel.
+ *
+ * @return
+ *     A newly-allocated guac_rdpdr_fs_io which must eventually be freed with
+ *     guac_rdpdr_fs_io_free().
+ */
+guac_rdpdr_fs_io* guac_rdpdr_fs_io_alloc(guac_rdp_common_svc* svc);
+
+/**
+ * Queues the given read or write request for handling by a worker thread.
+ * If the queue is full, this function blocks until space is available,
+ * releasing the generic RDP message lock while blocked such that the workers
+ * can continue to send their completions.
+ *
+ * @param io
+ *     The worker pool that should handle the request.
+ *
+ * @param request
+ *     The request to queue. The request is copied, with ownership of any
+ *     write data passing to the worker pool.
+ */
+void guac_rdpdr_fs_io_submit(guac_rdpdr_fs_io* io,
+        const guac_rdpdr_fs_io_request* request);
+
+/**
+ * Waits for all submitted read and write requests to complete. This must be
+ * invoked prior to handling any other I/O request, such that operations like
+ * closing, truncating, or querying a file always observe the effects of all
+ * reads and writes received before them. The generic RDP message lock is
+ * released while waiting, as the workers require that lock to send their
+ * completions.
+ *
+ * @param io
+ *     The worker pool to wait for.
+ */
+void guac_rdpdr_fs_io_drain(guac_rdpdr_fs_io* io);
+
+/**
+ * Waits for all submitted requests to complete, stops all worker threads,
+ * and frees the given pool. As with guac_rdpdr_fs_io_drain(), the generic
+ * RDP message lock is released while waiting.
+ *
+ * @param io
+ *     The worker pool to free.
+ */
+void guac_rdpdr_fs_io_free(guac_rdpdr_fs_io* io);
+
+#endif
+
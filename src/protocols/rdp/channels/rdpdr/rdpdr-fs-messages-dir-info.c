@@ -32,26 +32,19 @@
 
 void guac_rdpdr_fs_process_query_directory_info(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
-        const char* entry_name, int entry_file_id) {
-
-    guac_rdp_fs_file* file;
+        const guac_rdp_fs_dir_entry* entry) {
 
     wStream* output_stream;
-    int length = guac_utf8_strlen(entry_name);
+    int length = guac_utf8_strlen(entry->name);
     int utf16_length = length*2;
 
     unsigned char utf16_entry_name[256];
-    guac_rdp_utf8_to_utf16((const unsigned char*) entry_name, length,
+    guac_rdp_utf8_to_utf16((const unsigned char*) entry->name, length,
             (char*) utf16_entry_name, sizeof(utf16_entry_name));
 
-    /* Get file */
-    file = guac_rdp_fs_get_file((guac_rdp_fs*) device->data, entry_file_id);
-    if (file == NULL)
-        return;
-
     guac_client_log(svc->client, GUAC_LOG_DEBUG,
-            "%s: [file_id=%i (entry_name=\"%s\")]",
-            __func__, entry_file_id, entry_name);
+            "%s: [file_id=%i] entry_name=\"%s\"",
+            __func__, iorequest->file_id, entry->name);
 
     output_stream = guac_rdpdr_new_io_completion(device,
             iorequest->completion_id, STATUS_SUCCESS,
@@ -62,13 +55,13 @@ void guac_rdpdr_fs_process_query_directory_info(guac_rdp_common_svc* svc,
 
     Stream_Write_UINT32(output_stream, 0); /* NextEntryOffset */
     Stream_Write_UINT32(output_stream, 0); /* FileIndex */
-    Stream_Write_UINT64(output_stream, file->ctime); /* CreationTime */
-    Stream_Write_UINT64(output_stream, file->atime); /* LastAccessTime */
-    Stream_Write_UINT64(output_stream, file->mtime); /* LastWriteTime */
-    Stream_Write_UINT64(output_stream, file->mtime); /* ChangeTime */
-    Stream_Write_UINT64(output_stream, file->size);  /* EndOfFile */
-    Stream_Write_UINT64(output_stream, file->size);  /* AllocationSize */
-    Stream_Write_UINT32(output_stream, file->attributes);   /* FileAttributes */
+    Stream_Write_UINT64(output_stream, entry->ctime); /* CreationTime */
+    Stream_Write_UINT64(output_stream, entry->atime); /* LastAccessTime */
+    Stream_Write_UINT64(output_stream, entry->mtime); /* LastWriteTime */
+    Stream_Write_UINT64(output_stream, entry->mtime); /* ChangeTime */
+    Stream_Write_UINT64(output_stream, entry->size);  /* EndOfFile */
+    Stream_Write_UINT64(output_stream, entry->size);  /* AllocationSize */
+    Stream_Write_UINT32(output_stream, entry->attributes);   /* FileAttributes */
     Stream_Write_UINT32(output_stream, utf16_length+2); /* FileNameLength*/
 
     Stream_Write(output_stream, utf16_entry_name, utf16_length); /* FileName */
@@ -80,26 +73,19 @@ void guac_rdpdr_fs_process_query_directory_info(guac_rdp_common_svc* svc,
 
 void guac_rdpdr_fs_process_query_full_directory_info(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
-        const char* entry_name, int entry_file_id) {
-
-    guac_rdp_fs_file* file;
+        const guac_rdp_fs_dir_entry* entry) {
 
     wStream* output_stream;
-    int length = guac_utf8_strlen(entry_name);
+    int length = guac_utf8_strlen(entry->name);
     int utf16_length = length*2;
 
     unsigned char utf16_entry_name[256];
-    guac_rdp_utf8_to_utf16((const unsigned char*) entry_name, length,
+    guac_rdp_utf8_to_utf16((const unsigned char*) entry->name, length,
             (char*) utf16_entry_name, sizeof(utf16_entry_name));
 
-    /* Get file */
-    file = guac_rdp_fs_get_file((guac_rdp_fs*) device->data, entry_file_id);
-    if (file == NULL)
-        return;
-
     guac_client_log(svc->client, GUAC_LOG_DEBUG,
-            "%s: [file_id=%i (entry_name=\"%s\")]",
-            __func__, entry_file_id, entry_name);
+            "%s: [file_id=%i] entry_name=\"%s\"",
+            __func__, iorequest->file_id, entry->name);
 
     output_stream = guac_rdpdr_new_io_completion(device,
             iorequest->completion_id, STATUS_SUCCESS,
@@ -110,13 +96,13 @@ void guac_rdpdr_fs_process_query_full_directory_info(guac_rdp_common_svc* svc,
 
     Stream_Write_UINT32(output_stream, 0); /* NextEntryOffset */
     Stream_Write_UINT32(output_stream, 0); /* FileIndex */
-    Stream_Write_UINT64(output_stream, file->ctime); /* CreationTime */
-    Stream_Write_UINT64(output_stream, file->atime); /* LastAccessTime */
-    Stream_Write_UINT64(output_stream, file->mtime); /* LastWriteTime */
-    Stream_Write_UINT64(output_stream, file->mtime); /* ChangeTime */
-    Stream_Write_UINT64(output_stream, file->size);  /* EndOfFile */
-    Stream_Write_UINT64(output_stream, file->size);  /* AllocationSize */
-    Stream_Write_UINT32(output_stream, file->attributes);   /* FileAttributes */
+    Stream_Write_UINT64(output_stream, entry->ctime); /* CreationTime */
+    Stream_Write_UINT64(output_stream, entry->atime); /* LastAccessTime */
+    Stream_Write_UINT64(output_stream, entry->mtime); /* LastWriteTime */
+    Stream_Write_UINT64(output_stream, entry->mtime); /* ChangeTime */
+    Stream_Write_UINT64(output_stream, entry->size);  /* EndOfFile */
+    Stream_Write_UINT64(output_stream, entry->size);  /* AllocationSize */
+    Stream_Write_UINT32(output_stream, entry->attributes);   /* FileAttributes */
     Stream_Write_UINT32(output_stream, utf16_length+2); /* FileNameLength*/
     Stream_Write_UINT32(output_stream, 0); /* EaSize */
 
@@ -129,26 +115,19 @@ void guac_rdpdr_fs_process_query_full_directory_info(guac_rdp_common_svc* svc,
 
 void guac_rdpdr_fs_process_query_both_directory_info(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
-        const char* entry_name, int entry_file_id) {
-
-    guac_rdp_fs_file* file;
+        const guac_rdp_fs_dir_entry* entry) {
 
     wStream* output_stream;
-    int length = guac_utf8_strlen(entry_name);
+    int length = guac_utf8_strlen(entry->name);
     int utf16_length = length*2;
 
     unsigned char utf16_entry_name[256];
-    guac_rdp_utf8_to_utf16((const unsigned char*) entry_name, length,
+    guac_rdp_utf8_to_utf16((const unsigned char*) entry->name, length,
             (char*) utf16_entry_name, sizeof(utf16_entry_name));
 
-    /* Get file */
-    file = guac_rdp_fs_get_file((guac_rdp_fs*) device->data, entry_file_id);
-    if (file == NULL)
-        return;
-
     guac_client_log(svc->client, GUAC_LOG_DEBUG,
-            "%s: [file_id=%i (entry_name=\"%s\")]",
-            __func__, entry_file_id, entry_name);
+            "%s: [file_id=%i] entry_name=\"%s\"",
+            __func__, iorequest->file_id, entry->name);
 
     output_stream = guac_rdpdr_new_io_completion(device,
             iorequest->completion_id, STATUS_SUCCESS,
@@ -159,13 +138,13 @@ void guac_rdpdr_fs_process_query_both_directory_info(guac_rdp_common_svc* svc,
 
     Stream_Write_UINT32(output_stream, 0); /* NextEntryOffset */
     Stream_Write_UINT32(output_stream, 0); /* FileIndex */
-    Stream_Write_UINT64(output_stream, file->ctime); /* CreationTime */
-    Stream_Write_UINT64(output_stream, file->atime); /* LastAccessTime */
-    Stream_Write_UINT64(output_stream, file->mtime); /* LastWriteTime */
-    Stream_Write_UINT64(output_stream, file->mtime); /* ChangeTime */
-    Stream_Write_UINT64(output_stream, file->size);  /* EndOfFile */
-    Stream_Write_UINT64(output_stream, file->size);  /* AllocationSize */
-    Stream_Write_UINT32(output_stream, file->attributes);   /* FileAttributes */
+    Stream_Write_UINT64(output_stream, entry->ctime); /* CreationTime */
+    Stream_Write_UINT64(output_stream, entry->atime); /* LastAccessTime */
+    Stream_Write_UINT64(output_stream, entry->mtime); /* LastWriteTime */
+    Stream_Write_UINT64(output_stream, entry->mtime); /* ChangeTime */
+    Stream_Write_UINT64(output_stream, entry->size);  /* EndOfFile */
+    Stream_Write_UINT64(output_stream, entry->size);  /* AllocationSize */
+    Stream_Write_UINT32(output_stream, entry->attributes);   /* FileAttributes */
     Stream_Write_UINT32(output_stream, utf16_length+2); /* FileNameLength*/
     Stream_Write_UINT32(output_stream, 0); /* EaSize */
     Stream_Write_UINT8(output_stream,  0); /* ShortNameLength */
@@ -182,26 +161,19 @@ void guac_rdpdr_fs_process_query_both_directory_info(guac_rdp_common_svc* svc,
 
 void guac_rdpdr_fs_process_query_names_info(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
-        const char* entry_name, int entry_file_id) {
-
-    guac_rdp_fs_file* file;
+        const guac_rdp_fs_dir_entry* entry) {
 
     wStream* output_stream;
-    int length = guac_utf8_strlen(entry_name);
+    int length = guac_utf8_strlen(entry->name);
     int utf16_length = length*2;
 
     unsigned char utf16_entry_name[256];
-    guac_rdp_utf8_to_utf16((const unsigned char*) entry_name, length,
+    guac_rdp_utf8_to_utf16((const unsigned char*) entry->name, length,
             (char*) utf16_entry_name, sizeof(utf16_entry_name));
 
-    /* Get file */
-    file = guac_rdp_fs_get_file((guac_rdp_fs*) device->data, entry_file_id);
-    if (file == NULL)
-        return;
-
     guac_client_log(svc->client, GUAC_LOG_DEBUG,
-            "%s: [file_id=%i (entry_name=\"%s\")]",
-            __func__, entry_file_id, entry_name);
+            "%s: [file_id=%i] entry_name=\"%s\"",
+            __func__, iorequest->file_id, entry->name);
 
     output_stream = guac_rdpdr_new_io_completion(device,
             iorequest->completion_id, STATUS_SUCCESS,
@@ -30,6 +30,7 @@
 
 #include "channels/common-svc.h"
 #include "channels/rdpdr/rdpdr.h"
+#include "fs.h"
 
 #include <winpr/stream.h>
 
@@ -51,15 +52,13 @@
  *     The contents of the common RDPDR Device I/O Request header shared by all
  *     RDPDR devices.
  *
- * @param entry_name
- *     The filename of the file being queried.
- *
- * @param entry_file_id
- *     The ID of the file being queried.
+ * @param entry
+ *     The cached metadata of the directory entry being queried, as returned
+ *     by guac_rdp_fs_read_dir().
  */
 typedef void guac_rdpdr_directory_query_handler(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
-        const char* entry_name, int entry_file_id);
+        const guac_rdp_fs_dir_entry* entry);
 
 /**
  * Processes a query request for FileDirectoryInformation. From the
@@ -18,6 +18,7 @@
  */
 
 #include "channels/common-svc.h"
+#include "channels/rdpdr/rdpdr-fs-io.h"
 #include "channels/rdpdr/rdpdr-fs-messages-dir-info.h"
 #include "channels/rdpdr/rdpdr-fs-messages-file-info.h"
 #include "channels/rdpdr/rdpdr-fs-messages-vol-info.h"
@@ -140,10 +141,6 @@ void guac_rdpdr_fs_process_read(guac_rdp_common_svc* svc,
 
     UINT32 length;
     UINT64 offset;
-    char* buffer;
-    int bytes_read;
-
-    wStream* output_stream;
 
     /* Check remaining bytes before reading stream. */
     if (Stream_GetRemainingLength(input_stream) < 12) {
@@ -165,30 +162,18 @@ void guac_rdpdr_fs_process_read(guac_rdp_common_svc* svc,
     if (length > GUAC_RDP_MAX_READ_BUFFER)
         length = GUAC_RDP_MAX_READ_BUFFER;
 
-    /* Allocate buffer */
-    buffer = guac_mem_alloc(length);
-
-    /* Attempt read */
-    bytes_read = guac_rdp_fs_read((guac_rdp_fs*) device->data,
-            iorequest->file_id, offset, buffer, length);
-
-    /* If error, return invalid parameter */
-    if (bytes_read < 0) {
-        output_stream = guac_rdpdr_new_io_completion(device,
-                iorequest->completion_id, guac_rdp_fs_get_status(bytes_read), 4);
-        Stream_Write_UINT32(output_stream, 0); /* Length */
-    }
-
-    /* Otherwise, send bytes read */
-    else {
-        output_stream = guac_rdpdr_new_io_completion(device,
-                iorequest->completion_id, STATUS_SUCCESS, 4+bytes_read);
-        Stream_Write_UINT32(output_stream, bytes_read);  /* Length */
-        Stream_Write(output_stream, buffer, bytes_read); /* ReadData */
-    }
+    /* Read and send completion asynchronously */
+    guac_rdpdr_fs_io_request request = {
+        .type          = GUAC_RDPDR_FS_IO_READ,
+        .device        = device,
+        .completion_id = iorequest->completion_id,
+        .file_id       = iorequest->file_id,
+        .offset        = offset,
+        .length        = length,
+        .data          = NULL
+    };
 
-    guac_rdp_common_svc_write(svc, output_stream);
-    guac_mem_free(buffer);
+    guac_rdpdr_fs_io_submit(((guac_rdpdr*) svc->data)->fs_io, &request);
 
 }
 
@@ -198,9 +183,6 @@ void guac_rdpdr_fs_process_write(guac_rdp_common_svc* svc,
 
     UINT32 length;
     UINT64 offset;
-    int bytes_written;
-
-    wStream* output_stream;
 
     /* Check remaining length. */
     if (Stream_GetRemainingLength(input_stream) < 32) {
@@ -226,28 +208,24 @@ void guac_rdpdr_fs_process_write(guac_rdp_common_svc* svc,
                 "Drive redirection may not work as expected.");
         return;
     }
-    
-    /* Attempt write */
-    bytes_written = guac_rdp_fs_write((guac_rdp_fs*) device->data,
-            iorequest->file_id, offset, Stream_Pointer(input_stream), length);
 
-    /* If error, return invalid parameter */
-    if (bytes_written < 0) {
-        output_stream = guac_rdpdr_new_io_completion(device,
-                iorequest->completion_id, guac_rdp_fs_get_status(bytes_written), 5);
-        Stream_Write_UINT32(output_stream, 0); /* Length */
-        Stream_Write_UINT8(output_stream, 0);  /* Padding */
-    }
+    /* The request PDU is freed once handled, so the data to be written must
+     * be copied for the worker thread */
+    void* data = guac_mem_alloc(length);
+    memcpy(data, Stream_Pointer(input_stream), length);
 
-    /* Otherwise, send success */
-    else {
-        output_stream = guac_rdpdr_new_io_completion(device,
-                iorequest->completion_id, STATUS_SUCCESS, 5);
-        Stream_Write_UINT32(output_stream, bytes_written); /* Length */
-        Stream_Write_UINT8(output_stream, 0);              /* Padding */
-    }
+    /* Write and send completion asynchronously */
+    guac_rdpdr_fs_io_request request = {
+        .type          = GUAC_RDPDR_FS_IO_WRITE,
+        .device        = device,
+        .completion_id = iorequest->completion_id,
+        .file_id       = iorequest->file_id,
+        .offset        = offset,
+        .length        = length,
+        .data          = data
+    };
 
-    guac_rdp_common_svc_write(svc, output_stream);
+    guac_rdpdr_fs_io_submit(((guac_rdpdr*) svc->data)->fs_io, &request);
 
 }
 
@@ -470,7 +448,7 @@ void guac_rdpdr_fs_process_query_directory(guac_rdp_common_svc* svc,
     int fs_information_class, initial_query;
     int path_length;
 
-    const char* entry_name;
+    const guac_rdp_fs_dir_entry* entry;
 
     /* Get file */
     file = guac_rdp_fs_get_file((guac_rdp_fs*) device->data, iorequest->file_id);
@@ -516,61 +494,43 @@ void guac_rdpdr_fs_process_query_directory(guac_rdp_common_svc* svc,
             iorequest->file_id, initial_query, file->dir_pattern);
 
     /* Find first matching entry in directory */
-    while ((entry_name = guac_rdp_fs_read_dir((guac_rdp_fs*) device->data,
-                    iorequest->file_id)) != NULL) {
-
-        /* Convert to absolute path */
-        char entry_path[GUAC_RDP_FS_MAX_PATH];
-        if (guac_rdp_fs_convert_path(file->absolute_path,
-                    entry_name, entry_path) == 0) {
-
-            int entry_file_id;
-
-            /* Pattern defined and match fails, continue with next file */
-            if (guac_rdp_fs_matches(entry_path, file->dir_pattern))
-                continue;
-
-            /* Open directory entry */
-            entry_file_id = guac_rdp_fs_open((guac_rdp_fs*) device->data,
-                    entry_path, FILE_READ_DATA, 0, FILE_OPEN, 0);
-
-            if (entry_file_id >= 0) {
-
-                /* Dispatch to appropriate class-specific handler */
-                switch (fs_information_class) {
-
-                    case FileDirectoryInformation:
-                        guac_rdpdr_fs_process_query_directory_info(svc, device,
-                                iorequest, entry_name, entry_file_id);
-                        break;
-
-                    case FileFullDirectoryInformation:
-                        guac_rdpdr_fs_process_query_full_directory_info(svc,
-                                device, iorequest, entry_name, entry_file_id);
-                        break;
-
-                    case FileBothDirectoryInformation:
-                        guac_rdpdr_fs_process_query_both_directory_info(svc,
-                                device, iorequest, entry_name, entry_file_id);
-                        break;
-
-                    case FileNamesInformation:
-                        guac_rdpdr_fs_process_query_names_info(svc, device,
-                                iorequest, entry_name, entry_file_id);
-                        break;
-
-                    default:
-                        guac_client_log(svc->client, GUAC_LOG_DEBUG,
-                                "Unknown dir information class: 0x%x",
-                                fs_information_class);
-                }
+    entry = guac_rdp_fs_read_dir((guac_rdp_fs*) device->data,
+            iorequest->file_id, file->dir_pattern);
+
+    if (entry != NULL) {
+
+        /* Dispatch to appropriate class-specific handler */
+        switch (fs_information_class) {
+
+            case FileDirectoryInformation:
+                guac_rdpdr_fs_process_query_directory_info(svc, device,
+                        iorequest, entry);
+                break;
+
+            case FileFullDirectoryInformation:
+                guac_rdpdr_fs_process_query_full_directory_info(svc,
+                        device, iorequest, entry);
+                break;
+
+            case FileBothDirectoryInformation:
+                guac_rdpdr_fs_process_query_both_directory_info(svc,
+                        device, iorequest, entry);
+                break;
+
+            case FileNamesInformation:
+                guac_rdpdr_fs_process_query_names_info(svc, device,
+                        iorequest, entry);
+                break;
+
+            default:
+                guac_client_log(svc->client, GUAC_LOG_DEBUG,
+                        "Unknown dir information class: 0x%x",
+                        fs_information_class);
+        }
 
-                guac_rdp_fs_close((guac_rdp_fs*) device->data, entry_file_id);
-                return;
+        return;
 
-            } /* end if file exists */
-        } /* end if path valid */
-    } /* end if entry exists */
+    }
 
     /*
      * Handle errors as a lack of files.
@@ -18,6 +18,7 @@
  */
 
 #include "channels/rdpdr/rdpdr-fs.h"
+#include "channels/rdpdr/rdpdr-fs-io.h"
 #include "channels/rdpdr/rdpdr-fs-messages.h"
 #include "channels/rdpdr/rdpdr.h"
 #include "rdp.h"
@@ -34,6 +35,14 @@ void guac_rdpdr_device_fs_iorequest_handler(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device, guac_rdpdr_iorequest* iorequest,
         wStream* input_stream) {
 
+    guac_rdpdr* rdpdr = (guac_rdpdr*) svc->data;
+
+    /* Reads and writes may still be in progress on worker threads. All other
+     * requests must observe the effects of those reads and writes. */
+    if (iorequest->major_func != IRP_MJ_READ
+            && iorequest->major_func != IRP_MJ_WRITE)
+        guac_rdpdr_fs_io_drain(rdpdr->fs_io);
+
     switch (iorequest->major_func) {
 
         /* File open */
@@ -111,6 +120,14 @@ void guac_rdpdr_device_fs_iorequest_handler(guac_rdp_common_svc* svc,
 void guac_rdpdr_device_fs_free_handler(guac_rdp_common_svc* svc,
         guac_rdpdr_device* device) {
 
+    guac_rdpdr* rdpdr = (guac_rdpdr*) svc->data;
+
+    /* Finish any outstanding reads/writes and stop the I/O workers */
+    if (rdpdr->fs_io != NULL) {
+        guac_rdpdr_fs_io_free(rdpdr->fs_io);
+        rdpdr->fs_io = NULL;
+    }
+
     Stream_Free(device->device_announce, 1);
     
 }
@@ -150,5 +167,8 @@ void guac_rdpdr_register_fs(guac_rdp_common_svc* svc, char* drive_name) {
     /* Init data */
     device->data = rdp_client->filesystem;
 
+    /* Perform reads and writes on dedicated worker threads */
+    rdpdr->fs_io = guac_rdpdr_fs_io_alloc(svc);
+
 }
 
@@ -38,6 +38,12 @@
  */
 typedef struct guac_rdpdr_device guac_rdpdr_device;
 
+/**
+ * Pool of worker threads performing reads and writes for a redirected drive.
+ * See rdpdr-fs-io.h.
+ */
+typedef struct guac_rdpdr_fs_io guac_rdpdr_fs_io;
+
 /**
  * The contents of the header common to all RDPDR Device I/O Requests. See:
  *
@@ -182,6 +188,12 @@ typedef struct guac_rdpdr {
      */
     guac_rdpdr_device devices[8];
 
+    /**
+     * The worker threads performing reads and writes for the redirected
+     * drive, or NULL if no drive is redirected.
+     */
+    guac_rdpdr_fs_io* fs_io;
+
 } guac_rdpdr;
 
 /**
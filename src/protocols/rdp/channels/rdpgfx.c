@@ -27,10 +27,326 @@
 #include <freerdp/gdi/gfx.h>
 #include <freerdp/event.h>
 #include <guacamole/client.h>
+#include <guacamole/display.h>
+#include <guacamole/mem.h>
+#include <guacamole/rect.h>
 
 #include <stdlib.h>
 #include <string.h>
 
+guac_rdp_rdpgfx* guac_rdp_rdpgfx_alloc(guac_client* client) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_mem_zalloc(sizeof(guac_rdp_rdpgfx));
+    rdpgfx->client = client;
+
+    /* Not yet connected */
+    rdpgfx->rdpgfx = NULL;
+
+    return rdpgfx;
+
+}
+
+void guac_rdp_rdpgfx_free(guac_rdp_rdpgfx* rdpgfx) {
+    guac_mem_free(rdpgfx->cache_slots);
+    guac_mem_free(rdpgfx);
+}
+
+/**
+ * Returns the guac_rdp_rdpgfx module associated with the given
+ * RdpgfxClientContext. The RdpgfxClientContext must already have been
+ * initialized by gdi_graphics_pipeline_init().
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @return
+ *     The guac_rdp_rdpgfx module associated with the given
+ *     RdpgfxClientContext.
+ */
+static guac_rdp_rdpgfx* guac_rdp_rdpgfx_get(RdpgfxClientContext* context) {
+
+    rdpGdi* gdi = (rdpGdi*) context->custom;
+    guac_client* client = ((rdp_freerdp_context*) gdi->context)->client;
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+
+    return rdp_client->rdpgfx;
+
+}
+
+/**
+ * Translates the given rectangle within the given RDPGFX surface to the
+ * coordinates of the primary display, constraining the result to the bounds
+ * of that surface. Only surfaces mapped directly to the output (not scaled or
+ * mapped to RAIL windows) can be translated.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param surface_id
+ *     The ID of the surface containing the rectangle.
+ *
+ * @param left
+ *     The X coordinate of the upper-left corner of the rectangle, relative to
+ *     the surface.
+ *
+ * @param top
+ *     The Y coordinate of the upper-left corner of the rectangle, relative to
+ *     the surface.
+ *
+ * @param width
+ *     The width of the rectangle, in pixels.
+ *
+ * @param height
+ *     The height of the rectangle, in pixels.
+ *
+ * @param rect
+ *     The guac_rect that should receive the translated rectangle.
+ *
+ * @param dx
+ *     A pointer to an int that should receive the horizontal distance that
+ *     the left edge of the rectangle moved while being constrained to the
+ *     bounds of the surface.
+ *
+ * @param dy
+ *     A pointer to an int that should receive the vertical distance that the
+ *     top edge of the rectangle moved while being constrained to the bounds
+ *     of the surface.
+ *
+ * @return
+ *     Non-zero if the rectangle was translated successfully and is not empty,
+ *     zero otherwise.
+ */
+static int guac_rdp_rdpgfx_map_rect(RdpgfxClientContext* context,
+        UINT16 surface_id, int left, int top, int width, int height,
+        guac_rect* rect, int* dx, int* dy) {
+
+    gdiGfxSurface* surface = (gdiGfxSurface*) context->GetSurfaceData(context, surface_id);
+    if (surface == NULL || !surface->outputMapped)
+        return 0;
+
+    guac_rect bounds;
+    guac_rect_init(&bounds, surface->outputOriginX, surface->outputOriginY,
+            surface->width, surface->height);
+
+    guac_rect_init(rect, surface->outputOriginX + left,
+            surface->outputOriginY + top, width, height);
+
+    int original_left = rect->left;
+    int original_top = rect->top;
+
+    guac_rect_constrain(rect, &bounds);
+
+    *dx = rect->left - original_left;
+    *dy = rect->top - original_top;
+
+    return !guac_rect_is_empty(rect);
+
+}
+
+/**
+ * Handler for the RDPGFX SolidFill command which passes the command through
+ * to FreeRDP's GDI, hinting the filled regions to guac_display.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param solid_fill
+ *     The received SolidFill command.
+ *
+ * @return
+ *     CHANNEL_RC_OK (zero) if the command was handled successfully, an error
+ *     code otherwise.
+ */
+static UINT guac_rdp_rdpgfx_solid_fill(RdpgfxClientContext* context,
+        const RDPGFX_SOLID_FILL_PDU* solid_fill) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_rdp_rdpgfx_get(context);
+    guac_rdp_client* rdp_client = (guac_rdp_client*) rdpgfx->client->data;
+
+    UINT status = rdpgfx->solid_fill(context, solid_fill);
+    if (status != CHANNEL_RC_OK)
+        return status;
+
+    const RDPGFX_COLOR32* pixel = &solid_fill->fillPixel;
+    uint32_t color = 0xFF000000 | (pixel->R << 16) | (pixel->G << 8) | pixel->B;
+
+    guac_display_layer* default_layer = guac_display_default_layer(rdp_client->display);
+
+    for (int i = 0; i < solid_fill->fillRectCount; i++) {
+
+        const RECTANGLE_16* fill_rect = &solid_fill->fillRects[i];
+
+        guac_rect dst;
+        int dx, dy;
+        if (guac_rdp_rdpgfx_map_rect(context, solid_fill->surfaceId,
+                    fill_rect->left, fill_rect->top,
+                    fill_rect->right - fill_rect->left,
+                    fill_rect->bottom - fill_rect->top, &dst, &dx, &dy))
+            guac_display_layer_hint_fill(default_layer, &dst, color);
+
+    }
+
+    return status;
+
+}
+
+/**
+ * Handler for the RDPGFX SurfaceToSurface command which passes the command
+ * through to FreeRDP's GDI, hinting the copied regions to guac_display.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param surface_to_surface
+ *     The received SurfaceToSurface command.
+ *
+ * @return
+ *     CHANNEL_RC_OK (zero) if the command was handled successfully, an error
+ *     code otherwise.
+ */
+static UINT guac_rdp_rdpgfx_surface_to_surface(RdpgfxClientContext* context,
+        const RDPGFX_SURFACE_TO_SURFACE_PDU* surface_to_surface) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_rdp_rdpgfx_get(context);
+    guac_rdp_client* rdp_client = (guac_rdp_client*) rdpgfx->client->data;
+
+    UINT status = rdpgfx->surface_to_surface(context, surface_to_surface);
+    if (status != CHANNEL_RC_OK)
+        return status;
+
+    const RECTANGLE_16* rect_src = &surface_to_surface->rectSrc;
+    int width = rect_src->right - rect_src->left;
+    int height = rect_src->bottom - rect_src->top;
+
+    /* Copies can be hinted only if the source is also part of the display */
+    guac_rect src;
+    int src_dx, src_dy;
+    if (!guac_rdp_rdpgfx_map_rect(context, surface_to_surface->surfaceIdSrc,
+                rect_src->left, rect_src->top, width, height,
+                &src, &src_dx, &src_dy))
+        return status;
+
+    guac_display_layer* default_layer = guac_display_default_layer(rdp_client->display);
+
+    for (int i = 0; i < surface_to_surface->destPtsCount; i++) {
+
+        const RDPGFX_POINT16* dest_pt = &surface_to_surface->destPts[i];
+
+        guac_rect dst;
+        int dx, dy;
+        if (guac_rdp_rdpgfx_map_rect(context, surface_to_surface->surfaceIdDest,
+                    dest_pt->x, dest_pt->y, width, height, &dst, &dx, &dy))
+            guac_display_layer_hint_copy(default_layer, &dst,
+                    src.left - src_dx + dx, src.top - src_dy + dy);
+
+    }
+
+    return status;
+
+}
+
+/**
+ * Handler for the RDPGFX SurfaceToCache command which passes the command
+ * through to FreeRDP's GDI, recording the region of the display that was
+ * cached, if any, such that later CacheToSurface commands can be hinted to
+ * guac_display as copies.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param surface_to_cache
+ *     The received SurfaceToCache command.
+ *
+ * @return
+ *     CHANNEL_RC_OK (zero) if the command was handled successfully, an error
+ *     code otherwise.
+ */
+static UINT guac_rdp_rdpgfx_surface_to_cache(RdpgfxClientContext* context,
+        const RDPGFX_SURFACE_TO_CACHE_PDU* surface_to_cache) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_rdp_rdpgfx_get(context);
+
+    UINT status = rdpgfx->surface_to_cache(context, surface_to_cache);
+    if (status != CHANNEL_RC_OK)
+        return status;
+
+    UINT16 slot = surface_to_cache->cacheSlot;
+    if (slot > GUAC_RDP_RDPGFX_MAX_CACHE_SLOTS)
+        return status;
+
+    /* Cache slot tracking is allocated only once actually needed */
+    if (rdpgfx->cache_slots == NULL)
+        rdpgfx->cache_slots = guac_mem_zalloc(sizeof(guac_rect),
+                GUAC_RDP_RDPGFX_MAX_CACHE_SLOTS + 1);
+
+    /* NOTE: Cached data that does not originate entirely from the display is
+     * recorded as an empty rect and will not be hinted */
+    const RECTANGLE_16* rect_src = &surface_to_cache->rectSrc;
+    int width = rect_src->right - rect_src->left;
+    int height = rect_src->bottom - rect_src->top;
+
+    guac_rect* cached = &rdpgfx->cache_slots[slot];
+    int dx, dy;
+    if (!guac_rdp_rdpgfx_map_rect(context, surface_to_cache->surfaceId,
+                rect_src->left, rect_src->top, width, height, cached, &dx, &dy)
+            || guac_rect_width(cached) != width
+            || guac_rect_height(cached) != height)
+        *cached = (guac_rect) { 0 };
+
+    return status;
+
+}
+
+/**
+ * Handler for the RDPGFX CacheToSurface command which passes the command
+ * through to FreeRDP's GDI, hinting the restored region to guac_display as a
+ * copy of the region of the display that was originally cached.
+ *
+ * @param context
+ *     The RdpgfxClientContext associated with the RDPGFX channel.
+ *
+ * @param cache_to_surface
+ *     The received CacheToSurface command.
+ *
+ * @return
+ *     CHANNEL_RC_OK (zero) if the command was handled successfully, an error
+ *     code otherwise.
+ */
+static UINT guac_rdp_rdpgfx_cache_to_surface(RdpgfxClientContext* context,
+        const RDPGFX_CACHE_TO_SURFACE_PDU* cache_to_surface) {
+
+    guac_rdp_rdpgfx* rdpgfx = guac_rdp_rdpgfx_get(context);
+    guac_rdp_client* rdp_client = (guac_rdp_client*) rdpgfx->client->data;
+
+    UINT status = rdpgfx->cache_to_surface(context, cache_to_surface);
+    if (status != CHANNEL_RC_OK)
+        return status;
+
+    UINT16 slot = cache_to_surface->cacheSlot;
+    if (rdpgfx->cache_slots == NULL || slot > GUAC_RDP_RDPGFX_MAX_CACHE_SLOTS)
+        return status;
+
+    const guac_rect* cached = &rdpgfx->cache_slots[slot];
+    if (guac_rect_is_empty(cached))
+        return status;
+
+    guac_rect dst;
+    int dx, dy;
+    if (guac_rdp_rdpgfx_map_rect(context, cache_to_surface->surfaceId,
+                cache_to_surface->destPt.x, cache_to_surface->destPt.y,
+                guac_rect_width(cached), guac_rect_height(cached),
+                &dst, &dx, &dy)) {
+
+        guac_display_layer* default_layer = guac_display_default_layer(rdp_client->display);
+        guac_display_layer_hint_copy(default_layer, &dst,
+                cached->left + dx, cached->top + dy);
+
+    }
+
+    return status;
+
+}
+
 /**
  * Callback which associates handlers specific to Guacamole with the
  * RdpgfxClientContext instance allocated by FreeRDP to deal with received
@@ -62,12 +378,32 @@ static void guac_rdp_rdpgfx_channel_connected(rdpContext* context,
     RdpgfxClientContext* rdpgfx = (RdpgfxClientContext*) args->pInterface;
     rdpGdi* gdi = context->gdi;
 
-    if (!gdi_graphics_pipeline_init(gdi, rdpgfx))
+    if (!gdi_graphics_pipeline_init(gdi, rdpgfx)) {
         guac_client_log(client, GUAC_LOG_WARNING, "Rendering backend for RDPGFX "
                 "channel could not be loaded. Graphics may not render at all!");
-    else
-        guac_client_log(client, GUAC_LOG_DEBUG, "RDPGFX channel will be used for "
-                "the RDP Graphics Pipeline Extension.");
+        return;
+    }
+
+    /* Intercept surface commands that can be hinted to guac_display,
+     * passing those commands through to the handlers assigned by FreeRDP's
+     * GDI */
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+    guac_rdp_rdpgfx* guac_rdpgfx = rdp_client->rdpgfx;
+
+    guac_rdpgfx->solid_fill = rdpgfx->SolidFill;
+    guac_rdpgfx->surface_to_surface = rdpgfx->SurfaceToSurface;
+    guac_rdpgfx->surface_to_cache = rdpgfx->SurfaceToCache;
+    guac_rdpgfx->cache_to_surface = rdpgfx->CacheToSurface;
+
+    rdpgfx->SolidFill = guac_rdp_rdpgfx_solid_fill;
+    rdpgfx->SurfaceToSurface = guac_rdp_rdpgfx_surface_to_surface;
+    rdpgfx->SurfaceToCache = guac_rdp_rdpgfx_surface_to_cache;
+    rdpgfx->CacheToSurface = guac_rdp_rdpgfx_cache_to_surface;
+
+    guac_rdpgfx->rdpgfx = rdpgfx;
+
+    guac_client_log(client, GUAC_LOG_DEBUG, "RDPGFX channel will be used for "
+            "the RDP Graphics Pipeline Extension.");
 
 }
 
@@ -96,8 +432,27 @@ static void guac_rdp_rdpgfx_channel_disconnected(rdpContext* context,
     if (strcmp(args->name, RDPGFX_DVC_CHANNEL_NAME) != 0)
         return;
 
-    /* Un-init GDI-backed support for the Graphics Pipeline */
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+    guac_rdp_rdpgfx* guac_rdpgfx = rdp_client->rdpgfx;
+
+    /* Restore the handlers assigned by FreeRDP's GDI, if they were
+     * intercepted */
     RdpgfxClientContext* rdpgfx = (RdpgfxClientContext*) args->pInterface;
+    if (guac_rdpgfx->rdpgfx == rdpgfx) {
+
+        rdpgfx->SolidFill = guac_rdpgfx->solid_fill;
+        rdpgfx->SurfaceToSurface = guac_rdpgfx->surface_to_surface;
+        rdpgfx->SurfaceToCache = guac_rdpgfx->surface_to_cache;
+        rdpgfx->CacheToSurface = guac_rdpgfx->cache_to_surface;
+
+        guac_rdpgfx->rdpgfx = NULL;
+
+    }
+
+    /* Any cached regions are specific to the disconnected channel */
+    guac_mem_free(guac_rdpgfx->cache_slots);
+
+    /* Un-init GDI-backed support for the Graphics Pipeline */
     rdpGdi* gdi = context->gdi;
     gdi_graphics_pipeline_uninit(gdi, rdpgfx);
 
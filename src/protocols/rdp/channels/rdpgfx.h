@@ -25,6 +25,86 @@
 #include <freerdp/client/rdpgfx.h>
 #include <freerdp/freerdp.h>
 #include <guacamole/client.h>
+#include <guacamole/rect.h>
+
+/**
+ * The maximum number of cache slots that an RDP server may use to store
+ * surface data via the Graphics Pipeline. This is the number of cache slots
+ * available if the server has not requested a reduced cache size.
+ */
+#define GUAC_RDP_RDPGFX_MAX_CACHE_SLOTS 25600
+
+/**
+ * Graphics Pipeline (RDPGFX) module. Surface commands received via the
+ * Graphics Pipeline are passed through to FreeRDP's GDI, with fills and copies
+ * that target the primary surface additionally provided to guac_display as
+ * hints such that they need not be rediscovered by searching image data.
+ */
+typedef struct guac_rdp_rdpgfx {
+
+    /**
+     * The guac_client instance handling the relevant RDP connection.
+     */
+    guac_client* client;
+
+    /**
+     * RDPGFX control interface, or NULL if the RDPGFX channel is not
+     * currently connected.
+     */
+    RdpgfxClientContext* rdpgfx;
+
+    /**
+     * The SolidFill handler originally assigned by FreeRDP's GDI.
+     */
+    pcRdpgfxSolidFill solid_fill;
+
+    /**
+     * The SurfaceToSurface handler originally assigned by FreeRDP's GDI.
+     */
+    pcRdpgfxSurfaceToSurface surface_to_surface;
+
+    /**
+     * The SurfaceToCache handler originally assigned by FreeRDP's GDI.
+     */
+    pcRdpgfxSurfaceToCache surface_to_cache;
+
+    /**
+     * The CacheToSurface handler originally assigned by FreeRDP's GDI.
+     */
+    pcRdpgfxCacheToSurface cache_to_surface;
+
+    /**
+     * The region of the display from which the contents of each cache slot
+     * were most recently stored, indexed by cache slot, or NULL if no surface
+     * data has yet been cached. Slots whose contents did not originate from
+     * the display are empty rects.
+     */
+    guac_rect* cache_slots;
+
+} guac_rdp_rdpgfx;
+
+/**
+ * Allocates a new RDPGFX module, which will ultimately provide hints
+ * regarding the surface commands received via the RDPGFX channel once
+ * connected.
+ *
+ * @param client
+ *     The guac_client instance handling the relevant RDP connection.
+ *
+ * @return
+ *     A newly-allocated RDPGFX module.
+ */
+guac_rdp_rdpgfx* guac_rdp_rdpgfx_alloc(guac_client* client);
+
+/**
+ * Frees the resources associated with support for the RDPGFX channel. Only
+ * resources specific to Guacamole are freed. Resources specific to FreeRDP's
+ * handling of the RDPGFX channel will be freed by FreeRDP.
+ *
+ * @param rdpgfx
+ *     The RDPGFX module to free.
+ */
+void guac_rdp_rdpgfx_free(guac_rdp_rdpgfx* rdpgfx);
 
 /**
  * Adds FreeRDP's "rdpgfx" plugin to the list of dynamic virtual channel plugins
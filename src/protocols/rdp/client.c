@@ -24,6 +24,7 @@
 #include "channels/pipe-svc.h"
 #include "channels/rail.h"
 #include "fs.h"
+#include "gdi.h"
 #include "log.h"
 #include "rdp.h"
 #include "settings.h"
@@ -41,6 +42,7 @@
 #include <guacamole/mem.h>
 #include <guacamole/recording.h>
 #include <guacamole/rwlock.h>
+#include <guacamole/timer.h>
 
 #include <dirent.h>
 #include <errno.h>
@@ -217,6 +219,9 @@ int guac_client_init(guac_client* client, int argc, char** argv) {
     /* Init multi-touch support module (RDPEI) */
     rdp_client->rdpei = guac_rdp_rdpei_alloc(client);
 
+    /* Init Graphics Pipeline support module (RDPGFX) */
+    rdp_client->rdpgfx = guac_rdp_rdpgfx_alloc(client);
+
     /* Redirect FreeRDP log messages to guac_client_log() */
     guac_rdp_redirect_wlog(client);
 
@@ -228,6 +233,11 @@ int guac_client_init(guac_client* client, int argc, char** argv) {
     /* Init required locks */
     guac_rwlock_init(&(rdp_client->lock));
     pthread_mutex_init(&(rdp_client->message_lock), &(rdp_client->attributes));
+    pthread_mutex_init(&(rdp_client->frame_ack_lock), NULL);
+
+    /* Init timer for deferred frame acknowledgements */
+    rdp_client->frame_ack_timer = guac_timer_alloc(
+            guac_rdp_gdi_frame_ack_timeout, client);
 
     /* Set handlers */
     client->join_handler = guac_rdp_user_join_handler;
@@ -258,6 +268,9 @@ int guac_rdp_client_free_handler(guac_client* client) {
     /* Wait for client thread */
     pthread_join(rdp_client->client_thread, NULL);
 
+    /* No further frames will be received */
+    guac_timer_free(rdp_client->frame_ack_timer);
+
     /* Clean up event queue and associated signalling handle */
     guac_fifo_destroy(&rdp_client->input_events);
     CloseHandle(rdp_client->input_event_queued);
@@ -275,6 +288,9 @@ int guac_rdp_client_free_handler(guac_client* client) {
     /* Free multi-touch support module (RDPEI) */
     guac_rdp_rdpei_free(rdp_client->rdpei);
 
+    /* Free Graphics Pipeline support module (RDPGFX) */
+    guac_rdp_rdpgfx_free(rdp_client->rdpgfx);
+
     /* Clean up filesystem, if allocated */
     if (rdp_client->filesystem != NULL)
         guac_rdp_fs_free(rdp_client->filesystem);
@@ -317,6 +333,7 @@ int guac_rdp_client_free_handler(guac_client* client) {
 
     guac_rwlock_destroy(&(rdp_client->lock));
     pthread_mutex_destroy(&(rdp_client->message_lock));
+    pthread_mutex_destroy(&(rdp_client->frame_ack_lock));
 
     /* Free client data */
     guac_mem_free(rdp_client);
@@ -367,6 +367,10 @@ int guac_rdp_fs_open(guac_rdp_fs* fs, const char* path,
     file->id = file_id;
     file->fd  = fd;
     file->dir = NULL;
+    file->dir_entries = NULL;
+    file->dir_entry_count = 0;
+    file->dir_entries_size = 0;
+    file->dir_entry_index = 0;
     file->dir_pattern[0] = '\0';
     file->absolute_path = guac_strdup(normalized_path);
     file->real_path = guac_strdup(real_path);
@@ -414,7 +418,6 @@ int guac_rdp_fs_open(guac_rdp_fs* fs, const char* path,
 int guac_rdp_fs_read(guac_rdp_fs* fs, int file_id, uint64_t offset,
         void* buffer, int length) {
 
-    off_t lseek_offset;
     int bytes_read;
 
     guac_rdp_fs_file* file = guac_rdp_fs_get_file(fs, file_id);
@@ -424,11 +427,9 @@ int guac_rdp_fs_read(guac_rdp_fs* fs, int file_id, uint64_t offset,
         return GUAC_RDP_FS_EINVAL;
     }
 
-    /* Attempt read */
-    lseek_offset = lseek(file->fd, offset, SEEK_SET);
-    if (lseek_offset < 0)
-        return guac_rdp_fs_get_errorcode(errno);
-    GUAC_RETRY_EINTR(bytes_read, read(file->fd, buffer, length));
+    /* Attempt read (positional, so reads of the same file may safely occur
+     * concurrently) */
+    GUAC_RETRY_EINTR(bytes_read, pread(file->fd, buffer, length, offset));
 
     /* Translate errno on error */
     if (bytes_read < 0)
@@ -441,7 +442,6 @@ int guac_rdp_fs_read(guac_rdp_fs* fs, int file_id, uint64_t offset,
 int guac_rdp_fs_write(guac_rdp_fs* fs, int file_id, uint64_t offset,
         void* buffer, int length) {
 
-    off_t lseek_offset;
     int bytes_written;
 
     guac_rdp_fs_file* file = guac_rdp_fs_get_file(fs, file_id);
@@ -451,17 +451,17 @@ int guac_rdp_fs_write(guac_rdp_fs* fs, int file_id, uint64_t offset,
         return GUAC_RDP_FS_EINVAL;
     }
 
-    /* Attempt write */
-    lseek_offset = lseek(file->fd, offset, SEEK_SET);
-    if (lseek_offset < 0)
-        return guac_rdp_fs_get_errorcode(errno);
-    GUAC_RETRY_EINTR(bytes_written, write(file->fd, buffer, length));
+    /* Attempt write (positional, so writes to the same file may safely occur
+     * concurrently) */
+    GUAC_RETRY_EINTR(bytes_written, pwrite(file->fd, buffer, length, offset));
 
     /* Translate errno on error */
     if (bytes_written < 0)
         return guac_rdp_fs_get_errorcode(errno);
 
-    file->bytes_written += bytes_written;
+    /* Track total bytes written (atomically, as writes to the same file may
+     * be performed concurrently) */
+    __atomic_add_fetch(&file->bytes_written, bytes_written, __ATOMIC_RELAXED);
     return bytes_written;
 
 }
@@ -578,6 +578,11 @@ void guac_rdp_fs_close(guac_rdp_fs* fs, int file_id) {
     if (file->dir != NULL)
         closedir(file->dir);
 
+    /* Free any cached directory entries */
+    for (int i = 0; i < file->dir_entry_count; i++)
+        guac_mem_free(file->dir_entries[i].name);
+    guac_mem_free(file->dir_entries);
+
     /* Close file */
     close(file->fd);
 
@@ -591,31 +596,142 @@ void guac_rdp_fs_close(guac_rdp_fs* fs, int file_id) {
 
 }
 
-const char* guac_rdp_fs_read_dir(guac_rdp_fs* fs, int file_id) {
-
-    guac_rdp_fs_file* file;
+/**
+ * Reads the names of all entries within the given directory in a single pass,
+ * caching those names within the given file. The metadata of each entry is
+ * not retrieved until that entry is returned by guac_rdp_fs_read_dir().
+ *
+ * @param file
+ *     The file representing the directory to read.
+ *
+ * @return
+ *     Zero if the directory was successfully read, non-zero otherwise.
+ */
+static int guac_rdp_fs_read_dir_entries(guac_rdp_fs_file* file) {
 
     struct dirent* result;
 
-    /* Only read if file ID is valid */
-    if (file_id < 0 || file_id >= GUAC_RDP_FS_MAX_FILES)
-        return NULL;
-
-    file = &(fs->files[file_id]);
-
     /* Open directory if not yet open, stop if error */
     if (file->dir == NULL) {
         file->dir = fdopendir(file->fd);
         if (file->dir == NULL)
-            return NULL;
+            return 1;
     }
 
-    /* Read next entry, stop if error or no more entries */
-    if ((result = readdir(file->dir)) == NULL)
+    file->dir_entries_size = GUAC_RDP_FS_DIR_ENTRIES_INITIAL_SIZE;
+    file->dir_entries = guac_mem_alloc(sizeof(guac_rdp_fs_dir_entry),
+            file->dir_entries_size);
+
+    while ((result = readdir(file->dir)) != NULL) {
+
+        /* Grow cache as necessary */
+        if (file->dir_entry_count == file->dir_entries_size) {
+            file->dir_entries_size *= 2;
+            file->dir_entries = guac_mem_realloc_or_die(file->dir_entries,
+                    sizeof(guac_rdp_fs_dir_entry), file->dir_entries_size);
+        }
+
+        guac_rdp_fs_dir_entry* entry =
+            &(file->dir_entries[file->dir_entry_count++]);
+
+        entry->name = guac_strdup(result->d_name);
+
+    }
+
+    return 0;
+
+}
+
+/**
+ * Retrieves the metadata of the given entry within the given directory using
+ * fstatat(), relative to the directory itself, storing that metadata within
+ * the entry.
+ *
+ * @param file
+ *     The file representing the directory containing the entry.
+ *
+ * @param entry
+ *     The entry whose metadata should be retrieved.
+ *
+ * @return
+ *     Zero if the metadata was successfully retrieved, non-zero if the entry
+ *     cannot be stat'd (broken links, etc.).
+ */
+static int guac_rdp_fs_stat_dir_entry(guac_rdp_fs_file* file,
+        guac_rdp_fs_dir_entry* entry) {
+
+    struct stat file_stat;
+
+    /* The parent of the root directory is the root directory itself,
+     * as the drive must not expose anything outside its own root */
+    const char* stat_name = entry->name;
+    if (strcmp(stat_name, "..") == 0
+            && strcmp(file->absolute_path, "\\") == 0)
+        stat_name = ".";
+
+    if (fstatat(dirfd(file->dir), stat_name, &file_stat, 0))
+        return 1;
+
+    /* Load size and times */
+    entry->size  = file_stat.st_size;
+    entry->ctime = WINDOWS_TIME(file_stat.st_ctime);
+    entry->mtime = WINDOWS_TIME(file_stat.st_mtime);
+    entry->atime = WINDOWS_TIME(file_stat.st_atime);
+
+    /* Set type */
+    if (S_ISDIR(file_stat.st_mode))
+        entry->attributes = FILE_ATTRIBUTE_DIRECTORY;
+    else
+        entry->attributes = FILE_ATTRIBUTE_NORMAL;
+
+    return 0;
+
+}
+
+const guac_rdp_fs_dir_entry* guac_rdp_fs_read_dir(guac_rdp_fs* fs,
+        int file_id, const char* pattern) {
+
+    guac_rdp_fs_file* file;
+
+    /* Only read if file ID is valid */
+    if (file_id < 0 || file_id >= GUAC_RDP_FS_MAX_FILES)
+        return NULL;
+
+    file = &(fs->files[file_id]);
+
+    /* Read and cache all entry names if not yet read, stop if error */
+    if (file->dir_entries == NULL && guac_rdp_fs_read_dir_entries(file))
         return NULL;
 
-    /* Return filename */
-    return result->d_name;
+    /* Return next entry matching the pattern, if any */
+    while (file->dir_entry_index < file->dir_entry_count) {
+
+        guac_rdp_fs_dir_entry* entry =
+            &(file->dir_entries[file->dir_entry_index++]);
+
+        /* Skip entries not matching the pattern prior to stat'ing them */
+        if (pattern != NULL) {
+
+            char entry_path[GUAC_RDP_FS_MAX_PATH];
+            if (guac_rdp_fs_convert_path(file->absolute_path, entry->name,
+                        entry_path))
+                continue;
+
+            if (guac_rdp_fs_matches(entry_path, pattern))
+                continue;
+
+        }
+
+        /* Skip any entries that cannot be stat'd */
+        if (guac_rdp_fs_stat_dir_entry(file, entry))
+            continue;
+
+        return entry;
+
+    }
+
+    /* No more entries */
+    return NULL;
 
 }
 
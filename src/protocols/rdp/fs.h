@@ -114,6 +114,55 @@
  */
 #define WINDOWS_TIME(t) ((t + ((uint64_t) 11644473600)) * 10000000)
 
+/**
+ * The number of directory entries for which space is initially allocated when
+ * a directory is first read. Space for additional entries is allocated as
+ * needed.
+ */
+#define GUAC_RDP_FS_DIR_ENTRIES_INITIAL_SIZE 64
+
+/**
+ * The cached metadata of a single entry within a directory on the virtual
+ * filesystem of the Guacamole drive. The names of all directory entries are
+ * read in a single pass when a directory is first read, while the remaining
+ * metadata of each entry is retrieved with a single stat only when that entry
+ * is returned, such that queries against the contents of a directory need not
+ * open each file.
+ */
+typedef struct guac_rdp_fs_dir_entry {
+
+    /**
+     * The filename of this entry, relative to the containing directory.
+     */
+    char* name;
+
+    /**
+     * Bitwise OR of all associated Windows file attributes.
+     */
+    int attributes;
+
+    /**
+     * The size of this file, in bytes.
+     */
+    uint64_t size;
+
+    /**
+     * The time this file was created, as a Windows timestamp.
+     */
+    uint64_t ctime;
+
+    /**
+     * The time this file was last modified, as a Windows timestamp.
+     */
+    uint64_t mtime;
+
+    /**
+     * The time this file was last accessed, as a Windows timestamp.
+     */
+    uint64_t atime;
+
+} guac_rdp_fs_dir_entry;
+
 /**
  * An arbitrary file on the virtual filesystem of the Guacamole drive.
  */
@@ -145,6 +194,30 @@ typedef struct guac_rdp_fs_file {
      */
     DIR* dir;
 
+    /**
+     * The cached metadata of all entries within this directory, or NULL if
+     * the file is not being used as a directory or the directory has not yet
+     * been read. This cache lives only as long as the file remains open.
+     */
+    guac_rdp_fs_dir_entry* dir_entries;
+
+    /**
+     * The number of entries within the dir_entries array.
+     */
+    int dir_entry_count;
+
+    /**
+     * The number of entries that space has been allocated for within the
+     * dir_entries array.
+     */
+    int dir_entries_size;
+
+    /**
+     * The index of the next entry within dir_entries to be returned by
+     * guac_rdp_fs_read_dir().
+     */
+    int dir_entry_index;
+
     /**
      * The pattern the check directory contents against, if any.
      */
@@ -587,8 +660,11 @@ int guac_rdp_fs_convert_path(const char* parent, const char* rel_path,
         char* abs_path);
 
 /**
- * Returns the next filename within the directory having the given file ID,
- * or NULL if no more files.
+ * Returns the next entry within the directory having the given file ID that
+ * matches the given pattern, or NULL if no more files. The names of all
+ * entries within the directory are read upon the first call for a particular
+ * file ID, while the metadata of each entry is retrieved only if that entry
+ * matches the pattern. Entries which cannot be stat'd are omitted.
  *
  * @param fs
  *     The filesystem containing the file to read directory entries from.
@@ -597,11 +673,18 @@ int guac_rdp_fs_convert_path(const char* parent, const char* rel_path,
  *     The ID of the file to read directory entries from, as returned by
  *     guac_rdp_fs_open().
  *
+ * @param pattern
+ *     The pattern that the absolute path of each returned entry must match,
+ *     as tested by guac_rdp_fs_matches(), or NULL if all entries should be
+ *     returned.
+ *
  * @return
- *     The name of the next filename within the directory, or NULL if the last
- *     file in the directory has already been returned by a previous call.
+ *     The next entry within the directory, or NULL if the last entry in the
+ *     directory has already been returned by a previous call. The returned
+ *     entry remains valid until the file is closed.
  */
-const char* guac_rdp_fs_read_dir(guac_rdp_fs* fs, int file_id);
+const guac_rdp_fs_dir_entry* guac_rdp_fs_read_dir(guac_rdp_fs* fs,
+        int file_id, const char* pattern);
 
 /**
  * Returns the file having the given ID, or NULL if no such file exists.
@@ -18,6 +18,7 @@
  */
 
 #include "color.h"
+#include "gdi.h"
 #include "rdp.h"
 #include "settings.h"
 
@@ -31,8 +32,13 @@
 #include <guacamole/client.h>
 #include <guacamole/display.h>
 #include <guacamole/protocol.h>
+#include <guacamole/timer.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+#include <winpr/synch.h>
 #include <winpr/wtypes.h>
 
+#include <pthread.h>
 #include <stddef.h>
 
 void guac_rdp_gdi_mark_frame(rdpContext* context, int starting) {
@@ -51,8 +57,37 @@ BOOL guac_rdp_gdi_frame_marker(rdpContext* context, const FRAME_MARKER_ORDER* fr
     return TRUE;
 }
 
+/**
+ * Sends the pending frame acknowledgement to the RDP server if it is ready to
+ * be sent. The frame_ack_lock of the guac_rdp_client MUST already be held.
+ *
+ * @param rdp_client
+ *     The guac_rdp_client whose pending frame acknowledgement should be sent.
+ *
+ * @param context
+ *     The rdpContext associated with the current RDP session.
+ */
+static void guac_rdp_gdi_send_ready_frame_ack(guac_rdp_client* rdp_client,
+        rdpContext* context) {
+
+    if (!rdp_client->frame_ack_pending || !rdp_client->frame_ack_ready)
+        return;
+
+    pthread_mutex_lock(&(rdp_client->message_lock));
+    IFCALL(context->update->SurfaceFrameAcknowledge, context,
+            rdp_client->frame_ack_id);
+    pthread_mutex_unlock(&(rdp_client->message_lock));
+
+    rdp_client->frame_ack_pending = 0;
+    rdp_client->frame_ack_ready = 0;
+
+}
+
 BOOL guac_rdp_gdi_surface_frame_marker(rdpContext* context, const SURFACE_FRAME_MARKER* surface_frame_marker) {
 
+    guac_client* client = ((rdp_freerdp_context*) context)->client;
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+
     guac_rdp_gdi_mark_frame(context, surface_frame_marker->frameAction != SURFACECMD_FRAMEACTION_END);
 
     int frame_acknowledge;
@@ -62,14 +97,93 @@ BOOL guac_rdp_gdi_surface_frame_marker(rdpContext* context, const SURFACE_FRAME_
     frame_acknowledge = context->settings->FrameAcknowledge;
 #endif
 
-    if (frame_acknowledge > 0)
+    if (frame_acknowledge <= 0)
+        return TRUE;
+
+    /* Acknowledge immediately unless acknowledgement must be deferred until
+     * the frame has actually been received by a user */
+    if (!rdp_client->settings->defer_frame_ack) {
         IFCALL(context->update->SurfaceFrameAcknowledge, context,
                 surface_frame_marker->frameId);
+        return TRUE;
+    }
+
+    /* Only the ends of frames need be acknowledged if deferring */
+    if (surface_frame_marker->frameAction != SURFACECMD_FRAMEACTION_END)
+        return TRUE;
+
+    pthread_mutex_lock(&(rdp_client->frame_ack_lock));
+
+    /* Send any acknowledgement that is already ready before it is replaced
+     * by the acknowledgement of this frame */
+    guac_rdp_gdi_send_ready_frame_ack(rdp_client, context);
+
+    rdp_client->frame_ack_pending = 1;
+    rdp_client->frame_ack_ready = 0;
+    rdp_client->frame_ack_id = surface_frame_marker->frameId;
+    rdp_client->frame_ack_timestamp = guac_timestamp_current();
+
+    pthread_mutex_unlock(&(rdp_client->frame_ack_lock));
+
+    /* Do not wait indefinitely for a frame that may never be sent */
+    guac_timer_schedule(rdp_client->frame_ack_timer,
+            GUAC_RDP_FRAME_ACK_TIMEOUT, 0);
 
     return TRUE;
 
 }
 
+void guac_rdp_gdi_send_frame_ack(guac_rdp_client* rdp_client) {
+
+    pthread_mutex_lock(&(rdp_client->frame_ack_lock));
+    guac_rdp_gdi_send_ready_frame_ack(rdp_client,
+            GUAC_RDP_CONTEXT(rdp_client->rdp_inst));
+    pthread_mutex_unlock(&(rdp_client->frame_ack_lock));
+
+}
+
+void guac_rdp_gdi_frame_ack_timeout(void* data) {
+
+    guac_client* client = (guac_client*) data;
+    guac_rdp_client* rdp_client = (guac_rdp_client*) client->data;
+
+    pthread_mutex_lock(&(rdp_client->frame_ack_lock));
+
+    /* If no Guacamole frame has been sent since the pending frame was
+     * received, there was nothing to render, and no user will ever confirm
+     * receipt of that frame */
+    if (rdp_client->frame_ack_pending && !rdp_client->frame_ack_ready
+            && client->last_sent_timestamp <= rdp_client->frame_ack_timestamp) {
+        rdp_client->frame_ack_ready = 1;
+        SetEvent(rdp_client->input_event_queued);
+    }
+
+    pthread_mutex_unlock(&(rdp_client->frame_ack_lock));
+
+}
+
+int guac_rdp_user_sync_handler(guac_user* user, guac_timestamp timestamp) {
+
+    guac_rdp_client* rdp_client = (guac_rdp_client*) user->client->data;
+
+    pthread_mutex_lock(&(rdp_client->frame_ack_lock));
+
+    /* The pending frame acknowledgement may be sent once any user has
+     * confirmed receipt of a Guacamole frame sent after that frame was
+     * received from the RDP server. The acknowledgement is sent by the RDP
+     * client thread, which is awoken here. */
+    if (rdp_client->frame_ack_pending && !rdp_client->frame_ack_ready
+            && timestamp > rdp_client->frame_ack_timestamp) {
+        rdp_client->frame_ack_ready = 1;
+        SetEvent(rdp_client->input_event_queued);
+    }
+
+    pthread_mutex_unlock(&(rdp_client->frame_ack_lock));
+
+    return 0;
+
+}
+
 BOOL guac_rdp_gdi_begin_paint(rdpContext* context) {
 
     guac_client* client = ((rdp_freerdp_context*) context)->client;
@@ -88,6 +202,13 @@ BOOL guac_rdp_gdi_begin_paint(rdpContext* context) {
     current_context->stride = gdi->stride;
     guac_rect_init(&current_context->bounds, 0, 0, gdi->width, gdi->height);
 
+    /* Fills and copies performed via the Graphics Pipeline are explicitly
+     * hinted to guac_display as they are received, and need not be searched
+     * for within the image data of each frame (guac_display still falls back
+     * to searching if any of those hints turn out to be inaccurate) */
+    if (rdp_client->rdpgfx->rdpgfx != NULL)
+        current_context->hint_from = NULL;
+
     return TRUE;
 
 }
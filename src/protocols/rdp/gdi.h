@@ -20,8 +20,22 @@
 #ifndef GUAC_RDP_GDI_H
 #define GUAC_RDP_GDI_H
 
+#include "rdp.h"
+
 #include <freerdp/freerdp.h>
 #include <guacamole/protocol.h>
+#include <guacamole/timestamp.h>
+#include <guacamole/user.h>
+
+/**
+ * The amount of time to wait for a Guacamole frame to be sent after a frame
+ * is received from the RDP server, in milliseconds, before assuming that the
+ * RDP frame did not change the display and acknowledging it anyway. This
+ * applies only if frame acknowledgement is being deferred, and must exceed
+ * the longest time that rendering of a frame may be delayed to compensate
+ * for client-side processing lag.
+ */
+#define GUAC_RDP_FRAME_ACK_TIMEOUT 1000
 
 /**
  * Notifies the internal GDI implementation that a frame is either starting or
@@ -69,6 +83,43 @@ BOOL guac_rdp_gdi_frame_marker(rdpContext* context, const FRAME_MARKER_ORDER* fr
  */
 BOOL guac_rdp_gdi_surface_frame_marker(rdpContext* context, const SURFACE_FRAME_MARKER* surface_frame_marker);
 
+/**
+ * Sends the acknowledgement of the most recent frame received from the RDP
+ * server, if acknowledgement of that frame has been deferred and may now be
+ * sent. This function must be invoked only by the RDP client thread.
+ *
+ * @param rdp_client
+ *     The guac_rdp_client of the RDP connection whose pending frame
+ *     acknowledgement should be sent.
+ */
+void guac_rdp_gdi_send_frame_ack(guac_rdp_client* rdp_client);
+
+/**
+ * Callback for the frame_ack_timer of a guac_rdp_client, allowing a deferred
+ * frame acknowledgement to be sent if no Guacamole frame has been sent since
+ * the frame was received.
+ *
+ * @param data
+ *     The guac_client associated with the RDP connection.
+ */
+void guac_rdp_gdi_frame_ack_timeout(void* data);
+
+/**
+ * Handler for "sync" instructions received from users, allowing any deferred
+ * frame acknowledgement to be sent once a user has confirmed receipt of a
+ * Guacamole frame containing the contents of the corresponding RDP frame.
+ *
+ * @param user
+ *     The user that sent the "sync" instruction.
+ *
+ * @param timestamp
+ *     The timestamp of the Guacamole frame whose receipt is being confirmed.
+ *
+ * @return
+ *     Always zero.
+ */
+int guac_rdp_user_sync_handler(guac_user* user, guac_timestamp timestamp);
+
 /**
  * Handler called when a paint operation is beginning. This function is
  * expected to be called by the FreeRDP GDI implementation of RemoteFX when a
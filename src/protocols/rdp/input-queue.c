@@ -36,6 +36,38 @@
 
 #include <stdlib.h>
 
+/**
+ * Sends a single RDP mouse event PDU with the given flags and position to the
+ * RDP server, updating the count of mouse events sent. The message lock of the
+ * RDP client is acquired for the duration of the send.
+ *
+ * @param rdp_client
+ *     The RDP client instance that should be used to send the PDU.
+ *
+ * @param rdp_inst
+ *     The FreeRDP instance associated with the RDP client.
+ *
+ * @param flags
+ *     The PTR_FLAGS_* flags describing the mouse event.
+ *
+ * @param x
+ *     The X coordinate of the mouse pointer, in pixels.
+ *
+ * @param y
+ *     The Y coordinate of the mouse pointer, in pixels.
+ */
+static void guac_rdp_send_mouse_event(guac_rdp_client* rdp_client,
+        freerdp* rdp_inst, int flags, int x, int y) {
+
+    pthread_mutex_lock(&(rdp_client->message_lock));
+    GUAC_RDP_CONTEXT(rdp_inst)->input->MouseEvent(
+            GUAC_RDP_CONTEXT(rdp_inst)->input, flags, x, y);
+    pthread_mutex_unlock(&(rdp_client->message_lock));
+
+    rdp_client->mouse_events_sent++;
+
+}
+
 /**
  * Processes a single mouse event, updating client state and sending any
  * associated RDP PDUs via the provided RDP client instance.
@@ -46,9 +78,15 @@
  *
  * @param event
  *     The mouse event to process.
+ *
+ * @param send
+ *     Non-zero if PDUs describing the event should be sent to the RDP server,
+ *     zero if the event should only be reported to the render thread and any
+ *     in-progress recording. Only pure moves that have been superseded by a
+ *     later move may be processed without sending.
  */
 static void guac_rdp_handle_mouse_event(guac_rdp_client* rdp_client,
-        const guac_rdp_input_event* event) {
+        const guac_rdp_input_event* event, int send) {
 
     /* This function exclusively processes mouse events, and it's on the caller
      * to ensure only mouse events are provided */
@@ -73,13 +111,13 @@ static void guac_rdp_handle_mouse_event(guac_rdp_client* rdp_client,
     if (rdp_client->recording != NULL)
         guac_recording_report_mouse(rdp_client->recording, x, y, mask);
 
+    /* Skip sending positions that have been merged into a later move */
+    if (!send)
+        goto complete;
+
     /* If button mask unchanged, just send move event */
-    if (mask == rdp_client->mouse_button_mask) {
-        pthread_mutex_lock(&(rdp_client->message_lock));
-        GUAC_RDP_CONTEXT(rdp_inst)->input->MouseEvent(
-                GUAC_RDP_CONTEXT(rdp_inst)->input, PTR_FLAGS_MOVE, x, y);
-        pthread_mutex_unlock(&(rdp_client->message_lock));
-    }
+    if (mask == rdp_client->mouse_button_mask)
+        guac_rdp_send_mouse_event(rdp_client, rdp_inst, PTR_FLAGS_MOVE, x, y);
 
     /* Otherwise, send events describing button change */
     else {
@@ -99,10 +137,7 @@ static void guac_rdp_handle_mouse_event(guac_rdp_client* rdp_client,
             if (released_mask & 0x02) flags |= PTR_FLAGS_BUTTON3;
             if (released_mask & 0x04) flags |= PTR_FLAGS_BUTTON2;
 
-            pthread_mutex_lock(&(rdp_client->message_lock));
-            GUAC_RDP_CONTEXT(rdp_inst)->input->MouseEvent(
-                    GUAC_RDP_CONTEXT(rdp_inst)->input, flags, x, y);
-            pthread_mutex_unlock(&(rdp_client->message_lock));
+            guac_rdp_send_mouse_event(rdp_client, rdp_inst, flags, x, y);
 
         }
 
@@ -118,10 +153,7 @@ static void guac_rdp_handle_mouse_event(guac_rdp_client* rdp_client,
             if (pressed_mask & 0x10) flags |= PTR_FLAGS_WHEEL | PTR_FLAGS_WHEEL_NEGATIVE | 0x88;
 
             /* Send event */
-            pthread_mutex_lock(&(rdp_client->message_lock));
-            GUAC_RDP_CONTEXT(rdp_inst)->input->MouseEvent(
-                    GUAC_RDP_CONTEXT(rdp_inst)->input, flags, x, y);
-            pthread_mutex_unlock(&(rdp_client->message_lock));
+            guac_rdp_send_mouse_event(rdp_client, rdp_inst, flags, x, y);
 
         }
 
@@ -129,20 +161,14 @@ static void guac_rdp_handle_mouse_event(guac_rdp_client* rdp_client,
         if (pressed_mask & 0x18) {
 
             /* Down */
-            if (pressed_mask & 0x08) {
-                pthread_mutex_lock(&(rdp_client->message_lock));
-                GUAC_RDP_CONTEXT(rdp_inst)->input->MouseEvent(
-                        GUAC_RDP_CONTEXT(rdp_inst)->input, PTR_FLAGS_WHEEL | 0x78, x, y);
-                pthread_mutex_unlock(&(rdp_client->message_lock));
-            }
+            if (pressed_mask & 0x08)
+                guac_rdp_send_mouse_event(rdp_client, rdp_inst,
+                        PTR_FLAGS_WHEEL | 0x78, x, y);
 
             /* Up */
-            if (pressed_mask & 0x10) {
-                pthread_mutex_lock(&(rdp_client->message_lock));
-                GUAC_RDP_CONTEXT(rdp_inst)->input->MouseEvent(
-                        GUAC_RDP_CONTEXT(rdp_inst)->input, PTR_FLAGS_WHEEL | PTR_FLAGS_WHEEL_NEGATIVE | 0x88, x, y);
-                pthread_mutex_unlock(&(rdp_client->message_lock));
-            }
+            if (pressed_mask & 0x10)
+                guac_rdp_send_mouse_event(rdp_client, rdp_inst,
+                        PTR_FLAGS_WHEEL | PTR_FLAGS_WHEEL_NEGATIVE | 0x88, x, y);
 
         }
 
@@ -250,17 +276,71 @@ void guac_rdp_input_event_enqueue(guac_rdp_client* rdp_client,
 
 }
 
+/**
+ * Returns whether the given input event is a mouse event that only moves the
+ * mouse pointer, without pressing or releasing any buttons (including the
+ * scroll wheel), relative to the given button mask.
+ *
+ * @param event
+ *     The input event to test.
+ *
+ * @param mask
+ *     The button mask that is in effect prior to the given event.
+ *
+ * @return
+ *     Non-zero if the given event is a mouse event that only moves the mouse
+ *     pointer, zero otherwise.
+ */
+static int guac_rdp_input_event_is_move(const guac_rdp_input_event* event,
+        int mask) {
+    return event->type == GUAC_RDP_INPUT_EVENT_MOUSE
+        && event->details.mouse.mask == mask;
+}
+
 void guac_rdp_handle_input_events(guac_rdp_client* rdp_client) {
 
     guac_fifo_lock(&rdp_client->input_events);
 
+    /* Consecutive mouse events that only move the pointer are coalesced such
+     * that only the final position is sent to the RDP server, though every
+     * position is still reported to the render thread and any recording. Any
+     * such move is held here until an event that cannot be merged with it is
+     * encountered, or until the queue is empty. */
+    guac_rdp_input_event pending_move;
+    int move_pending = 0;
+
     guac_rdp_input_event input_event;
     while (guac_fifo_timed_dequeue(&rdp_client->input_events, &input_event, 0)) {
+
+        if (input_event.type == GUAC_RDP_INPUT_EVENT_MOUSE)
+            rdp_client->mouse_events_received++;
+
+        int is_move = guac_rdp_input_event_is_move(&input_event,
+                rdp_client->mouse_button_mask);
+
+        /* Handle any pending move before any event that cannot be merged with
+         * it, such that button transitions, wheel events, and key events are
+         * still handled in order and at the correct position */
+        if (move_pending && !(is_move && pending_move.user == input_event.user)) {
+            guac_rdp_handle_mouse_event(rdp_client, &pending_move, 1);
+            move_pending = 0;
+        }
+
+        /* Hold pure moves for merging with any subsequent moves, reporting
+         * (but not sending) any held move that this move supersedes */
+        if (is_move) {
+            if (move_pending)
+                guac_rdp_handle_mouse_event(rdp_client, &pending_move, 0);
+            pending_move = input_event;
+            move_pending = 1;
+            continue;
+        }
+
         switch (input_event.type) {
 
             /* Mouse event */
             case GUAC_RDP_INPUT_EVENT_MOUSE:
-                guac_rdp_handle_mouse_event(rdp_client, &input_event);
+                guac_rdp_handle_mouse_event(rdp_client, &input_event, 1);
                 break;
 
             /* Keyboard event */
@@ -276,6 +356,10 @@ void guac_rdp_handle_input_events(guac_rdp_client* rdp_client) {
         }
     }
 
+    /* Flush final position of any trailing run of moves */
+    if (move_pending)
+        guac_rdp_handle_mouse_event(rdp_client, &pending_move, 1);
+
     ResetEvent(rdp_client->input_event_queued);
     guac_fifo_unlock(&rdp_client->input_events);
 
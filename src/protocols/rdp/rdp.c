@@ -68,12 +68,14 @@
 #include <guacamole/socket.h>
 #include <guacamole/string.h>
 #include <guacamole/timestamp.h>
+#include <guacamole/timer.h>
 #include <guacamole/wol-constants.h>
 #include <guacamole/wol.h>
 #include <winpr/error.h>
 #include <winpr/synch.h>
 #include <winpr/wtypes.h>
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <time.h>
 
@@ -538,6 +540,11 @@ static int guac_rdp_handle_connection(guac_client* client) {
      * heuristics) */
     guac_display_layer_set_lossless(default_layer, settings->lossless);
 
+    /* Override the size of the client-side tile cache if requested */
+    if (settings->tile_cache_size >= 0)
+        guac_display_set_cache_size(rdp_client->display,
+                (size_t) settings->tile_cache_size * 1024 * 1024);
+
     rdp_client->current_surface = default_layer;
 
     rdp_client->available_svc = guac_common_list_alloc();
@@ -652,6 +659,9 @@ static int guac_rdp_handle_connection(guac_client* client) {
         /* Handle any input events that have been received */
         guac_rdp_handle_input_events(rdp_client);
 
+        /* Acknowledge any deferred frame that users have since received */
+        guac_rdp_gdi_send_frame_ack(rdp_client);
+
         /* Close connection cleanly if server is disconnecting */
         if (connection_closing)
             guac_rdp_client_abort(client, rdp_inst);
@@ -663,6 +673,10 @@ static int guac_rdp_handle_connection(guac_client* client) {
 
     }
 
+    guac_client_log(client, GUAC_LOG_DEBUG, "Received %" PRIu64 " mouse "
+            "events, sent %" PRIu64 " mouse events to the RDP server.",
+            rdp_client->mouse_events_received, rdp_client->mouse_events_sent);
+
     guac_rwlock_acquire_write_lock(&(rdp_client->lock));
 
     /* Clean up print job, if active */
@@ -676,6 +690,14 @@ static int guac_rdp_handle_connection(guac_client* client) {
     freerdp_disconnect(rdp_inst);
     pthread_mutex_unlock(&(rdp_client->message_lock));
 
+    /* Discard any deferred frame acknowledgement, as it cannot apply to any
+     * future connection */
+    guac_timer_cancel(rdp_client->frame_ack_timer);
+    pthread_mutex_lock(&(rdp_client->frame_ack_lock));
+    rdp_client->frame_ack_pending = 0;
+    rdp_client->frame_ack_ready = 0;
+    pthread_mutex_unlock(&(rdp_client->frame_ack_lock));
+
     /* Stop render loop */
     guac_display_render_thread_destroy(rdp_client->render_thread);
     rdp_client->render_thread = NULL;
@@ -24,6 +24,7 @@
 #include "channels/cliprdr.h"
 #include "channels/disp.h"
 #include "channels/rdpei.h"
+#include "channels/rdpgfx.h"
 #include "common/clipboard.h"
 #include "common/list.h"
 #include "fs.h"
@@ -47,6 +48,8 @@
 #include <guacamole/fifo.h>
 #include <guacamole/rwlock.h>
 #include <guacamole/recording.h>
+#include <guacamole/timer.h>
+#include <guacamole/timestamp.h>
 #include <winpr/wtypes.h>
 
 #include <pthread.h>
@@ -132,6 +135,50 @@ typedef struct guac_rdp_client {
      */
     guac_display_render_thread* render_thread;
 
+    /**
+     * Lock which guards the frame_ack_* members of this structure, which are
+     * shared between the RDP client thread and the threads handling "sync"
+     * instructions received from users. These members are used only if
+     * acknowledgement of RDP frames is being deferred (the "defer-frame-ack"
+     * parameter).
+     */
+    pthread_mutex_t frame_ack_lock;
+
+    /**
+     * Whether a frame has been received from the RDP server that has not yet
+     * been acknowledged.
+     */
+    int frame_ack_pending;
+
+    /**
+     * The ID of the most recent frame received from the RDP server that has
+     * not yet been acknowledged. This is meaningful only if frame_ack_pending
+     * is non-zero.
+     */
+    UINT32 frame_ack_id;
+
+    /**
+     * The time that the frame having the ID frame_ack_id was received. Any
+     * Guacamole frame sent after this time will contain that frame's
+     * contents.
+     */
+    guac_timestamp frame_ack_timestamp;
+
+    /**
+     * Whether the pending frame acknowledgement may now be sent, either
+     * because a user has confirmed receipt of a Guacamole frame containing the
+     * contents of that frame, or because no Guacamole frame has been sent
+     * since the frame was received (and none will be).
+     */
+    int frame_ack_ready;
+
+    /**
+     * Timer which allows the pending frame acknowledgement to be sent if the
+     * frame did not result in any Guacamole frame being sent within
+     * GUAC_RDP_FRAME_ACK_TIMEOUT milliseconds.
+     */
+    guac_timer* frame_ack_timer;
+
     /**
      * Queue of mouse, keyboard, and touch events. These events are accumulated
      * and flushed within the RDP client thread to avoid spending excessive
@@ -147,6 +194,20 @@ typedef struct guac_rdp_client {
      */
     guac_rdp_input_event input_events_items[GUAC_RDP_INPUT_EVENT_QUEUE_SIZE];
 
+    /**
+     * The total number of mouse events received from users and dequeued from
+     * input_events. This value is only accessed by the RDP client thread.
+     */
+    uint64_t mouse_events_received;
+
+    /**
+     * The total number of mouse event PDUs actually sent to the RDP server.
+     * As consecutive mouse movements are coalesced, this may be significantly
+     * lower than mouse_events_received. This value is only accessed by the RDP
+     * client thread.
+     */
+    uint64_t mouse_events_sent;
+
     /**
      * FreeRDP event handle that is set with SetEvent() when at least one input
      * event has been added to the input_events queue. When all input events
@@ -217,6 +278,11 @@ typedef struct guac_rdp_client {
      */
     guac_rdp_rdpei* rdpei;
 
+    /**
+     * Graphics Pipeline support module (RDPGFX).
+     */
+    guac_rdp_rdpgfx* rdpgfx;
+
     /**
      * List of all available static virtual channels.
      */
@@ -308,7 +374,8 @@ void guac_rdp_input_event_enqueue(guac_rdp_client* rdp_client,
  * Processes all events that have been enqueued with
  * guac_rdp_input_event_enqueue(), clearing the event queue and the state of
  * the input_event_queued handle. Events are processed in the order they are
- * received.
+ * received, except that consecutive mouse events which only move the mouse
+ * pointer are coalesced into a single move to the final position.
  *
  * @param rdp_client
  *     The RDP client instance whose queued input events should be processed.
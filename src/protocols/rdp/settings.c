@@ -152,6 +152,8 @@ const char* GUAC_RDP_CLIENT_ARGS[] = {
 
     "force-lossless",
     "normalize-clipboard",
+    "defer-frame-ack",
+    "tile-cache-size",
     NULL
 };
 
@@ -739,6 +741,24 @@ enum RDP_ARGS_IDX {
      */
     IDX_NORMALIZE_CLIPBOARD,
 
+    /**
+     * "true" if acknowledgement of each frame received from the RDP server
+     * should be withheld until a connected user has confirmed receipt of the
+     * Guacamole frame containing its contents, "false" or blank if frames
+     * should be acknowledged as soon as they are received. Deferring
+     * acknowledgement allows the RDP server to reduce the rate that frames
+     * are produced for clients that cannot keep up.
+     */
+    IDX_DEFER_FRAME_ACK,
+
+    /**
+     * The maximum amount of memory, in megabytes, that may be used to cache
+     * recently-sent image tiles within client-side buffers, such that
+     * recurring content can be redrawn without being sent again. "0"
+     * disables the cache. If blank, the libguac default is used.
+     */
+    IDX_TILE_CACHE_SIZE,
+
     RDP_ARGS_COUNT
 };
 
@@ -915,6 +935,16 @@ guac_rdp_settings* guac_rdp_parse_args(guac_user* user,
         guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
                 IDX_FORCE_LOSSLESS, 0);
 
+    /* Frame acknowledgement deferral */
+    settings->defer_frame_ack =
+        guac_user_parse_args_boolean(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_DEFER_FRAME_ACK, 0);
+
+    /* Client-side tile cache size */
+    settings->tile_cache_size =
+        guac_user_parse_args_int(user, GUAC_RDP_CLIENT_ARGS, argv,
+                IDX_TILE_CACHE_SIZE, -1);
+
     /* Domain */
     settings->domain =
         guac_user_parse_args_string(user, GUAC_RDP_CLIENT_ARGS, argv,
@@ -223,6 +223,20 @@ typedef struct guac_rdp_settings {
      */
     int lossless;
 
+    /**
+     * Whether acknowledgement of each frame received from the RDP server
+     * should be withheld until a connected user has confirmed receipt of the
+     * corresponding Guacamole frame.
+     */
+    int defer_frame_ack;
+
+    /**
+     * The maximum amount of memory, in megabytes, that may be used to cache
+     * recently-sent image tiles within client-side buffers, or -1 if the
+     * libguac default should be used.
+     */
+    int tile_cache_size;
+
     /**
      * Whether audio is enabled.
      */
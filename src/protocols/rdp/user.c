@@ -20,6 +20,7 @@
 #include "channels/audio-input/audio-input.h"
 #include "channels/cliprdr.h"
 #include "channels/pipe-svc.h"
+#include "gdi.h"
 #include "input.h"
 #include "rdp.h"
 #include "settings.h"
@@ -84,6 +85,14 @@ int guac_rdp_user_join_handler(guac_user* user, int argc, char** argv) {
 
     }
 
+    /* Confirmation of received frames allows deferred acknowledgement of
+     * frames from the RDP server */
+    user->sync_handler = guac_rdp_user_sync_handler;
+
+    /* Ensure the next clipboard broadcast reaches the joining user */
+    if (rdp_client->clipboard != NULL)
+        guac_common_clipboard_invalidate(rdp_client->clipboard->clipboard);
+
     /* Only handle events if not read-only */
     if (!settings->read_only) {
 
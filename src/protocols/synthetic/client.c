@@ -0,0 +1,101 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "client.h"
+#include "settings.h"
+#include "synthetic.h"
+#include "user.h"
+
+#include <guacamole/client.h>
+#include <guacamole/display.h>
+#include <guacamole/mem.h>
+#include <guacamole/socket.h>
+
+#include <pthread.h>
+
+/**
+ * A pending join handler implementation that will synchronize the connection
+ * state for all pending users prior to them being promoted to full user.
+ *
+ * @param client
+ *     The client whose pending users are about to be promoted.
+ *
+ * @return
+ *     Always zero.
+ */
+static int guac_synthetic_join_pending_handler(guac_client* client) {
+
+    guac_synthetic_client* synthetic_client = (guac_synthetic_client*) client->data;
+    guac_socket* broadcast_socket = client->pending_socket;
+
+    /* Synchronize with current display */
+    if (synthetic_client->display != NULL) {
+        guac_display_dup(synthetic_client->display, broadcast_socket);
+        guac_socket_flush(broadcast_socket);
+    }
+
+    return 0;
+
+}
+
+int guac_client_init(guac_client* client) {
+
+    /* Set client args */
+    client->args = GUAC_SYNTHETIC_CLIENT_ARGS;
+
+    /* Alloc client data */
+    guac_synthetic_client* synthetic_client = guac_mem_zalloc(sizeof(guac_synthetic_client));
+    client->data = synthetic_client;
+
+    /* Set handlers */
+    client->join_handler = guac_synthetic_user_join_handler;
+    client->join_pending_handler = guac_synthetic_join_pending_handler;
+    client->leave_handler = guac_synthetic_user_leave_handler;
+    client->free_handler = guac_synthetic_client_free_handler;
+
+    return 0;
+
+}
+
+int guac_synthetic_client_free_handler(guac_client* client) {
+
+    guac_synthetic_client* synthetic_client = (guac_synthetic_client*) client->data;
+
+    /* Ensure all background rendering processes are stopped before freeing
+     * underlying memory */
+    if (synthetic_client->display != NULL)
+        guac_display_stop(synthetic_client->display);
+
+    /* Wait for client thread to finish */
+    if (synthetic_client->client_thread_started)
+        pthread_join(synthetic_client->client_thread, NULL);
+
+    /* Free display */
+    if (synthetic_client->display != NULL)
+        guac_display_free(synthetic_client->display);
+
+    /* Free settings */
+    if (synthetic_client->settings != NULL)
+        guac_synthetic_settings_free(synthetic_client->settings);
+
+    guac_mem_free(synthetic_client);
+    return 0;
+
+}
+
@@ -0,0 +1,155 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "settings.h"
+#include "workload.h"
+
+#include <guacamole/mem.h>
+#include <guacamole/user.h>
+
+#include <limits.h>
+
+/* Client plugin arguments */
+const char* GUAC_SYNTHETIC_CLIENT_ARGS[] = {
+    "workload",
+    "width",
+    "height",
+    "frame-rate",
+    "duration",
+    "seed",
+    "read-only",
+    NULL
+};
+
+enum SYNTHETIC_ARGS_IDX {
+
+    /**
+     * The workload to render: "scroll", "windows", "video", or "terminal".
+     * If omitted, "scroll" is used.
+     */
+    IDX_WORKLOAD,
+
+    /**
+     * The width of the display, in pixels. If omitted, the optimal width of
+     * the connecting user's display is used.
+     */
+    IDX_WIDTH,
+
+    /**
+     * The height of the display, in pixels. If omitted, the optimal height of
+     * the connecting user's display is used.
+     */
+    IDX_HEIGHT,
+
+    /**
+     * The number of frames to render per second. If omitted, 30 frames are
+     * rendered per second.
+     */
+    IDX_FRAME_RATE,
+
+    /**
+     * The number of seconds after which the connection should be closed. If
+     * omitted or zero, the connection remains open until closed by the user.
+     */
+    IDX_DURATION,
+
+    /**
+     * An arbitrary integer used to seed any pseudo-random content of the
+     * workload, such that separate connections may render different content.
+     */
+    IDX_SEED,
+
+    /**
+     * "true" if this connection should be read-only (user input should be
+     * dropped), "false" or blank otherwise.
+     */
+    IDX_READ_ONLY,
+
+    SYNTHETIC_ARGS_COUNT
+};
+
+guac_synthetic_settings* guac_synthetic_parse_args(guac_user* user,
+        int argc, const char** argv) {
+
+    /* Validate arg count */
+    if (argc != SYNTHETIC_ARGS_COUNT) {
+        guac_user_log(user, GUAC_LOG_WARNING, "Incorrect number of connection "
+                "parameters provided: expected %i, got %i.",
+                SYNTHETIC_ARGS_COUNT, argc);
+        return NULL;
+    }
+
+    guac_synthetic_settings* settings = guac_mem_zalloc(sizeof(guac_synthetic_settings));
+
+    /* Parse workload */
+    settings->workload = GUAC_SYNTHETIC_DEFAULT_WORKLOAD;
+    if (argv[IDX_WORKLOAD][0] != '\0'
+            && guac_synthetic_workload_parse(argv[IDX_WORKLOAD], &settings->workload)) {
+        guac_user_log(user, GUAC_LOG_WARNING, "Invalid workload: \"%s\". "
+                "Using default.", argv[IDX_WORKLOAD]);
+    }
+
+    /* Use optimal display size unless overridden */
+    settings->width =
+        guac_user_parse_args_int_bounded(user, GUAC_SYNTHETIC_CLIENT_ARGS, argv,
+                IDX_WIDTH, user->info.optimal_width,
+                GUAC_SYNTHETIC_MIN_DIMENSION, GUAC_SYNTHETIC_MAX_DIMENSION);
+
+    settings->height =
+        guac_user_parse_args_int_bounded(user, GUAC_SYNTHETIC_CLIENT_ARGS, argv,
+                IDX_HEIGHT, user->info.optimal_height,
+                GUAC_SYNTHETIC_MIN_DIMENSION, GUAC_SYNTHETIC_MAX_DIMENSION);
+
+    /* Optimal size as reported by the user is not guaranteed to be sane */
+    if (settings->width < GUAC_SYNTHETIC_MIN_DIMENSION)
+        settings->width = GUAC_SYNTHETIC_MIN_DIMENSION;
+    else if (settings->width > GUAC_SYNTHETIC_MAX_DIMENSION)
+        settings->width = GUAC_SYNTHETIC_MAX_DIMENSION;
+
+    if (settings->height < GUAC_SYNTHETIC_MIN_DIMENSION)
+        settings->height = GUAC_SYNTHETIC_MIN_DIMENSION;
+    else if (settings->height > GUAC_SYNTHETIC_MAX_DIMENSION)
+        settings->height = GUAC_SYNTHETIC_MAX_DIMENSION;
+
+    settings->frame_rate =
+        guac_user_parse_args_int_bounded(user, GUAC_SYNTHETIC_CLIENT_ARGS, argv,
+                IDX_FRAME_RATE, GUAC_SYNTHETIC_DEFAULT_FRAME_RATE,
+                1, GUAC_SYNTHETIC_MAX_FRAME_RATE);
+
+    settings->duration =
+        guac_user_parse_args_int_bounded(user, GUAC_SYNTHETIC_CLIENT_ARGS, argv,
+                IDX_DURATION, 0, 0, INT_MAX);
+
+    settings->seed =
+        guac_user_parse_args_int(user, GUAC_SYNTHETIC_CLIENT_ARGS, argv,
+                IDX_SEED, 0);
+
+    settings->read_only =
+        guac_user_parse_args_boolean(user, GUAC_SYNTHETIC_CLIENT_ARGS, argv,
+                IDX_READ_ONLY, 0);
+
+    /* Parsing was successful */
+    return settings;
+
+}
+
+void guac_synthetic_settings_free(guac_synthetic_settings* settings) {
+    guac_mem_free(settings);
+}
+
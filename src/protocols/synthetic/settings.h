@@ -0,0 +1,140 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_SYNTHETIC_SETTINGS_H
+#define GUAC_SYNTHETIC_SETTINGS_H
+
+#include "workload.h"
+
+#include <guacamole/user.h>
+
+/**
+ * The protocol label included in the process title (the first argument passed
+ * to guac_process_title_set()), as seen in `ps`/`top`.
+ */
+#define GUAC_SYNTHETIC_PROCESS_TITLE_NAME "synthetic"
+
+/**
+ * The workload to render, if not specified.
+ */
+#define GUAC_SYNTHETIC_DEFAULT_WORKLOAD GUAC_SYNTHETIC_WORKLOAD_SCROLL
+
+/**
+ * The number of frames to render per second, if not specified.
+ */
+#define GUAC_SYNTHETIC_DEFAULT_FRAME_RATE 30
+
+/**
+ * The maximum number of frames that may be rendered per second.
+ */
+#define GUAC_SYNTHETIC_MAX_FRAME_RATE 1000
+
+/**
+ * The minimum width or height of the synthetic display, in pixels.
+ */
+#define GUAC_SYNTHETIC_MIN_DIMENSION 64
+
+/**
+ * The maximum width or height of the synthetic display, in pixels.
+ */
+#define GUAC_SYNTHETIC_MAX_DIMENSION 8192
+
+/**
+ * Settings for the synthetic connection, as parsed from the arguments given
+ * by a connecting user.
+ */
+typedef struct guac_synthetic_settings {
+
+    /**
+     * The workload to render.
+     */
+    guac_synthetic_workload_type workload;
+
+    /**
+     * The width of the display, in pixels.
+     */
+    int width;
+
+    /**
+     * The height of the display, in pixels.
+     */
+    int height;
+
+    /**
+     * The number of frames to render per second.
+     */
+    int frame_rate;
+
+    /**
+     * The number of seconds after which the connection should be closed, or
+     * zero if the connection should remain open until closed by the user.
+     */
+    int duration;
+
+    /**
+     * The arbitrary value used to seed any pseudo-random content of the
+     * workload.
+     */
+    int seed;
+
+    /**
+     * Whether this connection is read-only, and user input should be dropped.
+     */
+    int read_only;
+
+} guac_synthetic_settings;
+
+/**
+ * Parses all given args, storing them in a newly-allocated settings object. If
+ * the args fail to parse, NULL is returned.
+ *
+ * @param user
+ *     The user who submitted the given arguments while joining the
+ *     connection.
+ *
+ * @param argc
+ *     The number of arguments within the argv array.
+ *
+ * @param argv
+ *     The values of all arguments provided by the user.
+ *
+ * @return
+ *     A newly-allocated settings object which must be freed with
+ *     guac_synthetic_settings_free() when no longer needed. If the arguments
+ *     fail to parse, NULL is returned.
+ */
+guac_synthetic_settings* guac_synthetic_parse_args(guac_user* user,
+        int argc, const char** argv);
+
+/**
+ * Frees the given guac_synthetic_settings object, having been previously
+ * allocated via guac_synthetic_parse_args().
+ *
+ * @param settings
+ *     The settings object to free.
+ */
+void guac_synthetic_settings_free(guac_synthetic_settings* settings);
+
+/**
+ * NULL-terminated array of accepted client args.
+ */
+extern const char* GUAC_SYNTHETIC_CLIENT_ARGS[];
+
+#endif
+
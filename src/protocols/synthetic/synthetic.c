@@ -0,0 +1,111 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "settings.h"
+#include "synthetic.h"
+#include "workload.h"
+
+#include <guacamole/client.h>
+#include <guacamole/display.h>
+#include <guacamole/proctitle.h>
+#include <guacamole/timestamp.h>
+
+#include <stdio.h>
+
+void* guac_synthetic_client_thread(void* data) {
+
+    guac_client* client = (guac_client*) data;
+    guac_synthetic_client* synthetic_client = (guac_synthetic_client*) client->data;
+    guac_synthetic_settings* settings = synthetic_client->settings;
+
+    /* Identify the rendered display in process listings (for example,
+     * "synthetic 1920x1080@30") */
+    char title[64];
+    snprintf(title, sizeof(title), "%s %ix%i@%i",
+            GUAC_SYNTHETIC_PROCESS_TITLE_NAME, settings->width,
+            settings->height, settings->frame_rate);
+    guac_process_title_set(title);
+
+    guac_synthetic_workload* workload = &synthetic_client->workload;
+    guac_synthetic_workload_init(workload, settings->workload, settings->seed);
+
+    /* Init display at requested size */
+    guac_display* display = guac_display_alloc(client);
+    guac_display_layer* default_layer = guac_display_default_layer(display);
+    guac_display_layer_resize(default_layer, settings->width, settings->height);
+
+    if (!settings->read_only)
+        guac_display_set_cursor(display, GUAC_DISPLAY_CURSOR_POINTER);
+
+    synthetic_client->display = display;
+    synthetic_client->render_thread = guac_display_render_thread_create(display);
+
+    guac_client_log(client, GUAC_LOG_INFO, "Rendering synthetic workload at "
+            "%ix%i, %i frames per second.", settings->width, settings->height,
+            settings->frame_rate);
+
+    guac_timestamp frame_interval = 1000 / settings->frame_rate;
+    guac_timestamp start = guac_timestamp_current();
+    guac_timestamp next_frame = start;
+
+    while (client->state == GUAC_CLIENT_RUNNING) {
+
+        /* Close connection once the requested duration has elapsed */
+        guac_timestamp now = guac_timestamp_current();
+        if (settings->duration && now - start >= (guac_timestamp) settings->duration * 1000) {
+            guac_client_log(client, GUAC_LOG_INFO, "Synthetic workload "
+                    "completed after %i seconds.", settings->duration);
+            break;
+        }
+
+        /* Maintain requested frame rate */
+        if (now < next_frame)
+            guac_timestamp_msleep(next_frame - now);
+
+        /* Do not render further frames until connected clients have
+         * received previous frames, just as a real remote desktop server
+         * would not be asked for further updates */
+        guac_display_render_thread_wait_for_idle(synthetic_client->render_thread,
+                GUAC_SYNTHETIC_FLOW_CONTROL_MAX_WAIT);
+
+        guac_display_layer_raw_context* context = guac_display_layer_open_raw(default_layer);
+        guac_synthetic_workload_render(workload, context);
+        guac_display_layer_close_raw(default_layer, context);
+
+        guac_display_render_thread_notify_frame(synthetic_client->render_thread);
+
+        /* Skip any frames missed entirely due to lag, rather than attempting
+         * to render them in rapid succession */
+        next_frame += frame_interval;
+        now = guac_timestamp_current();
+        if (next_frame < now)
+            next_frame = now;
+
+    }
+
+    /* Stop render loop */
+    guac_display_render_thread_destroy(synthetic_client->render_thread);
+    synthetic_client->render_thread = NULL;
+
+    guac_client_stop(client);
+    guac_client_log(client, GUAC_LOG_INFO, "Synthetic workload stopped.");
+    return NULL;
+
+}
+
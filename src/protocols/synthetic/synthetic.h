@@ -0,0 +1,93 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_SYNTHETIC_SYNTHETIC_H
+#define GUAC_SYNTHETIC_SYNTHETIC_H
+
+#include "settings.h"
+#include "workload.h"
+
+#include <guacamole/client.h>
+#include <guacamole/display.h>
+
+#include <pthread.h>
+
+/**
+ * The maximum number of milliseconds to wait for connected clients to receive
+ * the previous frame before rendering the next frame. Waiting is bounded such
+ * that a single slow client cannot stall rendering indefinitely.
+ */
+#define GUAC_SYNTHETIC_FLOW_CONTROL_MAX_WAIT 500
+
+/**
+ * Synthetic-specific client data.
+ */
+typedef struct guac_synthetic_client {
+
+    /**
+     * Settings of the connection, as provided by the owner of the connection.
+     */
+    guac_synthetic_settings* settings;
+
+    /**
+     * The thread which renders the workload.
+     */
+    pthread_t client_thread;
+
+    /**
+     * Whether client_thread has been successfully started and must be joined
+     * when the connection is closed.
+     */
+    int client_thread_started;
+
+    /**
+     * The current state of the display. This will be NULL until the client
+     * thread has started rendering.
+     */
+    guac_display* display;
+
+    /**
+     * The thread which flushes frames of the display to connected users,
+     * compensating for client-side processing lag. This will be NULL until
+     * the client thread has started rendering.
+     */
+    guac_display_render_thread* render_thread;
+
+    /**
+     * The workload being rendered.
+     */
+    guac_synthetic_workload workload;
+
+} guac_synthetic_client;
+
+/**
+ * Renders the configured workload to the display of the given guac_client at
+ * the configured frame rate, until the connection is closed or the
+ * configured duration elapses.
+ *
+ * @param data
+ *     The guac_client associated with the synthetic connection.
+ *
+ * @return
+ *     Always NULL.
+ */
+void* guac_synthetic_client_thread(void* data);
+
+#endif
+
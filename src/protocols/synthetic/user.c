@@ -0,0 +1,107 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "settings.h"
+#include "synthetic.h"
+#include "user.h"
+
+#include <guacamole/client.h>
+#include <guacamole/display.h>
+#include <guacamole/user.h>
+
+#include <pthread.h>
+
+int guac_synthetic_user_join_handler(guac_user* user, int argc, char** argv) {
+
+    guac_synthetic_client* synthetic_client =
+        (guac_synthetic_client*) user->client->data;
+
+    /* Parse provided arguments */
+    guac_synthetic_settings* settings = guac_synthetic_parse_args(user,
+            argc, (const char**) argv);
+
+    /* Fail if settings cannot be parsed */
+    if (settings == NULL) {
+        guac_user_log(user, GUAC_LOG_INFO,
+                "Badly formatted client arguments.");
+        return 1;
+    }
+
+    /* Store settings at user level */
+    user->data = settings;
+
+    /* Start rendering if owner */
+    if (user->owner) {
+
+        /* Store owner's settings at client level */
+        synthetic_client->settings = settings;
+
+        /* Start client thread */
+        if (pthread_create(&synthetic_client->client_thread, NULL,
+                    guac_synthetic_client_thread, user->client)) {
+            guac_user_log(user, GUAC_LOG_ERROR, "Unable to start synthetic "
+                    "client thread.");
+            return 1;
+        }
+
+        synthetic_client->client_thread_started = 1;
+
+    }
+
+    /* Only handle mouse events if not read-only. The workload itself is
+     * unaffected by user input, but the mouse cursor is still rendered. */
+    if (!settings->read_only)
+        user->mouse_handler = guac_synthetic_user_mouse_handler;
+
+    return 0;
+
+}
+
+int guac_synthetic_user_leave_handler(guac_user* user) {
+
+    guac_synthetic_client* synthetic_client =
+        (guac_synthetic_client*) user->client->data;
+
+    if (synthetic_client->display)
+        guac_display_notify_user_left(synthetic_client->display, user);
+
+    /* Free settings if not owner (owner settings will be freed with client) */
+    if (!user->owner) {
+        guac_synthetic_settings* settings = (guac_synthetic_settings*) user->data;
+        guac_synthetic_settings_free(settings);
+    }
+
+    return 0;
+
+}
+
+int guac_synthetic_user_mouse_handler(guac_user* user, int x, int y, int mask) {
+
+    guac_synthetic_client* synthetic_client =
+        (guac_synthetic_client*) user->client->data;
+
+    /* Store current mouse location/state */
+    if (synthetic_client->render_thread != NULL)
+        guac_display_render_thread_notify_user_moved_mouse(
+                synthetic_client->render_thread, user, x, y, mask);
+
+    return 0;
+
+}
+
@@ -0,0 +1,481 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "workload.h"
+
+#include <guacamole/display.h>
+#include <guacamole/rect.h>
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The background color of the desktop drawn by the "windows" workload.
+ */
+#define GUAC_SYNTHETIC_DESKTOP_COLOR 0x3A6EA5
+
+/**
+ * The color of the body of the window drawn by the "windows" workload.
+ */
+#define GUAC_SYNTHETIC_WINDOW_COLOR 0xF0F0F0
+
+/**
+ * The color of the title bar of the window drawn by the "windows" workload.
+ */
+#define GUAC_SYNTHETIC_TITLE_COLOR 0x1F3F7F
+
+/**
+ * The height of the title bar of the window drawn by the "windows" workload,
+ * in pixels.
+ */
+#define GUAC_SYNTHETIC_TITLE_HEIGHT 24
+
+/**
+ * The background color of documents drawn by the "scroll" workload.
+ */
+#define GUAC_SYNTHETIC_PAPER_COLOR 0xFFFFFF
+
+/**
+ * The color of text drawn by the "scroll" and "windows" workloads.
+ */
+#define GUAC_SYNTHETIC_INK_COLOR 0x202020
+
+/**
+ * The background color of the terminal drawn by the "terminal" workload.
+ */
+#define GUAC_SYNTHETIC_TERMINAL_BACKGROUND 0x000000
+
+/**
+ * The color of text drawn by the "terminal" workload.
+ */
+#define GUAC_SYNTHETIC_TERMINAL_FOREGROUND 0xC0C0C0
+
+/**
+ * Advances the given xorshift pseudo-random number generator state,
+ * returning the next pseudo-random value.
+ *
+ * @param state
+ *     The generator state to advance. This value must never be zero.
+ *
+ * @return
+ *     The next pseudo-random value.
+ */
+static uint32_t guac_synthetic_random(uint32_t* state) {
+
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *state = x;
+
+}
+
+/**
+ * Sets every pixel within the given rectangle to the given color, extending
+ * the dirty rect of the given raw context to cover that rectangle. The
+ * rectangle is clipped to the bounds of the context.
+ *
+ * @param context
+ *     The raw context to draw to.
+ *
+ * @param rect
+ *     The rectangle to fill.
+ *
+ * @param color
+ *     The color to fill the rectangle with, in 32-bit RGB.
+ */
+static void guac_synthetic_fill(guac_display_layer_raw_context* context,
+        const guac_rect* rect, uint32_t color) {
+
+    guac_rect area = *rect;
+    guac_rect_constrain(&area, &context->bounds);
+    if (guac_rect_is_empty(&area))
+        return;
+
+    int width = guac_rect_width(&area);
+    unsigned char* buffer = GUAC_DISPLAY_LAYER_RAW_BUFFER(context, area);
+
+    for (int y = area.top; y < area.bottom; y++) {
+        uint32_t* row = (uint32_t*) buffer;
+        for (int x = 0; x < width; x++)
+            row[x] = 0xFF000000 | color;
+        buffer += context->stride;
+    }
+
+    guac_rect_extend(&context->dirty, &area);
+
+}
+
+/**
+ * Draws a single glyph-like pattern of pixels within the character cell
+ * having the given upper-left corner. The pattern drawn is determined
+ * entirely by the given character value, such that identical characters
+ * are drawn identically.
+ *
+ * @param context
+ *     The raw context to draw to.
+ *
+ * @param x
+ *     The X coordinate of the upper-left corner of the character cell.
+ *
+ * @param y
+ *     The Y coordinate of the upper-left corner of the character cell.
+ *
+ * @param c
+ *     An arbitrary character value.
+ *
+ * @param color
+ *     The color to draw the glyph with, in 32-bit RGB.
+ */
+static void guac_synthetic_draw_glyph(guac_display_layer_raw_context* context,
+        int x, int y, uint32_t c, uint32_t color) {
+
+    guac_rect cell;
+    guac_rect_init(&cell, x, y, GUAC_SYNTHETIC_CHAR_WIDTH, GUAC_SYNTHETIC_CHAR_HEIGHT);
+    guac_rect_constrain(&cell, &context->bounds);
+
+    /* Derive glyph shape from character value (never zero) */
+    uint32_t shape = c * 2654435761u + 1;
+
+    /* Leave a margin of one pixel horizontally and three pixels vertically,
+     * as would typically surround the glyphs of a monospace font */
+    for (int py = cell.top + 3; py < cell.bottom - 3; py++) {
+
+        uint32_t bits = guac_synthetic_random(&shape);
+        uint32_t* row = (uint32_t*) (context->buffer + py * context->stride);
+
+        for (int px = cell.left + 1; px < cell.right - 1; px++) {
+            if (bits & (1 << (px - cell.left)))
+                row[px] = 0xFF000000 | color;
+        }
+
+    }
+
+    guac_rect_extend(&context->dirty, &cell);
+
+}
+
+/**
+ * Draws a line of text-like glyphs spanning the given region, where runs of
+ * glyphs are separated by occasional spaces.
+ *
+ * @param context
+ *     The raw context to draw to.
+ *
+ * @param line
+ *     The region that should contain the line of text. The text is drawn
+ *     along the top of this region.
+ *
+ * @param seed
+ *     An arbitrary value which determines the content of the line. Lines
+ *     drawn with the same seed are identical.
+ *
+ * @param color
+ *     The color to draw the text with, in 32-bit RGB.
+ *
+ * @param density
+ *     The number of glyphs drawn for each space, on average.
+ */
+static void guac_synthetic_draw_text(guac_display_layer_raw_context* context,
+        const guac_rect* line, uint32_t seed, uint32_t color, int density) {
+
+    uint32_t state = seed | 1;
+
+    /* Vary the length of each line */
+    int length = guac_rect_width(line) / GUAC_SYNTHETIC_CHAR_WIDTH;
+    length -= guac_synthetic_random(&state) % (length / 4 + 1);
+
+    for (int i = 0; i < length; i++) {
+
+        uint32_t c = guac_synthetic_random(&state);
+        if (c % (density + 1) == 0)
+            continue;
+
+        guac_synthetic_draw_glyph(context,
+                line->left + i * GUAC_SYNTHETIC_CHAR_WIDTH,
+                line->top, c % 95, color);
+
+    }
+
+}
+
+/**
+ * Scrolls the contents of the given raw context upward by the given number of
+ * rows, marking the entire context as dirty. The rows exposed at the bottom
+ * are left unchanged.
+ *
+ * @param context
+ *     The raw context to scroll.
+ *
+ * @param rows
+ *     The number of rows to scroll by.
+ */
+static void guac_synthetic_scroll(guac_display_layer_raw_context* context,
+        int rows) {
+
+    int height = guac_rect_height(&context->bounds);
+    if (rows < height)
+        memmove(context->buffer, context->buffer + rows * context->stride,
+                (height - rows) * context->stride);
+
+    guac_rect_extend(&context->dirty, &context->bounds);
+
+}
+
+/**
+ * Renders the next frame of the "scroll" workload.
+ *
+ * @param workload
+ *     The workload being rendered.
+ *
+ * @param context
+ *     The raw context to draw to.
+ */
+static void guac_synthetic_render_scroll(guac_synthetic_workload* workload,
+        guac_display_layer_raw_context* context) {
+
+    guac_rect* bounds = &context->bounds;
+    int width = guac_rect_width(bounds);
+    int height = guac_rect_height(bounds);
+
+    /* Start with a full page of text */
+    if (workload->frame == 0) {
+        guac_synthetic_fill(context, bounds, GUAC_SYNTHETIC_PAPER_COLOR);
+        for (int y = 0; y < height; y += GUAC_SYNTHETIC_CHAR_HEIGHT) {
+            guac_rect line;
+            guac_rect_init(&line, GUAC_SYNTHETIC_CHAR_WIDTH * 4, y,
+                    width - GUAC_SYNTHETIC_CHAR_WIDTH * 8, GUAC_SYNTHETIC_CHAR_HEIGHT);
+            guac_synthetic_draw_text(context, &line, y / GUAC_SYNTHETIC_CHAR_HEIGHT,
+                    GUAC_SYNTHETIC_INK_COLOR, 6);
+        }
+        return;
+    }
+
+    guac_synthetic_scroll(context, GUAC_SYNTHETIC_SCROLL_ROWS);
+
+    /* Clear exposed area */
+    guac_rect exposed;
+    guac_rect_init(&exposed, 0, height - GUAC_SYNTHETIC_SCROLL_ROWS,
+            width, GUAC_SYNTHETIC_SCROLL_ROWS);
+    guac_synthetic_fill(context, &exposed, GUAC_SYNTHETIC_PAPER_COLOR);
+
+    /* Draw the next line of text once an entire line has been exposed. The
+     * line is drawn across the full character height, relying on clipping to
+     * the bounds of the context for the portion not yet exposed. */
+    int offset = (workload->frame * GUAC_SYNTHETIC_SCROLL_ROWS) % GUAC_SYNTHETIC_CHAR_HEIGHT;
+    if (offset == 0) {
+        uint64_t line_number = height / GUAC_SYNTHETIC_CHAR_HEIGHT
+            + workload->frame * GUAC_SYNTHETIC_SCROLL_ROWS / GUAC_SYNTHETIC_CHAR_HEIGHT;
+        guac_rect line;
+        guac_rect_init(&line, GUAC_SYNTHETIC_CHAR_WIDTH * 4,
+                height - GUAC_SYNTHETIC_CHAR_HEIGHT,
+                width - GUAC_SYNTHETIC_CHAR_WIDTH * 8, GUAC_SYNTHETIC_CHAR_HEIGHT);
+        guac_synthetic_fill(context, &line, GUAC_SYNTHETIC_PAPER_COLOR);
+        guac_synthetic_draw_text(context, &line, line_number,
+                GUAC_SYNTHETIC_INK_COLOR, 6);
+    }
+
+}
+
+/**
+ * Renders the next frame of the "windows" workload.
+ *
+ * @param workload
+ *     The workload being rendered.
+ *
+ * @param context
+ *     The raw context to draw to.
+ */
+static void guac_synthetic_render_windows(guac_synthetic_workload* workload,
+        guac_display_layer_raw_context* context) {
+
+    guac_rect* bounds = &context->bounds;
+    int width = guac_rect_width(bounds);
+    int height = guac_rect_height(bounds);
+
+    /* Erase window from previous position */
+    if (workload->frame == 0)
+        guac_synthetic_fill(context, bounds, GUAC_SYNTHETIC_DESKTOP_COLOR);
+    else
+        guac_synthetic_fill(context, &workload->window, GUAC_SYNTHETIC_DESKTOP_COLOR);
+
+    /* Move window back and forth across the display along a diagonal path,
+     * bouncing off of the edges */
+    int range_x = width - GUAC_SYNTHETIC_WINDOW_WIDTH;
+    int range_y = height - GUAC_SYNTHETIC_WINDOW_HEIGHT;
+    int x = 0, y = 0;
+
+    if (range_x > 0) {
+        x = (workload->frame * 7) % (range_x * 2);
+        if (x > range_x) x = range_x * 2 - x;
+    }
+
+    if (range_y > 0) {
+        y = (workload->frame * 5) % (range_y * 2);
+        if (y > range_y) y = range_y * 2 - y;
+    }
+
+    guac_rect_init(&workload->window, x, y,
+            GUAC_SYNTHETIC_WINDOW_WIDTH, GUAC_SYNTHETIC_WINDOW_HEIGHT);
+    guac_synthetic_fill(context, &workload->window, GUAC_SYNTHETIC_WINDOW_COLOR);
+
+    guac_rect title;
+    guac_rect_init(&title, x, y, GUAC_SYNTHETIC_WINDOW_WIDTH, GUAC_SYNTHETIC_TITLE_HEIGHT);
+    guac_synthetic_fill(context, &title, GUAC_SYNTHETIC_TITLE_COLOR);
+
+    /* Fill the window body with static text */
+    for (int line_y = GUAC_SYNTHETIC_TITLE_HEIGHT + 8;
+            line_y + GUAC_SYNTHETIC_CHAR_HEIGHT <= GUAC_SYNTHETIC_WINDOW_HEIGHT;
+            line_y += GUAC_SYNTHETIC_CHAR_HEIGHT) {
+        guac_rect line;
+        guac_rect_init(&line, x + 8, y + line_y,
+                GUAC_SYNTHETIC_WINDOW_WIDTH - 16, GUAC_SYNTHETIC_CHAR_HEIGHT);
+        guac_synthetic_draw_text(context, &line, line_y,
+                GUAC_SYNTHETIC_INK_COLOR, 6);
+    }
+
+}
+
+/**
+ * Renders the next frame of the "video" workload.
+ *
+ * @param workload
+ *     The workload being rendered.
+ *
+ * @param context
+ *     The raw context to draw to.
+ */
+static void guac_synthetic_render_video(guac_synthetic_workload* workload,
+        guac_display_layer_raw_context* context) {
+
+    guac_rect* bounds = &context->bounds;
+
+    int width = guac_rect_width(bounds);
+    unsigned char* buffer = GUAC_DISPLAY_LAYER_RAW_BUFFER(context, *bounds);
+
+    for (int y = bounds->top; y < bounds->bottom; y++) {
+        uint32_t* row = (uint32_t*) buffer;
+        for (int x = 0; x < width; x++)
+            row[x] = 0xFF000000 | guac_synthetic_random(&workload->random);
+        buffer += context->stride;
+    }
+
+    guac_rect_extend(&context->dirty, bounds);
+
+}
+
+/**
+ * Renders the next frame of the "terminal" workload.
+ *
+ * @param workload
+ *     The workload being rendered.
+ *
+ * @param context
+ *     The raw context to draw to.
+ */
+static void guac_synthetic_render_terminal(guac_synthetic_workload* workload,
+        guac_display_layer_raw_context* context) {
+
+    guac_rect* bounds = &context->bounds;
+    int width = guac_rect_width(bounds);
+    int height = guac_rect_height(bounds);
+
+    int rows = GUAC_SYNTHETIC_TERMINAL_LINES * GUAC_SYNTHETIC_CHAR_HEIGHT;
+
+    if (workload->frame == 0)
+        guac_synthetic_fill(context, bounds, GUAC_SYNTHETIC_TERMINAL_BACKGROUND);
+    else
+        guac_synthetic_scroll(context, rows);
+
+    /* Write several new lines of output along the bottom */
+    guac_rect exposed;
+    guac_rect_init(&exposed, 0, height - rows, width, rows);
+    guac_synthetic_fill(context, &exposed, GUAC_SYNTHETIC_TERMINAL_BACKGROUND);
+
+    for (int i = 0; i < GUAC_SYNTHETIC_TERMINAL_LINES; i++) {
+        guac_rect line;
+        guac_rect_init(&line, 0, exposed.top + i * GUAC_SYNTHETIC_CHAR_HEIGHT,
+                width, GUAC_SYNTHETIC_CHAR_HEIGHT);
+        guac_synthetic_draw_text(context, &line,
+                guac_synthetic_random(&workload->random),
+                GUAC_SYNTHETIC_TERMINAL_FOREGROUND, 12);
+    }
+
+}
+
+int guac_synthetic_workload_parse(const char* name,
+        guac_synthetic_workload_type* type) {
+
+    if (strcmp(name, "scroll") == 0)
+        *type = GUAC_SYNTHETIC_WORKLOAD_SCROLL;
+
+    else if (strcmp(name, "windows") == 0)
+        *type = GUAC_SYNTHETIC_WORKLOAD_WINDOWS;
+
+    else if (strcmp(name, "video") == 0)
+        *type = GUAC_SYNTHETIC_WORKLOAD_VIDEO;
+
+    else if (strcmp(name, "terminal") == 0)
+        *type = GUAC_SYNTHETIC_WORKLOAD_TERMINAL;
+
+    else
+        return 1;
+
+    return 0;
+
+}
+
+void guac_synthetic_workload_init(guac_synthetic_workload* workload,
+        guac_synthetic_workload_type type, uint32_t seed) {
+
+    workload->type = type;
+    workload->frame = 0;
+    workload->random = seed ? seed : 1;
+    guac_rect_init(&workload->window, 0, 0, 0, 0);
+
+}
+
+void guac_synthetic_workload_render(guac_synthetic_workload* workload,
+        guac_display_layer_raw_context* context) {
+
+    switch (workload->type) {
+
+        case GUAC_SYNTHETIC_WORKLOAD_SCROLL:
+            guac_synthetic_render_scroll(workload, context);
+            break;
+
+        case GUAC_SYNTHETIC_WORKLOAD_WINDOWS:
+            guac_synthetic_render_windows(workload, context);
+            break;
+
+        case GUAC_SYNTHETIC_WORKLOAD_VIDEO:
+            guac_synthetic_render_video(workload, context);
+            break;
+
+        case GUAC_SYNTHETIC_WORKLOAD_TERMINAL:
+            guac_synthetic_render_terminal(workload, context);
+            break;
+
+    }
+
+    workload->frame++;
+
+}
+
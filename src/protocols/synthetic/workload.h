@@ -0,0 +1,169 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_SYNTHETIC_WORKLOAD_H
+#define GUAC_SYNTHETIC_WORKLOAD_H
+
+#include <guacamole/display.h>
+#include <guacamole/rect.h>
+
+#include <stdint.h>
+
+/**
+ * The width of each character cell drawn by text-based workloads, in pixels.
+ */
+#define GUAC_SYNTHETIC_CHAR_WIDTH 8
+
+/**
+ * The height of each character cell drawn by text-based workloads, in pixels.
+ */
+#define GUAC_SYNTHETIC_CHAR_HEIGHT 16
+
+/**
+ * The number of rows that the "scroll" workload scrolls with each frame.
+ */
+#define GUAC_SYNTHETIC_SCROLL_ROWS 8
+
+/**
+ * The number of lines of text that the "terminal" workload writes with each
+ * frame.
+ */
+#define GUAC_SYNTHETIC_TERMINAL_LINES 4
+
+/**
+ * The width of the window moved by the "windows" workload, in pixels.
+ */
+#define GUAC_SYNTHETIC_WINDOW_WIDTH 480
+
+/**
+ * The height of the window moved by the "windows" workload, in pixels.
+ */
+#define GUAC_SYNTHETIC_WINDOW_HEIGHT 320
+
+/**
+ * All workloads that may be rendered by the synthetic protocol.
+ */
+typedef enum guac_synthetic_workload_type {
+
+    /**
+     * A document of text scrolling smoothly upward, as when scrolling through
+     * a web page or word processor document.
+     */
+    GUAC_SYNTHETIC_WORKLOAD_SCROLL,
+
+    /**
+     * A window being dragged around a static desktop.
+     */
+    GUAC_SYNTHETIC_WORKLOAD_WINDOWS,
+
+    /**
+     * Random noise covering the entire display, changing completely with
+     * every frame, approximating full-screen video.
+     */
+    GUAC_SYNTHETIC_WORKLOAD_VIDEO,
+
+    /**
+     * Several lines of dense text written to the bottom of a terminal with
+     * every frame, scrolling all previous lines upward, as when a large file
+     * is written to a terminal.
+     */
+    GUAC_SYNTHETIC_WORKLOAD_TERMINAL
+
+} guac_synthetic_workload_type;
+
+/**
+ * The state of a workload being rendered to a guac_display layer.
+ */
+typedef struct guac_synthetic_workload {
+
+    /**
+     * The type of workload being rendered.
+     */
+    guac_synthetic_workload_type type;
+
+    /**
+     * The number of frames rendered thus far.
+     */
+    uint64_t frame;
+
+    /**
+     * The current state of the pseudo-random number generator used to
+     * produce workload content. This value must never be zero.
+     */
+    uint32_t random;
+
+    /**
+     * The area occupied by the window of the "windows" workload as of the
+     * previous frame, or an empty rect if no window has yet been drawn.
+     */
+    guac_rect window;
+
+} guac_synthetic_workload;
+
+/**
+ * Parses the given workload name, returning the corresponding workload type.
+ *
+ * @param name
+ *     The name of the workload: "scroll", "windows", "video", or "terminal".
+ *
+ * @param type
+ *     Pointer to the guac_synthetic_workload_type that should receive the
+ *     parsed type.
+ *
+ * @return
+ *     Zero if the workload name was valid and has been parsed, non-zero if
+ *     the name is not recognized.
+ */
+int guac_synthetic_workload_parse(const char* name,
+        guac_synthetic_workload_type* type);
+
+/**
+ * Initializes the given workload state, such that the first frame of the
+ * workload will be rendered by the next call to
+ * guac_synthetic_workload_render().
+ *
+ * @param workload
+ *     The workload state to initialize.
+ *
+ * @param type
+ *     The type of workload to render.
+ *
+ * @param seed
+ *     An arbitrary value with which to seed workload content.
+ */
+void guac_synthetic_workload_init(guac_synthetic_workload* workload,
+        guac_synthetic_workload_type type, uint32_t seed);
+
+/**
+ * Renders the next frame of the given workload, updating the dirty rect of
+ * the given raw context to cover the modified region. The raw context must
+ * have been opened with guac_display_layer_open_raw() on a layer that is
+ * otherwise modified only by this workload.
+ *
+ * @param workload
+ *     The workload to render.
+ *
+ * @param context
+ *     The raw context of the layer to render to.
+ */
+void guac_synthetic_workload_render(guac_synthetic_workload* workload,
+        guac_display_layer_raw_context* context);
+
+#endif
+
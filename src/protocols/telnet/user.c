@@ -68,6 +68,10 @@ int guac_telnet_user_join_handler(guac_user* user, int argc, char** argv) {
 
     }
 
+    /* Ensure the next clipboard broadcast reaches the joining user */
+    if (telnet_client->term != NULL)
+        guac_terminal_clipboard_invalidate(telnet_client->term);
+
     /* Only handle events if not read-only */
     if (!settings->read_only) {
 
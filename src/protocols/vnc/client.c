@@ -198,6 +198,10 @@ int guac_vnc_client_free_handler(guac_client* client) {
     if (vnc_client->display != NULL)
         guac_display_free(vnc_client->display);
 
+    /* Free any pixel format converter */
+    if (vnc_client->pixel_converter != NULL)
+        guac_vnc_pixel_converter_free(vnc_client->pixel_converter);
+
 #ifdef ENABLE_PULSE
     /* If audio enabled, stop streaming */
     if (vnc_client->audio)
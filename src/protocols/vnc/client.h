@@ -37,6 +37,14 @@
  */
 #define GUAC_VNC_CONNECT_INTERVAL 1000
 
+/**
+ * The maximum amount of time to wait for connected clients to catch up
+ * before handling further messages from the VNC server when flow control is
+ * enabled, in milliseconds. Messages must still be handled eventually to
+ * avoid the connection stalling entirely.
+ */
+#define GUAC_VNC_FLOW_CONTROL_MAX_WAIT 500
+
 /**
  * Handler which frees all data associated with the guac_client.
  */
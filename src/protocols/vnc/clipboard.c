@@ -93,7 +93,9 @@ int guac_vnc_clipboard_handler(guac_user* user, guac_stream* stream,
     if (clipboard == NULL)
         return 0;
 
-    /* Clear clipboard and prepare for new data */
+    /* Clear clipboard and prepare for new data, which not all users will
+     * have */
+    guac_common_clipboard_invalidate(clipboard);
     guac_common_clipboard_reset(clipboard, mimetype);
 
     /* Set handlers for clipboard stream */
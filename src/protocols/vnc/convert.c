@@ -0,0 +1,228 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "convert.h"
+
+#include <guacamole/mem.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * Converts a single pixel value of the given format to 32-bit RGB. This is
+ * the reference conversion upon which all lookup tables and optimized
+ * conversions are based.
+ *
+ * @param format
+ *     The format of the pixel being converted.
+ *
+ * @param swap_red_blue
+ *     Non-zero if the red and blue components of the converted pixel should
+ *     be swapped, zero otherwise.
+ *
+ * @param v
+ *     The pixel value to convert.
+ *
+ * @return
+ *     The 32-bit RGB equivalent of the given pixel value, with the alpha
+ *     component set to 0xFF.
+ */
+static uint32_t guac_vnc_convert_pixel(const guac_vnc_pixel_format* format,
+        int swap_red_blue, uint32_t v) {
+
+    /* Translate value to 32-bit RGB (scaled in 64 bits such that 32-bit
+     * pixels cannot overflow) */
+    uint8_t red   = ((uint64_t) (v >> format->red_shift))   * 0x100 / (format->red_max   + 1);
+    uint8_t green = ((uint64_t) (v >> format->green_shift)) * 0x100 / (format->green_max + 1);
+    uint8_t blue  = ((uint64_t) (v >> format->blue_shift))  * 0x100 / (format->blue_max  + 1);
+
+    if (swap_red_blue)
+        return 0xFF000000 | (blue << 16) | (green << 8) | red;
+
+    return 0xFF000000 | (red << 16) | (green << 8) | blue;
+
+}
+
+/**
+ * Returns whether the given format is 32-bit RGB with 8 bits per component,
+ * identical to the format used by guac_display aside from the alpha
+ * component.
+ *
+ * @param format
+ *     The format to test.
+ *
+ * @return
+ *     Non-zero if the format is 32-bit RGB with 8 bits per component, zero
+ *     otherwise.
+ */
+static int guac_vnc_pixel_format_is_rgb32(const guac_vnc_pixel_format* format) {
+    return format->bpp == 4
+        && format->red_max   == 0xFF && format->red_shift   == 16
+        && format->green_max == 0xFF && format->green_shift == 8
+        && format->blue_max  == 0xFF && format->blue_shift  == 0;
+}
+
+/**
+ * Converts a row of 32-bit RGB pixels to 32-bit BGR, setting the alpha
+ * component of each converted pixel to 0xFF. Four pixels are converted at a
+ * time using SSE2 where available.
+ *
+ * @param src
+ *     The first pixel of the row to convert.
+ *
+ * @param dst
+ *     The buffer that should receive the converted pixels.
+ *
+ * @param width
+ *     The number of pixels to convert.
+ */
+static void guac_vnc_convert_swap_rgb32(const unsigned char* src,
+        uint32_t* dst, int width) {
+
+    int x = 0;
+
+#ifdef __SSE2__
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    const __m128i green = _mm_set1_epi32(0x0000FF00);
+    const __m128i low   = _mm_set1_epi32(0x000000FF);
+
+    for (; x + 4 <= width; x += 4) {
+
+        __m128i pixels = _mm_loadu_si128((const __m128i*) (src + x * 4));
+
+        /* Move red down to the lowest byte, and blue up to the third */
+        __m128i red  = _mm_and_si128(_mm_srli_epi32(pixels, 16), low);
+        __m128i blue = _mm_slli_epi32(_mm_and_si128(pixels, low), 16);
+
+        __m128i result = _mm_or_si128(
+                _mm_or_si128(alpha, _mm_and_si128(pixels, green)),
+                _mm_or_si128(red, blue));
+
+        _mm_storeu_si128((__m128i*) (dst + x), result);
+
+    }
+#endif
+
+    /* Convert any remaining pixels individually */
+    for (; x < width; x++) {
+
+        uint32_t v;
+        memcpy(&v, src + x * 4, sizeof(v));
+
+        dst[x] = 0xFF000000
+            | ((v & 0xFF) << 16)
+            | (v & 0xFF00)
+            | ((v >> 16) & 0xFF);
+
+    }
+
+}
+
+guac_vnc_pixel_converter* guac_vnc_pixel_converter_alloc(
+        const guac_vnc_pixel_format* format, int swap_red_blue) {
+
+    guac_vnc_pixel_converter* converter = guac_mem_alloc(sizeof(guac_vnc_pixel_converter));
+    converter->format = *format;
+    converter->swap_red_blue = swap_red_blue;
+    converter->lut = NULL;
+
+    /* 32-bit pixels are converted directly */
+    if (format->bpp == 4)
+        return converter;
+
+    /* Precompute conversion of every possible 8 or 16-bit pixel value */
+    int lut_size = (format->bpp == 2) ? 0x10000 : 0x100;
+    converter->lut = guac_mem_alloc(sizeof(uint32_t), lut_size);
+    for (int v = 0; v < lut_size; v++)
+        converter->lut[v] = guac_vnc_convert_pixel(format, swap_red_blue, v);
+
+    return converter;
+
+}
+
+void guac_vnc_pixel_converter_free(guac_vnc_pixel_converter* converter) {
+    guac_mem_free(converter->lut);
+    guac_mem_free(converter);
+}
+
+int guac_vnc_pixel_converter_matches(const guac_vnc_pixel_converter* converter,
+        const guac_vnc_pixel_format* format, int swap_red_blue) {
+
+    const guac_vnc_pixel_format* current = &converter->format;
+
+    return converter->swap_red_blue == swap_red_blue
+        && current->bpp         == format->bpp
+        && current->red_max     == format->red_max
+        && current->green_max   == format->green_max
+        && current->blue_max    == format->blue_max
+        && current->red_shift   == format->red_shift
+        && current->green_shift == format->green_shift
+        && current->blue_shift  == format->blue_shift;
+
+}
+
+void guac_vnc_pixel_converter_convert(const guac_vnc_pixel_converter* converter,
+        const unsigned char* src, uint32_t* dst, int width) {
+
+    const guac_vnc_pixel_format* format = &converter->format;
+
+    switch (format->bpp) {
+
+        /* 16-bit pixels are translated via lookup table */
+        case 2: {
+            const uint32_t* lut = converter->lut;
+            for (int x = 0; x < width; x++) {
+                uint16_t v;
+                memcpy(&v, src + x * 2, sizeof(v));
+                dst[x] = lut[v];
+            }
+            break;
+        }
+
+        /* 32-bit pixels are translated arithmetically, using SIMD for the
+         * common case of swapping red and blue */
+        case 4:
+
+            if (guac_vnc_pixel_format_is_rgb32(format) && converter->swap_red_blue) {
+                guac_vnc_convert_swap_rgb32(src, dst, width);
+                break;
+            }
+
+            for (int x = 0; x < width; x++) {
+                uint32_t v;
+                memcpy(&v, src + x * 4, sizeof(v));
+                dst[x] = guac_vnc_convert_pixel(format, converter->swap_red_blue, v);
+            }
+            break;
+
+        /* All other pixels are read as 8-bit and translated via lookup
+         * table */
+        default: {
+            const uint32_t* lut = converter->lut;
+            for (int x = 0; x < width; x++)
+                dst[x] = lut[src[x * format->bpp]];
+        }
+
+    }
+
+}
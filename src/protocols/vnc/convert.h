@@ -0,0 +1,178 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef GUAC_VNC_CONVERT_H
+#define GUAC_VNC_CONVERT_H
+
+/**
+ * Conversion of pixels within the VNC framebuffer to the 32-bit RGB format
+ * used by guac_display, for framebuffer formats which guac_display cannot use
+ * directly.
+ *
+ * @file convert.h
+ */
+
+#include <stdint.h>
+
+/**
+ * The format of the pixels within a VNC framebuffer. This is equivalent to
+ * the relevant portion of rfbPixelFormat, and is kept independent of
+ * libvncclient such that conversion can be tested in isolation.
+ */
+typedef struct guac_vnc_pixel_format {
+
+    /**
+     * The number of bytes used to store each pixel. Any value other than 2 or
+     * 4 is interpreted as 1.
+     */
+    int bpp;
+
+    /**
+     * The maximum value of the red component of each pixel.
+     */
+    int red_max;
+
+    /**
+     * The maximum value of the green component of each pixel.
+     */
+    int green_max;
+
+    /**
+     * The maximum value of the blue component of each pixel.
+     */
+    int blue_max;
+
+    /**
+     * The number of bits that each pixel must be shifted right to obtain the
+     * red component.
+     */
+    int red_shift;
+
+    /**
+     * The number of bits that each pixel must be shifted right to obtain the
+     * green component.
+     */
+    int green_shift;
+
+    /**
+     * The number of bits that each pixel must be shifted right to obtain the
+     * blue component.
+     */
+    int blue_shift;
+
+} guac_vnc_pixel_format;
+
+/**
+ * Converter which translates rows of pixels of a particular VNC framebuffer
+ * format to 32-bit RGB. Pixels of 8 or 16 bits are translated with a lookup
+ * table covering every possible pixel value, while 32-bit pixels are
+ * translated arithmetically (using SIMD instructions for the common case of
+ * swapping the red and blue components, where available).
+ */
+typedef struct guac_vnc_pixel_converter {
+
+    /**
+     * The format of the pixels being converted.
+     */
+    guac_vnc_pixel_format format;
+
+    /**
+     * Non-zero if the red and blue components of each converted pixel should
+     * be swapped, zero otherwise.
+     */
+    int swap_red_blue;
+
+    /**
+     * Lookup table mapping every possible 8 or 16-bit pixel value to its
+     * 32-bit RGB equivalent, or NULL if pixels are 32-bit.
+     */
+    uint32_t* lut;
+
+} guac_vnc_pixel_converter;
+
+/**
+ * Allocates a new converter for pixels of the given format, building any
+ * lookup tables required.
+ *
+ * @param format
+ *     The format of the pixels to be converted.
+ *
+ * @param swap_red_blue
+ *     Non-zero if the red and blue components of each converted pixel should
+ *     be swapped, zero otherwise.
+ *
+ * @return
+ *     A newly-allocated guac_vnc_pixel_converter, which must eventually be
+ *     freed with guac_vnc_pixel_converter_free().
+ */
+guac_vnc_pixel_converter* guac_vnc_pixel_converter_alloc(
+        const guac_vnc_pixel_format* format, int swap_red_blue);
+
+/**
+ * Frees the given converter and any associated lookup tables.
+ *
+ * @param converter
+ *     The converter to free.
+ */
+void guac_vnc_pixel_converter_free(guac_vnc_pixel_converter* converter);
+
+/**
+ * Returns whether the given converter converts pixels of the given format
+ * with the given red/blue swapping behavior, and thus need not be replaced.
+ *
+ * @param converter
+ *     The converter to test.
+ *
+ * @param format
+ *     The pixel format to compare against that of the converter.
+ *
+ * @param swap_red_blue
+ *     Non-zero if the red and blue components of each converted pixel should
+ *     be swapped, zero otherwise.
+ *
+ * @return
+ *     Non-zero if the converter matches the given format and red/blue
+ *     swapping behavior, zero otherwise.
+ */
+int guac_vnc_pixel_converter_matches(const guac_vnc_pixel_converter* converter,
+        const guac_vnc_pixel_format* format, int swap_red_blue);
+
+/**
+ * Converts a single row of pixels from the format of the given converter to
+ * 32-bit RGB. The alpha component of each converted pixel is always 0xFF.
+ *
+ * @param converter
+ *     The converter to use.
+ *
+ * @param src
+ *     The first pixel of the row to convert, stored in the format of the
+ *     converter.
+ *
+ * @param dst
+ *     The buffer that should receive the converted pixels. This buffer must
+ *     have space for at least width 32-bit pixels.
+ *
+ * @param width
+ *     The number of pixels to convert.
+ */
+void guac_vnc_pixel_converter_convert(const guac_vnc_pixel_converter* converter,
+        const unsigned char* src, uint32_t* dst, int width);
+
+#endif
+
@@ -40,6 +40,7 @@ const char* GUAC_VNC_CLIENT_ARGS[] = {
     "port",
     "read-only",
     "disable-display-resize",
+    "flow-control",
     "encodings",
     GUAC_VNC_ARGV_USERNAME,
     GUAC_VNC_ARGV_PASSWORD,
@@ -104,6 +105,7 @@ const char* GUAC_VNC_CLIENT_ARGS[] = {
     "force-lossless",
     "compress-level",
     "quality-level",
+    "tile-cache-size",
     NULL
 };
 
@@ -132,6 +134,14 @@ enum VNC_ARGS_IDX {
      */
     IDX_DISABLE_DISPLAY_RESIZE,
 
+    /**
+     * "true" if requests for further framebuffer updates should be delayed
+     * until connected clients have caught up with the updates already
+     * received, "false" or blank if updates should be requested as quickly
+     * as they can be handled.
+     */
+    IDX_FLOW_CONTROL,
+
     /**
      * Space-separated list of encodings to use within the VNC session. If not
      * specified, this will be:
@@ -450,6 +460,14 @@ enum VNC_ARGS_IDX {
      */
     IDX_QUALITY_LEVEL,
 
+    /**
+     * The maximum amount of memory, in megabytes, that may be used to cache
+     * recently-sent image tiles within client-side buffers, such that
+     * recurring content can be redrawn without being sent again. "0"
+     * disables the cache. If blank, the libguac default is used.
+     */
+    IDX_TILE_CACHE_SIZE,
+
     VNC_ARGS_COUNT
 };
 
@@ -514,6 +532,11 @@ guac_vnc_settings* guac_vnc_parse_args(guac_user* user,
             guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
                                          IDX_DISABLE_DISPLAY_RESIZE, false);
 
+    /* Flow control of framebuffer updates */
+    settings->flow_control =
+            guac_user_parse_args_boolean(user, GUAC_VNC_CLIENT_ARGS, argv,
+                                         IDX_FLOW_CONTROL, false);
+
     /* Parse color depth */
     settings->color_depth =
         guac_user_parse_args_int(user, GUAC_VNC_CLIENT_ARGS, argv,
@@ -534,6 +557,11 @@ guac_vnc_settings* guac_vnc_parse_args(guac_user* user,
         guac_user_parse_args_int(user, GUAC_VNC_CLIENT_ARGS, argv,
                 IDX_QUALITY_LEVEL, -1);
 
+    /* Client-side tile cache size */
+    settings->tile_cache_size =
+        guac_user_parse_args_int(user, GUAC_VNC_CLIENT_ARGS, argv,
+                IDX_TILE_CACHE_SIZE, -1);
+
 #ifdef ENABLE_VNC_REPEATER
     /* Set repeater parameters if specified */
     settings->dest_host =
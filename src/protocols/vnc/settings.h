@@ -69,6 +69,13 @@ typedef struct guac_vnc_settings {
      */
     bool disable_display_resize;
 
+    /**
+     * Whether requests for further framebuffer updates should be delayed
+     * until connected clients have caught up with the updates already
+     * received, allowing the VNC server to coalesce changes in the meantime.
+     */
+    bool flow_control;
+
     /**
      * Space-separated list of encodings to use within the VNC session.
      */
@@ -107,6 +114,13 @@ typedef struct guac_vnc_settings {
       */
     int quality_level;
 
+    /**
+     * The maximum amount of memory, in megabytes, that may be used to cache
+     * recently-sent image tiles within client-side buffers, or -1 if the
+     * libguac default should be used.
+     */
+    int tile_cache_size;
+
 #ifdef ENABLE_VNC_REPEATER
     /**
      * The VNC host to connect to, if using a repeater.
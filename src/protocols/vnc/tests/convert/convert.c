@@ -0,0 +1,240 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "convert.h"
+
+#include <CUnit/CUnit.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The 16-bit RGB565 format used by most VNC servers for 16-bit color.
+ */
+static const guac_vnc_pixel_format test_format_rgb565 = {
+    .bpp = 2,
+    .red_max = 31, .green_max = 63, .blue_max = 31,
+    .red_shift = 11, .green_shift = 5, .blue_shift = 0
+};
+
+/**
+ * The 16-bit RGB555 format used by some VNC servers for 15-bit color.
+ */
+static const guac_vnc_pixel_format test_format_rgb555 = {
+    .bpp = 2,
+    .red_max = 31, .green_max = 31, .blue_max = 31,
+    .red_shift = 10, .green_shift = 5, .blue_shift = 0
+};
+
+/**
+ * The 8-bit BGR233 format used by libvncclient for 8-bit color.
+ */
+static const guac_vnc_pixel_format test_format_bgr233 = {
+    .bpp = 1,
+    .red_max = 7, .green_max = 7, .blue_max = 3,
+    .red_shift = 0, .green_shift = 3, .blue_shift = 6
+};
+
+/**
+ * The 32-bit RGB format used by guac_display, aside from alpha.
+ */
+static const guac_vnc_pixel_format test_format_rgb32 = {
+    .bpp = 4,
+    .red_max = 255, .green_max = 255, .blue_max = 255,
+    .red_shift = 16, .green_shift = 8, .blue_shift = 0
+};
+
+/**
+ * Converts a single pixel using the same arithmetic as the per-pixel loop
+ * used by guac_vnc_update() prior to the introduction of
+ * guac_vnc_pixel_converter, serving as the reference against which all
+ * converted output is checked. Unlike that loop, which read only the first
+ * byte of any pixel that was not 16 bits wide, 32-bit pixels are read in full.
+ *
+ * @param format
+ *     The format of the pixel to convert.
+ *
+ * @param swap_red_blue
+ *     Non-zero if red and blue should be swapped, zero otherwise.
+ *
+ * @param pixel
+ *     Pointer to the pixel to convert.
+ *
+ * @return
+ *     The converted 32-bit pixel.
+ */
+static uint32_t reference_convert(const guac_vnc_pixel_format* format,
+        int swap_red_blue, const unsigned char* pixel) {
+
+    uint32_t v;
+    switch (format->bpp) {
+
+        case 2:
+            v = *((uint16_t*) pixel);
+            break;
+
+        case 4:
+            v = *((uint32_t*) pixel);
+            break;
+
+        default:
+            v = *((uint8_t*) pixel);
+
+    }
+
+    uint8_t red   = (v >> format->red_shift)   * 0x100 / (format->red_max   + 1);
+    uint8_t green = (v >> format->green_shift) * 0x100 / (format->green_max + 1);
+    uint8_t blue  = (v >> format->blue_shift)  * 0x100 / (format->blue_max  + 1);
+
+    if (swap_red_blue)
+        return 0xFF000000 | (blue << 16) | (green << 8) | red;
+
+    return 0xFF000000 | (red << 16) | (green << 8) | blue;
+
+}
+
+/**
+ * Verifies that every possible pixel value of the given 8 or 16-bit format is
+ * converted identically to the reference conversion, both with and without
+ * swapping of red and blue.
+ *
+ * @param format
+ *     The format to test.
+ */
+static void verify_all_values(const guac_vnc_pixel_format* format) {
+
+    int count = (format->bpp == 2) ? 0x10000 : 0x100;
+
+    /* Build row containing every possible value */
+    unsigned char* src = malloc(count * format->bpp);
+    for (int v = 0; v < count; v++) {
+        if (format->bpp == 2) {
+            uint16_t value = v;
+            memcpy(src + v * 2, &value, sizeof(value));
+        }
+        else
+            src[v] = v;
+    }
+
+    uint32_t* dst = malloc(count * sizeof(uint32_t));
+
+    for (int swap = 0; swap <= 1; swap++) {
+
+        guac_vnc_pixel_converter* converter = guac_vnc_pixel_converter_alloc(format, swap);
+        guac_vnc_pixel_converter_convert(converter, src, dst, count);
+
+        int mismatches = 0;
+        for (int v = 0; v < count; v++) {
+            if (dst[v] != reference_convert(format, swap, src + v * format->bpp))
+                mismatches++;
+        }
+
+        CU_ASSERT_EQUAL(mismatches, 0);
+        guac_vnc_pixel_converter_free(converter);
+
+    }
+
+    free(dst);
+    free(src);
+
+}
+
+/**
+ * Test which verifies that all RGB565 pixels are converted identically to the
+ * reference conversion.
+ */
+void test_convert__rgb565(void) {
+    verify_all_values(&test_format_rgb565);
+}
+
+/**
+ * Test which verifies that all RGB555 pixels are converted identically to the
+ * reference conversion.
+ */
+void test_convert__rgb555(void) {
+    verify_all_values(&test_format_rgb555);
+}
+
+/**
+ * Test which verifies that all BGR233 pixels are converted identically to the
+ * reference conversion.
+ */
+void test_convert__bgr233(void) {
+    verify_all_values(&test_format_bgr233);
+}
+
+/**
+ * Test which verifies that swapping red and blue within 32-bit pixels produces
+ * output identical to the reference conversion for all row lengths and
+ * alignments, including rows not evenly divisible into SIMD-sized chunks.
+ */
+void test_convert__swap_rgb32(void) {
+
+    unsigned char src[4 * 64 + 4];
+    uint32_t dst[64];
+
+    /* Fill source with arbitrary but deterministic pixel data */
+    srand(0x1B872E69);
+    for (int i = 0; i < sizeof(src); i++)
+        src[i] = rand();
+
+    guac_vnc_pixel_converter* converter =
+        guac_vnc_pixel_converter_alloc(&test_format_rgb32, 1);
+
+    for (int offset = 0; offset < 4; offset++) {
+        for (int width = 0; width <= 64; width++) {
+
+            const unsigned char* row = src + offset;
+            guac_vnc_pixel_converter_convert(converter, row, dst, width);
+
+            int mismatches = 0;
+            for (int x = 0; x < width; x++) {
+                uint32_t pixel;
+                memcpy(&pixel, row + x * 4, sizeof(pixel));
+                if (dst[x] != reference_convert(&test_format_rgb32, 1,
+                            (unsigned char*) &pixel))
+                    mismatches++;
+            }
+
+            CU_ASSERT_EQUAL(mismatches, 0);
+
+        }
+    }
+
+    guac_vnc_pixel_converter_free(converter);
+
+}
+
+/**
+ * Test which verifies that converters correctly report whether they match a
+ * given format and red/blue swapping behavior.
+ */
+void test_convert__matches(void) {
+
+    guac_vnc_pixel_converter* converter =
+        guac_vnc_pixel_converter_alloc(&test_format_rgb565, 0);
+
+    CU_ASSERT_TRUE(guac_vnc_pixel_converter_matches(converter, &test_format_rgb565, 0));
+    CU_ASSERT_FALSE(guac_vnc_pixel_converter_matches(converter, &test_format_rgb565, 1));
+    CU_ASSERT_FALSE(guac_vnc_pixel_converter_matches(converter, &test_format_rgb555, 0));
+
+    guac_vnc_pixel_converter_free(converter);
+
+}
+
@@ -74,6 +74,10 @@ int guac_vnc_user_join_handler(guac_user* user, int argc, char** argv) {
 
     }
 
+    /* Ensure the next clipboard broadcast reaches the joining user */
+    if (vnc_client->clipboard != NULL)
+        guac_common_clipboard_invalidate(vnc_client->clipboard);
+
     /* Only handle events if not read-only */
     if (!settings->read_only) {
 
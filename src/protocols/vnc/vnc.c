@@ -372,6 +372,48 @@ static int guac_vnc_wait_for_messages(rfbClient* rfb_client, int msec_timeout) {
 
 }
 
+/**
+ * Waits for connected clients to catch up with the framebuffer updates
+ * already received from the VNC server, up to GUAC_VNC_FLOW_CONTROL_MAX_WAIT
+ * milliseconds. As libvncclient requests the next framebuffer update only
+ * after the current update has been handled, delaying the handling of
+ * further messages allows the VNC server to coalesce changes into fewer
+ * updates rather than those updates being decoded only to be replaced
+ * before a slow client can display them.
+ *
+ * @param client
+ *     The guac_client associated with the VNC connection.
+ */
+static void guac_vnc_wait_for_client(guac_client* client) {
+
+    guac_vnc_client* vnc_client = (guac_vnc_client*) client->data;
+    guac_timestamp wait_start = guac_timestamp_current();
+
+    /* Wait for any completed frames to be flushed (the render thread itself
+     * delays flushing frames while clients are lagging) */
+    if (!guac_display_render_thread_wait_for_idle(vnc_client->render_thread,
+                GUAC_VNC_FLOW_CONTROL_MAX_WAIT))
+        return;
+
+    /* Allow any remaining client-side processing lag to elapse */
+    int time_since_last_frame = guac_timestamp_current() - client->last_sent_timestamp;
+    int required_wait = guac_client_get_processing_lag(client) - time_since_last_frame;
+
+    /* Never wait longer than the maximum overall */
+    int remaining_wait = GUAC_VNC_FLOW_CONTROL_MAX_WAIT
+        - (guac_timestamp_current() - wait_start);
+    if (required_wait > remaining_wait)
+        required_wait = remaining_wait;
+
+    if (required_wait > 0) {
+        guac_client_log(client, GUAC_LOG_TRACE, "Delaying handling of VNC "
+                "messages by %ims to allow client to catch up.",
+                required_wait);
+        guac_timestamp_msleep(required_wait);
+    }
+
+}
+
 /**
  * Handles any inbound VNC messages that have been received, updating the
  * Guacamole display accordingly.
@@ -720,6 +762,11 @@ void* guac_vnc_client_thread(void* data) {
     guac_display_layer_set_lossless(guac_display_default_layer(vnc_client->display),
             settings->lossless);
 
+    /* Override the size of the client-side tile cache if requested */
+    if (settings->tile_cache_size >= 0)
+        guac_display_set_cache_size(vnc_client->display,
+                (size_t) settings->tile_cache_size * 1024 * 1024);
+
     /* If compression and display quality have been configured, set those. */
     if (settings->compress_level >= 0 && settings->compress_level <= 9)
         rfb_client->appData.compressLevel = settings->compress_level;
@@ -752,6 +799,11 @@ void* guac_vnc_client_thread(void* data) {
         int wait_result = guac_vnc_wait_for_messages(rfb_client, GUAC_VNC_MESSAGE_CHECK_INTERVAL);
         while (wait_result > 0) {
 
+            /* Allow clients to catch up before handling (and thus requesting)
+             * further updates */
+            if (settings->flow_control)
+                guac_vnc_wait_for_client(client);
+
             /* Handle any message received */
             if (!guac_vnc_handle_messages(client)) {
                 guac_client_abort(client,
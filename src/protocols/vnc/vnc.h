@@ -22,6 +22,7 @@
 
 #include "common/clipboard.h"
 #include "common/iconv.h"
+#include "convert.h"
 #include "display.h"
 #include "settings.h"
 
@@ -116,6 +117,14 @@ typedef struct guac_vnc_client {
      */
     guac_display_layer_raw_context* current_context;
 
+    /**
+     * The converter used to translate pixels within the VNC framebuffer to
+     * the format used by guac_display, if the VNC framebuffer format cannot
+     * be used directly. If no conversion has yet been necessary, this will be
+     * NULL.
+     */
+    guac_vnc_pixel_converter* pixel_converter;
+
     /**
      * The current instance of the guac_display render thread. If the thread
      * has not yet been started, this will be NULL.
@@ -25,9 +25,14 @@
 #include <guacamole/mem.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 /**
  * The minimum number of columns to allocate for a buffer row, regardless of
  * the terminal size. We set a minimum size here to reduce the memory
@@ -35,13 +40,56 @@
  */
 #define GUAC_TERMINAL_BUFFER_ROW_MIN_SIZE 256
 
+/**
+ * The number of consecutive rows stored within each chunk of the buffer.
+ * Chunks are the unit of storage that is packed, compressed, and unpacked as
+ * rows move into and out of the scrollback region.
+ */
+#define GUAC_TERMINAL_BUFFER_CHUNK_ROWS 64
+
+/**
+ * The number of rows of scrollback immediately above the top of the terminal
+ * display that are always kept in their expanded form. Chunks containing
+ * these rows are never packed, as they are likely to be modified or viewed
+ * again soon.
+ */
+#define GUAC_TERMINAL_BUFFER_HOT_ROWS 256
+
+/**
+ * The number of rows beyond GUAC_TERMINAL_BUFFER_HOT_ROWS that a packed chunk
+ * must be from the top of the terminal display before it is additionally
+ * compressed. This has no effect if guacamole-server was built without zlib.
+ */
+#define GUAC_TERMINAL_BUFFER_COMPRESS_ROWS 4096
+
+/**
+ * The maximum number of distinct sets of attributes that may be referenced by
+ * the packed chunks of a single buffer. This value is also used to represent
+ * the absence of an attribute table entry, and thus is not itself a valid
+ * index.
+ */
+#define GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES 0xFFFF
+
+/**
+ * The number of hash buckets used to locate entries within the attribute
+ * table of each buffer.
+ */
+#define GUAC_TERMINAL_BUFFER_ATTRIBUTE_BUCKETS 0x400
+
+/**
+ * The initial number of entries to allocate for the attribute table of a
+ * buffer. The table grows by doubling as necessary.
+ */
+#define GUAC_TERMINAL_BUFFER_ATTRIBUTE_INITIAL_SIZE 64
+
 /**
  * A single variable-length row of terminal data.
  */
 typedef struct guac_terminal_buffer_row {
 
     /**
-     * Array of guac_terminal_char representing the contents of the row.
+     * Array of guac_terminal_char representing the contents of the row, or
+     * NULL if no storage has yet been allocated for this row.
      */
     guac_terminal_char* characters;
 
@@ -66,6 +114,179 @@ typedef struct guac_terminal_buffer_row {
 
 } guac_terminal_buffer_row;
 
+/**
+ * The compact representation of a single guac_terminal_char within a packed
+ * chunk. Rather than storing a full copy of the character's attributes, each
+ * cell references an entry within the attribute table of the buffer.
+ */
+typedef struct guac_terminal_buffer_cell {
+
+    /**
+     * The Unicode codepoint of the character, or GUAC_CHAR_CONTINUATION if
+     * this character is part of another character which spans multiple
+     * columns.
+     */
+    int32_t value;
+
+    /**
+     * The index of the attributes of this character within the attribute
+     * table of the buffer.
+     */
+    uint16_t attributes;
+
+    /**
+     * The number of columns this character occupies.
+     */
+    uint8_t width;
+
+} guac_terminal_buffer_cell;
+
+/**
+ * The packed representation of a single guac_terminal_buffer_row. The
+ * characters of the row are stored as guac_terminal_buffer_cell within the
+ * cell storage of the containing chunk. Any trailing characters that are
+ * identical to the default character of the buffer are not stored at all.
+ */
+typedef struct guac_terminal_buffer_packed_row {
+
+    /**
+     * The index of the first cell of this row within the cell storage of the
+     * containing chunk.
+     */
+    unsigned int offset;
+
+    /**
+     * The number of cells actually stored for this row. All characters
+     * between this value and the length of the row are the default character.
+     */
+    unsigned int stored;
+
+    /**
+     * The length of the original row in characters.
+     */
+    unsigned int length;
+
+    /**
+     * True if the original row had been wrapped to avoid going off the
+     * screen. False otherwise.
+     */
+    bool wrapped_row;
+
+} guac_terminal_buffer_packed_row;
+
+/**
+ * The form in which the rows of a chunk are currently stored.
+ */
+typedef enum guac_terminal_buffer_chunk_state {
+
+    /**
+     * Each row of the chunk is stored as a guac_terminal_buffer_row that may
+     * be directly read and modified.
+     */
+    GUAC_TERMINAL_BUFFER_CHUNK_EXPANDED,
+
+    /**
+     * The rows of the chunk are stored within a single contiguous array of
+     * guac_terminal_buffer_cell, and must be expanded before use.
+     */
+    GUAC_TERMINAL_BUFFER_CHUNK_PACKED,
+
+    /**
+     * The rows of the chunk are stored as with
+     * GUAC_TERMINAL_BUFFER_CHUNK_PACKED, but the contiguous array of cells has
+     * additionally been compressed.
+     */
+    GUAC_TERMINAL_BUFFER_CHUNK_COMPRESSED
+
+} guac_terminal_buffer_chunk_state;
+
+/**
+ * A contiguous range of GUAC_TERMINAL_BUFFER_CHUNK_ROWS rows within the ring
+ * buffer of a guac_terminal_buffer (fewer for the final chunk if the buffer
+ * size is not a multiple of GUAC_TERMINAL_BUFFER_CHUNK_ROWS).
+ */
+typedef struct guac_terminal_buffer_chunk {
+
+    /**
+     * The form in which the rows of this chunk are currently stored.
+     */
+    guac_terminal_buffer_chunk_state state;
+
+    /**
+     * The number of rows within this chunk.
+     */
+    unsigned int length;
+
+    /**
+     * The rows of this chunk, or NULL if the chunk is not currently expanded.
+     */
+    guac_terminal_buffer_row* rows;
+
+    /**
+     * The packed representations of the rows of this chunk, or NULL if the
+     * chunk is currently expanded.
+     */
+    guac_terminal_buffer_packed_row* packed_rows;
+
+    /**
+     * The contiguous storage of all cells referenced by packed_rows, or NULL
+     * if the chunk is currently expanded or compressed, or if no cells needed
+     * to be stored.
+     */
+    guac_terminal_buffer_cell* cells;
+
+    /**
+     * The number of cells referenced by packed_rows. This value is only
+     * meaningful if the chunk is not currently expanded.
+     */
+    size_t cell_count;
+
+    /**
+     * The compressed form of the cells referenced by packed_rows, or NULL if
+     * the chunk is not currently compressed.
+     */
+    unsigned char* compressed;
+
+    /**
+     * The size of the compressed data, in bytes.
+     */
+    size_t compressed_length;
+
+    /**
+     * Whether a previous attempt to compress this chunk did not reduce its
+     * size. Such chunks are not compressed again until they have been
+     * expanded and repacked.
+     */
+    bool incompressible;
+
+} guac_terminal_buffer_chunk;
+
+/**
+ * A set of character attributes that is referenced by the cells of packed
+ * chunks.
+ */
+typedef struct guac_terminal_buffer_attribute_entry {
+
+    /**
+     * The attributes represented by this entry.
+     */
+    guac_terminal_attributes attributes;
+
+    /**
+     * The number of packed cells that currently reference this entry. If zero,
+     * this entry is unused and is part of the free list.
+     */
+    unsigned int references;
+
+    /**
+     * The index of the next entry within the same hash bucket or, if this
+     * entry is unused, the index of the next unused entry. If there is no
+     * such entry, this will be GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES.
+     */
+    uint16_t next;
+
+} guac_terminal_buffer_attribute_entry;
+
 struct guac_terminal_buffer {
 
     /**
@@ -74,11 +295,16 @@ struct guac_terminal_buffer {
     guac_terminal_char default_character;
 
     /**
-     * Array of buffer rows. This array functions as a ring buffer.
-     * When a new row needs to be appended, the top reference is moved down
-     * and the old top row is replaced.
+     * Array of all chunks of buffer rows. Together, the rows of these chunks
+     * function as a ring buffer. When a new row needs to be appended, the top
+     * reference is moved down and the old top row is replaced.
      */
-    guac_terminal_buffer_row* rows;
+    guac_terminal_buffer_chunk* chunks;
+
+    /**
+     * The number of chunks in the chunks array.
+     */
+    unsigned int chunk_count;
 
     /**
      * The index of the first row in the buffer (the row which represents row 0
@@ -99,37 +325,748 @@ struct guac_terminal_buffer {
      */
     unsigned int available;
 
+    /**
+     * The index of the first row currently shown by the terminal display,
+     * relative to the top of the display. This is negative if the terminal
+     * has been scrolled to view part of the scrollback buffer.
+     */
+    int visible_top;
+
+    /**
+     * The number of rows within the terminal display.
+     */
+    int visible_rows;
+
+    /**
+     * The index of the next chunk to be considered for packing or compression
+     * when the buffer is scrolled. Chunks are visited round-robin, such that
+     * chunks that were expanded while viewing scrollback are eventually
+     * packed again.
+     */
+    unsigned int sweep;
+
+    /**
+     * Table of all distinct sets of attributes referenced by packed chunks.
+     */
+    guac_terminal_buffer_attribute_entry* attributes;
+
+    /**
+     * The number of entries within the attributes table that have ever been
+     * used, including entries which are now part of the free list.
+     */
+    unsigned int attributes_length;
+
+    /**
+     * The number of entries allocated for the attributes table.
+     */
+    unsigned int attributes_available;
+
+    /**
+     * The index of the first unused entry within the attributes table, or
+     * GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES if there are no unused entries.
+     */
+    uint16_t free_attributes;
+
+    /**
+     * The index of the first entry within each hash bucket of the attributes
+     * table, or GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES if the bucket is empty.
+     */
+    uint16_t attribute_buckets[GUAC_TERMINAL_BUFFER_ATTRIBUTE_BUCKETS];
+
+    /**
+     * The approximate number of bytes of memory currently allocated for this
+     * buffer, including all rows, chunks, and attribute table storage.
+     */
+    size_t memory;
+
 };
 
+/**
+ * Allocates a block of memory via guac_mem_alloc(), adding the size of that
+ * block to the memory usage tracked for the given buffer.
+ *
+ * @param buffer
+ *     The buffer that will own the allocated memory.
+ *
+ * @param count
+ *     The number of elements to allocate.
+ *
+ * @param size
+ *     The size of each element, in bytes.
+ *
+ * @return
+ *     The newly-allocated memory, which must eventually be freed with
+ *     guac_terminal_buffer_free_memory().
+ */
+static void* guac_terminal_buffer_alloc_memory(guac_terminal_buffer* buffer,
+        size_t count, size_t size) {
+    buffer->memory += guac_mem_ckd_mul_or_die(count, size);
+    return guac_mem_alloc(count, size);
+}
+
+/**
+ * Frees a block of memory allocated with guac_terminal_buffer_alloc_memory(),
+ * subtracting the size of that block from the memory usage tracked for the
+ * given buffer.
+ *
+ * @param buffer
+ *     The buffer that owns the memory being freed.
+ *
+ * @param mem
+ *     The memory to free. If NULL, this function has no effect.
+ *
+ * @param count
+ *     The number of elements originally allocated.
+ *
+ * @param size
+ *     The size of each element, in bytes.
+ */
+static void guac_terminal_buffer_free_memory(guac_terminal_buffer* buffer,
+        void* mem, size_t count, size_t size) {
+
+    if (mem == NULL)
+        return;
+
+    buffer->memory -= count * size;
+    guac_mem_free(mem);
+
+}
+
+/**
+ * Returns whether the given colors are identical in every respect, including
+ * their palette index.
+ *
+ * @param a
+ *     The first color to compare.
+ *
+ * @param b
+ *     The second color to compare.
+ *
+ * @return
+ *     true if the colors are identical, false otherwise.
+ */
+static bool guac_terminal_buffer_color_equals(const guac_terminal_color* a,
+        const guac_terminal_color* b) {
+    return a->palette_index == b->palette_index
+        && a->red   == b->red
+        && a->green == b->green
+        && a->blue  == b->blue;
+}
+
+/**
+ * Returns whether the given sets of character attributes are identical.
+ *
+ * @param a
+ *     The first set of attributes to compare.
+ *
+ * @param b
+ *     The second set of attributes to compare.
+ *
+ * @return
+ *     true if the attributes are identical, false otherwise.
+ */
+static bool guac_terminal_buffer_attributes_equal(const guac_terminal_attributes* a,
+        const guac_terminal_attributes* b) {
+    return a->bold        == b->bold
+        && a->half_bright == b->half_bright
+        && a->cursor      == b->cursor
+        && a->reverse     == b->reverse
+        && a->underscore  == b->underscore
+        && guac_terminal_buffer_color_equals(&a->foreground, &b->foreground)
+        && guac_terminal_buffer_color_equals(&a->background, &b->background);
+}
+
+/**
+ * Returns whether the given characters are identical, including their
+ * attributes.
+ *
+ * @param a
+ *     The first character to compare.
+ *
+ * @param b
+ *     The second character to compare.
+ *
+ * @return
+ *     true if the characters are identical, false otherwise.
+ */
+static bool guac_terminal_buffer_char_equals(const guac_terminal_char* a,
+        const guac_terminal_char* b) {
+    return a->value == b->value
+        && a->width == b->width
+        && guac_terminal_buffer_attributes_equal(&a->attributes, &b->attributes);
+}
+
+/**
+ * Returns the hash bucket of the attribute table that the given set of
+ * attributes belongs to.
+ *
+ * @param attributes
+ *     The attributes to hash.
+ *
+ * @return
+ *     The index of the hash bucket for the given attributes.
+ */
+static unsigned int guac_terminal_buffer_attributes_hash(
+        const guac_terminal_attributes* attributes) {
+
+    const guac_terminal_color* fg = &attributes->foreground;
+    const guac_terminal_color* bg = &attributes->background;
+
+    uint32_t hash = attributes->bold
+        | (attributes->half_bright << 1)
+        | (attributes->cursor      << 2)
+        | (attributes->reverse     << 3)
+        | (attributes->underscore  << 4);
+
+    hash = hash * 31 + (uint32_t) fg->palette_index;
+    hash = hash * 31 + ((fg->red << 16) | (fg->green << 8) | fg->blue);
+    hash = hash * 31 + (uint32_t) bg->palette_index;
+    hash = hash * 31 + ((bg->red << 16) | (bg->green << 8) | bg->blue);
+
+    return (hash ^ (hash >> 16)) % GUAC_TERMINAL_BUFFER_ATTRIBUTE_BUCKETS;
+
+}
+
+/**
+ * Adds a reference to the given set of attributes within the attribute table
+ * of the given buffer, adding a new entry to the table if necessary.
+ *
+ * @param buffer
+ *     The buffer whose attribute table should be used.
+ *
+ * @param attributes
+ *     The attributes to reference.
+ *
+ * @return
+ *     The index of the entry within the attribute table, or -1 if the
+ *     attribute table is full and a new entry could not be added.
+ */
+static int guac_terminal_buffer_attributes_ref(guac_terminal_buffer* buffer,
+        const guac_terminal_attributes* attributes) {
+
+    unsigned int bucket = guac_terminal_buffer_attributes_hash(attributes);
+
+    /* Reuse existing entry if present */
+    uint16_t index = buffer->attribute_buckets[bucket];
+    while (index != GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES) {
+
+        guac_terminal_buffer_attribute_entry* entry = &buffer->attributes[index];
+        if (guac_terminal_buffer_attributes_equal(&entry->attributes, attributes)) {
+            entry->references++;
+            return index;
+        }
+
+        index = entry->next;
+
+    }
+
+    /* Prefer previously-used entries that are now free */
+    if (buffer->free_attributes != GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES) {
+        index = buffer->free_attributes;
+        buffer->free_attributes = buffer->attributes[index].next;
+    }
+
+    /* Otherwise, add an entry to the end of the table */
+    else {
+
+        if (buffer->attributes_length >= GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES)
+            return -1;
+
+        /* Grow table if full */
+        if (buffer->attributes_length == buffer->attributes_available) {
+
+            unsigned int available = buffer->attributes_available * 2;
+            if (available > GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES)
+                available = GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES;
+
+            buffer->attributes = guac_mem_realloc_or_die(buffer->attributes,
+                    sizeof(guac_terminal_buffer_attribute_entry), available);
+
+            buffer->memory += (available - buffer->attributes_available)
+                * sizeof(guac_terminal_buffer_attribute_entry);
+
+            buffer->attributes_available = available;
+
+        }
+
+        index = buffer->attributes_length++;
+
+    }
+
+    guac_terminal_buffer_attribute_entry* entry = &buffer->attributes[index];
+    entry->attributes = *attributes;
+    entry->references = 1;
+    entry->next = buffer->attribute_buckets[bucket];
+    buffer->attribute_buckets[bucket] = index;
+
+    return index;
+
+}
+
+/**
+ * Removes a reference to the entry at the given index within the attribute
+ * table of the given buffer. If no further references to that entry remain,
+ * the entry is removed from the table and may be reused.
+ *
+ * @param buffer
+ *     The buffer whose attribute table should be used.
+ *
+ * @param index
+ *     The index of the entry to dereference.
+ */
+static void guac_terminal_buffer_attributes_unref(guac_terminal_buffer* buffer,
+        uint16_t index) {
+
+    guac_terminal_buffer_attribute_entry* entry = &buffer->attributes[index];
+    GUAC_ASSERT(entry->references > 0);
+
+    if (--entry->references > 0)
+        return;
+
+    /* Unlink entry from its hash bucket */
+    unsigned int bucket = guac_terminal_buffer_attributes_hash(&entry->attributes);
+    uint16_t* current = &buffer->attribute_buckets[bucket];
+    while (*current != index) {
+        GUAC_ASSERT(*current != GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES);
+        current = &buffer->attributes[*current].next;
+    }
+
+    *current = entry->next;
+
+    /* Entry is now free for reuse */
+    entry->next = buffer->free_attributes;
+    buffer->free_attributes = index;
+
+}
+
+/**
+ * Rounds the given value up to the nearest possible row length. To avoid
+ * unnecessary, repeated resizing of rows, each row length is rounded up to the
+ * nearest power of two.
+ *
+ * @param value
+ *     The value to round.
+ *
+ * @return
+ *     The power of two that is closest to the given value without exceeding
+ *     that value.
+ */
+static unsigned int guac_terminal_buffer_row_length(int value) {
+
+    GUAC_ASSERT(value >= 0);
+    GUAC_ASSERT(value <= GUAC_TERMINAL_MAX_COLUMNS);
+
+    unsigned int rounded = GUAC_TERMINAL_BUFFER_ROW_MIN_SIZE;
+    while (rounded < value)
+        rounded <<= 1;
+
+    return rounded;
+
+}
+
+/**
+ * Allocates storage for the characters of the given row, which must not
+ * already have any such storage. The storage allocated will be sufficient for
+ * at least the given number of characters, and all characters will be
+ * initialized to the default character of the buffer.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param row
+ *     The row to allocate storage for.
+ *
+ * @param length
+ *     The number of characters that the row must be able to store.
+ */
+static void guac_terminal_buffer_row_init(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_row* row, int length) {
+
+    GUAC_ASSERT(row->characters == NULL);
+
+    row->available = guac_terminal_buffer_row_length(length);
+    row->characters = guac_terminal_buffer_alloc_memory(buffer,
+            row->available, sizeof(guac_terminal_char));
+
+    for (int i = 0; i < row->available; i++)
+        row->characters[i] = buffer->default_character;
+
+}
+
+/**
+ * Converts the given chunk of the given buffer from its packed form to its
+ * expanded form, decompressing the chunk first if necessary. If the chunk is
+ * already expanded, this function has no effect.
+ *
+ * @param buffer
+ *     The buffer containing the chunk.
+ *
+ * @param chunk
+ *     The chunk to expand.
+ */
+static void guac_terminal_buffer_chunk_expand(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_chunk* chunk) {
+
+    if (chunk->state == GUAC_TERMINAL_BUFFER_CHUNK_EXPANDED)
+        return;
+
+#ifdef HAVE_ZLIB
+    /* Restore packed form of chunk if compressed */
+    if (chunk->state == GUAC_TERMINAL_BUFFER_CHUNK_COMPRESSED) {
+
+        chunk->cells = guac_terminal_buffer_alloc_memory(buffer,
+                chunk->cell_count, sizeof(guac_terminal_buffer_cell));
+
+        uLongf length = chunk->cell_count * sizeof(guac_terminal_buffer_cell);
+        int result = uncompress((Bytef*) chunk->cells, &length,
+                chunk->compressed, chunk->compressed_length);
+
+        GUAC_ASSERT(result == Z_OK);
+        GUAC_ASSERT(length == chunk->cell_count * sizeof(guac_terminal_buffer_cell));
+
+        guac_terminal_buffer_free_memory(buffer, chunk->compressed,
+                chunk->compressed_length, 1);
+
+        chunk->compressed = NULL;
+        chunk->compressed_length = 0;
+        chunk->state = GUAC_TERMINAL_BUFFER_CHUNK_PACKED;
+
+    }
+#endif
+
+    GUAC_ASSERT(chunk->state == GUAC_TERMINAL_BUFFER_CHUNK_PACKED);
+
+    chunk->rows = guac_terminal_buffer_alloc_memory(buffer, chunk->length,
+            sizeof(guac_terminal_buffer_row));
+
+    for (unsigned int i = 0; i < chunk->length; i++) {
+
+        guac_terminal_buffer_packed_row* packed_row = &chunk->packed_rows[i];
+        guac_terminal_buffer_row* row = &chunk->rows[i];
+
+        row->length = packed_row->length;
+        row->wrapped_row = packed_row->wrapped_row;
+
+        /* Allocate only as much storage as the row actually requires, as the
+         * row is likely only being read (rows which have no length at all are
+         * allocated normally, once actually needed) */
+        row->available = packed_row->length;
+        row->characters = NULL;
+        if (row->available > 0)
+            row->characters = guac_terminal_buffer_alloc_memory(buffer,
+                    row->available, sizeof(guac_terminal_char));
+
+        for (unsigned int j = packed_row->stored; j < row->available; j++)
+            row->characters[j] = buffer->default_character;
+
+        /* Restore all stored characters, releasing their attributes */
+        guac_terminal_buffer_cell* cell = &chunk->cells[packed_row->offset];
+        for (unsigned int j = 0; j < packed_row->stored; j++) {
+
+            guac_terminal_char* character = &row->characters[j];
+            character->value = cell->value;
+            character->attributes = buffer->attributes[cell->attributes].attributes;
+            character->width = cell->width;
+
+            guac_terminal_buffer_attributes_unref(buffer, cell->attributes);
+            cell++;
+
+        }
+
+    }
+
+    guac_terminal_buffer_free_memory(buffer, chunk->cells, chunk->cell_count,
+            sizeof(guac_terminal_buffer_cell));
+
+    guac_terminal_buffer_free_memory(buffer, chunk->packed_rows, chunk->length,
+            sizeof(guac_terminal_buffer_packed_row));
+
+    chunk->cells = NULL;
+    chunk->packed_rows = NULL;
+    chunk->cell_count = 0;
+    chunk->incompressible = false;
+    chunk->state = GUAC_TERMINAL_BUFFER_CHUNK_EXPANDED;
+
+}
+
+/**
+ * Converts the given chunk of the given buffer from its expanded form to its
+ * packed form. Only the characters of each row that differ from the default
+ * character are stored, with each character referencing its attributes via
+ * the attribute table of the buffer. If the attribute table cannot
+ * accommodate the attributes of the chunk, the chunk is left expanded.
+ *
+ * @param buffer
+ *     The buffer containing the chunk.
+ *
+ * @param chunk
+ *     The expanded chunk to pack.
+ *
+ * @return
+ *     true if the chunk was successfully packed, false if the chunk has been
+ *     left expanded.
+ */
+static bool guac_terminal_buffer_chunk_pack(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_chunk* chunk) {
+
+    GUAC_ASSERT(chunk->state == GUAC_TERMINAL_BUFFER_CHUNK_EXPANDED);
+
+    guac_terminal_buffer_packed_row* packed_rows = guac_terminal_buffer_alloc_memory(
+            buffer, chunk->length, sizeof(guac_terminal_buffer_packed_row));
+
+    /* Determine the number of characters that actually need to be stored for
+     * each row, omitting any trailing default characters */
+    size_t cell_count = 0;
+    for (unsigned int i = 0; i < chunk->length; i++) {
+
+        guac_terminal_buffer_row* row = &chunk->rows[i];
+
+        unsigned int stored = row->length;
+        while (stored > 0 && guac_terminal_buffer_char_equals(
+                    &row->characters[stored - 1], &buffer->default_character))
+            stored--;
+
+        packed_rows[i].offset = cell_count;
+        packed_rows[i].stored = stored;
+        packed_rows[i].length = row->length;
+        packed_rows[i].wrapped_row = row->wrapped_row;
+
+        cell_count += stored;
+
+    }
+
+    guac_terminal_buffer_cell* cells = NULL;
+    if (cell_count > 0)
+        cells = guac_terminal_buffer_alloc_memory(buffer, cell_count,
+                sizeof(guac_terminal_buffer_cell));
+
+    /* Store all characters, referencing their attributes */
+    size_t packed = 0;
+    for (unsigned int i = 0; i < chunk->length; i++) {
+
+        guac_terminal_buffer_row* row = &chunk->rows[i];
+        for (unsigned int j = 0; j < packed_rows[i].stored; j++) {
+
+            guac_terminal_char* character = &row->characters[j];
+
+            int attributes = guac_terminal_buffer_attributes_ref(buffer,
+                    &character->attributes);
+
+            /* Abort if the attribute table is full, releasing any references
+             * added thus far */
+            if (attributes < 0) {
+
+                for (size_t k = 0; k < packed; k++)
+                    guac_terminal_buffer_attributes_unref(buffer, cells[k].attributes);
+
+                guac_terminal_buffer_free_memory(buffer, cells, cell_count,
+                        sizeof(guac_terminal_buffer_cell));
+
+                guac_terminal_buffer_free_memory(buffer, packed_rows, chunk->length,
+                        sizeof(guac_terminal_buffer_packed_row));
+
+                return false;
+
+            }
+
+            guac_terminal_buffer_cell* cell = &cells[packed++];
+            cell->value = character->value;
+            cell->attributes = attributes;
+            cell->width = character->width;
+
+        }
+
+    }
+
+    /* The expanded rows are no longer needed */
+    for (unsigned int i = 0; i < chunk->length; i++) {
+        guac_terminal_buffer_row* row = &chunk->rows[i];
+        guac_terminal_buffer_free_memory(buffer, row->characters,
+                row->available, sizeof(guac_terminal_char));
+    }
+
+    guac_terminal_buffer_free_memory(buffer, chunk->rows, chunk->length,
+            sizeof(guac_terminal_buffer_row));
+
+    chunk->rows = NULL;
+    chunk->packed_rows = packed_rows;
+    chunk->cells = cells;
+    chunk->cell_count = cell_count;
+    chunk->state = GUAC_TERMINAL_BUFFER_CHUNK_PACKED;
+
+    return true;
+
+}
+
+#ifdef HAVE_ZLIB
+/**
+ * Compresses the cell storage of the given packed chunk. If compression does
+ * not reduce the size of that storage, the chunk is left as-is and will not
+ * be considered for compression again until it has been repacked.
+ *
+ * @param buffer
+ *     The buffer containing the chunk.
+ *
+ * @param chunk
+ *     The packed chunk to compress.
+ */
+static void guac_terminal_buffer_chunk_compress(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_chunk* chunk) {
+
+    GUAC_ASSERT(chunk->state == GUAC_TERMINAL_BUFFER_CHUNK_PACKED);
+
+    uLong length = chunk->cell_count * sizeof(guac_terminal_buffer_cell);
+    uLongf compressed_length = compressBound(length);
+
+    unsigned char* compressed = guac_mem_alloc(compressed_length);
+    if (compress2(compressed, &compressed_length, (const Bytef*) chunk->cells,
+                length, Z_BEST_SPEED) != Z_OK
+            || compressed_length >= length) {
+        guac_mem_free(compressed);
+        chunk->incompressible = true;
+        return;
+    }
+
+    chunk->compressed = guac_mem_realloc_or_die(compressed, compressed_length);
+    chunk->compressed_length = compressed_length;
+    buffer->memory += compressed_length;
+
+    guac_terminal_buffer_free_memory(buffer, chunk->cells, chunk->cell_count,
+            sizeof(guac_terminal_buffer_cell));
+
+    chunk->cells = NULL;
+    chunk->state = GUAC_TERMINAL_BUFFER_CHUNK_COMPRESSED;
+
+}
+#endif
+
+/**
+ * Returns the index of the given row within the ring buffer of the given
+ * buffer. The row index is relative to the top of the terminal display,
+ * where negative indices represent rows in the scrollback buffer.
+ *
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param row
+ *     The index of the row relative to the top of the terminal display.
+ *
+ * @return
+ *     The index of the row within the ring buffer.
+ */
+static unsigned int guac_terminal_buffer_ring_index(guac_terminal_buffer* buffer,
+        int row) {
+
+    long index = ((long) buffer->top + row) % (long) buffer->available;
+    if (index < 0)
+        index += buffer->available;
+
+    return index;
+
+}
+
+/**
+ * Packs or compresses the chunk at the given index within the given buffer if
+ * that chunk is far enough into the scrollback region that it is unlikely to
+ * be needed again soon. Chunks that contain any row of the terminal display,
+ * any row within GUAC_TERMINAL_BUFFER_HOT_ROWS rows above the terminal
+ * display, or any row currently visible due to the terminal being scrolled
+ * are left as-is.
+ *
+ * @param buffer
+ *     The buffer containing the chunk.
+ *
+ * @param index
+ *     The index of the chunk to consider.
+ */
+static void guac_terminal_buffer_chunk_age(guac_terminal_buffer* buffer,
+        unsigned int index) {
+
+    guac_terminal_buffer_chunk* chunk = &buffer->chunks[index];
+
+    /* Determine the index of the oldest row in the chunk relative to the top
+     * of the terminal display. Ring entries below the terminal display are
+     * the oldest rows of the scrollback buffer. */
+    unsigned int first = index * GUAC_TERMINAL_BUFFER_CHUNK_ROWS;
+    int oldest = (first + buffer->available - buffer->top) % buffer->available;
+    if (oldest >= buffer->visible_rows)
+        oldest -= (int) buffer->available;
+
+    int newest = oldest + (int) chunk->length - 1;
+
+    /* Leave chunks that are or may soon be modified as-is, including chunks
+     * that wrap around to contain rows of the terminal display */
+    if (newest >= -GUAC_TERMINAL_BUFFER_HOT_ROWS)
+        return;
+
+    /* Leave chunks that are currently visible as-is */
+    if (newest >= buffer->visible_top
+            && oldest < buffer->visible_top + buffer->visible_rows)
+        return;
+
+    if (chunk->state == GUAC_TERMINAL_BUFFER_CHUNK_EXPANDED)
+        guac_terminal_buffer_chunk_pack(buffer, chunk);
+
+#ifdef HAVE_ZLIB
+    else if (chunk->state == GUAC_TERMINAL_BUFFER_CHUNK_PACKED
+            && !chunk->incompressible && chunk->cell_count > 0
+            && newest < -GUAC_TERMINAL_BUFFER_HOT_ROWS - GUAC_TERMINAL_BUFFER_COMPRESS_ROWS)
+        guac_terminal_buffer_chunk_compress(buffer, chunk);
+#endif
+
+}
+
 guac_terminal_buffer* guac_terminal_buffer_alloc(int rows,
         const guac_terminal_char* default_character) {
 
     /* Allocate scrollback */
     guac_terminal_buffer* buffer =
-        guac_mem_alloc(sizeof(guac_terminal_buffer));
+        guac_mem_zalloc(sizeof(guac_terminal_buffer));
 
-    int i;
-    guac_terminal_buffer_row* row;
+    buffer->memory = sizeof(guac_terminal_buffer);
 
     /* Init scrollback data */
     buffer->default_character = *default_character;
     buffer->available = rows;
     buffer->top = 0;
     buffer->length = 0;
-    buffer->rows = guac_mem_alloc(sizeof(guac_terminal_buffer_row), buffer->available);
+    buffer->sweep = 0;
+
+    /* Assume the largest possible terminal display until informed otherwise */
+    buffer->visible_top = 0;
+    buffer->visible_rows = GUAC_TERMINAL_MAX_ROWS;
+
+    /* Init empty attribute table */
+    buffer->free_attributes = GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES;
+    buffer->attributes_available = GUAC_TERMINAL_BUFFER_ATTRIBUTE_INITIAL_SIZE;
+    buffer->attributes = guac_terminal_buffer_alloc_memory(buffer,
+            buffer->attributes_available, sizeof(guac_terminal_buffer_attribute_entry));
+
+    for (int i = 0; i < GUAC_TERMINAL_BUFFER_ATTRIBUTE_BUCKETS; i++)
+        buffer->attribute_buckets[i] = GUAC_TERMINAL_BUFFER_MAX_ATTRIBUTES;
+
+    /* Init chunks of scrollback rows (storage for the characters of each row
+     * is allocated only when first needed) */
+    buffer->chunk_count = (rows + GUAC_TERMINAL_BUFFER_CHUNK_ROWS - 1) / GUAC_TERMINAL_BUFFER_CHUNK_ROWS;
+    buffer->chunks = guac_terminal_buffer_alloc_memory(buffer,
+            buffer->chunk_count, sizeof(guac_terminal_buffer_chunk));
 
-    /* Init scrollback rows */
-    row = buffer->rows;
-    for (i=0; i<rows; i++) {
+    for (unsigned int i = 0; i < buffer->chunk_count; i++) {
 
-        /* Allocate row  */
-        row->available = GUAC_TERMINAL_BUFFER_ROW_MIN_SIZE;
-        row->length = 0;
-        row->wrapped_row = false;
-        row->characters = guac_mem_alloc(sizeof(guac_terminal_char), row->available);
+        guac_terminal_buffer_chunk* chunk = &buffer->chunks[i];
+        memset(chunk, 0, sizeof(guac_terminal_buffer_chunk));
 
-        /* Next row */
-        row++;
+        chunk->state = GUAC_TERMINAL_BUFFER_CHUNK_EXPANDED;
+        chunk->length = GUAC_TERMINAL_BUFFER_CHUNK_ROWS;
+
+        /* The final chunk may be partial */
+        if (i == buffer->chunk_count - 1 && rows % GUAC_TERMINAL_BUFFER_CHUNK_ROWS)
+            chunk->length = rows % GUAC_TERMINAL_BUFFER_CHUNK_ROWS;
+
+        chunk->rows = guac_terminal_buffer_alloc_memory(buffer, chunk->length,
+                sizeof(guac_terminal_buffer_row));
+
+        memset(chunk->rows, 0, sizeof(guac_terminal_buffer_row) * chunk->length);
 
     }
 
@@ -139,17 +1076,26 @@ guac_terminal_buffer* guac_terminal_buffer_alloc(int rows,
 
 void guac_terminal_buffer_free(guac_terminal_buffer* buffer) {
 
-    int i;
-    guac_terminal_buffer_row* row = buffer->rows;
+    /* Free all chunks, regardless of their current form */
+    for (unsigned int i = 0; i < buffer->chunk_count; i++) {
+
+        guac_terminal_buffer_chunk* chunk = &buffer->chunks[i];
+
+        if (chunk->rows != NULL) {
+            for (unsigned int j = 0; j < chunk->length; j++)
+                guac_mem_free(chunk->rows[j].characters);
+        }
+
+        guac_mem_free(chunk->rows);
+        guac_mem_free(chunk->packed_rows);
+        guac_mem_free(chunk->cells);
+        guac_mem_free(chunk->compressed);
 
-    /* Free all rows */
-    for (i=0; i<buffer->available; i++) {
-        guac_mem_free(row->characters);
-        row++;
     }
 
     /* Free actual buffer */
-    guac_mem_free(buffer->rows);
+    guac_mem_free(buffer->chunks);
+    guac_mem_free(buffer->attributes);
     guac_mem_free(buffer);
 
 }
@@ -159,9 +1105,22 @@ void guac_terminal_buffer_reset(guac_terminal_buffer* buffer) {
     buffer->length = 0;
 }
 
+size_t guac_terminal_buffer_get_memory_usage(guac_terminal_buffer* buffer) {
+    return buffer->memory;
+}
+
+void guac_terminal_buffer_set_visible(guac_terminal_buffer* buffer, int top,
+        int rows) {
+    buffer->visible_top = top;
+    buffer->visible_rows = rows;
+}
+
 /**
- * Returns the row at the given location. The row returned is guaranteed to be at least the given
- * width.
+ * Returns the row at the given location. If the chunk containing the row is
+ * currently packed, that chunk is expanded. The row returned is guaranteed to
+ * have storage allocated for at least as many characters as the length of
+ * that row, and the returned row remains valid until the buffer is next
+ * scrolled.
  *
  * @param buffer
  *     The buffer to retrieve a row from.
@@ -180,33 +1139,18 @@ static guac_terminal_buffer_row* guac_terminal_buffer_get_row(guac_terminal_buff
         return NULL;
 
     /* Normalize row index into a scrollback buffer index */
-    unsigned int index = (buffer->top + row) % buffer->available;
-    return &(buffer->rows[index]);
+    unsigned int index = guac_terminal_buffer_ring_index(buffer, row);
 
-}
-
-/**
- * Rounds the given value up to the nearest possible row length. To avoid
- * unnecessary, repeated resizing of rows, each row length is rounded up to the
- * nearest power of two.
- *
- * @param value
- *     The value to round.
- *
- * @return
- *     The power of two that is closest to the given value without exceeding
- *     that value.
- */
-static unsigned int guac_terminal_buffer_row_length(int value) {
+    guac_terminal_buffer_chunk* chunk = &buffer->chunks[index / GUAC_TERMINAL_BUFFER_CHUNK_ROWS];
+    guac_terminal_buffer_chunk_expand(buffer, chunk);
 
-    GUAC_ASSERT(value >= 0);
-    GUAC_ASSERT(value <= GUAC_TERMINAL_MAX_COLUMNS);
+    guac_terminal_buffer_row* buffer_row = &chunk->rows[index % GUAC_TERMINAL_BUFFER_CHUNK_ROWS];
 
-    unsigned int rounded = GUAC_TERMINAL_BUFFER_ROW_MIN_SIZE;
-    while (rounded < value)
-        rounded <<= 1;
+    /* Allocate storage for row only once actually needed */
+    if (buffer_row->characters == NULL)
+        guac_terminal_buffer_row_init(buffer, buffer_row, 0);
 
-    return rounded;
+    return buffer_row;
 
 }
 
@@ -216,17 +1160,17 @@ static unsigned int guac_terminal_buffer_row_length(int value) {
  * cannot be expanded due to buffer size limitations, it will be expanded to
  * the greatest size allowed without exceeding those limits.
  *
+ * @param buffer
+ *     The buffer containing the row.
+ *
  * @param row
  *     The row to expand.
  *
  * @param length
  *     The number of characters that the row must be able to store.
- *
- * @param default_character
- *     The character that should fill any newly-allocated character cells.
  */
-static void guac_terminal_buffer_row_expand(guac_terminal_buffer_row* row, int length,
-        const guac_terminal_char* default_character) {
+static void guac_terminal_buffer_row_expand(guac_terminal_buffer* buffer,
+        guac_terminal_buffer_row* row, int length) {
 
     /* Bail out if no resize/init is necessary */
     if (length <= row->length)
@@ -239,14 +1183,19 @@ static void guac_terminal_buffer_row_expand(guac_terminal_buffer_row* row, int l
     /* Expand allocated memory if there is otherwise insufficient space to fit
      * the provided length */
     if (length > row->available) {
-        row->available = guac_terminal_buffer_row_length(length);
+
+        unsigned int available = guac_terminal_buffer_row_length(length);
         row->characters = guac_mem_realloc_or_die(row->characters,
-                sizeof(guac_terminal_char), row->available);
+                sizeof(guac_terminal_char), available);
+
+        buffer->memory += (available - row->available) * sizeof(guac_terminal_char);
+        row->available = available;
+
     }
 
     /* Initialize new part of row */
     for (int i = row->length; i < row->available; i++)
-        row->characters[i] = *default_character;
+        row->characters[i] = buffer->default_character;
 
     row->length = length;
 
@@ -352,7 +1301,7 @@ void guac_terminal_buffer_copy_columns(guac_terminal_buffer* buffer, int row,
     if (buffer_row == NULL)
         return;
 
-    guac_terminal_buffer_row_expand(buffer_row, end_column + offset + 1, &buffer->default_character);
+    guac_terminal_buffer_row_expand(buffer, buffer_row, end_column + offset + 1);
     GUAC_ASSERT(buffer_row->length >= end_column + offset + 1);
 
     /* Fit relevant extents of operation within bounds (NOTE: Because this
@@ -409,7 +1358,7 @@ void guac_terminal_buffer_copy_rows(guac_terminal_buffer* buffer,
         if (src_row == NULL || dst_row == NULL)
             continue;
 
-        guac_terminal_buffer_row_expand(dst_row, src_row->length, &buffer->default_character);
+        guac_terminal_buffer_row_expand(buffer, dst_row, src_row->length);
         GUAC_ASSERT(dst_row->length >= src_row->length);
 
         /* Copy data */
@@ -442,6 +1391,21 @@ void guac_terminal_buffer_scroll_up(guac_terminal_buffer* buffer, int amount,
             buffer->length = buffer->available;
     }
 
+    /* Pack any chunks that have just scrolled out of the hot region of the
+     * scrollback buffer */
+    for (int i = 0; i < amount + GUAC_TERMINAL_BUFFER_CHUNK_ROWS
+            && i < buffer->available; i += GUAC_TERMINAL_BUFFER_CHUNK_ROWS) {
+        unsigned int index = guac_terminal_buffer_ring_index(buffer,
+                -GUAC_TERMINAL_BUFFER_HOT_ROWS - 1 - i);
+        guac_terminal_buffer_chunk_age(buffer, index / GUAC_TERMINAL_BUFFER_CHUNK_ROWS);
+    }
+
+    /* Additionally revisit one other chunk each time the buffer is scrolled,
+     * such that chunks that were expanded to view scrollback are eventually
+     * packed again, and such that packed chunks are eventually compressed */
+    guac_terminal_buffer_chunk_age(buffer, buffer->sweep);
+    buffer->sweep = (buffer->sweep + 1) % buffer->chunk_count;
+
 }
 
 void guac_terminal_buffer_scroll_down(guac_terminal_buffer* buffer, int amount) {
@@ -449,7 +1413,7 @@ void guac_terminal_buffer_scroll_down(guac_terminal_buffer* buffer, int amount)
     if (amount <= 0)
         return;
 
-    buffer->top = (buffer->top - amount) % buffer->available;
+    buffer->top = guac_terminal_buffer_ring_index(buffer, -amount);
 
 }
 
@@ -495,7 +1459,7 @@ void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
     start_column = guac_terminal_fit_to_range(start_column, 0, GUAC_TERMINAL_MAX_COLUMNS - 1);
     end_column = guac_terminal_fit_to_range(end_column, 0, GUAC_TERMINAL_MAX_COLUMNS - 1);
 
-    guac_terminal_buffer_row_expand(buffer_row, end_column + 1, &buffer->default_character);
+    guac_terminal_buffer_row_expand(buffer, buffer_row, end_column + 1);
     GUAC_ASSERT(buffer_row->length >= end_column + 1);
 
     int remaining_continuation_chars = 0;
@@ -538,7 +1502,7 @@ void guac_terminal_buffer_set_cursor(guac_terminal_buffer* buffer, int row,
 
     column = guac_terminal_fit_to_range(column, 0, GUAC_TERMINAL_MAX_COLUMNS - 1);
 
-    guac_terminal_buffer_row_expand(buffer_row, column + 1, &buffer->default_character);
+    guac_terminal_buffer_row_expand(buffer, buffer_row, column + 1);
     GUAC_ASSERT(buffer_row->length >= column + 1);
 
     buffer_row->characters[column].attributes.cursor = is_cursor;
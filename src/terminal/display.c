@@ -17,7 +17,6 @@
  * under the License.
  */
 
-#include "common/surface.h"
 #include "terminal/common.h"
 #include "terminal/display.h"
 #include "terminal/palette.h"
@@ -34,9 +33,9 @@
 #include <glib-object.h>
 #include <guacamole/assert.h>
 #include <guacamole/client.h>
+#include <guacamole/display.h>
 #include <guacamole/mem.h>
-#include <guacamole/protocol.h>
-#include <guacamole/socket.h>
+#include <guacamole/rect.h>
 #include <pango/pangocairo.h>
 
 /* Maps any codepoint onto a number between 0 and 511 inclusive */
@@ -99,11 +98,39 @@ int __guac_terminal_set_colors(guac_terminal_display* display,
 }
 
 /**
- * Sends the given character to the terminal at the given row and column,
- * rendering the character immediately. This bypasses the guac_terminal_display
- * mechanism and is intended for flushing of updates only.
+ * Returns the rectangle covering the visible area of the given terminal
+ * display, in pixels, constrained to the given bounds.
+ *
+ * @param display
+ *     The terminal display whose visible area should be determined.
+ *
+ * @param max
+ *     The bounds of the buffer that the visible area must fit within, such as
+ *     the bounds of a raw or Cairo context for a display layer.
+ *
+ * @param bounds
+ *     The rectangle to populate with the visible area of the terminal.
+ */
+static void guac_terminal_display_get_bounds(guac_terminal_display* display,
+        const guac_rect* max, guac_rect* bounds) {
+
+    guac_rect_init(bounds, 0, 0,
+            display->char_width  * display->width,
+            display->char_height * display->height);
+
+    guac_rect_constrain(bounds, max);
+
+}
+
+/**
+ * Draws the given character to the pending frame of the terminal display
+ * layer at the given row and column, rendering the character immediately.
+ * This bypasses the guac_terminal_display mechanism and is intended for
+ * flushing of updates only.
  */
-int __guac_terminal_set(guac_terminal_display* display, int row, int col, int codepoint) {
+int __guac_terminal_set(guac_terminal_display* display,
+        guac_display_layer_cairo_context* context, int row, int col,
+        int codepoint) {
 
     int width;
 
@@ -116,10 +143,9 @@ int __guac_terminal_set(guac_terminal_display* display, int row, int col, int co
     /* Use background color */
     const guac_terminal_color* background = &display->glyph_background;
 
-    cairo_surface_t* surface;
-    cairo_t* cairo;
-    int surface_width, surface_height;
-   
+    cairo_t* cairo = context->cairo;
+    int glyph_x, glyph_y, glyph_width, glyph_height;
+
     PangoLayout* layout;
     int layout_width, layout_height;
     int ideal_layout_width, ideal_layout_height;
@@ -136,16 +162,31 @@ int __guac_terminal_set(guac_terminal_display* display, int row, int col, int co
     /* Convert to UTF-8 */
     bytes = guac_terminal_encode_utf8(codepoint, utf8);
 
-    surface_width = width * display->char_width;
-    surface_height = display->char_height;
+    glyph_x = display->char_width * col;
+    glyph_y = display->char_height * row;
+    glyph_width = width * display->char_width;
+    glyph_height = display->char_height;
+
+    ideal_layout_width = glyph_width * PANGO_SCALE;
+    ideal_layout_height = glyph_height * PANGO_SCALE;
+
+    /* Determine region actually affected by the glyph, clipping any wide
+     * glyph that extends beyond the edge of the terminal */
+    guac_rect bounds;
+    guac_rect glyph_rect;
+    guac_terminal_display_get_bounds(display, &context->bounds, &bounds);
+    guac_rect_init(&glyph_rect, glyph_x, glyph_y, glyph_width, glyph_height);
+    guac_rect_constrain(&glyph_rect, &bounds);
 
-    ideal_layout_width = surface_width * PANGO_SCALE;
-    ideal_layout_height = surface_height * PANGO_SCALE;
+    if (guac_rect_is_empty(&glyph_rect))
+        return 0;
 
-    /* Prepare surface */
-    surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24,
-                                         surface_width, surface_height);
-    cairo = cairo_create(surface);
+    /* Restrict all drawing to the glyph's character cells */
+    cairo_save(cairo);
+    cairo_rectangle(cairo, glyph_rect.left, glyph_rect.top,
+            guac_rect_width(&glyph_rect), guac_rect_height(&glyph_rect));
+    cairo_clip(cairo);
+    cairo_translate(cairo, glyph_x, glyph_y);
 
     /* Fill background */
     cairo_set_source_rgb(cairo,
@@ -153,8 +194,7 @@ int __guac_terminal_set(guac_terminal_display* display, int row, int col, int co
             background->green / 255.0,
             background->blue  / 255.0);
 
-    cairo_rectangle(cairo, 0, 0, surface_width, surface_height); 
-    cairo_fill(cairo);
+    cairo_paint(cairo);
 
     /* Get layout */
     layout = pango_cairo_create_layout(cairo);
@@ -188,16 +228,12 @@ int __guac_terminal_set(guac_terminal_display* display, int row, int col, int co
     cairo_move_to(cairo, 0.0, 0.0);
     pango_cairo_show_layout(cairo, layout);
 
-    /* Draw */
-    guac_common_surface_draw(display->display_surface,
-        display->char_width * col,
-        display->char_height * row,
-        surface);
-
     /* Free all */
     g_object_unref(layout);
-    cairo_destroy(cairo);
-    cairo_surface_destroy(surface);
+    cairo_restore(cairo);
+
+    /* Include glyph within the changes for the pending frame */
+    guac_rect_extend(&context->dirty, &glyph_rect);
 
     return 0;
 
@@ -217,7 +253,7 @@ static int get_margin_by_dpi(int dpi) {
 }
 
 guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
-        const char* font_name, int font_size, int dpi,
+        guac_display* graphical_display, const char* font_name, int font_size, int dpi,
         guac_terminal_color* foreground, guac_terminal_color* background,
         guac_terminal_color (*palette)[256]) {
 
@@ -230,25 +266,24 @@ guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
     display->char_width = 0;
     display->char_height = 0;
 
-    /* Create default surface */
-    display->display_layer = guac_client_alloc_layer(client);
-    display->select_layer = guac_client_alloc_layer(client);
-    display->display_surface = guac_common_surface_alloc(client,
-            client->socket, display->display_layer, 0, 0);
+    /* Create layers for terminal contents and text selection */
+    display->graphical_display = graphical_display;
+    display->display_layer = guac_display_alloc_layer(graphical_display, 1);
+    display->select_layer = guac_display_alloc_layer(graphical_display, 0);
 
     /* Never use lossy compression for terminal contents */
-    guac_common_surface_set_lossless(display->display_surface, 1);
+    guac_display_layer_set_lossless(display->display_layer, 1);
+    guac_display_layer_set_lossless(display->select_layer, 1);
 
     /* Select layer is a child of the display layer */
-    guac_protocol_send_move(client->socket, display->select_layer,
-            display->display_layer, 0, 0, 0);
+    guac_display_layer_set_parent(display->select_layer, display->display_layer);
 
     /* Calculate margin size by DPI */
     display->margin = get_margin_by_dpi(dpi);
 
     /* Offset the Default Layer to make margins even on all sides */
-    guac_protocol_send_move(client->socket, display->display_layer,
-        GUAC_DEFAULT_LAYER, display->margin, display->margin, 0);
+    guac_display_layer_move(display->display_layer,
+            display->margin, display->margin);
 
     display->default_foreground = display->glyph_foreground = *foreground;
     display->default_background = display->glyph_background = *background;
@@ -267,6 +302,8 @@ guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
     if (guac_terminal_display_set_font(display, font_name, font_size, dpi)) {
         guac_client_abort(display->client, GUAC_PROTOCOL_STATUS_SERVER_ERROR,
                 "Unable to set initial font \"%s\"", font_name);
+        guac_display_free_layer(display->select_layer);
+        guac_display_free_layer(display->display_layer);
         guac_mem_free(display);
         return NULL;
     }
@@ -286,6 +323,10 @@ void guac_terminal_display_free(guac_terminal_display* display) {
     /* Free operations buffers */
     guac_mem_free(display->operations);
 
+    /* Free layers */
+    guac_display_free_layer(display->select_layer);
+    guac_display_free_layer(display->display_layer);
+
     /* Free display */
     guac_mem_free(display);
 
@@ -517,13 +558,23 @@ void guac_terminal_display_set_columns(guac_terminal_display* display, int row,
 
 void guac_terminal_display_resize(guac_terminal_display* display, int width, int height) {
 
-    /* Resize display only if dimensions have changed */
-    if (width == display->width && height == display->height)
-        return;
-
     GUAC_ASSERT(width >= 0 && width <= GUAC_TERMINAL_MAX_COLUMNS);
     GUAC_ASSERT(height >= 0 && height <= GUAC_TERMINAL_MAX_ROWS);
 
+    /* Resize layers to fit the given dimensions using the current font
+     * metrics (the font may have changed even if the dimensions have not) */
+    guac_display_layer_resize(display->display_layer,
+            display->char_width  * width,
+            display->char_height * height);
+
+    guac_display_layer_resize(display->select_layer,
+            display->char_width  * width,
+            display->char_height * height);
+
+    /* Reallocate operations only if dimensions have changed */
+    if (width == display->width && height == display->height)
+        return;
+
     /* Fill with background color */
     guac_terminal_char fill = {
         .value = 0,
@@ -569,20 +620,62 @@ void guac_terminal_display_resize(guac_terminal_display* display, int width, int
     display->width = width;
     display->height = height;
 
-    /* Send display size */
-    guac_common_surface_resize(
-            display->display_surface,
-            display->char_width  * width,
-            display->char_height * height);
+}
 
-    guac_protocol_send_size(display->client->socket,
-            display->select_layer,
-            display->char_width  * width,
-            display->char_height * height);
+/**
+ * Copies a rectangle of image data within the given raw context from one
+ * location to another. The source and destination rectangles may overlap.
+ *
+ * @param context
+ *     The raw context of the layer containing the image data to copy.
+ *
+ * @param src
+ *     The rectangle of image data that should be copied.
+ *
+ * @param dst_x
+ *     The X coordinate of the upper-left corner of the destination, in pixels.
+ *
+ * @param dst_y
+ *     The Y coordinate of the upper-left corner of the destination, in pixels.
+ */
+static void guac_terminal_display_copy_rect(guac_display_layer_raw_context* context,
+        const guac_rect* src, int dst_x, int dst_y) {
+
+    guac_rect dst;
+    guac_rect_init(&dst, dst_x, dst_y, guac_rect_width(src), guac_rect_height(src));
+
+    size_t stride = context->stride;
+    size_t length = guac_mem_ckd_mul_or_die(guac_rect_width(src),
+            GUAC_DISPLAY_LAYER_RAW_BPP);
+
+    unsigned char* src_buffer = GUAC_DISPLAY_LAYER_RAW_BUFFER(context, *src);
+    unsigned char* dst_buffer = GUAC_DISPLAY_LAYER_RAW_BUFFER(context, dst);
+
+    /* Copy rows bottom-up if the destination is below the source, such that
+     * overlapping source rows are not overwritten before being copied */
+    if (dst.top > src->top) {
+        size_t offset = guac_mem_ckd_mul_or_die(guac_rect_height(src) - 1, stride);
+        for (int y = src->bottom - 1; y >= src->top; y--) {
+            memmove(dst_buffer + offset, src_buffer + offset, length);
+            offset -= stride;
+        }
+    }
+
+    /* Otherwise, rows can be copied top-down */
+    else {
+        for (int y = src->top; y < src->bottom; y++) {
+            memmove(dst_buffer, src_buffer, length);
+            dst_buffer += stride;
+            src_buffer += stride;
+        }
+    }
+
+    guac_rect_extend(&context->dirty, &dst);
 
 }
 
-void __guac_terminal_display_flush_copy(guac_terminal_display* display) {
+void __guac_terminal_display_flush_copy(guac_terminal_display* display,
+        guac_display_layer_raw_context* context) {
 
     guac_terminal_operation* current = display->operations;
     int row, col;
@@ -684,16 +777,15 @@ void __guac_terminal_display_flush_copy(guac_terminal_display* display) {
 
                 }
 
-                /* Send copy */
-                guac_common_surface_copy(
-
-                        display->display_surface,
+                /* Copy within pending frame */
+                guac_rect src;
+                guac_rect_init(&src,
                         current->column * display->char_width,
                         current->row * display->char_height,
                         rect_width * display->char_width,
-                        rect_height * display->char_height,
+                        rect_height * display->char_height);
 
-                        display->display_surface,
+                guac_terminal_display_copy_rect(context, &src,
                         col * display->char_width,
                         row * display->char_height);
 
@@ -707,7 +799,8 @@ void __guac_terminal_display_flush_copy(guac_terminal_display* display) {
 
 }
 
-void __guac_terminal_display_flush_clear(guac_terminal_display* display) {
+void __guac_terminal_display_flush_clear(guac_terminal_display* display,
+        guac_display_layer_raw_context* context) {
 
     guac_terminal_operation* current = display->operations;
     int row, col;
@@ -821,15 +914,19 @@ void __guac_terminal_display_flush_clear(guac_terminal_display* display) {
 
                 }
 
-                /* Send rect */
-                guac_common_surface_set(
-                        display->display_surface,
+                /* Fill rect within pending frame */
+                guac_rect rect;
+                guac_rect_init(&rect,
                         col * display->char_width,
                         row * display->char_height,
                         rect_width * display->char_width,
-                        rect_height * display->char_height,
-                        color.red, color.green, color.blue,
-                        0xFF);
+                        rect_height * display->char_height);
+
+                guac_display_layer_raw_context_set(context, &rect,
+                          0xFF000000
+                        | (color.red   << 16)
+                        | (color.green << 8)
+                        |  color.blue);
 
             } /* end if clear operation */
 
@@ -841,7 +938,8 @@ void __guac_terminal_display_flush_clear(guac_terminal_display* display) {
 
 }
 
-void __guac_terminal_display_flush_set(guac_terminal_display* display) {
+void __guac_terminal_display_flush_set(guac_terminal_display* display,
+        guac_display_layer_cairo_context* context) {
 
     guac_terminal_operation* current = display->operations;
     int row, col;
@@ -863,8 +961,8 @@ void __guac_terminal_display_flush_set(guac_terminal_display* display) {
                 __guac_terminal_set_colors(display,
                         &(current->character.attributes));
 
-                /* Send character */
-                __guac_terminal_set(display, row, col, codepoint);
+                /* Draw character */
+                __guac_terminal_set(display, context, row, col, codepoint);
 
                 /* Mark operation as handled */
                 current->type = GUAC_CHAR_NOP;
@@ -883,50 +981,97 @@ void __guac_terminal_display_flush_set(guac_terminal_display* display) {
 }
 void guac_terminal_display_flush_operations(guac_terminal_display* display) {
 
-    /* Flush operations, copies first, then clears, then sets. */
-    __guac_terminal_display_flush_copy(display);
-    __guac_terminal_display_flush_clear(display);
-    __guac_terminal_display_flush_set(display);
+    guac_display_layer* layer = display->display_layer;
+
+    /* Flush copies first, then clears, directly to the pending frame */
+    guac_display_layer_raw_context* raw_context = guac_display_layer_open_raw(layer);
+    __guac_terminal_display_flush_copy(display, raw_context);
+    __guac_terminal_display_flush_clear(display, raw_context);
+    guac_display_layer_close_raw(layer, raw_context);
+
+    /* Render remaining sets through Cairo, as these require text rendering */
+    guac_display_layer_cairo_context* cairo_context = guac_display_layer_open_cairo(layer);
+    cairo_surface_mark_dirty(cairo_context->surface);
+    __guac_terminal_display_flush_set(display, cairo_context);
+    cairo_surface_flush(cairo_context->surface);
+    guac_display_layer_close_cairo(layer, cairo_context);
 
 }
 
 void guac_terminal_display_flush(guac_terminal_display* display) {
 
-    /* Flush operations */
+    /* Flush operations to the pending frame of the guac_display. The frame
+     * itself is ended and encoded separately by the render thread. */
     guac_terminal_display_flush_operations(display);
 
-    /* Flush surface */
-    guac_common_surface_flush(display->display_surface);
-
 }
 
-void guac_terminal_display_dup(
-        guac_terminal_display* display, guac_client* client, guac_socket* socket) {
+/**
+ * Fills the given rectangle of the text selection layer with the selection
+ * highlight color. The rectangle is given in character cells and is clipped
+ * to the visible area of the terminal.
+ *
+ * @param display
+ *     The terminal display whose selection is being drawn.
+ *
+ * @param context
+ *     The raw context of the text selection layer.
+ *
+ * @param row
+ *     The row of the upper-left corner of the rectangle.
+ *
+ * @param col
+ *     The column of the upper-left corner of the rectangle.
+ *
+ * @param width
+ *     The width of the rectangle, in columns.
+ *
+ * @param height
+ *     The height of the rectangle, in rows.
+ */
+static void guac_terminal_display_select_rect(guac_terminal_display* display,
+        guac_display_layer_raw_context* context, int row, int col,
+        int width, int height) {
 
-    /* Create default surface */
-    guac_common_surface_dup(display->display_surface, client, socket);
+    guac_rect bounds;
+    guac_terminal_display_get_bounds(display, &context->bounds, &bounds);
 
-    /* Select layer is a child of the display layer */
-    guac_protocol_send_move(socket, display->select_layer,
-            display->display_layer, 0, 0, 0);
+    guac_rect rect;
+    guac_rect_init(&rect,
+            col * display->char_width,
+            row * display->char_height,
+            width * display->char_width,
+            height * display->char_height);
 
-    /* Offset the Default Layer to make margins even on all sides */
-    guac_protocol_send_move(socket, display->display_layer,
-        GUAC_DEFAULT_LAYER, display->margin, display->margin, 0);
+    guac_rect_constrain(&rect, &bounds);
+    if (!guac_rect_is_empty(&rect))
+        guac_display_layer_raw_context_set(context, &rect,
+                GUAC_TERMINAL_SELECTION_COLOR);
 
-    /* Send select layer size */
-    guac_protocol_send_size(socket, display->select_layer,
-            display->char_width  * display->width,
-            display->char_height * display->height);
+}
+
+/**
+ * Clears the entire text selection layer of the given terminal display,
+ * leaving it fully transparent.
+ *
+ * @param display
+ *     The terminal display whose selection is being cleared.
+ *
+ * @param context
+ *     The raw context of the text selection layer.
+ */
+static void guac_terminal_display_erase_select(guac_terminal_display* display,
+        guac_display_layer_raw_context* context) {
+
+    guac_rect bounds;
+    guac_terminal_display_get_bounds(display, &context->bounds, &bounds);
+    guac_display_layer_raw_context_set(context, &bounds, 0x00000000);
 
 }
 
 void guac_terminal_display_select(guac_terminal_display* display,
         int start_row, int start_col, int end_row, int end_col, bool rectangle) {
 
-    guac_socket* socket = display->client->socket;
-    guac_layer* select_layer = display->select_layer;
-
     /* Do nothing if selection is unchanged */
     if (display->text_selected
             && display->selection_start_row    == start_row
@@ -943,6 +1088,12 @@ void guac_terminal_display_select(guac_terminal_display* display,
     display->selection_end_row = end_row;
     display->selection_end_column = end_col;
 
+    guac_display_layer* select_layer = display->select_layer;
+    guac_display_layer_raw_context* context = guac_display_layer_open_raw(select_layer);
+
+    /* Erase old selection */
+    guac_terminal_display_erase_select(display, context);
+
     /* If single row, just need one rectangle */
     if (start_row == end_row) {
 
@@ -954,11 +1105,8 @@ void guac_terminal_display_select(guac_terminal_display* display,
         }
 
         /* Select characters between columns */
-        guac_protocol_send_rect(socket, select_layer,
-                start_col * display->char_width,
-                start_row * display->char_height,
-                (end_col - start_col + 1) * display->char_width,
-                display->char_height);
+        guac_terminal_display_select_rect(display, context,
+                start_row, start_col, end_col - start_col + 1, 1);
 
     }
 
@@ -967,42 +1115,30 @@ void guac_terminal_display_select(guac_terminal_display* display,
 
         /* Multilines rectangular selection */
         if (rectangle) {
-            guac_protocol_send_rect(socket, select_layer,
-                    start_col * display->char_width,
-                    start_row * display->char_height,
-                    (end_col - start_col + 1) * display->char_width,
-                    (end_row - start_row + 1) * display->char_height);
+            guac_terminal_display_select_rect(display, context,
+                    start_row, start_col, end_col - start_col + 1,
+                    end_row - start_row + 1);
         }
 
         /* Multilines standard selection */
         else {
             /* First row */
-            guac_protocol_send_rect(socket, select_layer,
-                    start_col * display->char_width,
-                    start_row * display->char_height,
-                    display->width * display->char_width,
-                    display->char_height);
+            guac_terminal_display_select_rect(display, context,
+                    start_row, start_col, display->width, 1);
 
             /* Middle */
-            guac_protocol_send_rect(socket, select_layer,
-                    0,
-                    (start_row + 1) * display->char_height,
-                    display->width * display->char_width,
-                    (end_row - start_row - 1) * display->char_height);
+            guac_terminal_display_select_rect(display, context,
+                    start_row + 1, 0, display->width,
+                    end_row - start_row - 1);
 
             /* Last row */
-            guac_protocol_send_rect(socket, select_layer,
-                    0,
-                    end_row * display->char_height,
-                    (end_col + 1) * display->char_width,
-                    display->char_height);
+            guac_terminal_display_select_rect(display, context,
+                    end_row, 0, end_col + 1, 1);
         }
 
     }
 
-    /* Draw new selection, erasing old */
-    guac_protocol_send_cfill(socket, GUAC_COMP_SRC, select_layer,
-            0x00, 0x80, 0xFF, 0x60);
+    guac_display_layer_close_raw(select_layer, context);
 
 }
 
@@ -1012,12 +1148,10 @@ void guac_terminal_display_clear_select(guac_terminal_display* display) {
     if (!display->text_selected)
         return;
 
-    guac_socket* socket = display->client->socket;
-    guac_layer* select_layer = display->select_layer;
-
-    guac_protocol_send_rect(socket, select_layer, 0, 0, 1, 1);
-    guac_protocol_send_cfill(socket, GUAC_COMP_SRC, select_layer,
-            0x00, 0x00, 0x00, 0x00);
+    guac_display_layer* select_layer = display->select_layer;
+    guac_display_layer_raw_context* context = guac_display_layer_open_raw(select_layer);
+    guac_terminal_display_erase_select(display, context);
+    guac_display_layer_close_raw(select_layer, context);
 
     /* Text is no longer selected */
     display->text_selected = false;
@@ -18,7 +18,6 @@
  */
 
 #include "common/clipboard.h"
-#include "common/cursor.h"
 #include "common/iconv.h"
 #include "terminal/buffer.h"
 #include "terminal/color-scheme.h"
@@ -44,11 +43,13 @@
 #include <wchar.h>
 
 #include <guacamole/client.h>
+#include <guacamole/display.h>
 #include <guacamole/error.h>
 #include <guacamole/flag.h>
 #include <guacamole/mem.h>
 #include <guacamole/proctitle.h>
 #include <guacamole/protocol.h>
+#include <guacamole/rect.h>
 #include <guacamole/socket.h>
 #include <guacamole/string.h>
 #include <guacamole/timestamp.h>
@@ -255,6 +256,11 @@ int guac_terminal_get_columns(guac_terminal* term) {
     return term->term_width;
 }
 
+size_t guac_terminal_get_memory_usage(guac_terminal* term) {
+    return guac_terminal_buffer_get_memory_usage(term->normal_buffer)
+         + guac_terminal_buffer_get_memory_usage(term->alternate_buffer);
+}
+
 void guac_terminal_reset(guac_terminal* term) {
 
     int row;
@@ -314,13 +320,8 @@ void guac_terminal_reset(guac_terminal* term) {
  *
  * @param terminal
  *     The terminal whose background should be painted or repainted.
- *
- * @param socket
- *     The socket over which instructions required to paint / repaint the
- *     terminal background should be send.
  */
-static void guac_terminal_repaint_default_layer(guac_terminal* terminal,
-        guac_socket* socket) {
+static void guac_terminal_repaint_default_layer(guac_terminal* terminal) {
 
     int width = terminal->width;
     int height = terminal->height;
@@ -330,12 +331,22 @@ static void guac_terminal_repaint_default_layer(guac_terminal* terminal,
     const guac_terminal_color* color = &display->default_background;
 
     /* Reset size */
-    guac_protocol_send_size(socket, GUAC_DEFAULT_LAYER, width, height);
+    guac_display_layer* default_layer = guac_display_default_layer(terminal->graphical_display);
+    guac_display_layer_resize(default_layer, width, height);
 
     /* Paint background color */
-    guac_protocol_send_rect(socket, GUAC_DEFAULT_LAYER, 0, 0, width, height);
-    guac_protocol_send_cfill(socket, GUAC_COMP_OVER, GUAC_DEFAULT_LAYER,
-            color->red, color->green, color->blue, 0xFF);
+    guac_display_layer_raw_context* context = guac_display_layer_open_raw(default_layer);
+
+    guac_rect rect;
+    guac_rect_init(&rect, 0, 0, width, height);
+    guac_rect_constrain(&rect, &context->bounds);
+    guac_display_layer_raw_context_set(context, &rect,
+              0xFF000000
+            | (color->red   << 16)
+            | (color->green << 8)
+            |  color->blue);
+
+    guac_display_layer_close_raw(default_layer, context);
 
 }
 
@@ -366,9 +377,9 @@ void* guac_terminal_thread(void* data) {
         if (guac_terminal_render_frame(terminal))
             break;
 
-        /* Signal end of frame */
-        guac_client_end_frame(client);
-        guac_socket_flush(client->socket);
+        /* Signal end of frame (the frame is encoded and sent by the display
+         * render thread, which paces frames according to client lag) */
+        guac_display_render_thread_notify_frame(terminal->render_thread);
 
     }
 
@@ -547,9 +558,13 @@ guac_terminal* guac_terminal_create(guac_client* client,
     term->current_buffer = term->normal_buffer = guac_terminal_buffer_alloc(initial_scrollback, &default_char);
     term->alternate_buffer = guac_terminal_buffer_alloc(GUAC_TERMINAL_MAX_ROWS, &default_char);
 
+    /* Init graphical display, which will be shared by the terminal display,
+     * scrollbar, and mouse cursor */
+    term->graphical_display = guac_display_alloc(client);
+
     /* Init display */
     term->display = guac_terminal_display_alloc(client,
-            options->font_name, options->font_size, options->dpi,
+            term->graphical_display, options->font_name, options->font_size, options->dpi,
             &default_char.attributes.foreground,
             &default_char.attributes.background,
             (guac_terminal_color(*)[256]) default_palette);
@@ -557,13 +572,11 @@ guac_terminal* guac_terminal_create(guac_client* client,
     /* Fail if display init failed */
     if (term->display == NULL) {
         guac_client_log(client, GUAC_LOG_DEBUG, "Display initialization failed");
+        guac_display_free(term->graphical_display);
         guac_mem_free(term);
         return NULL;
     }
 
-    /* Init common cursor */
-    term->cursor = guac_common_cursor_alloc(client);
-
     /* Init terminal state */
     term->current_attributes = default_char.attributes;
     term->default_char = default_char;
@@ -614,12 +627,14 @@ guac_terminal* guac_terminal_create(guac_client* client,
     pthread_mutex_init(&(term->lock), NULL);
 
     /* Repaint and resize overall display */
-    guac_terminal_repaint_default_layer(term, term->client->socket);
+    guac_terminal_repaint_default_layer(term);
     guac_terminal_display_resize(term->display,
             term->term_width, term->term_height);
 
     /* Allocate scrollbar */
-    term->scrollbar = guac_terminal_scrollbar_alloc(term->client, GUAC_DEFAULT_LAYER,
+    term->scrollbar = guac_terminal_scrollbar_alloc(term->client,
+            term->graphical_display,
+            guac_display_default_layer(term->graphical_display),
             term->outer_width, term->outer_height, term->term_height);
 
     /* Associate scrollbar with this terminal */
@@ -640,7 +655,10 @@ guac_terminal* guac_terminal_create(guac_client* client,
 
     /* Initialize mouse cursor */
     term->current_cursor = GUAC_TERMINAL_CURSOR_BLANK;
-    guac_common_cursor_set_blank(term->cursor);
+    guac_display_set_cursor(term->graphical_display, GUAC_DISPLAY_CURSOR_NONE);
+
+    /* Start render thread for graphical display */
+    term->render_thread = guac_display_render_thread_create(term->graphical_display);
 
     /* Start terminal thread */
     if (pthread_create(&(term->thread), NULL,
@@ -696,6 +714,9 @@ void guac_terminal_free(guac_terminal* term) {
     /* Wait for render thread to finish */
     pthread_join(term->thread, NULL);
 
+    /* Stop rendering of further graphical display frames */
+    guac_display_render_thread_destroy(term->render_thread);
+
     /* Close and flush any open pipe stream */
     guac_terminal_pipe_stream_close(term);
 
@@ -707,6 +728,11 @@ void guac_terminal_free(guac_terminal* term) {
 
     /* Free display */
     guac_terminal_display_free(term->display);
+    guac_display_free(term->graphical_display);
+
+    guac_client_log(term->client, GUAC_LOG_DEBUG, "Terminal buffers "
+            "were using %zu bytes at the end of the session.",
+            guac_terminal_get_memory_usage(term));
 
     /* Free buffers */
     guac_terminal_buffer_free(term->normal_buffer);
@@ -996,7 +1022,10 @@ void guac_terminal_scroll_up(guac_terminal* term,
         /* Scroll up visibly */
         guac_terminal_display_copy_rows(term->display, start_row + amount, end_row, -amount);
 
-        /* Advance and increase buffer length by scroll amount */
+        /* Advance and increase buffer length by scroll amount, ensuring the
+         * buffer does not pack any rows that are currently visible */
+        guac_terminal_buffer_set_visible(term->current_buffer,
+                -term->scroll_offset, term->term_height);
         guac_terminal_buffer_scroll_up(term->current_buffer, amount, true);
 
         /* Reset scrollbar bounds */
@@ -1387,6 +1416,8 @@ static void __guac_terminal_resize(guac_terminal* term, int width, int height) {
                     shift_amount, term->display->height - 1, -shift_amount);
 
             /* Update buffer top and cursor row based on shift */
+            guac_terminal_buffer_set_visible(term->current_buffer,
+                    -term->scroll_offset, term->term_height);
             guac_terminal_buffer_scroll_up(term->current_buffer, shift_amount, false);
             term->cursor_row  -= shift_amount;
             if (term->visible_cursor_row != -1)
@@ -1484,9 +1515,6 @@ static void __guac_terminal_resize(guac_terminal* term, int width, int height) {
 
 int guac_terminal_resize(guac_terminal* terminal, int width, int height) {
 
-    guac_terminal_display* display = terminal->display;
-    guac_client* client = display->client;
-
     /* Acquire exclusive access to terminal */
     guac_terminal_lock(terminal);
 
@@ -1509,7 +1537,7 @@ int guac_terminal_resize(guac_terminal* terminal, int width, int height) {
     terminal->width = adjusted_width;
 
     /* Resize default layer to given pixel dimensions */
-    guac_terminal_repaint_default_layer(terminal, client->socket);
+    guac_terminal_repaint_default_layer(terminal);
 
     /* Resize terminal if row/column dimensions have changed */
     if (columns != terminal->term_width || rows != terminal->term_height) {
@@ -1544,7 +1572,7 @@ void guac_terminal_flush(guac_terminal* terminal) {
     if (terminal->pipe_stream_flags & GUAC_TERMINAL_PIPE_AUTOFLUSH)
         guac_terminal_pipe_stream_flush(terminal);
 
-    /* Flush display state */
+    /* Flush display state to the pending frame */
     guac_terminal_select_redraw(terminal);
     guac_terminal_commit_cursor(terminal);
     guac_terminal_display_flush(terminal->display);
@@ -1813,7 +1841,7 @@ static int __guac_terminal_send_key(guac_terminal* term, int keysym, int pressed
     /* Hide mouse cursor if not already hidden */
     if (term->current_cursor != GUAC_TERMINAL_CURSOR_BLANK) {
         term->current_cursor = GUAC_TERMINAL_CURSOR_BLANK;
-        guac_common_cursor_set_blank(term->cursor);
+        guac_display_set_cursor(term->graphical_display, GUAC_DISPLAY_CURSOR_NONE);
         guac_terminal_notify(term);
     }
 
@@ -2690,7 +2718,8 @@ static int __guac_terminal_send_mouse(guac_terminal* term, guac_user* user,
     int pressed_mask  = ~term->mouse_mask &  mask;
 
     /* Store current mouse location/state */
-    guac_common_cursor_update(term->cursor, user, x, y, mask);
+    guac_display_render_thread_notify_user_moved_mouse(term->render_thread,
+            user, x, y, mask);
 
     /* Notify scrollbar, do not handle anything handled by scrollbar */
     if (guac_terminal_scrollbar_handle_mouse(term->scrollbar, x, y, mask)) {
@@ -2698,7 +2727,7 @@ static int __guac_terminal_send_mouse(guac_terminal* term, guac_user* user,
         /* Set pointer cursor if mouse is over scrollbar */
         if (term->current_cursor != GUAC_TERMINAL_CURSOR_POINTER) {
             term->current_cursor = GUAC_TERMINAL_CURSOR_POINTER;
-            guac_common_cursor_set_pointer(term->cursor);
+            guac_display_set_cursor(term->graphical_display, GUAC_DISPLAY_CURSOR_POINTER);
             guac_terminal_notify(term);
         }
 
@@ -2716,7 +2745,7 @@ static int __guac_terminal_send_mouse(guac_terminal* term, guac_user* user,
     /* Show mouse cursor if not already shown */
     if (term->current_cursor != GUAC_TERMINAL_CURSOR_IBAR) {
         term->current_cursor = GUAC_TERMINAL_CURSOR_IBAR;
-        guac_common_cursor_set_ibar(term->cursor);
+        guac_display_set_cursor(term->graphical_display, GUAC_DISPLAY_CURSOR_IBAR);
         guac_terminal_notify(term);
     }
 
@@ -3051,15 +3080,9 @@ int guac_terminal_create_typescript(guac_terminal* term, const char* path,
 static void __guac_terminal_sync_socket(
         guac_client* client, guac_terminal* term, guac_socket* socket) {
 
-    /* Synchronize display state with new user */
-    guac_terminal_repaint_default_layer(term, socket);
-    guac_terminal_display_dup(term->display, client, socket);
-
-    /* Synchronize mouse cursor */
-    guac_common_cursor_dup(term->cursor, client, socket);
-
-    /* Paint scrollbar for joining users */
-    guac_terminal_scrollbar_dup(term->scrollbar, client, socket);
+    /* Synchronize all graphical state (terminal display, background,
+     * scrollbar, and mouse cursor) with new users */
+    guac_display_dup(term->graphical_display, socket);
 
 }
 
@@ -3178,6 +3201,7 @@ int guac_terminal_get_mod_ctrl(guac_terminal* terminal) {
 
 void guac_terminal_clipboard_reset(guac_terminal* terminal,
         const char* mimetype) {
+    guac_common_clipboard_invalidate(terminal->clipboard);
     guac_common_clipboard_reset(terminal->clipboard, mimetype);
 }
 
@@ -3198,16 +3222,20 @@ void guac_terminal_clipboard_append(guac_terminal* terminal,
     guac_mem_free(output_data);
 }
 
+void guac_terminal_clipboard_invalidate(guac_terminal* terminal) {
+    guac_common_clipboard_invalidate(terminal->clipboard);
+}
+
 void guac_terminal_remove_user(guac_terminal* terminal, guac_user* user) {
 
     /* Remove the user from the terminal cursor */
-    guac_common_cursor_remove_user(terminal->cursor, user);
+    guac_display_notify_user_left(terminal->graphical_display, user);
 }
 
 void guac_terminal_redraw_default_layer(guac_terminal* terminal) {
 
     /* Redraw terminal text and background */
-    guac_terminal_repaint_default_layer(terminal, terminal->client->socket);
+    guac_terminal_repaint_default_layer(terminal);
     __guac_terminal_redraw_rect(terminal, 0, 0,
             terminal->term_height - 1,
             terminal->term_width - 1);
@@ -35,10 +35,14 @@
 
 #include "types.h"
 
+#include <stddef.h>
+
 /**
  * A buffer containing a constant number of arbitrary-length rows.
  * New rows can be appended to the buffer, with the oldest row replaced with
- * the new row.
+ * the new row. Rows that scroll far enough into the scrollback region are
+ * stored internally in a compact, packed form (and possibly compressed), and
+ * are transparently restored when next accessed.
  */
 typedef struct guac_terminal_buffer guac_terminal_buffer;
 
@@ -65,6 +69,38 @@ void guac_terminal_buffer_free(guac_terminal_buffer* buffer);
  */
 void guac_terminal_buffer_reset(guac_terminal_buffer* buffer);
 
+/**
+ * Returns the approximate amount of memory currently used by the given
+ * buffer, including all stored rows, in bytes.
+ *
+ * @param buffer
+ *     The buffer whose memory usage should be determined.
+ *
+ * @return
+ *     The approximate number of bytes of memory currently allocated for the
+ *     given buffer.
+ */
+size_t guac_terminal_buffer_get_memory_usage(guac_terminal_buffer* buffer);
+
+/**
+ * Informs the given buffer of the rows currently shown by the terminal
+ * display. Rows within the terminal display, as well as any rows of
+ * scrollback currently visible, are never packed.
+ *
+ * @param buffer
+ *     The buffer to update.
+ *
+ * @param top
+ *     The index of the first row currently shown by the terminal display,
+ *     relative to the top of the display. This will be negative if the
+ *     terminal has been scrolled to view part of the scrollback buffer.
+ *
+ * @param rows
+ *     The number of rows within the terminal display.
+ */
+void guac_terminal_buffer_set_visible(guac_terminal_buffer* buffer, int top,
+        int rows);
+
 /**
  * Copies the given range of columns to a new location, offset from
  * the original by the given number of columns.
@@ -122,19 +158,27 @@ void guac_terminal_buffer_set_columns(guac_terminal_buffer* buffer, int row,
         int start_column, int end_column, guac_terminal_char* character);
 
 /**
- * Get the char (int ASCII code) at a specific row/col of the display.
+ * Retrieves the characters of the given row of the buffer. The returned
+ * array of characters remains valid only until the buffer is next scrolled,
+ * as scrolling may result in rows being packed into a more compact form.
  *
- * @param terminal
- *     The terminal on which we want to read a character.
+ * @param buffer
+ *     The buffer containing the row.
+ *
+ * @param characters
+ *     A pointer to the pointer that should receive the array of characters
+ *     within the row, or NULL if the characters are not needed.
+ *
+ * @param is_wrapped
+ *     A pointer to the bool that should receive whether the row was
+ *     automatically wrapped, or NULL if this is not needed.
  *
  * @param row
- *     The row where to read the character.
- * 
- * @param col
- *     The column where to read the character.
- * 
+ *     The index of the row to retrieve, where negative indices represent rows
+ *     within the scrollback buffer.
+ *
  * @return
- *     The ASCII code of the character at the given row/col.
+ *     The length of the row, in characters, or zero if there is no such row.
  */
 unsigned int guac_terminal_buffer_get_columns(guac_terminal_buffer* buffer,
         guac_terminal_char** characters, bool* is_wrapped, int row);
@@ -26,12 +26,11 @@
  * @file display.h
  */
 
-#include "common/surface.h"
 #include "palette.h"
 #include "types.h"
 
 #include <guacamole/client.h>
-#include <guacamole/layer.h>
+#include <guacamole/display.h>
 #include <pango/pangocairo.h>
 
 #include <stdbool.h>
@@ -53,6 +52,13 @@
  */
 #define GUAC_TERMINAL_MM_PER_INCH 25.4
 
+/**
+ * The color of the highlight drawn over selected text, as a 32-bit ARGB value
+ * with premultiplied alpha. This is a translucent blue (0x0080FF at an alpha
+ * of 0x60).
+ */
+#define GUAC_TERMINAL_SELECTION_COLOR 0x60003060
+
 /**
  * All available terminal operations which affect character cells.
  */
@@ -186,19 +192,20 @@ typedef struct guac_terminal_display {
     guac_terminal_color glyph_background;
 
     /**
-     * The surface containing the actual terminal.
+     * The guac_display that all terminal contents are rendered to. Frames
+     * of this display are encoded and sent by its own worker threads.
      */
-    guac_common_surface* display_surface;
+    guac_display* graphical_display;
 
     /**
      * Layer which contains the actual terminal.
      */
-    guac_layer* display_layer;
+    guac_display_layer* display_layer;
 
     /**
      * Sub-layer of display layer which highlights selected text.
      */
-    guac_layer* select_layer;
+    guac_display_layer* select_layer;
 
     /**
      * Whether text is currently selected.
@@ -235,9 +242,11 @@ typedef struct guac_terminal_display {
 
 /**
  * Allocates a new display having the given default foreground and background
- * colors.
+ * colors. All terminal contents will be rendered to new layers allocated
+ * from the given guac_display.
  */
 guac_terminal_display* guac_terminal_display_alloc(guac_client* client,
+        guac_display* graphical_display,
         const char* font_name, int font_size, int dpi,
         guac_terminal_color* foreground, guac_terminal_color* background,
         guac_terminal_color (*palette)[256]);
@@ -331,33 +340,15 @@ void guac_terminal_display_resize(guac_terminal_display* display, int width, int
 void guac_terminal_display_flush_operations(guac_terminal_display* display);
 
 /**
- * Flushes all pending operations within the given guac_terminal_display,
- * then flushes the display surface.
+ * Flushes all pending operations within the given guac_terminal_display to
+ * the pending frame of its guac_display. The changes will be sent to
+ * connected users when that frame ends.
  *
  * @param display
  *     The terminal display to flush.
  */
 void guac_terminal_display_flush(guac_terminal_display* display);
 
-/**
- * Initializes and syncs the current terminal display state for all joining
- * users associated with the provided socket, sending the necessary instructions
- * to completely recreate and redraw the terminal rendering over the given
- * socket.
- *
- * @param display
- *     The terminal display to sync to the users associated with the provided
- *     socket.
- *
- * @param client
- *     The client whose users are joining.
- *
- * @param socket
- *     The socket over which any necessary instructions should be sent.
- */
-void guac_terminal_display_dup(
-        guac_terminal_display* display, guac_client* client, guac_socket* socket);
-
 /**
  * Draws the text selection rectangle from the given coordinates to the given end coordinates.
  *
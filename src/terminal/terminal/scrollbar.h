@@ -27,7 +27,9 @@
  */
 
 #include <guacamole/client.h>
-#include <guacamole/layer.h>
+#include <guacamole/display.h>
+
+#include <stdint.h>
 
 /**
  * The width of the scrollbar, in pixels.
@@ -45,6 +47,20 @@
  */
 #define GUAC_TERMINAL_SCROLLBAR_MIN_HEIGHT 64
 
+/**
+ * The color of the scrollbar container, as a 32-bit ARGB value with
+ * premultiplied alpha. This is a translucent gray (0x808080 at an alpha of
+ * 0x40).
+ */
+#define GUAC_TERMINAL_SCROLLBAR_CONTAINER_COLOR 0x40202020
+
+/**
+ * The color of the draggable scrollbar handle, as a 32-bit ARGB value with
+ * premultiplied alpha. This is a translucent light gray (0xA0A0A0 at an alpha
+ * of 0x8F).
+ */
+#define GUAC_TERMINAL_SCROLLBAR_HANDLE_COLOR 0x8F595959
+
 /**
  * The state of all scrollbar components, describing all variable aspects of
  * the scrollbar's appearance.
@@ -121,7 +137,7 @@ struct guac_terminal_scrollbar {
     /**
      * The layer containing the scrollbar.
      */
-    const guac_layer* parent;
+    const guac_display_layer* parent;
 
     /**
      * The width of the parent layer, in pixels.
@@ -136,13 +152,13 @@ struct guac_terminal_scrollbar {
     /**
      * The scrollbar itself.
      */
-    guac_layer* container;
+    guac_display_layer* container;
 
     /**
      * The draggable handle within the scrollbar, representing the current
      * scroll value.
      */
-    guac_layer* handle;
+    guac_display_layer* handle;
 
     /**
      * The minimum scroll value.
@@ -206,12 +222,17 @@ struct guac_terminal_scrollbar {
  * position of the scrollbar. Currently, the scrollbar is always anchored to
  * the right edge of the parent layer.
  *
- * This will cause instructions to be written to the client's socket, but the
- * client's socket will not be automatically flushed.
+ * The layers of the scrollbar are allocated from the given guac_display, and
+ * all changes to the scrollbar will be sent to connected users as part of the
+ * frames of that display.
  *
  * @param client
  *     The client to associate with the new scrollbar.
  *
+ * @param graphical_display
+ *     The guac_display from which the layers of the scrollbar should be
+ *     allocated.
+ *
  * @param parent
  *     The layer which will contain the newly-allocated scrollbar.
  *
@@ -230,8 +251,8 @@ struct guac_terminal_scrollbar {
  *     A newly allocated scrollbar.
  */
 guac_terminal_scrollbar* guac_terminal_scrollbar_alloc(guac_client* client,
-        const guac_layer* parent, int parent_width, int parent_height,
-        int visible_area);
+        guac_display* graphical_display, const guac_display_layer* parent,
+        int parent_width, int parent_height, int visible_area);
 
 /**
  * Frees the given scrollbar.
@@ -242,35 +263,15 @@ guac_terminal_scrollbar* guac_terminal_scrollbar_alloc(guac_client* client,
 void guac_terminal_scrollbar_free(guac_terminal_scrollbar* scrollbar);
 
 /**
- * Flushes the render state of the given scrollbar, updating the remote display
- * accordingly.
- *
- * This may cause instructions to be written to the client's socket, but the
- * client's socket will not be automatically flushed.
+ * Flushes the render state of the given scrollbar to the pending frame of the
+ * guac_display containing its layers, updating the remote display
+ * accordingly once that frame ends.
  *
  * @param scrollbar
  *     The scrollbar whose render state is to be flushed.
  */
 void guac_terminal_scrollbar_flush(guac_terminal_scrollbar* scrollbar);
 
-/**
- * Forces a complete redraw / resync of scrollbar state for all joining users
- * associated with the provided socket, sending the necessary instructions to
- * completely recreate and redraw the scrollbar rendering over the given
- * socket.
- *
- * @param scrollbar
- *     The scrollbar to sync to the given users.
- *
- * @param client
- *     The client associated with the joining users.
- *
- * @param socket
- *     The socket over which any necessary instructions should be sent.
- */
-void guac_terminal_scrollbar_dup(guac_terminal_scrollbar* scrollbar,
-        guac_client* client, guac_socket* socket);
-
 /**
  * Sets the minimum and maximum allowed scroll values of the given scrollbar
  * to the given values. If necessary, the current value of the scrollbar will
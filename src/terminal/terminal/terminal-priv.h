@@ -21,7 +21,6 @@
 #define GUAC_TERMINAL_PRIV_H
 
 #include "common/clipboard.h"
-#include "common/cursor.h"
 #include "buffer.h"
 #include "display.h"
 #include "scrollbar.h"
@@ -29,6 +28,7 @@
 #include "typescript.h"
 #include "selection-point.h"
 
+#include <guacamole/display.h>
 #include <guacamole/flag.h>
 
 /**
@@ -75,6 +75,19 @@ struct guac_terminal {
      */
     pthread_t thread;
 
+    /**
+     * The guac_display that all graphical terminal state (the terminal
+     * display, scrollbar, background, and mouse cursor) is rendered to.
+     */
+    guac_display* graphical_display;
+
+    /**
+     * The render thread responsible for ending frames of graphical_display
+     * and handing them to its encoder threads, pacing those frames according
+     * to client-side processing lag.
+     */
+    guac_display_render_thread* render_thread;
+
     /**
      * Called whenever the necessary terminal codes are sent to change
      * the path for future file uploads.
@@ -152,11 +165,6 @@ struct guac_terminal {
      */
     guac_terminal_typescript* typescript;
 
-    /**
-     * Terminal-wide mouse cursor, synchronized across all users.
-     */
-    guac_common_cursor* cursor;
-
     /**
      * Graphical representation of the current scroll state.
      */
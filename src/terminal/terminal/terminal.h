@@ -29,6 +29,7 @@
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include <guacamole/client.h>
 #include <guacamole/stream.h>
@@ -1163,6 +1164,19 @@ int guac_terminal_get_rows(guac_terminal* term);
  */
 int guac_terminal_get_columns(guac_terminal* term);
 
+/**
+ * Returns the approximate amount of memory currently used to store the
+ * contents of the given terminal, including its scrollback buffer, in bytes.
+ *
+ * @param term
+ *     The terminal whose memory usage should be determined.
+ *
+ * @return
+ *     The approximate number of bytes of memory currently used to store the
+ *     contents of the given terminal.
+ */
+size_t guac_terminal_get_memory_usage(guac_terminal* term);
+
 /**
  * Clears the clipboard contents for a given terminal, and assigns a new
  * mimetype for future data.
@@ -1190,6 +1204,18 @@ void guac_terminal_clipboard_reset(guac_terminal* terminal,
 void guac_terminal_clipboard_append(guac_terminal* terminal,
         const char* data, int length);
 
+/**
+ * Marks the clipboard contents most recently broadcast by the given terminal
+ * as no longer being held by all connected users, such that the next
+ * broadcast of the clipboard reaches all users even if its contents are
+ * unchanged. This function must be called whenever a user joins a terminal
+ * connection.
+ *
+ * @param terminal
+ *      The terminal whose clipboard is being invalidated.
+ */
+void guac_terminal_clipboard_invalidate(guac_terminal* terminal);
+
 /**
  * Removes the given user from any user-specific resources internal to the
  * given terminal. This function must be called whenever a user leaves a
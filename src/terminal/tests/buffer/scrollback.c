@@ -0,0 +1,219 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "terminal/buffer.h"
+#include "terminal/palette.h"
+#include "terminal/terminal.h"
+#include "terminal/types.h"
+
+#include <CUnit/CUnit.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * The number of rows of scrollback to allocate for each test buffer.
+ */
+#define TEST_SCROLLBACK_ROWS 20000
+
+/**
+ * The number of rows to write to each test buffer. This is intentionally
+ * larger than TEST_SCROLLBACK_ROWS such that the ring buffer wraps.
+ */
+#define TEST_WRITTEN_ROWS 50000
+
+/**
+ * The row of the terminal display that each line is written to before the
+ * buffer is scrolled.
+ */
+#define TEST_WRITE_ROW 23
+
+/**
+ * The character that is assigned to newly-allocated cells of each test
+ * buffer.
+ */
+static const guac_terminal_char test_default_char = {
+    .value = 0,
+    .attributes = {
+        .foreground = { .palette_index = GUAC_TERMINAL_COLOR_FOREGROUND },
+        .background = { .palette_index = GUAC_TERMINAL_COLOR_BACKGROUND }
+    },
+    .width = 1
+};
+
+/**
+ * Returns the number of columns written for the given line.
+ *
+ * @param line
+ *     The index of the line written.
+ *
+ * @return
+ *     The number of columns of content written for that line.
+ */
+static int test_line_length(int line) {
+    return 40 + line % 30;
+}
+
+/**
+ * Returns the character expected at the given column of the given line.
+ *
+ * @param line
+ *     The index of the line written.
+ *
+ * @param column
+ *     The column of the character within the line.
+ *
+ * @return
+ *     The character expected at the given location.
+ */
+static guac_terminal_char test_line_char(int line, int column) {
+
+    guac_terminal_char character = test_default_char;
+    character.value = 'a' + (line + column) % 26;
+    character.attributes.bold = (column % 5 == 0);
+    character.attributes.foreground.palette_index = (line / 7) % 16;
+
+    return character;
+
+}
+
+/**
+ * Writes TEST_WRITTEN_ROWS lines of varying content and attributes to the
+ * given buffer, scrolling the buffer after each line as the terminal would.
+ *
+ * @param buffer
+ *     The buffer to write to.
+ */
+static void test_write_lines(guac_terminal_buffer* buffer) {
+
+    for (int line = 0; line < TEST_WRITTEN_ROWS; line++) {
+
+        guac_terminal_char blank = test_default_char;
+        guac_terminal_buffer_set_columns(buffer, TEST_WRITE_ROW, 0, 127, &blank);
+
+        for (int column = 0; column < test_line_length(line); column++) {
+            guac_terminal_char character = test_line_char(line, column);
+            guac_terminal_buffer_set_columns(buffer, TEST_WRITE_ROW,
+                    column, column, &character);
+        }
+
+        guac_terminal_buffer_set_wrapped(buffer, TEST_WRITE_ROW, line % 3 == 0);
+        guac_terminal_buffer_scroll_up(buffer, 1, true);
+
+    }
+
+}
+
+/**
+ * Verifies that rows which have scrolled far into the scrollback buffer (and
+ * thus have been packed) retain their contents, attributes, and wrapped state
+ * when later read back.
+ */
+void test_buffer__scrollback_contents(void) {
+
+    guac_terminal_buffer* buffer = guac_terminal_buffer_alloc(
+            TEST_SCROLLBACK_ROWS, &test_default_char);
+
+    test_write_lines(buffer);
+
+    /* The most recently written line is now immediately above the row it
+     * was written to */
+    for (int offset = 1; offset < TEST_SCROLLBACK_ROWS - TEST_WRITE_ROW; offset++) {
+
+        int line = TEST_WRITTEN_ROWS - offset;
+
+        guac_terminal_char* characters;
+        bool is_wrapped;
+        int length = guac_terminal_buffer_get_columns(buffer, &characters,
+                &is_wrapped, TEST_WRITE_ROW - offset);
+
+        CU_ASSERT_FATAL(length > test_line_length(line));
+        CU_ASSERT_EQUAL(is_wrapped, line % 3 == 0);
+
+        for (int column = 0; column < test_line_length(line); column++) {
+            guac_terminal_char expected = test_line_char(line, column);
+            CU_ASSERT_EQUAL_FATAL(characters[column].value, expected.value);
+            CU_ASSERT_EQUAL_FATAL(characters[column].width, expected.width);
+            CU_ASSERT_EQUAL_FATAL(characters[column].attributes.bold,
+                    expected.attributes.bold);
+            CU_ASSERT_EQUAL_FATAL(characters[column].attributes.foreground.palette_index,
+                    expected.attributes.foreground.palette_index);
+        }
+
+        CU_ASSERT_EQUAL(characters[test_line_length(line)].value, 0);
+
+    }
+
+    guac_terminal_buffer_free(buffer);
+
+}
+
+/**
+ * Verifies that the memory used by a buffer with a large amount of scrollback
+ * is substantially less than would be required to store each row in its
+ * expanded form, and that rows expanded to be read are eventually packed
+ * again as the buffer continues to scroll.
+ */
+void test_buffer__scrollback_memory(void) {
+
+    guac_terminal_buffer* buffer = guac_terminal_buffer_alloc(
+            TEST_SCROLLBACK_ROWS, &test_default_char);
+
+    size_t expanded_size = sizeof(guac_terminal_char) * 256 * TEST_SCROLLBACK_ROWS;
+
+    test_write_lines(buffer);
+    size_t packed_size = guac_terminal_buffer_get_memory_usage(buffer);
+    CU_ASSERT(packed_size < expanded_size / 4);
+
+    /* Reading all scrollback requires expanding all rows */
+    for (int row = 0; row > -TEST_SCROLLBACK_ROWS; row--)
+        guac_terminal_buffer_get_columns(buffer, NULL, NULL, row);
+
+    CU_ASSERT(guac_terminal_buffer_get_memory_usage(buffer) > packed_size);
+
+    /* Continued scrolling should eventually repack everything that was
+     * expanded */
+    for (int i = 0; i < TEST_SCROLLBACK_ROWS; i++)
+        guac_terminal_buffer_scroll_up(buffer, 1, true);
+
+    CU_ASSERT(guac_terminal_buffer_get_memory_usage(buffer) < expanded_size / 4);
+
+    guac_terminal_buffer_free(buffer);
+
+}
+
+/**
+ * Verifies that scrollback is packed even if the buffer is no larger than the
+ * maximum height of the terminal display, as is the case for the default
+ * amount of scrollback, so long as the terminal display itself is smaller.
+ */
+void test_buffer__scrollback_default_size(void) {
+
+    guac_terminal_buffer* buffer = guac_terminal_buffer_alloc(
+            GUAC_TERMINAL_MAX_ROWS, &test_default_char);
+
+    guac_terminal_buffer_set_visible(buffer, 0, TEST_WRITE_ROW + 1);
+
+    size_t expanded_size = sizeof(guac_terminal_char) * 256 * GUAC_TERMINAL_MAX_ROWS;
+
+    test_write_lines(buffer);
+    CU_ASSERT(guac_terminal_buffer_get_memory_usage(buffer) < expanded_size / 2);
+
+    guac_terminal_buffer_free(buffer);
+
+}